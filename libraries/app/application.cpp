@@ -6,6 +6,7 @@
 #include <graphene/chain/db_with.hpp>
 #include <graphene/chain/genesis_state.hpp>
 #include <graphene/protocol/fee_schedule.hpp>
+#include <graphene/protocol/signature_cache.hpp>
 #include <graphene/protocol/types.hpp>
 
 #include <graphene/egenesis/egenesis.hpp>
@@ -500,6 +501,49 @@ void application_impl::open_chain_database() const
       _chain_db->enable_standby_votes_tracking( _options->at("enable-standby-votes-tracking").as<bool>() );
    }
 
+   if( _options->count("replay-pipeline-depth") > 0 )
+      _chain_db->set_replay_pipeline_depth( _options->at("replay-pipeline-depth").as<uint32_t>() );
+
+   if( _options->count("incremental-object-flush") > 0 )
+      _chain_db->set_incremental_flush( _options->at("incremental-object-flush").as<bool>() );
+
+   if( _options->count("parallel-authority-check") > 0 )
+      _chain_db->enable_parallel_authority_check( _options->at("parallel-authority-check").as<bool>() );
+
+   if( _options->count("parallel-vote-tally") > 0 )
+      _chain_db->enable_parallel_vote_tally( _options->at("parallel-vote-tally").as<bool>() );
+
+   if( _options->count("incremental-vote-tally") > 0 )
+      _chain_db->enable_incremental_vote_tally( _options->at("incremental-vote-tally").as<bool>(),
+            _options->count("check-incremental-vote-tally") > 0
+            && _options->at("check-incremental-vote-tally").as<bool>() );
+
+   if( _options->count("mempool-max-size-mb") > 0 || _options->count("mempool-max-transactions-per-account") > 0 )
+   {
+      const size_t max_size_mb = _options->count("mempool-max-size-mb") > 0 ?
+                                 _options->at("mempool-max-size-mb").as<uint32_t>() : 0;
+      const uint32_t max_per_account = _options->count("mempool-max-transactions-per-account") > 0 ?
+                                       _options->at("mempool-max-transactions-per-account").as<uint32_t>() : 0;
+      _chain_db->set_mempool_limits( max_size_mb * 1024 * 1024, max_per_account );
+   }
+
+   if( _options->count("read-snapshots") > 0 )
+      _chain_db->enable_read_snapshots( _options->at("read-snapshots").as<bool>() );
+
+   if( _options->count("signature-cache-size") > 0 )
+      graphene::protocol::signature_cache::instance().set_capacity(
+            _options->at("signature-cache-size").as<uint32_t>() );
+
+   if( _options->count("block-storage") > 0 )
+   {
+      const std::string mode = _options->at("block-storage").as<std::string>();
+      FC_ASSERT( mode == "stream" || mode == "mmap" || mode == "compressed",
+                 "Unknown block storage mode ${m}", ("m", mode) );
+      _chain_db->set_block_storage_mode( mode == "mmap" ? chain::block_database::storage_mode::mapped
+                                       : mode == "compressed" ? chain::block_database::storage_mode::compressed
+                                       : chain::block_database::storage_mode::streams );
+   }
+
    if( _options->count("replay-blockchain") > 0 || _options->count("revalidate-blockchain") > 0 )
       _chain_db->wipe( _data_dir / "blockchain", false );
 
@@ -648,13 +692,49 @@ bool application_impl::handle_block(const graphene::net::block_message& blk_msg,
          // happens, there's no reason to fetch the transactions, so  construct a list of the
          // transaction message ids we no longer need.
          // during sync, it is unlikely that we'll see any old
-         contained_transaction_msg_ids.reserve( contained_transaction_msg_ids.size()
-                                                    + blk_msg.block.transactions.size() );
-         for (const processed_transaction& ptrx : blk_msg.block.transactions)
+         const auto& transactions = blk_msg.block.transactions;
+         std::vector<graphene::net::message_hash_type> message_ids( transactions.size() );
+         std::vector<size_t> unknown;
+         auto& by_id = _relayed_transactions.get<by_trx_id>();
+         for( size_t i = 0; i < transactions.size(); ++i )
+         {
+            auto itr = by_id.find( transactions[i].id() );
+            if( itr == by_id.end() )
+               unknown.push_back( i );
+            else
+            {
+               message_ids[i] = itr->message_id;
+               by_id.erase( itr );
+            }
+         }
+         auto& by_exp = _relayed_transactions.get<by_expiration>();
+         by_exp.erase( by_exp.begin(), by_exp.lower_bound( blk_msg.block.timestamp ) );
+
+         // the rest of the ids are computed the way the network would, by packing and hashing a trx_message
+         if( !unknown.empty() )
          {
-            graphene::net::trx_message transaction_message(ptrx);
-            contained_transaction_msg_ids.emplace_back(graphene::net::message(transaction_message).id());
+            const size_t chunks = std::min<size_t>( fc::asio::default_io_service_scope::get_num_threads(),
+                                                    unknown.size() );
+            const size_t chunk_size = ( unknown.size() + chunks - 1 ) / chunks;
+            std::vector<fc::future<void>> workers;
+            workers.reserve( chunks );
+            for( size_t base = 0; base < unknown.size(); base += chunk_size )
+            {
+               const size_t end = std::min( base + chunk_size, unknown.size() );
+               workers.push_back( fc::do_parallel( [&transactions,&unknown,&message_ids,base,end] () {
+                  for( size_t i = base; i < end; ++i )
+                  {
+                     graphene::net::trx_message transaction_message( transactions[unknown[i]] );
+                     message_ids[unknown[i]] = graphene::net::message( transaction_message ).id();
+                  }
+               }) );
+            }
+            for( auto& worker : workers )
+               worker.wait();
          }
+
+         contained_transaction_msg_ids.insert( contained_transaction_msg_ids.end(),
+                                               message_ids.begin(), message_ids.end() );
       }
 
       return result;
@@ -676,7 +756,8 @@ bool application_impl::handle_block(const graphene::net::block_message& blk_msg,
    }
 } FC_CAPTURE_AND_RETHROW( (blk_msg)(sync_mode) ) return false; } // GCOVR_EXCL_LINE
 
-void application_impl::handle_transaction(const graphene::net::trx_message& transaction_message)
+void application_impl::handle_transaction(const graphene::net::trx_message& transaction_message,
+                                          const graphene::net::message_hash_type& transaction_message_id)
 { try {
    static fc::time_point last_call;
    static int trx_count = 0;
@@ -688,9 +769,55 @@ void application_impl::handle_transaction(const graphene::net::trx_message& tran
       trx_count = 0;
    }
 
-   _chain_db->precompute_parallel( transaction_message.trx ).wait();
-   _chain_db->push_transaction( transaction_message.trx );
-} FC_CAPTURE_AND_RETHROW( (transaction_message) ) } // GCOVR_EXCL_LINE
+   if( _transactions_in_admission >= max_transactions_in_admission )
+      FC_THROW_EXCEPTION( graphene::net::transaction_queue_full_exception,
+                          "${n} transactions are waiting to be validated already", ("n", _transactions_in_admission) );
+   ++_transactions_in_admission;
+   struct admission_slot
+   {
+      uint32_t& count;
+      ~admission_slot() { --count; }
+   } slot { _transactions_in_admission };
+
+   // validate(), the size and the signatures don't depend on the state, check them on the io threads
+   const uint32_t max_transaction_size = _chain_db->get_global_properties().parameters.maximum_transaction_size;
+   admitted_transaction admitted { transaction_message.trx, transaction_message_id,
+                                   fc::promise<void>::create( "graphene::app::push_admitted_transaction" ) };
+   _chain_db->precompute_parallel( admitted.trx ).wait();
+   FC_ASSERT( admitted.trx.get_packed_size() <= max_transaction_size, "Transaction is too large" );
+
+   fc::future<void> pushed( admitted.pushed );
+   _admitted_transactions.push_back( std::move( admitted ) );
+   if( !_push_admitted_transactions_done.valid() || _push_admitted_transactions_done.ready() )
+      _push_admitted_transactions_done = fc::async( [this] () { push_admitted_transactions(); },
+                                                    "push_admitted_transactions" );
+   pushed.wait();
+} FC_CAPTURE_AND_RETHROW( (transaction_message)(transaction_message_id) ) } // GCOVR_EXCL_LINE
+
+void application_impl::push_admitted_transactions()
+{
+   // this runs as a task of its own, so the transactions of all peers checked meanwhile are pushed in one go
+   while( !_admitted_transactions.empty() )
+   {
+      const size_t chunk = std::min( _admitted_transactions.size(), transaction_push_chunk_size );
+      for( size_t i = 0; i < chunk; ++i )
+      {
+         admitted_transaction& admitted = _admitted_transactions.front();
+         try
+         {
+            _chain_db->push_transaction( admitted.trx );
+            _relayed_transactions.insert( { admitted.trx.id(), admitted.message_id, admitted.trx.expiration } );
+            admitted.pushed->set_value();
+         }
+         catch( const fc::exception& e )
+         {
+            admitted.pushed->set_exception( e.dynamic_copy_exception() );
+         }
+         _admitted_transactions.pop_front();
+      }
+      fc::yield();
+   }
+}
 
 void application_impl::handle_message(const message& message_to_process)
 {
@@ -1044,6 +1171,12 @@ void application_impl::shutdown()
    else
       ilog( "P2P network is disabled" );
 
+   if( _push_admitted_transactions_done.valid() && !_push_admitted_transactions_done.ready() )
+   {
+      ilog( "Waiting for transactions from the network to be pushed" );
+      _push_admitted_transactions_done.wait();
+   }
+
    if( _chain_db )
    {
       ilog( "Closing chain database" );
@@ -1172,6 +1305,39 @@ void application::set_program_options(boost::program_options::options_descriptio
          ("enable-standby-votes-tracking", bpo::value<bool>()->implicit_value(true),
           "Whether to enable tracking of votes of standby validators and delegates. "
           "Set it to true to provide accurate data to API clients, set to false for slightly better performance.")
+         ("replay-pipeline-depth", bpo::value<uint32_t>(),
+          "Number of blocks read, decoded and precomputed ahead of the one being applied during a replay, "
+          "default to 1000")
+         ("incremental-object-flush", bpo::value<bool>()->implicit_value(true),
+          "Whether to only write the object database indexes that changed since the last flush")
+         ("parallel-authority-check", bpo::value<bool>()->implicit_value(true),
+          "Whether to verify the authorities of the transactions of a received block on several threads before "
+          "it is applied, default to false (verify them while applying the block)")
+         ("parallel-vote-tally", bpo::value<bool>()->implicit_value(true),
+          "Whether to add up the votes of all accounts on several threads during chain maintenance, "
+          "default to false")
+         ("incremental-vote-tally", bpo::value<bool>()->implicit_value(true),
+          "Whether to keep running totals of the votes, so that chain maintenance only walks the accounts that "
+          "changed since the previous maintenance interval, default to false")
+         ("check-incremental-vote-tally", bpo::value<bool>()->implicit_value(true),
+          "Whether chain maintenance still recounts all votes when incremental-vote-tally is enabled, and logs "
+          "an error if the running totals differ from the recount, default to false")
+         ("mempool-max-size-mb", bpo::value<uint32_t>(),
+          "Maximum size in megabytes of the pending transactions kept, when it is reached a transaction is only "
+          "accepted if it pays a higher fee per kilobyte than the lowest ones, which are evicted, "
+          "default to 0 (no limit)")
+         ("mempool-max-transactions-per-account", bpo::value<uint32_t>(),
+          "Maximum number of pending transactions paid for by the same account, default to 0 (no limit)")
+         ("read-snapshots", bpo::value<bool>()->implicit_value(true),
+          "Whether to serve get_objects, get_limit_orders and get_order_book from a copy of the state at the head "
+          "block on the io thread pool, instead of from the live state on the thread that applies blocks")
+         ("signature-cache-size", bpo::value<uint32_t>(),
+          "Number of public keys recovered from transaction signatures to keep for when the same transactions are "
+          "seen again, e.g. in a block, default to 100000, 0 to disable")
+         ("block-storage", bpo::value<string>(),
+          "How the block database is accessed: \"stream\" (default), \"mmap\" to memory map it, which lets API "
+          "threads read blocks without locking, or \"compressed\" to keep blocks in compressed chunks. "
+          "Use block_converter to switch an existing database between stream and compressed")
          ("api-limit-get-account-history-operations",
           bpo::value<uint32_t>()->default_value(default_opts.api_limit_get_account_history_operations),
           "For history_api::get_account_history_operations to set max limit value")
@@ -7,8 +7,16 @@
 #include <graphene/app/api_access.hpp>
 #include <graphene/chain/genesis_state.hpp>
 #include <graphene/protocol/types.hpp>
+#include <graphene/net/config.hpp>
 #include <graphene/net/message.hpp>
 
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+
+#include <deque>
+
 namespace graphene { namespace app { namespace detail {
 
 
@@ -65,7 +73,16 @@ class application_impl : public net::node_delegate, public std::enable_shared_fr
       bool handle_block(const graphene::net::block_message& blk_msg, bool sync_mode,
                         std::vector<graphene::net::message_hash_type>& contained_transaction_msg_ids) override;
 
-      void handle_transaction(const graphene::net::trx_message& transaction_message) override;
+      /**
+       * @brief validates a transaction from the network and pushes it to the pending state
+       *
+       * The checks that need no chain state are run on the io threads, then the transaction waits in
+       * _admitted_transactions to be pushed with others by push_admitted_transactions().
+       *
+       * @throws graphene::net::transaction_queue_full_exception if too many transactions are waiting already
+       */
+      void handle_transaction(const graphene::net::trx_message& transaction_message,
+                              const graphene::net::message_hash_type& transaction_message_id) override;
 
       void handle_message(const graphene::net::message& message_to_process) override;
 
@@ -197,6 +214,9 @@ class application_impl : public net::node_delegate, public std::enable_shared_fr
    private:
       void shutdown();
 
+      /// Pushes the transactions in _admitted_transactions a chunk at a time, until there are none left
+      void push_admitted_transactions();
+
       void initialize_plugins() const;
       void startup_plugins() const;
       void shutdown_plugins() const;
@@ -228,6 +248,44 @@ class application_impl : public net::node_delegate, public std::enable_shared_fr
       string _node_info;
 
       fc::serial_valve valve;
+
+      /// The id of the message a transaction came in from the network with, until it is included in a block
+      struct relayed_transaction
+      {
+         graphene::protocol::transaction_id_type  trx_id;
+         graphene::net::message_hash_type        message_id;
+         fc::time_point_sec                      expiration;
+      };
+      struct by_trx_id;
+      struct by_expiration;
+      using relayed_transaction_index = boost::multi_index_container< relayed_transaction,
+         boost::multi_index::indexed_by<
+            boost::multi_index::hashed_unique< boost::multi_index::tag<by_trx_id>,
+               boost::multi_index::member< relayed_transaction, graphene::protocol::transaction_id_type,
+                                           &relayed_transaction::trx_id >,
+               std::hash<graphene::protocol::transaction_id_type> >,
+            boost::multi_index::ordered_non_unique< boost::multi_index::tag<by_expiration>,
+               boost::multi_index::member< relayed_transaction, fc::time_point_sec,
+                                           &relayed_transaction::expiration > > > >;
+      /// Filled by handle_transaction(), looked up and pruned by handle_block()
+      relayed_transaction_index _relayed_transactions;
+
+      /// Most transactions from the network handle_transaction() takes at once, more are turned away
+      static constexpr uint32_t max_transactions_in_admission = GRAPHENE_NET_MAX_TRX_PER_SECOND;
+      /// Most transactions push_admitted_transactions() pushes before it lets other tasks, e.g. blocks, in
+      static constexpr size_t transaction_push_chunk_size = 100;
+
+      /// A transaction that passed the checks which need no chain state, waiting to be pushed
+      struct admitted_transaction
+      {
+         graphene::protocol::precomputable_transaction  trx;
+         graphene::net::message_hash_type              message_id;
+         fc::promise<void>::ptr                        pushed;
+      };
+      std::deque<admitted_transaction> _admitted_transactions;
+      /// Transactions handle_transaction() is checking or waiting to push
+      uint32_t _transactions_in_admission = 0;
+      fc::future<void> _push_admitted_transactions_done;
    };
 
 }}} // namespace graphene namespace app namespace detail
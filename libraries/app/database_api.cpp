@@ -5,10 +5,12 @@
 #include <graphene/app/util.hpp>
 #include <graphene/chain/get_config.hpp>
 #include <graphene/chain/hardfork.hpp>
+#include <graphene/chain/read_snapshot.hpp>
 #include <graphene/protocol/btc_address.hpp>
 
 #include <fc/crypto/hex.hpp>
 #include <fc/rpc/api_connection.hpp>
+#include <fc/thread/parallel.hpp>
 
 #include <boost/range/iterator_range.hpp>
 
@@ -106,6 +108,29 @@ fc::variants database_api_impl::get_objects( const vector<object_id_type>& ids,
 {
    bool to_subscribe = get_whether_to_subscribe( subscribe );
 
+   if( auto snapshot = _db.read_snapshot() )
+   {
+      // served from the state of the head block, on the io thread pool
+      fc::variants result = fc::do_parallel( [snapshot,&ids]() {
+         fc::variants objects;
+         objects.reserve( ids.size() );
+         for( const auto& id : ids )
+         {
+            const object* obj = snapshot->find_object( id );
+            objects.push_back( obj ? obj->to_variant() : fc::variant() );
+         }
+         return objects;
+      }).wait();
+      if( to_subscribe )
+      {
+         for( size_t i = 0; i < ids.size(); ++i )
+            if( !result[i].is_null() && !ids[i].is<operation_history_id_type>()
+                  && !ids[i].is<account_history_id_type>() )
+               subscribe_to_item( ids[i] );
+      }
+      return result;
+   }
+
    fc::variants result;
    result.reserve(ids.size());
 
@@ -1386,6 +1411,61 @@ order_book database_api::get_order_book( const string& base, const string& quote
    return my->get_order_book( base, quote, limit );
 }
 
+namespace {
+
+   /// The orders of both sides of a market in a read snapshot, as database_api_impl::get_limit_orders() finds them
+   vector<limit_order_object> snapshot_limit_orders( const read_snapshot& snapshot, const asset_id_type a,
+                                                     const asset_id_type b, const uint32_t limit )
+   {
+      vector<limit_order_object> result;
+      result.reserve( limit * 2 );
+      for( const auto& side : { std::make_pair( a, b ), std::make_pair( b, a ) } )
+      {
+         const auto& orders = snapshot.get_orders( side.first, side.second );
+         const size_t count = std::min<size_t>( limit, orders.size() );
+         for( size_t i = 0; i < count; ++i )
+            result.push_back( *orders[i] );
+      }
+      return result;
+   }
+
+   /// Fills an order book with the orders of both sides of a market, DB is the database or a read snapshot
+   template<typename DB>
+   order_book make_order_book( const string& base, const string& quote,
+                               const asset_object& base_asset, const asset_object& quote_asset,
+                               const vector<limit_order_object>& orders, const DB& db )
+   {
+      order_book result( base, quote );
+      const auto base_id = base_asset.get_id();
+
+      for( const auto& o : orders )
+      {
+         auto order_price = price_to_string( o.sell_price, base_asset, quote_asset );
+         if( o.sell_price.base.asset_id == base_id )
+         {
+            auto quote_amt = quote_asset.amount_to_string( share_type( fc::uint128_t( o.for_sale.value )
+                                                                 * o.sell_price.quote.amount.value
+                                                                 / o.sell_price.base.amount.value ) );
+            auto base_amt = base_asset.amount_to_string( o.for_sale );
+            result.bids.emplace_back( order_price, quote_amt, base_amt, o.get_id(),
+                                      o.seller, o.seller(db).name, o.expiration );
+         }
+         else
+         {
+            auto quote_amt = quote_asset.amount_to_string( o.for_sale );
+            auto base_amt = base_asset.amount_to_string( share_type( fc::uint128_t( o.for_sale.value )
+                                                                * o.sell_price.quote.amount.value
+                                                                / o.sell_price.base.amount.value ) );
+            result.asks.emplace_back( order_price, quote_amt, base_amt, o.get_id(),
+                                      o.seller, o.seller(db).name, o.expiration );
+         }
+      }
+
+      return result;
+   }
+
+}
+
 order_book database_api_impl::get_order_book( const string& base, const string& quote, uint32_t limit )const
 {
    FC_ASSERT( _app_options, "Internal error" );
@@ -1394,40 +1474,23 @@ order_book database_api_impl::get_order_book( const string& base, const string&
               "limit can not be greater than ${configured_limit}",
               ("configured_limit", configured_limit) );
 
-   order_book result( base, quote );
-
    auto assets = lookup_asset_symbols( {base, quote} );
    FC_ASSERT( assets[0], "Invalid base asset symbol: ${s}", ("s",base) );
    FC_ASSERT( assets[1], "Invalid quote asset symbol: ${s}", ("s",quote) );
 
    auto base_id = assets[0]->get_id();
    auto quote_id = assets[1]->get_id();
-   auto orders = get_limit_orders( base_id, quote_id, limit );
 
-   for( const auto& o : orders )
+   if( auto snapshot = _db.read_snapshot() )
    {
-      auto order_price = price_to_string( o.sell_price, *assets[0], *assets[1] );
-      if( o.sell_price.base.asset_id == base_id )
-      {
-         auto quote_amt = assets[1]->amount_to_string( share_type( fc::uint128_t( o.for_sale.value )
-                                                              * o.sell_price.quote.amount.value
-                                                              / o.sell_price.base.amount.value ) );
-         auto base_amt = assets[0]->amount_to_string( o.for_sale );
-         result.bids.emplace_back( order_price, quote_amt, base_amt, o.get_id(),
-                                   o.seller, o.seller(_db).name, o.expiration );
-      }
-      else
-      {
-         auto quote_amt = assets[1]->amount_to_string( o.for_sale );
-         auto base_amt = assets[0]->amount_to_string( share_type( fc::uint128_t( o.for_sale.value )
-                                                             * o.sell_price.quote.amount.value
-                                                             / o.sell_price.base.amount.value ) );
-         result.asks.emplace_back( order_price, quote_amt, base_amt, o.get_id(),
-                                   o.seller, o.seller(_db).name, o.expiration );
-      }
+      // served from the state of the head block, on the io thread pool
+      return fc::do_parallel( [snapshot,&base,&quote,base_id,quote_id,limit]() {
+         return make_order_book( base, quote, snapshot->get( base_id ), snapshot->get( quote_id ),
+                                 snapshot_limit_orders( *snapshot, base_id, quote_id, limit ), *snapshot );
+      }).wait();
    }
 
-   return result;
+   return make_order_book( base, quote, *assets[0], *assets[1], get_limit_orders( base_id, quote_id, limit ), _db );
 }
 
 vector<market_ticker> database_api::get_top_markets(uint32_t limit)const
@@ -2580,30 +2643,31 @@ vector<limit_order_object> database_api_impl::get_limit_orders( const asset_id_t
               "limit can not be greater than ${configured_limit}",
               ("configured_limit", configured_limit) );
 
-   const auto& limit_order_idx = _db.get_index_type<limit_order_index>();
-   const auto& limit_price_idx = limit_order_idx.indices().get<by_price>();
+   if( auto snapshot = _db.read_snapshot() )
+   {
+      // served from the state of the head block, on the io thread pool
+      return fc::do_parallel( [snapshot,a,b,limit]() {
+         return snapshot_limit_orders( *snapshot, a, b, limit );
+      }).wait();
+   }
+
+   const auto& limit_book = _db.get_limit_order_book();
 
    vector<limit_order_object> result;
    result.reserve(limit*2);
 
-   uint32_t count = 0;
-   auto limit_itr = limit_price_idx.lower_bound(price::max(a,b));
-   auto limit_end = limit_price_idx.upper_bound(price::min(a,b));
-   while(limit_itr != limit_end && count < limit)
-   {
-      result.push_back(*limit_itr);
-      ++limit_itr;
-      ++count;
-   }
-   count = 0;
-   limit_itr = limit_price_idx.lower_bound(price::max(b,a));
-   limit_end = limit_price_idx.upper_bound(price::min(b,a));
-   while(limit_itr != limit_end && count < limit)
-   {
-      result.push_back(*limit_itr);
-      ++limit_itr;
-      ++count;
-   }
+   auto take_orders = [&limit_book,&result,limit]( asset_id_type sell, asset_id_type receive ) {
+      uint32_t count = 0;
+      limit_book.for_each_order( sell, receive, [&result,&count,limit]( const limit_order_object& order ) {
+         if( count >= limit )
+            return false;
+         result.push_back( order );
+         ++count;
+         return true;
+      });
+   };
+   take_orders( a, b );
+   take_orders( b, a );
 
    return result;
 }
@@ -324,6 +324,10 @@ namespace graphene { namespace app {
 
          /**
           * @brief Get status of all current connections to peers
+          *
+          * The info of each peer includes, under send_queues, the number and size of the messages queued to send
+          * to it, and how many were sent or dropped and how long they were queued on average, for each class of
+          * messages: new blocks, control messages, transactions and blocks sent to sync.
           */
          std::vector<net::peer_status> get_connected_peers() const;
 
@@ -1,6 +1,8 @@
 #include <graphene/chain/account_object.hpp>
 #include <graphene/chain/database.hpp>
 
+#include <graphene/db/undo_delta.hpp>
+
 #include <fc/io/raw.hpp>
 #include <fc/uint128.hpp>
 
@@ -340,3 +342,5 @@ FC_REFLECT_DERIVED_NO_TYPENAME( graphene::chain::account_statistics_object,
 GRAPHENE_IMPLEMENT_EXTERNAL_SERIALIZATION( graphene::chain::account_object )
 GRAPHENE_IMPLEMENT_EXTERNAL_SERIALIZATION( graphene::chain::account_balance_object )
 GRAPHENE_IMPLEMENT_EXTERNAL_SERIALIZATION( graphene::chain::account_statistics_object )
+
+GRAPHENE_IMPLEMENT_DELTA_UNDO( graphene::chain::account_object )
@@ -1,7 +1,12 @@
 #include <graphene/chain/block_database.hpp>
 #include <graphene/protocol/fee_schedule.hpp>
 #include <fc/io/raw.hpp>
+#include <fc/interprocess/file_mapping.hpp>
 #include <boost/endian/buffers.hpp>
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <cstring>
 
 namespace graphene { namespace chain {
 
@@ -18,44 +23,276 @@ struct index_entry
  }}
 FC_REFLECT( graphene::chain::index_entry, (block_pos)(block_size)(block_id) );
 
-namespace graphene { namespace chain {
+namespace graphene { namespace chain { namespace detail {
+
+   /**
+    * A file that is memory mapped read-write and grown in large steps. Growing maps the file again and keeps the
+    * previous mappings until the file is closed, so that addresses handed out to readers stay valid while the
+    * file grows under them. The space past size() is preallocated and cut off again on close.
+    *
+    * Only one thread may write, readers must load size() before data().
+    */
+   class mapped_file
+   {
+      public:
+         mapped_file( const fc::path& filename, uint64_t size, uint64_t min_growth )
+         :_filename(filename),_min_growth(min_growth),_size(size)
+         {
+            reserve( size + min_growth );
+         }
+
+         ~mapped_file()
+         {
+            _regions.clear();
+            try
+            {
+               fc::resize_file( _filename, _size.load() );
+            }
+            catch( const fc::exception& e )
+            {
+               elog( "Unable to truncate ${f}: ${e}", ("f", _filename)("e", e.to_detail_string()) );
+            }
+         }
+
+         uint64_t    size()const { return _size.load( std::memory_order_acquire ); }
+         const char* data()const { return _address.load( std::memory_order_acquire ); }
+
+         /// @return the address of offset, after making sure that the file is large enough for length more bytes
+         char* writable( uint64_t offset, uint64_t length )
+         {
+            if( offset + length > _capacity )
+               reserve( offset + length );
+            return _address.load( std::memory_order_relaxed ) + offset;
+         }
+
+         /// Makes everything written below new_size visible to readers
+         void set_size( uint64_t new_size ) { _size.store( new_size, std::memory_order_release ); }
+
+         void flush() { _regions.back()->region.flush(); }
+
+      private:
+         struct mapping
+         {
+            mapping( const fc::path& filename, uint64_t capacity )
+            :file( filename.generic_string().c_str(), fc::read_write ),
+             region( file, fc::read_write, 0, capacity ){}
+
+            fc::file_mapping  file;
+            fc::mapped_region region;
+         };
+
+         void reserve( uint64_t needed )
+         {
+            const uint64_t capacity = std::max( needed, _capacity + std::max( _min_growth, _capacity / 2 ) );
+            fc::resize_file( _filename, capacity );
+            _regions.emplace_back( new mapping( _filename, capacity ) );
+            _address.store( static_cast<char*>( _regions.back()->region.get_address() ), std::memory_order_release );
+            _capacity = capacity;
+         }
+
+         const fc::path                          _filename;
+         const uint64_t                          _min_growth;
+         std::vector< std::unique_ptr<mapping> > _regions;
+         uint64_t                                _capacity = 0;
+         std::atomic<char*>                      _address{nullptr};
+         std::atomic<uint64_t>                   _size;
+   };
+
+} // detail
+
+namespace {
+   /// Preallocation steps of the mapped files, the index grows by a million blocks at a time
+   const uint64_t mapped_index_growth  = sizeof(index_entry) << 20;
+   const uint64_t mapped_blocks_growth = uint64_t(256) << 20;
+}
+
+block_database::block_database() = default;
 
-void block_database::open( const fc::path& dbdir )
+block_database::~block_database() = default;
+
+void block_database::open( const fc::path& dbdir, storage_mode mode )
 { try {
    fc::create_directories(dbdir);
+   _mode = mode;
    _block_num_to_pos.exceptions(std::ios_base::failbit | std::ios_base::badbit);
    _blocks.exceptions(std::ios_base::failbit | std::ios_base::badbit);
 
    _index_filename = dbdir / "index";
+   _blocks_filename = dbdir / "blocks";
+
+   // the index would point into an empty blocks file in the other format, and be cut off as trailing garbage
+   if( _mode == storage_mode::compressed )
+      FC_ASSERT( !fc::exists( _blocks_filename ) || compressed_block_file::exists( dbdir ),
+                 "${d} holds an uncompressed block database, convert it with block_converter first", ("d", dbdir) );
+   else
+      FC_ASSERT( fc::exists( _blocks_filename ) || !compressed_block_file::exists( dbdir ),
+                 "${d} holds a compressed block database, convert it with block_converter first", ("d", dbdir) );
+
+   if( _mode == storage_mode::mapped )
+   {
+      if( !fc::exists( _index_filename ) )
+      {
+         std::ofstream( _index_filename.generic_string().c_str(), std::ofstream::binary | std::ofstream::trunc );
+         std::ofstream( _blocks_filename.generic_string().c_str(), std::ofstream::binary | std::ofstream::trunc );
+      }
+      FC_ASSERT( fc::exists( _blocks_filename ), "Missing blocks file ${f}", ("f", _blocks_filename) );
+      const uint64_t index_size = fc::file_size( _index_filename );
+      _mapped_index.reset( new detail::mapped_file( _index_filename, index_size - index_size % sizeof(index_entry),
+                                                    mapped_index_growth ) );
+
+      // both files can still hold zeroed preallocated space after an unclean shutdown, find where the data ends
+      const index_entry* entries = reinterpret_cast<const index_entry*>( _mapped_index->data() );
+      uint64_t count = _mapped_index->size() / sizeof(index_entry);
+      while( count > 0 && entries[count-1].block_size.value() == 0 && entries[count-1].block_id == block_id_type() )
+         --count;
+      uint64_t blocks_size = 0;
+      for( uint64_t i = 0; i < count; ++i )
+      {
+         if( entries[i].block_size.value() > 0 )
+            blocks_size = std::max( blocks_size, entries[i].block_pos.value() + entries[i].block_size.value() );
+      }
+      blocks_size = std::min( blocks_size, uint64_t( fc::file_size( _blocks_filename ) ) );
+      _mapped_blocks.reset( new detail::mapped_file( _blocks_filename, blocks_size, mapped_blocks_growth ) );
+
+      // cut off the entries at the end whose blocks did not make it to disk, before readers can see the index
+      while( count > 0 && !holds_block( entries[count-1] ) )
+         --count;
+      _mapped_index->set_size( count * sizeof(index_entry) );
+      return;
+   }
+   if( _mode == storage_mode::compressed )
+   {
+      // the compressed files replace the blocks file, the index stays the same
+      if( !fc::exists( _index_filename ) )
+        _block_num_to_pos.open( _index_filename.generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out | std::fstream::trunc);
+      else
+        _block_num_to_pos.open( _index_filename.generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out );
+      _compressed.open( dbdir );
+      return;
+   }
    if( !fc::exists( _index_filename ) )
    {
      _block_num_to_pos.open( _index_filename.generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out | std::fstream::trunc);
-     _blocks.open( (dbdir/"blocks").generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out | std::fstream::trunc);
+     _blocks.open( _blocks_filename.generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out | std::fstream::trunc);
    }
    else
    {
      _block_num_to_pos.open( _index_filename.generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out );
-     _blocks.open( (dbdir/"blocks").generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out );
+     _blocks.open( _blocks_filename.generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out );
    }
 } FC_CAPTURE_AND_RETHROW( (dbdir) ) } // GCOVR_EXCL_LINE
 
 bool block_database::is_open()const
 {
+  if( _mode == storage_mode::mapped )
+     return _mapped_index != nullptr;
+  if( _mode == storage_mode::compressed )
+     return _compressed.is_open();
   return _blocks.is_open();
 }
 
 void block_database::close()
 {
-  _blocks.close();
+  if( _mode == storage_mode::mapped )
+  {
+     _mapped_blocks.reset();
+     _mapped_index.reset();
+     return;
+  }
+  if( _mode == storage_mode::compressed )
+     _compressed.close();
+  else
+     _blocks.close();
   _block_num_to_pos.close();
 }
 
 void block_database::flush()
 {
-  _blocks.flush();
+  if( _mode == storage_mode::mapped )
+  {
+     _mapped_blocks->flush();
+     _mapped_index->flush();
+     return;
+  }
+  if( _mode == storage_mode::compressed )
+     _compressed.flush();
+  else
+     _blocks.flush();
   _block_num_to_pos.flush();
 }
 
+bool block_database::read_index_entry( uint32_t block_num, index_entry& e )const
+{
+   const uint64_t index_pos = sizeof(e) * uint64_t(block_num);
+   while( true )
+   {
+      const uint64_t sequence = _index_sequence.load( std::memory_order_acquire );
+      if( sequence & 1 )
+         continue;
+      if( _mapped_index->size() < index_pos + sizeof(e) )
+         return false;
+      std::memcpy( (char*)&e, _mapped_index->data() + index_pos, sizeof(e) );
+      std::atomic_thread_fence( std::memory_order_acquire );
+      if( _index_sequence.load( std::memory_order_relaxed ) == sequence )
+         return true;
+   }
+}
+
+void block_database::write_index_entry( uint32_t block_num, const index_entry& e )
+{
+   const uint64_t index_pos = sizeof(e) * uint64_t(block_num);
+   const uint64_t index_size = _mapped_index->size();
+   char* base = _mapped_index->writable( index_pos, sizeof(e) ) - index_pos;
+   if( index_pos >= index_size )
+   {
+      // readers can not see past index_size yet, skipped entries must read as empty like with streams
+      std::memset( base + index_size, 0, index_pos - index_size );
+      std::memcpy( base + index_pos, (const char*)&e, sizeof(e) );
+      _mapped_index->set_size( index_pos + sizeof(e) );
+      return;
+   }
+   _index_sequence.fetch_add( 1, std::memory_order_relaxed );
+   std::atomic_thread_fence( std::memory_order_release );
+   std::memcpy( base + index_pos, (const char*)&e, sizeof(e) );
+   _index_sequence.fetch_add( 1, std::memory_order_release );
+}
+
+uint64_t block_database::read_blocks_file( uint64_t position, char* out, uint64_t size )const
+{
+   if( _mode == storage_mode::compressed )
+      return _compressed.read( position, out, size );
+   _blocks.seekg( position );
+   _blocks.read( out, size );
+   return _blocks.gcount();
+}
+
+bool block_database::read_block_data( const index_entry& e, vector<char>& data )const
+{
+   if( e.block_pos.value() + e.block_size.value() > _mapped_blocks->size() )
+      return false;
+   data.resize( e.block_size.value() );
+   std::memcpy( data.data(), _mapped_blocks->data() + e.block_pos.value(), e.block_size.value() );
+   return true;
+}
+
+bool block_database::holds_block( const index_entry& e )const
+{
+   vector<char> data;
+   if( e.block_size.value() == 0 || !read_block_data( e, data ) )
+      return false;
+   try
+   {
+      return fc::raw::unpack<signed_block>(data).id() == e.block_id;
+   }
+   catch (const fc::exception&)
+   {
+   }
+   catch (const std::exception&)
+   {
+   }
+   return false;
+}
+
 void block_database::store( const block_id_type& _id, const signed_block& b )
 {
    block_id_type id = _id;
@@ -64,20 +301,49 @@ void block_database::store( const block_id_type& _id, const signed_block& b )
       id = b.id();
       elog( "id argument of block_database::store() was not initialized for block ${id}", ("id", id) );
    }
+   if( _mode == storage_mode::mapped )
+   {
+      index_entry e;
+      auto vec = fc::raw::pack( b );
+      const uint64_t pos = _mapped_blocks->size();
+      std::memcpy( _mapped_blocks->writable( pos, vec.size() ), vec.data(), vec.size() );
+      _mapped_blocks->set_size( pos + vec.size() );
+      e.block_pos  = pos;
+      e.block_size = vec.size();
+      e.block_id   = id;
+      write_index_entry( block_header::num_from_id(id), e );
+      return;
+   }
    _block_num_to_pos.seekp( sizeof( index_entry ) * int64_t(block_header::num_from_id(id)) );
    index_entry e;
-   _blocks.seekp( 0, _blocks.end );
    auto vec = fc::raw::pack( b );
-   e.block_pos  = _blocks.tellp();
+   if( _mode == storage_mode::compressed )
+      e.block_pos = _compressed.append( vec.data(), vec.size() );
+   else
+   {
+      _blocks.seekp( 0, _blocks.end );
+      e.block_pos = _blocks.tellp();
+      _blocks.write( vec.data(), vec.size() );
+   }
    e.block_size = vec.size();
    e.block_id   = id;
-   _blocks.write( vec.data(), vec.size() );
    _block_num_to_pos.write( (char*)&e, sizeof(e) );
 }
 
 void block_database::remove( const block_id_type& id )
 { try {
    index_entry e;
+   if( _mode == storage_mode::mapped )
+   {
+      if( !read_index_entry( block_header::num_from_id(id), e ) )
+         FC_THROW_EXCEPTION(fc::key_not_found_exception, "Block ${id} not contained in block database", ("id", id));
+      if( e.block_id == id )
+      {
+         e.block_size = 0;
+         write_index_entry( block_header::num_from_id(id), e );
+      }
+      return;
+   }
    int64_t index_pos = sizeof(e) * int64_t(block_header::num_from_id(id));
    _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
    if ( _block_num_to_pos.tellg() <= index_pos )
@@ -100,6 +366,8 @@ bool block_database::contains( const block_id_type& id )const
       return false;
 
    index_entry e;
+   if( _mode == storage_mode::mapped )
+      return read_index_entry( block_header::num_from_id(id), e ) && e.block_id == id && e.block_size.value() > 0;
    int64_t index_pos = sizeof(e) * int64_t(block_header::num_from_id(id));
    _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
    if ( _block_num_to_pos.tellg() < int64_t(index_pos + sizeof(e)) )
@@ -114,13 +382,21 @@ block_id_type block_database::fetch_block_id( uint32_t block_num )const
 {
    assert( block_num != 0 );
    index_entry e;
-   int64_t index_pos = sizeof(e) * int64_t(block_num);
-   _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
-   if ( _block_num_to_pos.tellg() <= index_pos )
-      FC_THROW_EXCEPTION(fc::key_not_found_exception, "Block number ${block_num} not contained in block database", ("block_num", block_num));
+   if( _mode == storage_mode::mapped )
+   {
+      if( !read_index_entry( block_num, e ) )
+         FC_THROW_EXCEPTION(fc::key_not_found_exception, "Block number ${block_num} not contained in block database", ("block_num", block_num));
+   }
+   else
+   {
+      int64_t index_pos = sizeof(e) * int64_t(block_num);
+      _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
+      if ( _block_num_to_pos.tellg() <= index_pos )
+         FC_THROW_EXCEPTION(fc::key_not_found_exception, "Block number ${block_num} not contained in block database", ("block_num", block_num));
 
-   _block_num_to_pos.seekg( index_pos );
-   _block_num_to_pos.read( (char*)&e, sizeof(e) );
+      _block_num_to_pos.seekg( index_pos );
+      _block_num_to_pos.read( (char*)&e, sizeof(e) );
+   }
 
    FC_ASSERT( e.block_id != block_id_type(), "Empty block_id in block_database (maybe corrupt on disk?)" );
    return e.block_id;
@@ -131,6 +407,15 @@ optional<signed_block> block_database::fetch_optional( const block_id_type& id )
    try
    {
       index_entry e;
+      if( _mode == storage_mode::mapped )
+      {
+         vector<char> data;
+         if( !read_index_entry( block_header::num_from_id(id), e ) || e.block_id != id || !read_block_data( e, data ) )
+            return optional<signed_block>();
+         auto result = fc::raw::unpack<signed_block>(data);
+         FC_ASSERT( result.id() == e.block_id );
+         return result;
+      }
       int64_t index_pos = sizeof(e) * int64_t(block_header::num_from_id(id));
       _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
       if ( _block_num_to_pos.tellg() <= index_pos )
@@ -142,9 +427,8 @@ optional<signed_block> block_database::fetch_optional( const block_id_type& id )
       if( e.block_id != id ) return optional<signed_block>();
 
       vector<char> data( e.block_size.value() );
-      _blocks.seekg( e.block_pos.value() );
-      if (e.block_size.value())
-         _blocks.read( data.data(), e.block_size.value() );
+      if( e.block_size.value() && read_blocks_file( e.block_pos.value(), data.data(), data.size() ) != data.size() )
+         return optional<signed_block>();
       auto result = fc::raw::unpack<signed_block>(data);
       FC_ASSERT( result.id() == e.block_id );
       return result;
@@ -163,6 +447,15 @@ optional<signed_block> block_database::fetch_by_number( uint32_t block_num )cons
    try
    {
       index_entry e;
+      if( _mode == storage_mode::mapped )
+      {
+         vector<char> data;
+         if( !read_index_entry( block_num, e ) || !read_block_data( e, data ) )
+            return optional<signed_block>();
+         auto result = fc::raw::unpack<signed_block>(data);
+         FC_ASSERT( result.id() == e.block_id );
+         return result;
+      }
       int64_t index_pos = sizeof(e) * int64_t(block_num);
       _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
       if ( _block_num_to_pos.tellg() <= index_pos )
@@ -172,8 +465,8 @@ optional<signed_block> block_database::fetch_by_number( uint32_t block_num )cons
       _block_num_to_pos.read( (char*)&e, sizeof(e) );
 
       vector<char> data( e.block_size.value() );
-      _blocks.seekg( e.block_pos.value() );
-      _blocks.read( data.data(), e.block_size.value() );
+      if( read_blocks_file( e.block_pos.value(), data.data(), data.size() ) != data.size() )
+         return optional<signed_block>();
       auto result = fc::raw::unpack<signed_block>(data);
       FC_ASSERT( result.id() == e.block_id );
       return result;
@@ -192,6 +485,19 @@ optional<index_entry> block_database::last_index_entry()const {
    {
       index_entry e;
 
+      if( _mode == storage_mode::mapped )
+      {
+         // trailing garbage was cut off in open(), this only skips blocks that were removed since
+         uint64_t count = _mapped_index->size() / sizeof(index_entry);
+         while( count > 0 )
+         {
+            --count;
+            if( read_index_entry( count, e ) && holds_block( e ) )
+               return e;
+         }
+         return optional<index_entry>();
+      }
+
       _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
       std::streampos pos = _block_num_to_pos.tellg();
       if( pos < long(sizeof(index_entry)) )
@@ -199,8 +505,7 @@ optional<index_entry> block_database::last_index_entry()const {
 
       pos -= pos % sizeof(index_entry);
 
-      _blocks.seekg( 0, _block_num_to_pos.end );
-      const std::streampos blocks_size = _blocks.tellg();
+      const std::streampos blocks_size = total_block_size();
       while( pos > 0 )
       {
          pos -= sizeof(index_entry);
@@ -211,9 +516,7 @@ optional<index_entry> block_database::last_index_entry()const {
             try
             {
                vector<char> data( e.block_size.value() );
-               _blocks.seekg( e.block_pos.value() );
-               _blocks.read( data.data(), e.block_size.value() );
-               if( _blocks.gcount() == long(e.block_size.value()) )
+               if( read_blocks_file( e.block_pos.value(), data.data(), data.size() ) == data.size() )
                {
                   const signed_block block = fc::raw::unpack<signed_block>(data);
                   if( block.id() == e.block_id )
@@ -254,13 +557,138 @@ optional<block_id_type> block_database::last_id()const
 
 size_t block_database::blocks_current_position()const
 {
+   // there is no read position in the other modes
+   if( _mode != storage_mode::streams )
+      return total_block_size();
    return (size_t)_blocks.tellg();
 }
 
 size_t block_database::total_block_size()const
 {
+   if( _mode == storage_mode::mapped )
+      return _mapped_blocks->size();
+   if( _mode == storage_mode::compressed )
+      return _compressed.size();
    _blocks.seekg( 0, _blocks.end );
    return (size_t)_blocks.tellg();
 }
 
+uint64_t block_database::disk_size( const fc::path& dbdir )
+{
+   uint64_t total = 0;
+   for( boost::filesystem::directory_iterator itr( dbdir ), end; itr != end; ++itr )
+   {
+      if( boost::filesystem::is_regular_file( itr->path() ) )
+         total += boost::filesystem::file_size( itr->path() );
+   }
+   return total;
+}
+
+block_database::raw_block_range block_database::read_range( uint32_t first_block_num, uint32_t count )const
+{ try {
+   raw_block_range result;
+   if( count == 0 )
+      return result;
+
+   std::vector<index_entry> entries( count );
+   std::ifstream blocks;
+   if( _mode == storage_mode::mapped )
+   {
+      for( uint32_t i = 0; i < count; ++i )
+      {
+         if( !read_index_entry( first_block_num + i, entries[i] ) )
+         {
+            entries.resize( i );
+            break;
+         }
+      }
+   }
+   else
+   {
+      std::ifstream index( _index_filename.generic_string().c_str(), std::ifstream::binary );
+      FC_ASSERT( index.is_open(), "Unable to open block database index" );
+      if( _mode == storage_mode::streams )
+      {
+         blocks.open( _blocks_filename.generic_string().c_str(), std::ifstream::binary );
+         FC_ASSERT( blocks.is_open(), "Unable to open block database files" );
+      }
+      index.seekg( sizeof(index_entry) * int64_t(first_block_num) );
+      index.read( (char*)entries.data(), sizeof(index_entry) * count );
+      entries.resize( index.gcount() / sizeof(index_entry) );
+   }
+   // @return the number of bytes actually read
+   auto read_blocks = [this,&blocks]( uint64_t position, char* out, uint64_t size ) -> uint64_t {
+      if( _mode == storage_mode::mapped )
+      {
+         const uint64_t blocks_size = _mapped_blocks->size();
+         if( position >= blocks_size )
+            return 0;
+         size = std::min( size, blocks_size - position );
+         std::memcpy( out, _mapped_blocks->data() + position, size );
+         return size;
+      }
+      if( _mode == storage_mode::compressed )
+         return _compressed.read( position, out, size );
+      blocks.seekg( position );
+      blocks.read( out, size );
+      return blocks.gcount();
+   };
+
+   uint64_t span_begin = 0;
+   uint64_t span_end = 0;
+   uint64_t total_size = 0;
+   result.entries.reserve( entries.size() );
+   for( const auto& e : entries )
+   {
+      if( e.block_size.value() == 0 || e.block_id == block_id_type() )
+         break;
+      raw_block_range::entry item;
+      item.block_num = first_block_num + result.entries.size();
+      item.block_id  = e.block_id;
+      item.position  = e.block_pos.value();
+      item.size      = e.block_size.value();
+      if( result.entries.empty() || item.position < span_begin )
+         span_begin = item.position;
+      span_end = std::max( span_end, item.position + item.size );
+      total_size += item.size;
+      result.entries.push_back( item );
+   }
+   if( result.entries.empty() )
+      return result;
+
+   if( span_end - span_begin <= total_size + total_size / 4 )
+   {
+      // blocks are appended in order, so apart from the odd orphaned fork block a range is one contiguous read
+      result.data.resize( span_end - span_begin );
+      const uint64_t available = span_begin + read_blocks( span_begin, result.data.data(), result.data.size() );
+      for( size_t i = 0; i < result.entries.size(); ++i )
+      {
+         auto& item = result.entries[i];
+         if( item.position + item.size > available )
+         {
+            result.entries.resize( i );
+            break;
+         }
+         item.offset = item.position - span_begin;
+      }
+   }
+   else
+   {
+      result.data.resize( total_size );
+      size_t offset = 0;
+      for( size_t i = 0; i < result.entries.size(); ++i )
+      {
+         auto& item = result.entries[i];
+         if( read_blocks( item.position, result.data.data() + offset, item.size ) != item.size )
+         {
+            result.entries.resize( i );
+            break;
+         }
+         item.offset = offset;
+         offset += item.size;
+      }
+   }
+   return result;
+} FC_CAPTURE_AND_RETHROW( (first_block_num)(count) ) } // GCOVR_EXCL_LINE
+
 } }
@@ -0,0 +1,414 @@
+#include <graphene/chain/compressed_block_file.hpp>
+
+#include <fc/exception/exception.hpp>
+#include <fc/log/logger.hpp>
+
+#include <boost/endian/buffers.hpp>
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace graphene { namespace chain {
+
+namespace {
+
+   const uint32_t chunk_index_version = 1;
+
+   struct chunk_index_header
+   {
+      boost::endian::little_uint32_buf_t version;
+      boost::endian::little_uint32_buf_t chunk_size;
+   };
+
+   struct chunk_index_entry
+   {
+      boost::endian::little_uint64_buf_t offset;
+      boost::endian::little_uint32_buf_t size;
+   };
+
+   struct tail_header
+   {
+      boost::endian::little_uint64_buf_t position;
+   };
+
+   /// Samples beyond this many bytes are ignored by train_dictionary(), counting is memory hungry
+   const size_t max_training_bytes = 1024 * 1024;
+
+   std::vector<char> read_file( const fc::path& filename )
+   {
+      std::vector<char> result;
+      std::ifstream in( filename.generic_string().c_str(), std::ifstream::binary );
+      if( !in.is_open() )
+         return result;
+      in.seekg( 0, in.end );
+      result.resize( in.tellg() );
+      in.seekg( 0, in.beg );
+      in.read( result.data(), result.size() );
+      result.resize( in.gcount() );
+      return result;
+   }
+
+   std::vector<char> deflate_chunk( const char* data, uint32_t size, const std::vector<char>& dictionary )
+   {
+      z_stream zs;
+      std::memset( &zs, 0, sizeof(zs) );
+      // raw deflate, the chunk index already records the sizes
+      FC_ASSERT( deflateInit2( &zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY ) == Z_OK );
+      std::vector<char> result( deflateBound( &zs, size ) );
+      if( !dictionary.empty() )
+         deflateSetDictionary( &zs, (const Bytef*)dictionary.data(), dictionary.size() );
+      zs.next_in   = (Bytef*)data;
+      zs.avail_in  = size;
+      zs.next_out  = (Bytef*)result.data();
+      zs.avail_out = result.size();
+      const int status = deflate( &zs, Z_FINISH );
+      result.resize( zs.total_out );
+      deflateEnd( &zs );
+      FC_ASSERT( status == Z_STREAM_END, "Unable to compress block chunk: ${s}", ("s", status) );
+      return result;
+   }
+
+   std::vector<char> inflate_chunk( const std::vector<char>& compressed, uint32_t size,
+                                    const std::vector<char>& dictionary )
+   {
+      z_stream zs;
+      std::memset( &zs, 0, sizeof(zs) );
+      FC_ASSERT( inflateInit2( &zs, -15 ) == Z_OK );
+      if( !dictionary.empty() )
+         inflateSetDictionary( &zs, (const Bytef*)dictionary.data(), dictionary.size() );
+      std::vector<char> result( size );
+      zs.next_in   = (Bytef*)compressed.data();
+      zs.avail_in  = compressed.size();
+      zs.next_out  = (Bytef*)result.data();
+      zs.avail_out = size;
+      const int status = inflate( &zs, Z_FINISH );
+      const uint64_t inflated = zs.total_out;
+      inflateEnd( &zs );
+      FC_ASSERT( status == Z_STREAM_END && inflated == size, "Corrupt block chunk: ${s}", ("s", status) );
+      return result;
+   }
+
+}
+
+bool compressed_block_file::exists( const fc::path& dir )
+{
+   return fc::exists( dir / "chunks.index" );
+}
+
+void compressed_block_file::open( const fc::path& dir )
+{ try {
+   fc::create_directories( dir );
+   _dir = dir;
+   _chunks.clear();
+   _cache.clear();
+   _chunk_size = default_chunk_size;
+   _dictionary = read_file( dir / "dictionary" );
+
+   const fc::path index_filename = dir / "chunks.index";
+   const fc::path chunks_filename = dir / "chunks";
+   const fc::path tail_filename = dir / "blocks.tail";
+   if( !fc::exists( index_filename ) )
+   {
+      chunk_index_header header;
+      header.version = chunk_index_version;
+      header.chunk_size = _chunk_size;
+      std::ofstream index( index_filename.generic_string().c_str(), std::ofstream::binary | std::ofstream::trunc );
+      index.write( (const char*)&header, sizeof(header) );
+      std::ofstream( chunks_filename.generic_string().c_str(), std::ofstream::binary | std::ofstream::trunc );
+      fc::remove_all( tail_filename );
+   }
+
+   // chunks past the end of the chunks file were not completely written before a crash, drop them
+   const std::vector<char> index = read_file( index_filename );
+   FC_ASSERT( index.size() >= sizeof(chunk_index_header), "Corrupt ${f}", ("f", index_filename) );
+   const auto* header = reinterpret_cast<const chunk_index_header*>( index.data() );
+   FC_ASSERT( header->version.value() == chunk_index_version, "Unsupported version of ${f}", ("f", index_filename) );
+   _chunk_size = header->chunk_size.value();
+   const uint64_t chunks_file_size = fc::exists( chunks_filename ) ? fc::file_size( chunks_filename ) : 0;
+   _chunks_file_size = 0;
+   const auto* entries = reinterpret_cast<const chunk_index_entry*>( index.data() + sizeof(chunk_index_header) );
+   const size_t count = ( index.size() - sizeof(chunk_index_header) ) / sizeof(chunk_index_entry);
+   for( size_t i = 0; i < count; ++i )
+   {
+      const chunk_location location{ entries[i].offset.value(), entries[i].size.value() };
+      if( location.offset != _chunks_file_size || location.offset + location.size > chunks_file_size )
+         break;
+      _chunks.push_back( location );
+      _chunks_file_size += location.size;
+   }
+   fc::resize_file( index_filename, sizeof(chunk_index_header) + _chunks.size() * sizeof(chunk_index_entry) );
+   fc::resize_file( chunks_filename, _chunks_file_size );
+
+   // the tail may still hold chunks that were sealed right before a crash
+   _tail.clear();
+   const std::vector<char> tail = read_file( tail_filename );
+   const uint64_t tail_position = uint64_t(_chunks.size()) * _chunk_size;
+   if( tail.size() >= sizeof(tail_header) )
+   {
+      const uint64_t position = reinterpret_cast<const tail_header*>( tail.data() )->position.value();
+      const uint64_t available = tail.size() - sizeof(tail_header);
+      FC_ASSERT( position <= tail_position && position + available >= tail_position,
+                 "Block tail does not match the compressed chunks" );
+      _tail.assign( tail.begin() + sizeof(tail_header) + ( tail_position - position ), tail.end() );
+   }
+   else
+      FC_ASSERT( _chunks.empty(), "Missing block tail" );
+   write_tail();
+
+   _chunk_index.exceptions( std::ios_base::failbit | std::ios_base::badbit );
+   _chunks_out.exceptions( std::ios_base::failbit | std::ios_base::badbit );
+   _chunk_index.open( index_filename.generic_string().c_str(), std::ofstream::binary | std::ofstream::app );
+   _chunks_out.open( chunks_filename.generic_string().c_str(), std::ofstream::binary | std::ofstream::app );
+   while( _tail.size() >= _chunk_size )
+      seal_chunk();
+} FC_CAPTURE_AND_RETHROW( (dir) ) } // GCOVR_EXCL_LINE
+
+void compressed_block_file::flush()
+{
+   _chunk_index.flush();
+   _chunks_out.flush();
+   _tail_out.flush();
+}
+
+void compressed_block_file::close()
+{
+   if( !is_open() )
+      return;
+   _chunk_index.close();
+   _chunks_out.close();
+   _tail_out.close();
+   std::lock_guard<std::mutex> guard( _mutex );
+   _chunks.clear();
+   _tail.clear();
+   _cache.clear();
+}
+
+uint64_t compressed_block_file::append( const char* data, uint32_t size )
+{
+   uint64_t position;
+   {
+      std::lock_guard<std::mutex> guard( _mutex );
+      position = uint64_t(_chunks.size()) * _chunk_size + _tail.size();
+      _tail.insert( _tail.end(), data, data + size );
+   }
+   _tail_out.write( data, size );
+   while( _tail.size() >= _chunk_size )
+      seal_chunk();
+   return position;
+}
+
+void compressed_block_file::seal_chunk()
+{
+   // readers only need the lock while the chunk is published, compressing and writing it happens without
+   if( _chunks.empty() && _dictionary.empty() )
+   {
+      // nothing better to train on when no dictionary was installed up front
+      _dictionary = train_dictionary( { std::vector<char>( _tail.begin(), _tail.begin() + _chunk_size ) } );
+      write_dictionary( _dir, _dictionary );
+   }
+
+   auto sealed = std::make_shared< const std::vector<char> >( _tail.begin(), _tail.begin() + _chunk_size );
+   const auto compressed = deflate_chunk( sealed->data(), _chunk_size, _dictionary );
+   _chunks_out.write( compressed.data(), compressed.size() );
+   _chunks_out.flush();
+
+   chunk_index_entry entry;
+   entry.offset = _chunks_file_size;
+   entry.size = compressed.size();
+   _chunk_index.write( (const char*)&entry, sizeof(entry) );
+   _chunk_index.flush();
+
+   {
+      std::lock_guard<std::mutex> guard( _mutex );
+      _chunks.push_back( { _chunks_file_size, uint32_t(compressed.size()) } );
+      _chunks_file_size += compressed.size();
+      // the chunk was just written, it is the most likely one to be read next
+      cache_chunk( _chunks.size() - 1, sealed );
+      _tail.erase( _tail.begin(), _tail.begin() + _chunk_size );
+   }
+   write_tail();
+}
+
+void compressed_block_file::write_tail()
+{
+   tail_header header;
+   header.position = uint64_t(_chunks.size()) * _chunk_size;
+   const fc::path tail_filename = _dir / "blocks.tail";
+   if( _tail_out.is_open() )
+      _tail_out.close();
+   _tail_out.exceptions( std::ios_base::failbit | std::ios_base::badbit );
+   _tail_out.open( tail_filename.generic_string().c_str(), std::ofstream::binary | std::ofstream::trunc );
+   _tail_out.write( (const char*)&header, sizeof(header) );
+   _tail_out.write( _tail.data(), _tail.size() );
+   _tail_out.flush();
+}
+
+compressed_block_file::chunk_data compressed_block_file::load_chunk( const chunk_location& location )const
+{
+   // sealed chunks never change, so they can be read without holding the lock
+   std::vector<char> compressed( location.size );
+   std::ifstream in( ( _dir / "chunks" ).generic_string().c_str(), std::ifstream::binary );
+   in.seekg( location.offset );
+   in.read( compressed.data(), compressed.size() );
+   FC_ASSERT( in.gcount() == int64_t(location.size), "Unable to read block chunk at ${o}", ("o", location.offset) );
+   return std::make_shared< const std::vector<char> >( inflate_chunk( compressed, _chunk_size, _dictionary ) );
+}
+
+void compressed_block_file::cache_chunk( uint64_t chunk, const chunk_data& data )const
+{
+   for( auto itr = _cache.begin(); itr != _cache.end(); ++itr )
+   {
+      if( itr->first == chunk )
+      {
+         _cache.erase( itr );
+         break;
+      }
+   }
+   _cache.emplace_front( chunk, data );
+   if( _cache.size() > max_cached_chunks )
+      _cache.pop_back();
+}
+
+uint64_t compressed_block_file::read( uint64_t position, char* out, uint64_t size )const
+{
+   uint64_t done = 0;
+   while( done < size )
+   {
+      const uint64_t current = position + done;
+      const uint64_t chunk = current / _chunk_size;
+      chunk_data data;
+      chunk_location location;
+      {
+         std::lock_guard<std::mutex> guard( _mutex );
+         if( chunk >= _chunks.size() )
+         {
+            const uint64_t tail_position = uint64_t(_chunks.size()) * _chunk_size;
+            const uint64_t tail_end = tail_position + _tail.size();
+            if( current >= tail_end )
+               return done;
+            const uint64_t n = std::min( size - done, tail_end - current );
+            std::memcpy( out + done, _tail.data() + ( current - tail_position ), n );
+            return done + n;
+         }
+         location = _chunks[chunk];
+         for( auto itr = _cache.begin(); itr != _cache.end(); ++itr )
+         {
+            if( itr->first == chunk )
+            {
+               data = itr->second;
+               _cache.splice( _cache.begin(), _cache, itr );
+               break;
+            }
+         }
+      }
+      if( !data )
+      {
+         data = load_chunk( location );
+         std::lock_guard<std::mutex> guard( _mutex );
+         cache_chunk( chunk, data );
+      }
+      const uint64_t offset = current % _chunk_size;
+      const uint64_t n = std::min( size - done, uint64_t(_chunk_size) - offset );
+      std::memcpy( out + done, data->data() + offset, n );
+      done += n;
+   }
+   return done;
+}
+
+uint64_t compressed_block_file::size()const
+{
+   std::lock_guard<std::mutex> guard( _mutex );
+   return uint64_t(_chunks.size()) * _chunk_size + _tail.size();
+}
+
+uint64_t compressed_block_file::disk_size()const
+{
+   std::lock_guard<std::mutex> guard( _mutex );
+   return _chunks_file_size + sizeof(chunk_index_header) + _chunks.size() * sizeof(chunk_index_entry)
+          + sizeof(tail_header) + _tail.size() + _dictionary.size();
+}
+
+std::vector<char> compressed_block_file::train_dictionary( const std::vector< std::vector<char> >& samples,
+                                                           uint32_t max_size )
+{
+   // count every 8 byte sequence, the most frequent ones are emitted with some context after them
+   const size_t key_size = sizeof(uint64_t);
+   const size_t segment_size = 32;
+   struct candidate
+   {
+      uint32_t count  = 0;
+      uint32_t sample = 0;
+      uint32_t pos    = 0;
+   };
+   std::unordered_map<uint64_t, candidate> counts;
+   size_t counted = 0;
+   for( uint32_t s = 0; s < samples.size() && counted < max_training_bytes; ++s )
+   {
+      const auto& sample = samples[s];
+      for( uint32_t pos = 0; pos + key_size <= sample.size() && counted < max_training_bytes; ++pos, ++counted )
+      {
+         uint64_t key;
+         std::memcpy( &key, sample.data() + pos, key_size );
+         auto& c = counts[key];
+         if( c.count++ == 0 )
+         {
+            c.sample = s;
+            c.pos = pos;
+         }
+      }
+   }
+
+   std::vector< std::pair<uint64_t, candidate> > ranked;
+   for( const auto& item : counts )
+   {
+      if( item.second.count > 1 )
+         ranked.push_back( item );
+   }
+   std::sort( ranked.begin(), ranked.end(), []( const std::pair<uint64_t, candidate>& a,
+                                                const std::pair<uint64_t, candidate>& b ) {
+      return a.second.count != b.second.count ? a.second.count > b.second.count : a.first < b.first;
+   });
+
+   std::vector< std::pair<const char*, size_t> > segments;
+   std::unordered_set<uint64_t> covered;
+   size_t total = 0;
+   for( const auto& item : ranked )
+   {
+      if( total >= max_size )
+         break;
+      if( covered.count( item.first ) > 0 )
+         continue;
+      const auto& sample = samples[item.second.sample];
+      const size_t length = std::min( { segment_size, sample.size() - item.second.pos, max_size - total } );
+      const char* begin = sample.data() + item.second.pos;
+      for( size_t pos = 0; pos + key_size <= length; ++pos )
+      {
+         uint64_t key;
+         std::memcpy( &key, begin + pos, key_size );
+         covered.insert( key );
+      }
+      segments.emplace_back( begin, length );
+      total += length;
+   }
+
+   // deflate encodes close matches cheaper, so the most frequent segments go last
+   std::vector<char> dictionary;
+   dictionary.reserve( total );
+   for( auto itr = segments.rbegin(); itr != segments.rend(); ++itr )
+      dictionary.insert( dictionary.end(), itr->first, itr->first + itr->second );
+   return dictionary;
+}
+
+void compressed_block_file::write_dictionary( const fc::path& dir, const std::vector<char>& dictionary )
+{ try {
+   fc::create_directories( dir );
+   std::ofstream out( ( dir / "dictionary" ).generic_string().c_str(), std::ofstream::binary | std::ofstream::trunc );
+   out.write( dictionary.data(), dictionary.size() );
+   FC_ASSERT( out.good(), "Unable to write block dictionary" );
+} FC_CAPTURE_AND_RETHROW( (dir) ) } // GCOVR_EXCL_LINE
+
+} } // graphene::chain
@@ -7,6 +7,7 @@
 #include <graphene/chain/operation_history_object.hpp>
 
 #include <graphene/chain/proposal_object.hpp>
+#include <graphene/chain/read_snapshot.hpp>
 #include <graphene/chain/transaction_history_object.hpp>
 #include <graphene/chain/validator_object.hpp>
 #include <graphene/chain/exceptions.hpp>
@@ -96,10 +97,11 @@ bool database::push_block(const signed_block& new_block, uint32_t skip)
    bool result;
    detail::with_skip_flags( *this, skip, [&]()
    {
-      detail::without_pending_transactions( *this, std::move(_pending_tx),
+      detail::without_pending_transactions( *this, _pending_tx.release(),
       [&]()
       {
          result = _push_block(new_block);
+         publish_read_snapshot();
       });
    });
    return result;
@@ -254,6 +256,11 @@ processed_transaction database::push_transaction( const precomputable_transactio
 } FC_CAPTURE_AND_RETHROW( (trx) ) } // GCOVR_EXCL_LINE
 
 processed_transaction database::_push_transaction( const precomputable_transaction& trx )
+{
+   return _push_transaction( trx, mempool::describe( *this, trx ) );
+}
+
+processed_transaction database::_push_transaction( const precomputable_transaction& trx, mempool::entry&& entry )
 {
    // If this is the first transaction pushed after applying a block, start a new undo session.
    // This allows us to quickly rewind to the clean state of the head block, in case a new block arrives.
@@ -265,9 +272,19 @@ processed_transaction database::_push_transaction( const precomputable_transacti
    // _apply_transaction fails.  If we make it to merge(), we
    // apply the changes.
 
+   // When the pool is full, only a transaction paying a higher fee rate than the lowest ones gets in.
+   GRAPHENE_ASSERT( _pending_tx.account_has_room_for( entry ), mempool_full,
+                    "No room for transaction ${id}, its fee payer ${a} has ${max} pending transactions already",
+                    ("id", entry.id)("a", entry.fee_payer)("max", _pending_tx.max_per_account()) );
+   GRAPHENE_ASSERT( _pending_tx.has_room_for( entry ), mempool_full,
+                    "No room for transaction ${id} paying ${rate} per kilobyte, ${n} pending transactions",
+                    ("id", entry.id)("rate", entry.fee_rate)("n", _pending_tx.size()) );
+
    auto temp_session = _undo_db.start_undo_session();
    auto processed_trx = _apply_transaction( trx );
-   _pending_tx.push_back(processed_trx);
+   entry.trx = processed_trx;
+   _pending_tx.make_room( entry );
+   _pending_tx.insert( std::move(entry) );
 
    // notify_changed_objects();
    // The transaction applied successfully. Merge its changes into the pending block session.
@@ -407,8 +424,9 @@ signed_block database::_generate_block(
    _pending_tx_session = _undo_db.start_undo_session();
 
    uint64_t postponed_tx_count = 0;
-   for( const processed_transaction& tx : _pending_tx )
+   for( const auto& pending : _pending_tx.indices().get<mempool::by_sequence>() )
    {
+      const processed_transaction& tx = pending.trx;
       size_t new_total_size = total_block_size + fc::raw::pack_size( tx );
 
       // postpone transaction if it would make block too big
@@ -496,8 +514,20 @@ void database::pop_block()
    _popped_tx.insert( _popped_tx.begin(),
                       fork_db_head->data.transactions.begin(),
                       fork_db_head->data.transactions.end() );
+   publish_read_snapshot();
 } FC_CAPTURE_AND_RETHROW() } // GCOVR_EXCL_LINE
 
+std::shared_ptr<const read_snapshot> database::read_snapshot()const
+{
+   return std::atomic_load( &_read_snapshot );
+}
+
+void database::publish_read_snapshot()
+{
+   if( _read_snapshot_publisher )
+      std::atomic_store( &_read_snapshot, _read_snapshot_publisher->publish() );
+}
+
 void database::clear_pending()
 { try {
    assert( (_pending_tx.size() == 0) || _pending_tx_session.valid() );
@@ -585,6 +615,9 @@ void database::_apply_block( const signed_block& next_block )
    _current_block_time   = next_block.timestamp;
 
    signed_block processed_block( next_block ); // make a copy
+   std::shared_ptr<const precomputed_authorities> authorities;
+   if( 0 == (skip & skip_transaction_signatures) )
+      authorities = _take_precomputed_authorities( next_block );
    for( auto& trx : processed_block.transactions )
    {
       /* We do not need to push the undo state for each transaction
@@ -593,7 +626,9 @@ void database::_apply_block( const signed_block& next_block )
        * for transactions when validating broadcast transactions or
        * when building a block.
        */
-      trx.operation_results = apply_transaction( trx, skip ).operation_results;
+      const bool verified = authorities && _is_authority_verified( *authorities, _current_trx_in_block );
+      trx.operation_results = apply_transaction( trx, verified ? ( skip | skip_transaction_signatures ) : skip )
+                                 .operation_results;
       ++_current_trx_in_block;
    }
 
@@ -801,8 +836,109 @@ void database::_precompute_parallel( const Trx* trx, const size_t count, const u
    }
 }
 
+std::shared_ptr<database::precomputed_authorities> database::_copy_authorities( const signed_block& block )const
+{
+   auto result = std::make_shared<precomputed_authorities>();
+   result->max_authority_depth = get_global_properties().parameters.max_authority_depth;
+   result->transactions.resize( block.transactions.size() );
+
+   // the accounts the transactions require, then the ones their authorities refer to, as deep as verifying goes
+   flat_set<account_id_type> level;
+   for( const auto& trx : block.transactions )
+   {
+      vector<authority> other;
+      for( const auto& op : trx.operations )
+         operation_get_required_authorities( op, level, level, other );
+      for( const auto& auth : other )
+         for( const auto& account : auth.account_auths )
+            level.insert( account.first );
+   }
+   for( uint32_t depth = 0; depth <= result->max_authority_depth && !level.empty(); ++depth )
+   {
+      flat_set<account_id_type> next_level;
+      for( const account_id_type id : level )
+      {
+         const account_object* account = find( id );
+         if( account == nullptr || result->accounts.find( id ) != result->accounts.end() )
+            continue;
+         result->accounts.emplace( id, std::make_pair( account->active, account->owner ) );
+         for( const auto& auth : account->active.account_auths )
+            next_level.insert( auth.first );
+         for( const auto& auth : account->owner.account_auths )
+            next_level.insert( auth.first );
+      }
+      level = std::move( next_level );
+   }
+   return result;
+}
+
+void database::_verify_authorities( const signed_block& block, size_t base, size_t count,
+                                    precomputed_authorities& authorities )const
+{
+   for( size_t i = base; i < base + count; ++i )
+   {
+      auto& result = authorities.transactions[i];
+      auto get_authorities = [&authorities,&result]( account_id_type id ) -> const std::pair<authority,authority>& {
+         result.reads.insert( id );
+         auto itr = authorities.accounts.find( id );
+         FC_ASSERT( itr != authorities.accounts.end(), "The authorities of ${a} were not copied", ("a",id) );
+         return itr->second;
+      };
+      auto get_active = [&get_authorities]( account_id_type id ) { return &get_authorities( id ).first; };
+      auto get_owner  = [&get_authorities]( account_id_type id ) { return &get_authorities( id ).second; };
+      try
+      {
+         block.transactions[i].verify_authority( get_chain_id(), get_active, get_owner,
+                                                 authorities.max_authority_depth );
+         result.verified = true;
+      }
+      catch( const fc::exception& )
+      {
+         // verified again when applied, which reports the error
+      }
+   }
+}
+
+std::shared_ptr<const database::precomputed_authorities> database::_take_precomputed_authorities(
+      const signed_block& block )
+{
+   const block_id_type id = block.id();
+   auto itr = std::find_if( _precomputed_authorities.begin(), _precomputed_authorities.end(),
+                            [&id]( const auto& item ) { return item.first == id; } );
+   if( itr == _precomputed_authorities.end() )
+      return nullptr;
+   std::shared_ptr<const precomputed_authorities> result = std::move( itr->second );
+   _precomputed_authorities.erase( itr );
+   if( result->transactions.size() != block.transactions.size()
+         || result->max_authority_depth != get_global_properties().parameters.max_authority_depth )
+      return nullptr;
+   return result;
+}
+
+bool database::_is_authority_verified( const precomputed_authorities& authorities, size_t trx_in_block )const
+{
+   const auto& result = authorities.transactions[trx_in_block];
+   if( !result.verified )
+      return false;
+   // the verification only depends on these authorities, an earlier transaction of the block may have changed them
+   for( const account_id_type id : result.reads )
+   {
+      const account_object* account = find( id );
+      const auto& copy = authorities.accounts.at( id );
+      if( account == nullptr || !( account->active == copy.first ) || !( account->owner == copy.second ) )
+         return false;
+   }
+   return true;
+}
+
 fc::future<void> database::precompute_parallel( const signed_block& block, const uint32_t skip )const
 { try {
+   // Copied here, before anything yields, so that the workers never read the database. Whatever changes it
+   // meanwhile is caught by _is_authority_verified() when the block is applied.
+   std::shared_ptr<precomputed_authorities> authorities;
+   if( _parallel_authority_check && 0 == (skip & skip_transaction_signatures) && !block.transactions.empty() )
+      authorities = _copy_authorities( block );
+
    std::vector<fc::future<void>> workers;
    if( !block.transactions.empty() )
    {
@@ -810,16 +946,28 @@ fc::future<void> database::precompute_parallel( const signed_block& block, const
          _precompute_parallel( &block.transactions[0], block.transactions.size(), skip );
       else
       {
-         uint32_t chunks = fc::asio::default_io_service_scope::get_num_threads();
-         uint32_t chunk_size = ( block.transactions.size() + chunks - 1 ) / chunks;
+         // Signature recovery dominates, so the chunks are balanced by the number of signatures rather than the
+         // number of transactions. Each transaction is weighted one more than its signatures for the remaining work.
+         const uint32_t chunks = fc::asio::default_io_service_scope::get_num_threads();
+         uint64_t total_weight = 0;
+         for( const auto& trx : block.transactions )
+            total_weight += trx.signatures.size() + 1;
+         const uint64_t chunk_weight = ( total_weight + chunks - 1 ) / chunks;
          workers.reserve( chunks + 1 );
-         for( size_t base = 0; base < block.transactions.size(); base += chunk_size )
-            workers.push_back( fc::do_parallel( [this,&block,base,chunk_size,skip] () {
-               _precompute_parallel( &block.transactions[base],
-                                     ( ( base + chunk_size ) < block.transactions.size() ) ? chunk_size
-                                                 : ( block.transactions.size() - base ),
-                                     skip );
+         size_t base = 0;
+         while( base < block.transactions.size() )
+         {
+            size_t count = 0;
+            uint64_t weight = 0;
+            while( base + count < block.transactions.size() && weight < chunk_weight )
+               weight += block.transactions[base + count++].signatures.size() + 1;
+            workers.push_back( fc::do_parallel( [this,&block,base,count,skip,authorities] () {
+               _precompute_parallel( &block.transactions[base], count, skip );
+               if( authorities )
+                  _verify_authorities( block, base, count, *authorities );
             }) );
+            base += count;
+         }
       }
    }
 
@@ -829,16 +977,49 @@ fc::future<void> database::precompute_parallel( const signed_block& block, const
       block.calculate_merkle_root();
    block.id();
 
-   if( workers.empty() )
-      return fc::future< void >( fc::promise< void >::create( true ) );
+   // the workers use the block, all of them must be done before an exception leaves
+   std::exception_ptr failure;
+   for( auto& worker : workers )
+   {
+      try
+      {
+         worker.wait();
+      }
+      catch( ... )
+      {
+         if( !failure )
+            failure = std::current_exception();
+      }
+   }
+   if( failure )
+      std::rethrow_exception( failure );
 
-   auto first = workers.begin();
-   auto worker = first;
-   while( ++worker != workers.end() )
-      worker->wait();
-   return *first;
+   if( authorities )
+   {
+      const size_t max_precomputed_blocks = 64;
+      const block_id_type id = block.id();
+      auto itr = std::find_if( _precomputed_authorities.begin(), _precomputed_authorities.end(),
+                               [&id]( const auto& item ) { return item.first == id; } );
+      if( itr != _precomputed_authorities.end() )
+         _precomputed_authorities.erase( itr );
+      if( _precomputed_authorities.size() >= max_precomputed_blocks )
+         _precomputed_authorities.pop_front();
+      _precomputed_authorities.emplace_back( id, std::move( authorities ) );
+   }
+   return fc::future< void >( fc::promise< void >::create( true ) );
 } FC_LOG_AND_RETHROW() }
 
+void database::precompute_serial( const signed_block& block, const uint32_t skip )const
+{
+   if( !block.transactions.empty() )
+      _precompute_parallel( &block.transactions[0], block.transactions.size(), skip );
+   if( 0 == (skip&skip_validator_signature) )
+      block.signee();
+   if( 0 == (skip&skip_merkle_check) )
+      block.calculate_merkle_root();
+   block.id();
+}
+
 fc::future<void> database::precompute_parallel( const precomputable_transaction& trx )const
 {
    return fc::do_parallel([this,&trx] () {
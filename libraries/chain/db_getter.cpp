@@ -3,6 +3,8 @@
 #include <graphene/chain/asset_object.hpp>
 #include <graphene/chain/chain_property_object.hpp>
 #include <graphene/chain/global_property_object.hpp>
+#include <graphene/chain/market_object.hpp>
+#include <graphene/chain/vote_tally_tracker.hpp>
 
 namespace graphene { namespace chain {
 
@@ -31,6 +33,21 @@ const dynamic_global_property_object& database::get_dynamic_global_properties()
    return *_p_dyn_global_prop_obj;
 }
 
+const limit_order_book_index& database::get_limit_order_book()const
+{
+   return *_p_limit_order_book;
+}
+
+const call_order_trigger_index& database::get_call_order_triggers()const
+{
+   return *_p_call_order_triggers;
+}
+
+const vote_tally_tracker& database::get_vote_tally_tracker()const
+{
+   return *_p_vote_tally_tracker;
+}
+
 const fee_schedule&  database::current_fee_schedule()const
 {
    return get_global_properties().parameters.get_current_fees();
@@ -18,6 +18,7 @@
 #include <graphene/chain/special_authority_object.hpp>
 #include <graphene/chain/transaction_history_object.hpp>
 #include <graphene/chain/vesting_balance_object.hpp>
+#include <graphene/chain/vote_tally_tracker.hpp>
 #include <graphene/chain/withdraw_permission_object.hpp>
 #include <graphene/chain/validator_object.hpp>
 #include <graphene/chain/producer_schedule_object.hpp>
@@ -111,17 +112,21 @@ void database::initialize_indexes()
    auto acnt_index = add_index< primary_index<account_index, 20> >(); // ~1 million accounts per chunk
    acnt_index->add_secondary_index<account_member_index>();
    acnt_index->add_secondary_index<account_referrer_index>();
+   _p_vote_tally_tracker = acnt_index->add_secondary_index<vote_tally_tracker>();
 
    add_index< primary_index<delegate_index, 8> >(); // 256 members per chunk
    add_index< primary_index<validator_index, 10> >(); // 1024 validators per chunk
-   add_index< primary_index<limit_order_index > >();
-   add_index< primary_index<call_order_index > >();
+   auto limit_order_idx = add_index< primary_index<limit_order_index > >();
+   _p_limit_order_book = limit_order_idx->add_secondary_index<limit_order_book_index>();
+   auto call_order_idx = add_index< primary_index<call_order_index > >();
+   _p_call_order_triggers = call_order_idx->add_secondary_index<call_order_trigger_index>( &call_order_idx->indices() );
 
    auto prop_index = add_index< primary_index<proposal_index > >();
    prop_index->add_secondary_index<required_approval_index>();
 
    add_index< primary_index<withdraw_permission_index > >();
-   add_index< primary_index<vesting_balance_index> >();
+   auto vesting_balance_idx = add_index< primary_index<vesting_balance_index> >();
+   vesting_balance_idx->add_secondary_index< vote_tally_marker_index<vesting_balance_object> >( _p_vote_tally_tracker );
    add_index< primary_index<worker_index> >();
    add_index< primary_index<balance_index> >();
    add_index< primary_index<blinded_balance_index> >();
@@ -136,7 +141,8 @@ void database::initialize_indexes()
    add_index< primary_index<backed_asset_data_index,                 13 > >(); // 8192
    add_index< primary_index<simple_index<global_property_object          >> >();
    add_index< primary_index<simple_index<dynamic_global_property_object  >> >();
-   add_index< primary_index<account_stats_index,                       20 > >(); // 1 Mi
+   auto stats_idx = add_index< primary_index<account_stats_index,                20 > >(); // 1 Mi
+   stats_idx->add_secondary_index< vote_tally_marker_index<account_statistics_object> >( _p_vote_tally_tracker );
    add_index< primary_index<simple_index<asset_dynamic_data_object       >> >();
    add_index< primary_index<simple_index<block_summary_object            >> >();
    add_index< primary_index<simple_index<chain_property_object          > > >();
@@ -1,4 +1,6 @@
+#include <fc/asio.hpp>
 #include <fc/uint128.hpp>
+#include <fc/thread/parallel.hpp>
 
 #include <graphene/protocol/market.hpp>
 
@@ -18,9 +20,12 @@
 #include <graphene/chain/special_authority_object.hpp>
 #include <graphene/chain/vesting_balance_object.hpp>
 #include <graphene/chain/vote_count.hpp>
+#include <graphene/chain/vote_tally_tracker.hpp>
 #include <graphene/chain/validator_object.hpp>
 #include <graphene/chain/worker_object.hpp>
 
+#include <future>
+
 namespace graphene { namespace chain {
 
 template<class Index>
@@ -47,8 +52,7 @@ vector<std::reference_wrapper<const typename Index::object_type>> database::sort
    return refs;
 }
 
-template<class Type>
-void database::perform_account_maintenance(Type tally_helper)
+void database::update_core_in_balances()
 {
    const auto& bal_idx = get_index_type< account_balance_index >().indices().get< by_maintenance_flag >();
    if( bal_idx.begin() != bal_idx.end() )
@@ -69,7 +73,11 @@ void database::perform_account_maintenance(Type tally_helper)
          bal_itr = bal_idx.rbegin();
       }
    }
+}
 
+template<class Type>
+void database::perform_account_maintenance(Type& tally_helper)
+{
    const auto& stats_idx = get_index_type< account_stats_index >().indices().get< by_maintenance_seq >();
    auto stats_itr = stats_idx.lower_bound( true );
 
@@ -802,6 +810,17 @@ void database::perform_chain_maintenance(const signed_block& next_block)
    struct vote_tally_helper {
       database& d;
       const global_property_object& props;
+      /// Stake accounts and their voting stake, recorded by the walk when tallying in parallel
+      vector< std::pair<const account_object*, uint64_t> > stakes;
+
+      /// Where a part of the stakes is added up
+      struct tally_shard
+      {
+         vector<uint64_t> vote_tally;
+         vector<uint64_t> validator_count_histogram;
+         vector<uint64_t> council_count_histogram;
+         uint64_t         total_voting_stake = 0;
+      };
 
       vote_tally_helper(database& d, const global_property_object& gpo)
          : d(d), props(gpo)
@@ -814,59 +833,214 @@ void database::perform_chain_maintenance(const signed_block& next_block)
 
       void operator()( const account_object& stake_account, const account_statistics_object& stats )
       {
-         if( props.parameters.count_non_member_votes || stake_account.is_member(d.head_block_time()) )
+         if( vote_tally_tracker::counts_votes( d, stake_account ) )
          {
-            // There may be a difference between the account whose stake is voting and the one specifying opinions.
-            // Usually they're the same, but if the stake account has specified a voting_account, that account is the one
-            // specifying the opinions.
-            const account_object& opinion_account =
-                  (stake_account.options.voting_account ==
-                   GRAPHENE_PROXY_TO_SELF_ACCOUNT)? stake_account
-                                     : d.get(stake_account.options.voting_account);
-
-            uint64_t voting_stake = stats.total_core_in_orders.value
-                  + (stake_account.cashback_vb.valid() ? (*stake_account.cashback_vb)(d).balance.amount.value: 0)
-                  + stats.core_in_balance.value;
-
-            for( vote_id_type id : opinion_account.options.votes )
-            {
-               uint32_t offset = id.instance();
-               // if they somehow managed to specify an illegal offset, ignore it.
-               if( offset < d._vote_tally_buffer.size() )
-                  d._vote_tally_buffer[offset] += voting_stake;
-            }
+            // The stake is read during the walk even when tallying in parallel, because process_fees() of the
+            // accounts walked before pays cashback to the accounts walked after
+            uint64_t voting_stake = vote_tally_tracker::voting_stake( d, stake_account, stats );
+
+            if( d._p_vote_tally_tracker->enabled() )
+               d._p_vote_tally_tracker->record( d, stake_account, voting_stake );
+
+            if( d._parallel_vote_tally )
+               stakes.emplace_back( &stake_account, voting_stake );
+            else
+               tally( stake_account, voting_stake, d._vote_tally_buffer, d._validator_count_histogram_buffer,
+                      d._council_count_histogram_buffer, d._total_voting_stake );
+         }
+      }
+
+      void tally( const account_object& stake_account, uint64_t voting_stake, vector<uint64_t>& vote_tally,
+                  vector<uint64_t>& validator_count_histogram, vector<uint64_t>& council_count_histogram,
+                  uint64_t& total_voting_stake )const
+      {
+         // There may be a difference between the account whose stake is voting and the one specifying opinions.
+         // Usually they're the same, but if the stake account has specified a voting_account, that account is the one
+         // specifying the opinions.
+         const account_object& opinion_account =
+               (stake_account.options.voting_account ==
+                GRAPHENE_PROXY_TO_SELF_ACCOUNT)? stake_account
+                                  : d.get(stake_account.options.voting_account);
+
+         for( vote_id_type id : opinion_account.options.votes )
+         {
+            uint32_t offset = id.instance();
+            // if they somehow managed to specify an illegal offset, ignore it.
+            if( offset < vote_tally.size() )
+               vote_tally[offset] += voting_stake;
+         }
+
+         if( opinion_account.options.num_producers <= props.parameters.maximum_producer_count )
+         {
+            uint16_t offset = std::min(size_t(opinion_account.options.num_producers/2),
+                                       validator_count_histogram.size() - 1);
+            // votes for a number greater than maximum_producer_count
+            // are turned into votes for maximum_producer_count.
+            //
+            // in particular, this takes care of the case where a
+            // member was voting for a high number, then the
+            // parameter was lowered.
+            validator_count_histogram[offset] += voting_stake;
+         }
+         if( opinion_account.options.num_delegates <= props.parameters.maximum_council_count )
+         {
+            uint16_t offset = std::min(size_t(opinion_account.options.num_delegates/2),
+                                       council_count_histogram.size() - 1);
+            // votes for a number greater than maximum_council_count
+            // are turned into votes for maximum_council_count.
+            //
+            // same rationale as for validators
+            council_count_histogram[offset] += voting_stake;
+         }
+
+         total_voting_stake += voting_stake;
+      }
+
+      /// Adds up the stakes recorded by the walk, in contiguous parts on the worker threads, then adds the parts
+      /// to the database buffers. The totals are sums, so they do not depend on how the stakes are split.
+      void tally_recorded_stakes()
+      {
+         const size_t shards = std::min<size_t>( fc::asio::default_io_service_scope::get_num_threads(),
+                                                 stakes.size() / d._vote_tally_shard_size );
+         if( shards <= 1 )
+         {
+            for( const auto& stake : stakes )
+               tally( *stake.first, stake.second, d._vote_tally_buffer, d._validator_count_histogram_buffer,
+                      d._council_count_histogram_buffer, d._total_voting_stake );
+            stakes.clear();
+            return;
+         }
 
-            if( opinion_account.options.num_producers <= props.parameters.maximum_producer_count )
+         const size_t shard_size = ( stakes.size() + shards - 1 ) / shards;
+         vector<tally_shard> results( shards );
+         // The workers read accounts from the database. Waiting on an fc future would let other tasks of this
+         // thread change them meanwhile, in the middle of the maintenance block, so this thread blocks instead.
+         std::vector<std::promise<void>> done( shards );
+         std::vector<std::future<void>> workers;
+         workers.reserve( shards );
+         for( size_t i = 0; i < shards; ++i )
+         {
+            const size_t base = i * shard_size;
+            const size_t end = std::min( base + shard_size, stakes.size() );
+            tally_shard& shard = results[i];
+            shard.vote_tally.resize( d._vote_tally_buffer.size() );
+            shard.validator_count_histogram.resize( d._validator_count_histogram_buffer.size() );
+            shard.council_count_histogram.resize( d._council_count_histogram_buffer.size() );
+            workers.push_back( done[i].get_future() );
+            fc::do_parallel( [this,&shard,&promise=done[i],base,end] () {
+               try
+               {
+                  for( size_t j = base; j < end; ++j )
+                     tally( *stakes[j].first, stakes[j].second, shard.vote_tally, shard.validator_count_histogram,
+                            shard.council_count_histogram, shard.total_voting_stake );
+                  promise.set_value();
+               }
+               catch( ... )
+               {
+                  promise.set_exception( std::current_exception() );
+               }
+            });
+         }
+         // the workers use results and stakes, all of them must be done before an exception leaves
+         std::exception_ptr failure;
+         for( auto& worker : workers )
+         {
+            try
             {
-               uint16_t offset = std::min(size_t(opinion_account.options.num_producers/2),
-                                          d._validator_count_histogram_buffer.size() - 1);
-               // votes for a number greater than maximum_producer_count
-               // are turned into votes for maximum_producer_count.
-               //
-               // in particular, this takes care of the case where a
-               // member was voting for a high number, then the
-               // parameter was lowered.
-               d._validator_count_histogram_buffer[offset] += voting_stake;
+               worker.get();
             }
-            if( opinion_account.options.num_delegates <= props.parameters.maximum_council_count )
+            catch( ... )
             {
-               uint16_t offset = std::min(size_t(opinion_account.options.num_delegates/2),
-                                          d._council_count_histogram_buffer.size() - 1);
-               // votes for a number greater than maximum_council_count
-               // are turned into votes for maximum_council_count.
-               //
-               // same rationale as for validators
-               d._council_count_histogram_buffer[offset] += voting_stake;
+               if( !failure )
+                  failure = std::current_exception();
             }
+         }
+         if( failure )
+            std::rethrow_exception( failure );
 
-            d._total_voting_stake += voting_stake;
+         for( const tally_shard& shard : results )
+         {
+            for( size_t i = 0; i < shard.vote_tally.size(); ++i )
+               d._vote_tally_buffer[i] += shard.vote_tally[i];
+            for( size_t i = 0; i < shard.validator_count_histogram.size(); ++i )
+               d._validator_count_histogram_buffer[i] += shard.validator_count_histogram[i];
+            for( size_t i = 0; i < shard.council_count_histogram.size(); ++i )
+               d._council_count_histogram_buffer[i] += shard.council_count_histogram[i];
+            d._total_voting_stake += shard.total_voting_stake;
          }
+         stakes.clear();
       }
    };
    
+   update_core_in_balances();
+
    vote_tally_helper tally_helper(*this, gpo);
 
-   perform_account_maintenance( tally_helper );
+   vote_tally_tracker& tracker = *_p_vote_tally_tracker;
+   const bool incremental = tracker.enabled() && tracker.is_current( *this );
+   if( incremental && !_check_incremental_vote_tally )
+   {
+      // the tracker is not undone with the block, if the block fails half way through the update the next
+      // maintenance must recount fully
+      try
+      {
+         tracker.update( *this );
+         tracker.get_totals( gpo.parameters, _vote_tally_buffer, _validator_count_histogram_buffer,
+                             _council_count_histogram_buffer, _total_voting_stake );
+      }
+      catch( ... )
+      {
+         tracker.reset();
+         throw;
+      }
+   }
+   else
+   {
+      vector<uint64_t> incremental_votes;
+      vector<uint64_t> incremental_validator_counts;
+      vector<uint64_t> incremental_council_counts;
+      uint64_t incremental_total = 0;
+      if( incremental )
+      {
+         // update() processes the fees as the full recount below does, so it is undone along with them
+         const vote_tally_tracker before = tracker;
+         try
+         {
+            auto session = _undo_db.start_undo_session( true );
+            tracker.update( *this );
+            incremental_votes.resize( _vote_tally_buffer.size() );
+            incremental_validator_counts.resize( _validator_count_histogram_buffer.size() );
+            incremental_council_counts.resize( _council_count_histogram_buffer.size() );
+            tracker.get_totals( gpo.parameters, incremental_votes, incremental_validator_counts,
+                                incremental_council_counts, incremental_total );
+         }
+         catch( ... )
+         {
+            tracker = before;
+            throw;
+         }
+         tracker = before;
+      }
+
+      if( tracker.enabled() )
+         tracker.reset();
+      perform_account_maintenance( tally_helper );
+      tally_helper.tally_recorded_stakes();
+
+      if( incremental )
+      {
+         const bool passed = incremental_votes == _vote_tally_buffer
+                             && incremental_validator_counts == _validator_count_histogram_buffer
+                             && incremental_council_counts == _council_count_histogram_buffer
+                             && incremental_total == _total_voting_stake;
+         if( !passed )
+            elog( "Incremental vote tally differs from the full recount at block ${b}: total voting stake ${i} "
+                  "instead of ${f}", ("b",next_block.block_num())("i",incremental_total)("f",_total_voting_stake) );
+         tracker.count_check( passed );
+      }
+   }
+   if( tracker.enabled() )
+      tracker.set_current( *this, next_block );
 
    struct clear_canary {
       clear_canary(vector<uint64_t>& target): target(target){}
@@ -4,16 +4,23 @@
 #include <graphene/chain/producer_schedule_object.hpp>
 #include <graphene/chain/special_authority_object.hpp>
 #include <graphene/chain/operation_history_object.hpp>
+#include <graphene/chain/read_snapshot.hpp>
+#include <graphene/chain/vote_tally_tracker.hpp>
 
 #include <graphene/protocol/fee_schedule.hpp>
 
 #include <fc/io/fstream.hpp>
+#include <fc/io/raw.hpp>
+#include <fc/thread/parallel.hpp>
 
+#include <atomic>
+#include <deque>
 #include <fstream>
 #include <functional>
+#include <iomanip>
 #include <iostream>
-#include <queue>
-#include <tuple>
+#include <memory>
+#include <sstream>
 
 namespace graphene { namespace chain {
 
@@ -28,6 +35,82 @@ database::~database()
    clear_pending();
 }
 
+void database::enable_incremental_vote_tally( bool enable, bool check )
+{
+   _p_vote_tally_tracker->enable( enable );
+   _check_incremental_vote_tally = check;
+}
+
+namespace {
+
+   /// Busy time of each replay stage and how long the apply stage had to wait for the others, in microseconds
+   struct replay_stats
+   {
+      std::atomic<uint64_t> read{0};
+      std::atomic<uint64_t> decode{0};
+      std::atomic<uint64_t> precompute{0};
+      uint64_t              apply = 0;
+      uint64_t              waited_for_read = 0;
+      uint64_t              waited_for_decode = 0;
+      uint64_t              waited_for_precompute = 0;
+   };
+
+   /// A run of consecutive blocks that goes through the read, decode and precompute stages as one pool task
+   struct replay_batch
+   {
+      enum stage_type : uint8_t { reading, decoding, precomputing, done };
+
+      uint32_t                  first_block_num = 0;
+      uint32_t                  requested = 0;
+      std::vector<signed_block> blocks;    ///< stops short of requested at the first missing or corrupt block
+      std::vector<size_t>       positions; ///< end of each block in the blocks file, for progress reporting
+      std::atomic<uint8_t>      stage{reading};
+      fc::future<void>          ready;
+   };
+
+   /**
+    * The batches in flight, oldest first. The pool tasks refer to locals of reindex(), so they are waited for when
+    * the replay ends early, also when it is left by an exception.
+    */
+   struct replay_batches
+   {
+      std::deque< std::shared_ptr<replay_batch> > in_flight;
+
+      ~replay_batches() { wait_all(); }
+
+      void wait_all()
+      {
+         for( auto& batch : in_flight )
+         {
+            try
+            {
+               batch->ready.wait();
+            }
+            catch( ... )
+            {
+            }
+         }
+         in_flight.clear();
+      }
+   };
+
+   void log_replay_stats( const replay_stats& stats )
+   {
+      auto secs = []( uint64_t us ) {
+         std::stringstream ss;
+         ss << std::fixed << std::setprecision(1) << double(us) / 1000000;
+         return ss.str();
+      };
+      ilog( "   [stage busy: read ${r}s, decode ${d}s, precompute ${p}s, apply ${a}s]"
+            "   [apply waited on: read ${wr}s, decode ${wd}s, precompute ${wp}s]",
+            ("r", secs( stats.read.load() ))("d", secs( stats.decode.load() ))
+            ("p", secs( stats.precompute.load() ))("a", secs( stats.apply ))
+            ("wr", secs( stats.waited_for_read ))("wd", secs( stats.waited_for_decode ))
+            ("wp", secs( stats.waited_for_precompute )) );
+   }
+
+}
+
 void database::reindex( fc::path data_dir )
 { try {
    auto last_block = _block_id_to_block.last();
@@ -56,52 +139,99 @@ void database::reindex( fc::path data_dir )
 
    size_t total_block_size = _block_id_to_block.total_block_size();
    const auto& gpo = get_global_properties();
-   std::queue< std::tuple< size_t, signed_block, fc::future< void > > > blocks;
-   uint32_t next_block_num = head_block_num() + 1;
-   uint32_t i = next_block_num;
-   while( next_block_num <= last_block_num || !blocks.empty() )
-   {
-      if( next_block_num <= last_block_num && blocks.size() < 20 )
-      {
-         const size_t processed_block_size = _block_id_to_block.blocks_current_position();
-         fc::optional< signed_block > block = _block_id_to_block.fetch_by_number( next_block_num );
-         ++next_block_num;
-         if( block.valid() )
-         {
-            if( block->timestamp >= (last_block->timestamp - gpo.parameters.maximum_time_until_expiration) )
-               skip &= (uint32_t)(~skip_transaction_dupe_check);
-            blocks.emplace( processed_block_size, std::move(*block), fc::future<void>() );
-            std::get<2>(blocks.back()) = precompute_parallel( std::get<1>(blocks.back()), skip );
-         }
-         else
+
+   // Blocks are read from disk, unpacked and precomputed by batches running on the thread pool, while this
+   // thread applies them in order. The pool tasks only see the expiration window as of the start of the replay,
+   // the apply stage keeps using the current one.
+   const fc::time_point_sec precompute_dupe_check_from = last_block->timestamp
+                                                         - gpo.parameters.maximum_time_until_expiration;
+   const uint32_t threads = std::max( 1u, uint32_t( fc::asio::default_io_service_scope::get_num_threads() ) );
+   const uint32_t batch_size = std::max( 1u, std::min( 500u, _replay_pipeline_depth / ( 2 * threads ) ) );
+   const uint32_t max_batches = std::max( 1u, ( _replay_pipeline_depth + batch_size - 1 ) / batch_size );
+   ilog( "Replay pipeline: ${n} batches of ${b} blocks in flight", ("n", max_batches)("b", batch_size) );
+
+   replay_stats stats;
+   auto start_batch = [this,&stats,&precompute_dupe_check_from,skip]( uint32_t first_block_num, uint32_t count ) {
+      auto batch = std::make_shared<replay_batch>();
+      batch->first_block_num = first_block_num;
+      batch->requested = count;
+      batch->ready = fc::do_parallel( [this,batch,&stats,&precompute_dupe_check_from,skip] () {
+         auto stage_start = fc::time_point::now();
+         const auto range = _block_id_to_block.read_range( batch->first_block_num, batch->requested );
+         auto stage_end = fc::time_point::now();
+         stats.read += ( stage_end - stage_start ).count();
+
+         batch->stage = replay_batch::decoding;
+         stage_start = stage_end;
+         batch->blocks.reserve( range.entries.size() );
+         batch->positions.reserve( range.entries.size() );
+         for( const auto& entry : range.entries )
          {
-            wlog( "Reindexing terminated due to gap:  Block ${i} does not exist!", ("i", i) );
-            uint32_t dropped_count = 0;
-            while( true )
+            try
             {
-               fc::optional< block_id_type > last_id = _block_id_to_block.last_id();
-               // this can trigger if we attempt to e.g. read a file that has block #2 but no block #1
-               // OR
-               // we've caught up to the gap
-               if( !last_id.valid() || block_header::num_from_id( *last_id ) <= i )
+               fc::datastream<const char*> ds( range.data.data() + entry.offset, entry.size );
+               signed_block block;
+               fc::raw::unpack( ds, block );
+               if( block.id() != entry.block_id )
                   break;
-               _block_id_to_block.remove( *last_id );
-               ++dropped_count;
+               batch->blocks.emplace_back( std::move( block ) );
+               batch->positions.push_back( entry.position + entry.size );
+            }
+            catch( const fc::exception& )
+            {
+               break;
             }
-            wlog( "Dropped ${n} blocks from after the gap", ("n", dropped_count) );
-            next_block_num = last_block_num + 1; // don't load more blocks
          }
+         stage_end = fc::time_point::now();
+         stats.decode += ( stage_end - stage_start ).count();
+
+         batch->stage = replay_batch::precomputing;
+         stage_start = stage_end;
+         for( const auto& block : batch->blocks )
+            precompute_serial( block, block.timestamp >= precompute_dupe_check_from
+                                      ? skip & (uint32_t)(~skip_transaction_dupe_check) : skip );
+         stats.precompute += ( fc::time_point::now() - stage_start ).count();
+         batch->stage = replay_batch::done;
+      });
+      return batch;
+   };
+
+   replay_batches batches;
+   uint32_t next_block_num = head_block_num() + 1;
+   uint32_t i = next_block_num;
+   while( i <= last_block_num )
+   {
+      while( next_block_num <= last_block_num && batches.in_flight.size() < max_batches )
+      {
+         const uint32_t count = std::min( batch_size, last_block_num - next_block_num + 1 );
+         batches.in_flight.push_back( start_batch( next_block_num, count ) );
+         next_block_num += count;
       }
-      else
+
+      const auto batch = batches.in_flight.front();
+      batches.in_flight.pop_front();
+      const auto stage = batch->stage.load();
+      const auto wait_start = fc::time_point::now();
+      batch->ready.wait();
+      const uint64_t waited = ( fc::time_point::now() - wait_start ).count();
+      if( stage == replay_batch::reading )
+         stats.waited_for_read += waited;
+      else if( stage == replay_batch::decoding )
+         stats.waited_for_decode += waited;
+      else if( stage == replay_batch::precomputing )
+         stats.waited_for_precompute += waited;
+
+      for( size_t b = 0; b < batch->blocks.size(); ++b, ++i )
       {
-         std::get<2>(blocks.front()).wait();
-         const signed_block& block = std::get<1>(blocks.front());
+         const signed_block& block = batch->blocks[b];
+         if( block.timestamp >= (last_block->timestamp - gpo.parameters.maximum_time_until_expiration) )
+            skip &= (uint32_t)(~skip_transaction_dupe_check);
 
          if( i % 10000 == 0 )
          {
             std::stringstream bysize;
             std::stringstream bynum;
-            size_t current_pos = std::get<0>(blocks.front());
+            size_t current_pos = batch->positions[b];
             if( current_pos > total_block_size )
                total_block_size = current_pos;
             bysize << std::fixed << std::setprecision(5) << (100 * double(current_pos) / total_block_size);
@@ -115,6 +245,7 @@ void database::reindex( fc::path data_dir )
                ("i", i)
                ("last", last_block_num)
             );
+            log_replay_stats( stats );
          }
          if( i == undo_point )
          {
@@ -122,6 +253,7 @@ void database::reindex( fc::path data_dir )
             flush();
             ilog( "Done writing object database to disk" );
          }
+         const auto apply_start = fc::time_point::now();
          if( i < undo_point )
             apply_block( block, skip );
          else
@@ -129,12 +261,33 @@ void database::reindex( fc::path data_dir )
             _undo_db.enable();
             push_block( block, skip );
          }
-         blocks.pop();
-         ++i;
+         stats.apply += ( fc::time_point::now() - apply_start ).count();
+      }
+
+      if( batch->blocks.size() < batch->requested )
+      {
+         wlog( "Reindexing terminated due to gap:  Block ${i} does not exist!", ("i", i) );
+         // the batches read ahead must be done with the files before blocks are removed from them
+         batches.wait_all();
+         uint32_t dropped_count = 0;
+         while( true )
+         {
+            fc::optional< block_id_type > last_id = _block_id_to_block.last_id();
+            // this can trigger if we attempt to e.g. read a file that has block #2 but no block #1
+            // OR
+            // we've caught up to the gap
+            if( !last_id.valid() || block_header::num_from_id( *last_id ) <= i )
+               break;
+            _block_id_to_block.remove( *last_id );
+            ++dropped_count;
+         }
+         wlog( "Dropped ${n} blocks from after the gap", ("n", dropped_count) );
+         break;
       }
    }
    _undo_db.enable();
    auto end = fc::time_point::now();
+   log_replay_stats( stats );
    ilog( "Done reindexing, elapsed time: ${t} sec", ("t",double((end-start).count())/1000000.0 ) );
 } FC_CAPTURE_AND_RETHROW( (data_dir) ) } // GCOVR_EXCL_LINE
 
@@ -174,9 +327,29 @@ void database::open(
           version_file.close();
       }
 
+      const bool import_snapshot = _snapshot_head_block.valid() && !fc::exists( data_dir / "object_database" );
+      if( import_snapshot )
+      {
+         ilog( "Installing the state snapshot of block ${n} from ${d}",
+               ("n", _snapshot_head_block->block_num())("d", _snapshot_object_dir) );
+         // copied into a temporary directory first, an interrupted copy must not look like a complete state
+         const auto tmp_dir = data_dir / "object_database.tmp";
+         if( fc::exists( tmp_dir ) )
+            fc::remove_all( tmp_dir );
+         inspect_indexes( [this,&tmp_dir]( const graphene::db::index& idx ) {
+            const auto space = fc::to_string( idx.object_space_id() );
+            const auto type = fc::to_string( idx.object_type_id() );
+            fc::create_directories( tmp_dir / space );
+            const auto files = graphene::db::index_file_header::saved_shards( _snapshot_object_dir / space / type );
+            for( const auto& file : files )
+               fc::copy( file, tmp_dir / space / file.filename() );
+         });
+         fc::rename( tmp_dir, data_dir / "object_database" );
+      }
+
       object_database::open(data_dir);
 
-      _block_id_to_block.open(data_dir / "database" / "block_num_to_block");
+      _block_id_to_block.open( data_dir / "database" / "block_num_to_block", _block_storage_mode );
 
       if( !find(global_property_id_type()) )
          init_genesis(genesis_loader());
@@ -190,6 +363,19 @@ void database::open(
          _p_producer_schedule_obj = &get( producer_schedule_id_type() );
       }
 
+      if( import_snapshot )
+      {
+         if( head_block_id() != _snapshot_head_block->id() )
+         {
+            // do not leave a state behind that the next start would take for a valid one
+            object_database::wipe( data_dir );
+            FC_THROW( "The state snapshot does not match its head block",
+                      ("head", head_block_id())("snapshot", _snapshot_head_block->id()) );
+         }
+         if( !_block_id_to_block.contains( head_block_id() ) )
+            _block_id_to_block.store( head_block_id(), *_snapshot_head_block );
+      }
+
       fc::optional<block_id_type> last_block = _block_id_to_block.last_id();
       if( last_block.valid() )
       {
@@ -198,6 +384,20 @@ void database::open(
                     ("last_block->id", last_block)("head_block_id",head_block_num()) );
          reindex( data_dir );
       }
+
+      if( _read_snapshots_enabled )
+      {
+         if( !_read_snapshot_publisher )
+         {
+            _read_snapshot_publisher = std::make_unique<read_snapshot_publisher>( *this );
+            auto observer = _read_snapshot_publisher->make_observer();
+            inspect_indexes( [this,&observer]( const graphene::db::index& idx ) {
+               get_mutable_index( idx.object_space_id(), idx.object_type_id() ).add_observer( observer );
+            });
+         }
+         _read_snapshot_publisher->reset();
+         publish_read_snapshot();
+      }
       _opened = true;
    }
    FC_CAPTURE_LOG_AND_RETHROW( (data_dir) )
@@ -248,6 +448,7 @@ void database::close(bool rewinding)
       _block_id_to_block.close();
 
    _fork_db.reset();
+   std::atomic_store( &_read_snapshot, std::shared_ptr<const chain::read_snapshot>() );
 
    _opened = false;
 }
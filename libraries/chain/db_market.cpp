@@ -299,19 +299,18 @@ bool database::apply_order(const limit_order_object& new_order_object, bool allo
    asset_id_type recv_asset_id = new_order_object.receive_asset_id();
 
    // We only need to check if the new order will match with others if it is at the front of the book
-   const auto& limit_price_idx = get_index_type<limit_order_index>().indices().get<by_price>();
-   auto limit_itr = limit_price_idx.lower_bound( boost::make_tuple( new_order_object.sell_price, order_id ) );
-   if( limit_itr != limit_price_idx.begin() )
-   {
-      --limit_itr;
-      if( limit_itr->sell_asset_id() == sell_asset_id && limit_itr->receive_asset_id() == recv_asset_id )
-         return false;
-   }
+   const auto& limit_book = get_limit_order_book();
+   const limit_order_object* best_order = limit_book.best( sell_asset_id, recv_asset_id );
+   if( best_order != nullptr && best_order->id != order_id )
+      return false;
 
    // this is the opposite side (on the book)
    auto max_price = ~new_order_object.sell_price;
-   limit_itr = limit_price_idx.lower_bound( max_price.max() );
-   auto limit_end = limit_price_idx.upper_bound( max_price );
+   // the best order of the opposite side, as long as the new order accepts its price
+   auto next_maker = [&limit_book,&max_price,sell_asset_id,recv_asset_id]() -> const limit_order_object* {
+      const limit_order_object* maker = limit_book.best( recv_asset_id, sell_asset_id );
+      return ( maker != nullptr && !( maker->sell_price < max_price ) ) ? maker : nullptr;
+   };
 
    // Order matching should be in favor of the taker.
    // When a new limit order is created, e.g. an ask, need to check if it will match the highest bid.
@@ -360,29 +359,28 @@ bool database::apply_order(const limit_order_object& new_order_object, bool allo
    if( to_check_call_orders )
    {
       // check limit orders first, match the ones with better price in comparison to call orders
-      while( !finished && limit_itr != limit_end && limit_itr->sell_price > call_match_price )
+      while( !finished )
       {
-         auto old_limit_itr = limit_itr;
-         ++limit_itr;
+         const limit_order_object* maker = next_maker();
+         if( maker == nullptr || !( maker->sell_price > call_match_price ) )
+            break;
          // match returns match_result_type::only_maker_filled when only the old order was fully filled.
          // In this case, we keep matching; otherwise, we stop.
-         finished = ( match( new_order_object, *old_limit_itr, old_limit_itr->sell_price ) != match_result_type::only_maker_filled );
+         finished = ( match( new_order_object, *maker, maker->sell_price ) != match_result_type::only_maker_filled );
       }
 
       if( !finished )
       {
          // check if there are margin calls
-         const auto& call_collateral_idx = get_index_type<call_order_index>().indices().get<by_collateral>();
-         auto call_min = price::min( recv_asset_id, sell_asset_id );
+         const auto& call_triggers = get_call_order_triggers();
          while( !finished )
          {
             // always check call order with least collateral ratio
-            auto call_itr = call_collateral_idx.lower_bound( call_min );
-            if( call_itr == call_collateral_idx.end()
-                  || call_itr->debt_type() != sell_asset_id
-                  || call_itr->collateralization() > sell_abd->current_maintenance_collateralization )   // feed protected
+            const call_order_object* least_call = call_triggers.least_collateralized( recv_asset_id, sell_asset_id );
+            if( least_call == nullptr
+                  || least_call->collateralization() > sell_abd->current_maintenance_collateralization )   // feed protected
                break;
-            auto match_result = match( new_order_object, *call_itr, call_match_price,
+            auto match_result = match( new_order_object, *least_call, call_match_price,
                                        sell_abd->current_feed.settlement_price,
                                        sell_abd->current_feed.maintenance_collateral_ratio,
                                        sell_abd->current_maintenance_collateralization );
@@ -394,13 +392,14 @@ bool database::apply_order(const limit_order_object& new_order_object, bool allo
       }
    }
    // still need to check limit orders
-   while( !finished && limit_itr != limit_end )
+   while( !finished )
    {
-      auto old_limit_itr = limit_itr;
-      ++limit_itr;
+      const limit_order_object* maker = next_maker();
+      if( maker == nullptr )
+         break;
       // match returns match_result_type::only_maker_filled when only the old order was fully filled.
       // In this case, we keep matching; otherwise, we stop.
-      finished = ( match( new_order_object, *old_limit_itr, old_limit_itr->sell_price ) != match_result_type::only_maker_filled );
+      finished = ( match( new_order_object, *maker, maker->sell_price ) != match_result_type::only_maker_filled );
    }
 
    const limit_order_object* updated_order_object = find< limit_order_object >( order_id );
@@ -768,54 +767,59 @@ bool database::check_call_orders( const asset_object& mia, bool enable_black_swa
 
     const backed_asset_data_object& ba = ( backed_asset_ptr ? *backed_asset_ptr : mia.backed_asset_data(*this) );
 
+    // Most feed updates leave the least collateralized call order above the maintenance collateralization and
+    // above water at the MSSP, then neither a margin call nor a black swan can happen, no need to look further
+    const auto& call_triggers = get_call_order_triggers();
+    const call_order_object* call_order_ptr = call_triggers.least_collateralized( ba.options.short_backing_asset,
+                                                                                  ba.asset_id );
+    if( call_order_ptr == nullptr )
+       return false;
+    if( !ba.has_settlement() && !ba.current_feed.settlement_price.is_null() )
+    {
+       const price least_collateralization = call_order_ptr->collateralization();
+       if( ba.current_maintenance_collateralization < least_collateralization
+           && ~least_collateralization < ba.current_feed.max_short_squeeze_price() )
+          return false;
+    }
+
     if( check_for_blackswan( mia, enable_black_swan, &ba ) )
        return false;
 
     if( ba.is_prediction_market ) return false;
     if( ba.current_feed.settlement_price.is_null() ) return false;
 
-    const limit_order_index& limit_index = get_index_type<limit_order_index>();
-    const auto& limit_price_index = limit_index.indices().get<by_price>();
+    const auto& limit_book = get_limit_order_book();
 
-    // looking for limit orders selling the most USD for the least CORE
-    auto max_price = price::max( ba.asset_id, ba.options.short_backing_asset );
     // stop when limit orders are selling too little USD for too much CORE
     auto min_price = ba.current_feed.max_short_squeeze_price();
 
-    // NOTE limit_price_index is sorted from greatest to least
-    auto limit_itr = limit_price_index.lower_bound( max_price );
-    auto limit_end = limit_price_index.upper_bound( min_price );
+    // looking for limit orders selling the most USD for the least CORE, the best of the book
+    auto next_limit_order = [&limit_book,&ba,&min_price]() -> const limit_order_object* {
+       const limit_order_object* order = limit_book.best( ba.asset_id, ba.options.short_backing_asset );
+       return ( order != nullptr && !( order->sell_price < min_price ) ) ? order : nullptr;
+    };
 
-    if( limit_itr == limit_end )
+    const limit_order_object* limit_order_ptr = next_limit_order();
+    if( limit_order_ptr == nullptr )
        return false;
 
-    const call_order_index& call_index = get_index_type<call_order_index>();
-    const auto& call_collateral_index = call_index.indices().get<by_collateral>();
-
-    auto call_min = price::min( ba.options.short_backing_asset, ba.asset_id );
-    auto call_max = price::max( ba.options.short_backing_asset, ba.asset_id );
-
-    auto call_collateral_itr = call_collateral_index.begin();
-    auto call_collateral_end = call_collateral_itr;
-
-    call_collateral_itr = call_collateral_index.lower_bound( call_min );
-    call_collateral_end = call_collateral_index.upper_bound( call_max );
-
     bool margin_called = false;
 
     auto head_num = head_block_num();
 
-    while( !check_for_blackswan( mia, enable_black_swan, &ba ) // TODO perhaps improve performance by passing in iterators
-           && limit_itr != limit_end
-           && call_collateral_itr != call_collateral_end )
+    // check_for_blackswan() finds the least collateralized call order and the best limit order as we do,
+    // through call_order_trigger_index and limit_order_book_index, without walking the indexes
+    while( !check_for_blackswan( mia, enable_black_swan, &ba )
+           && limit_order_ptr != nullptr
+           && call_order_ptr != nullptr )
     {
-       const call_order_object& call_order = *call_collateral_itr;
+       const call_order_object& call_order = *call_order_ptr;
 
        // Feed protected (don't call if CR>MCR)
        if( ba.current_maintenance_collateralization < call_order.collateralization() )
           return margin_called;
 
-       const limit_order_object& limit_order = *limit_itr;
+       const limit_order_object& limit_order = *limit_order_ptr;
        price match_price  = limit_order.sell_price;
        // There was a check `match_price.validate();` here, which is removed now because it always passes
 
@@ -867,15 +871,14 @@ bool database::check_call_orders( const asset_object& mia, bool enable_black_swa
 
        // the call order is taker
        fill_call_order( call_order, call_pays, call_receives, match_price, false );
-       call_collateral_itr = call_collateral_index.lower_bound( call_min );
+       call_order_ptr = call_triggers.least_collateralized( ba.options.short_backing_asset, ba.asset_id );
 
-       auto next_limit_itr = std::next( limit_itr );
        // the limit order is maker
        bool really_filled = fill_limit_order( limit_order, order_pays, order_receives, true, match_price, true );
        if( really_filled )
-          limit_itr = next_limit_itr;
+          limit_order_ptr = next_limit_order();
 
-    } // while call_itr != call_end
+    } // while there are call orders to margin call
 
     return margin_called;
 } FC_CAPTURE_AND_RETHROW() } // GCOVR_EXCL_LINE
@@ -484,12 +484,24 @@ void database::notify_changed_objects()
       if( !changed_objects.empty() )
       {
         vector<object_id_type> changed_ids;
-        changed_ids.reserve(head_undo.old_values.size());
+        changed_ids.reserve(head_undo.old_values.size() + head_undo.old_deltas.size());
         flat_set<account_id_type> changed_accounts_impacted;
         for( const auto& item : head_undo.old_values )
         {
           changed_ids.push_back(item.first);
-          get_relevant_accounts(item.second.get(), changed_accounts_impacted);
+          get_relevant_accounts(item.second, changed_accounts_impacted);
+        }
+        // objects tracked by delta have no full before-image, rebuild it the way undo does
+        for( const auto& item : head_undo.old_deltas )
+        {
+          changed_ids.push_back(item.first);
+          auto obj = find_object(item.first);
+          if(obj != nullptr)
+          {
+            std::unique_ptr<object> before = obj->clone();
+            item.second->apply_to( *before );
+            get_relevant_accounts(before.get(), changed_accounts_impacted);
+          }
         }
 
         if( !changed_ids.empty() )
@@ -507,7 +519,7 @@ void database::notify_changed_objects()
         for( const auto& item : head_undo.removed )
         {
           removed_ids.emplace_back( item.first );
-          auto obj = item.second.get();
+          auto obj = item.second;
           removed.emplace_back( obj );
           get_relevant_accounts(obj, removed_accounts_impacted);
         }
@@ -167,44 +167,27 @@ bool database::check_for_blackswan( const asset_object& mia, bool enable_black_s
     auto settle_price = ba.current_feed.settlement_price;
     if( settle_price.is_null() ) return false; // no feed
 
-    asset_id_type debt_asset_id = ba.asset_id;
-    auto call_min = price::min( ba.options.short_backing_asset, debt_asset_id );
-
     //check with collateralization
-    const auto& call_collateral_index = get_index_type<call_order_index>().indices().get<by_collateral>();
-    auto call_itr = call_collateral_index.lower_bound( call_min );
-    
-    if( call_itr == call_collateral_index.end() ) // no call order
-       return false;
-
-    if( call_itr->debt_type() != debt_asset_id ) // no call order
+    const call_order_object* least_call = get_call_order_triggers().least_collateralized(
+                                           ba.options.short_backing_asset, ba.asset_id );
+    if( least_call == nullptr ) // no call order
        return false;
 
     // We won't check for black swan on incoming limit order, so need to check with MSSP here
     price highest = ba.current_feed.max_short_squeeze_price();
 
-    const limit_order_index& limit_index = get_index_type<limit_order_index>();
-    const auto& limit_price_index = limit_index.indices().get<by_price>();
-
-    // looking for limit orders selling the most USD for the least CORE
-    auto highest_possible_bid = price::max( ba.asset_id, ba.options.short_backing_asset );
-    // stop when limit orders are selling too little USD for too much CORE
-    auto lowest_possible_bid  = price::min( ba.asset_id, ba.options.short_backing_asset );
-
-    FC_ASSERT( highest_possible_bid.base.asset_id == lowest_possible_bid.base.asset_id );
-    // NOTE limit_price_index is sorted from greatest to least
-    auto limit_itr = limit_price_index.lower_bound( highest_possible_bid );
-    auto limit_end = limit_price_index.upper_bound( lowest_possible_bid );
-
-    if( limit_itr != limit_end ) {
-       FC_ASSERT( highest.base.asset_id == limit_itr->sell_price.base.asset_id );
-       highest = std::max( limit_itr->sell_price, highest );
+    // looking for the limit order selling the most USD for the least CORE
+    const limit_order_object* highest_bid = get_limit_order_book().best( ba.asset_id,
+                                                                          ba.options.short_backing_asset );
+    if( highest_bid != nullptr ) {
+       FC_ASSERT( highest.base.asset_id == highest_bid->sell_price.base.asset_id );
+       highest = std::max( highest_bid->sell_price, highest );
     }
 
-    auto least_collateral = call_itr->collateralization();
+    auto least_collateral = least_call->collateralization();
     if( ~least_collateral >= highest  ) 
     {
-       wdump( (*call_itr) );
+       wdump( (*least_call) );
        elog( "Black Swan detected on asset ${symbol} (${id}) at block ${b}: \n"
              "   Least collateralized call: ${lc}  ${~lc}\n"
            //  "   Highest Bid:               ${hb}  ${~hb}\n"
@@ -212,7 +195,7 @@ bool database::check_for_blackswan( const asset_object& mia, bool enable_black_s
              "   Max:                       ${~h}  ${h}\n",
             ("id",mia.id)("symbol",mia.symbol)("b",head_block_num())
             ("lc",least_collateral.to_real())("~lc",(~least_collateral).to_real())
-          //  ("hb",limit_itr->sell_price.to_real())("~hb",(~limit_itr->sell_price).to_real())
+          //  ("hb",highest_bid->sell_price.to_real())("~hb",(~highest_bid->sell_price).to_real())
             ("sp",settle_price.to_real())("~sp",(~settle_price).to_real())
             ("h",highest.to_real())("~h",(~highest).to_real()) );
        edump((enable_black_swan));
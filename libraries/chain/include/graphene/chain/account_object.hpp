@@ -264,6 +264,13 @@ namespace graphene { namespace chain {
          {
             return !is_basic_account(now);
          }
+
+         /// Accounts carry authorities, options and lists, the undo history only keeps the fields that changed
+         /// @{
+         bool undo_by_delta()const override { return true; }
+         void pack_fields( std::vector<char>& out, std::vector<uint32_t>& field_ends )const override;
+         void unpack_field( uint32_t field, fc::datastream<const char*>& ds ) override;
+         /// @}
    };
 
    /**
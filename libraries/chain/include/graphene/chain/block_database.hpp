@@ -1,17 +1,61 @@
 #pragma once
 #include <fstream>
+#include <graphene/chain/compressed_block_file.hpp>
 #include <graphene/protocol/block.hpp>
 
 #include <fc/filesystem.hpp>
 
+#include <atomic>
+#include <memory>
+
 namespace graphene { namespace chain {
    struct index_entry;
    using namespace graphene::protocol;
 
+   namespace detail { class mapped_file; }
+
    class block_database 
    {
       public:
-         void open( const fc::path& dbdir );
+         /**
+          * How the index and blocks files are accessed. Streams and mapped modes use the same on-disk format.
+          *
+          * In mapped mode both files are memory mapped and grown in large steps, so that lookups are plain
+          * memory reads that can be done from any thread without locking while the chain thread appends blocks.
+          *
+          * In compressed mode the blocks file is replaced by a compressed_block_file in the same directory, the
+          * index is unchanged.
+          */
+         enum class storage_mode
+         {
+            streams,
+            mapped,
+            compressed
+         };
+
+         /** Packed blocks returned by read_range(), stored back to back in data */
+         struct raw_block_range
+         {
+            struct entry
+            {
+               uint32_t      block_num = 0;
+               block_id_type block_id;
+               uint64_t      position = 0; ///< offset of the block in the blocks file
+               size_t        offset = 0;   ///< offset of the block in data
+               uint32_t      size = 0;
+            };
+            std::vector<entry> entries;
+            std::vector<char>  data;
+         };
+
+         block_database();
+         ~block_database();
+
+         /**
+          * Opens the block database in dbdir, throws if dbdir holds the other of the raw and compressed formats.
+          * Those have to be converted with the block_converter program first.
+          */
+         void open( const fc::path& dbdir, storage_mode mode = storage_mode::streams );
          bool is_open()const;
          void flush();
          void close();
@@ -27,10 +71,40 @@ namespace graphene { namespace chain {
          optional<block_id_type> last_id()const;
          size_t                 blocks_current_position()const;
          size_t                 total_block_size()const;
+
+         /**
+          * Reads up to count consecutive blocks starting at first_block_num with a few large sequential reads,
+          * stopping early at the first block that is missing. Uses its own file handles in stream mode, so it may be
+          * called from other threads as long as the requested blocks are not modified at the same time.
+          */
+         raw_block_range        read_range( uint32_t first_block_num, uint32_t count )const;
+
+         /// Bytes used on disk by the files of the block database in dbdir, in any of the formats
+         static uint64_t        disk_size( const fc::path& dbdir );
       private:
          optional<index_entry> last_index_entry()const;
+
+         /// Mapped mode only, @return false if there is no entry for block_num
+         bool read_index_entry( uint32_t block_num, index_entry& e )const;
+         /// Mapped mode only, writes the entry of block_num while concurrent readers may be looking at it
+         void write_index_entry( uint32_t block_num, const index_entry& e );
+         /// Stream and compressed modes, @return the number of bytes read
+         uint64_t read_blocks_file( uint64_t position, char* out, uint64_t size )const;
+         /// Mapped mode only, @return false if the block data is outside of the blocks file
+         bool read_block_data( const index_entry& e, vector<char>& data )const;
+         /// Mapped mode only, @return true if e points to a block that can be read back with the id of e
+         bool holds_block( const index_entry& e )const;
+
          fc::path _index_filename;
+         fc::path _blocks_filename;
          mutable std::fstream _blocks;
          mutable std::fstream _block_num_to_pos;
+
+         storage_mode                         _mode = storage_mode::streams;
+         std::unique_ptr<detail::mapped_file> _mapped_index;
+         std::unique_ptr<detail::mapped_file> _mapped_blocks;
+         compressed_block_file                _compressed;
+         /// Sequence lock guarding index entries that are overwritten in mapped mode, odd while a write is going on
+         mutable std::atomic<uint64_t>        _index_sequence{0};
    };
 } }
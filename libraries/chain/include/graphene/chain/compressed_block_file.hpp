@@ -0,0 +1,96 @@
+#pragma once
+
+#include <fc/filesystem.hpp>
+
+#include <cstdint>
+#include <fstream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace graphene { namespace chain {
+
+   /**
+    * @class compressed_block_file
+    * @brief append-only storage for packed blocks that compresses them in fixed-size chunks
+    *
+    * Data is addressed by its position in the uncompressed stream, so block_database keeps its index format and
+    * looks blocks up by number and by id exactly like with the raw blocks file. The stream is cut into chunks of
+    * chunk_size bytes which are deflated independently, with a preset dictionary trained on block data, so that
+    * reading a block only inflates the chunk(s) holding it. The last, incomplete chunk is kept uncompressed in a
+    * tail file until it fills up.
+    *
+    * Files:
+    *  - chunks: the compressed chunks, back to back
+    *  - chunks.index: a header, then the offset and compressed size of each chunk
+    *  - blocks.tail: the stream position of the tail, then the uncompressed tail
+    *  - dictionary: the preset dictionary, if any
+    *
+    * read() may be called from any thread, everything else only from the thread that writes.
+    */
+   class compressed_block_file
+   {
+      public:
+         static constexpr uint32_t default_chunk_size  = 256 * 1024;
+         /// Deflate can not look back further than its 32KiB window, a longer dictionary would be wasted
+         static constexpr uint32_t max_dictionary_size = 32 * 1024;
+         static constexpr size_t   max_cached_chunks   = 16;
+
+         /// @return true if dir holds a compressed block file
+         static bool exists( const fc::path& dir );
+
+         void open( const fc::path& dir );
+         bool is_open()const { return _chunk_index.is_open(); }
+         void flush();
+         void close();
+
+         /// @return the position of the data in the uncompressed stream
+         uint64_t append( const char* data, uint32_t size );
+         /// @return the number of bytes read, less than size if the stream ends before
+         uint64_t read( uint64_t position, char* out, uint64_t size )const;
+
+         /// Size of the uncompressed stream
+         uint64_t size()const;
+         /// Bytes used on disk by all files
+         uint64_t disk_size()const;
+
+         /// Builds a preset dictionary out of the byte sequences that occur most often in samples
+         static std::vector<char> train_dictionary( const std::vector< std::vector<char> >& samples,
+                                                    uint32_t max_size = max_dictionary_size );
+         /// Installs a dictionary for a file in dir that has no chunks yet
+         static void write_dictionary( const fc::path& dir, const std::vector<char>& dictionary );
+
+      private:
+         struct chunk_location
+         {
+            uint64_t offset;
+            uint32_t size;
+         };
+         using chunk_data = std::shared_ptr< const std::vector<char> >;
+
+         void       seal_chunk();
+         void       write_tail();
+         chunk_data load_chunk( const chunk_location& location )const;
+         void       cache_chunk( uint64_t chunk, const chunk_data& data )const;
+
+         fc::path                    _dir;
+         uint32_t                    _chunk_size = default_chunk_size;
+         std::vector<char>           _dictionary;
+         std::vector<chunk_location> _chunks;
+         uint64_t                    _chunks_file_size = 0;
+         /// Uncompressed data after the last chunk
+         std::vector<char>           _tail;
+
+         std::ofstream               _chunk_index;
+         std::ofstream               _chunks_out;
+         std::ofstream               _tail_out;
+
+         /// Guards _chunks, _chunks_file_size, _tail and the cache against concurrent read() calls. The writing
+         /// thread is the only one changing them and holds it only while it does, it reads them without.
+         mutable std::mutex                                  _mutex;
+         /// Most recently used inflated chunks first
+         mutable std::list< std::pair<uint64_t,chunk_data> > _cache;
+   };
+
+} }
@@ -10,6 +10,7 @@
 #include <graphene/chain/block_database.hpp>
 #include <graphene/chain/genesis_state.hpp>
 #include <graphene/chain/evaluator.hpp>
+#include <graphene/chain/mempool.hpp>
 
 #include <graphene/db/object_database.hpp>
 #include <graphene/db/object.hpp>
@@ -32,8 +33,13 @@ namespace graphene { namespace chain {
    class validator_object;
    class force_settlement_object;
    class limit_order_object;
+   class limit_order_book_index;
+   class call_order_trigger_index;
+   class vote_tally_tracker;
    class collateral_bid_object;
    class call_order_object;
+   class read_snapshot;
+   class read_snapshot_publisher;
 
    struct budget_record;
    enum class vesting_balance_type;
@@ -163,6 +169,12 @@ namespace graphene { namespace chain {
          const fee_schedule&                    current_fee_schedule()const;
          const account_statistics_object&       get_account_stats_by_owner( account_id_type owner )const;
          const producer_schedule_object&         get_producer_schedule_object()const;
+         /// The limit orders of each market side by price level, see limit_order_book_index
+         const limit_order_book_index&          get_limit_order_book()const;
+         /// The least collateralized call order of each market, see call_order_trigger_index
+         const call_order_trigger_index&        get_call_order_triggers()const;
+         /// The running totals of the votes, see vote_tally_tracker
+         const vote_tally_tracker&              get_vote_tally_tracker()const;
 
          time_point_sec   head_block_time()const;
          uint32_t         head_block_num()const;
@@ -403,6 +415,8 @@ namespace graphene { namespace chain {
       public:
          // It is public because it is used in pending_transactions_restorer in db_with.hpp
          processed_transaction _push_transaction( const precomputable_transaction& trx );
+         /// Like _push_transaction(), with what mempool::describe() gives for trx in the current state already
+         processed_transaction _push_transaction( const precomputable_transaction& trx, mempool::entry&& entry );
          ///@throws fc::exception if the proposed transaction fails to apply.
          processed_transaction push_proposal( const proposal_object& proposal );
 
@@ -422,6 +436,17 @@ namespace graphene { namespace chain {
       public:
          void pop_block();
          void clear_pending();
+         /// The transactions applied on top of the head block, waiting to be included in a block
+         const mempool& get_pending_transactions()const { return _pending_tx; }
+
+         /**
+          * @return an immutable view of the state as of the head block, published after the last block that was
+          * pushed or popped, or null if read snapshots are not enabled. Can be called from any thread.
+          */
+         std::shared_ptr<const chain::read_snapshot> read_snapshot()const;
+      private:
+         void publish_read_snapshot();
+      public:
 
          /**
           *  This method is used to track applied operations during the evaluation of a block, these
@@ -507,10 +532,52 @@ namespace graphene { namespace chain {
           *         precomputations applied
           */
          fc::future<void> precompute_parallel( const precomputable_transaction& trx )const;
+
+         /** Same precomputations as precompute_parallel, but done on the calling thread. Used by the replay
+          *  pipeline, which already runs many blocks in parallel.
+          */
+         void precompute_serial( const signed_block& block, const uint32_t skip = skip_nothing )const;
       private:
          template<typename Trx>
          void _precompute_parallel( const Trx* trx, const size_t count, const uint32_t skip )const;
 
+         /**
+          * The authorities of the transactions of a block, verified by precompute_parallel() on the io threads
+          * against copies of the accounts they need. When the block is applied, a transaction whose accounts
+          * still have the same authorities is not verified again, so the result is the same as when verifying
+          * it then.
+          */
+         struct precomputed_authorities
+         {
+            struct transaction
+            {
+               /// accounts looked up while verifying
+               flat_set<account_id_type> reads;
+               bool                      verified = false;
+            };
+
+            /// max_authority_depth the transactions were verified with
+            uint32_t                                                    max_authority_depth = 0;
+            /// active and owner authorities of the accounts the transactions may need, at the time they were copied
+            std::map< account_id_type, std::pair<authority,authority> > accounts;
+            std::vector<transaction>                                    transactions;
+         };
+
+         /// Copies the authorities the transactions of a block may need, on the thread applying blocks
+         std::shared_ptr<precomputed_authorities> _copy_authorities( const signed_block& block )const;
+         /// Verifies the authorities of some transactions of a block against the copies only
+         void _verify_authorities( const signed_block& block, size_t base, size_t count,
+                                   precomputed_authorities& authorities )const;
+         /// @return the authorities precomputed for a block, which are forgotten then, or nullptr
+         std::shared_ptr<const precomputed_authorities> _take_precomputed_authorities( const signed_block& block );
+         /// @return whether a transaction verified by precompute_parallel() only read accounts whose authorities
+         ///         are unchanged since
+         bool _is_authority_verified( const precomputed_authorities& authorities, size_t trx_in_block )const;
+
+         /// Authorities precomputed for the last blocks, oldest first, only used by the thread applying blocks
+         mutable std::deque< std::pair< block_id_type, std::shared_ptr<const precomputed_authorities> > >
+                                                 _precomputed_authorities;
+
       protected:
          // Mark pop_undo() as protected -- we do not want outside calling pop_undo(),
          // it should call pop_block() instead
@@ -580,12 +647,13 @@ namespace graphene { namespace chain {
          void process_bids( const backed_asset_data_object& bad );
          void process_backed_assets();
 
+         void update_core_in_balances();
          template<class Type>
-         void perform_account_maintenance( Type tally_helper );
+         void perform_account_maintenance( Type& tally_helper );
          ///@}
          ///@}
 
-         vector< processed_transaction >        _pending_tx;
+         mempool                                _pending_tx;
          fork_database                          _fork_db;
 
          /**
@@ -628,6 +696,35 @@ namespace graphene { namespace chain {
          /// Set it to true to provide accurate data to API clients, set to false to have better performance.
          bool                              _track_standby_votes = true;
 
+         /// Number of blocks the replay pipeline keeps in flight ahead of the block being applied
+         uint32_t                          _replay_pipeline_depth = 1000;
+
+         /// Whether precompute_parallel() also verifies the authorities of the transactions of a block, which are
+         /// then not verified again when the block is applied unless an account they depend on changed
+         bool                              _parallel_authority_check = false;
+
+         /// Whether the votes of the accounts walked by perform_account_maintenance() are added up by several
+         /// threads once the walk is over, the results are the same either way
+         bool                              _parallel_vote_tally = false;
+         /// Fewest stakes added up by each thread when tallying the votes in parallel
+         uint32_t                          _vote_tally_shard_size = 1000;
+
+         /// Whether chain maintenance also recounts the votes fully when the vote tally tracker is enabled, to
+         /// compare its totals with the full recount, which is the one used
+         bool                              _check_incremental_vote_tally = false;
+
+         /// How the block database is accessed, see block_database::storage_mode
+         block_database::storage_mode      _block_storage_mode = block_database::storage_mode::streams;
+
+         /// State snapshot the next open() starts from, see set_snapshot_import()
+         fc::path                          _snapshot_object_dir;
+         optional<signed_block>            _snapshot_head_block;
+
+         /// Publishes a read snapshot after each block pushed or popped, if _read_snapshots_enabled was set on open()
+         bool                                          _read_snapshots_enabled = false;
+         std::unique_ptr<read_snapshot_publisher>      _read_snapshot_publisher;
+         std::shared_ptr<const chain::read_snapshot>   _read_snapshot; ///< only accessed with std::atomic_load/store
+
          /**
           * Whether database is successfully opened or not.
           *
@@ -650,9 +747,49 @@ namespace graphene { namespace chain {
          const producer_schedule_object*         _p_producer_schedule_obj    = nullptr;
          ///@}
 
+         /// Secondary indexes of limit_order_index and call_order_index, created with the indexes
+         const limit_order_book_index*          _p_limit_order_book        = nullptr;
+         const call_order_trigger_index*        _p_call_order_triggers     = nullptr;
+         /// Secondary index of account_index, updated by chain maintenance
+         vote_tally_tracker*                    _p_vote_tally_tracker      = nullptr;
+
       public:
          /// Enable or disable tracking of votes of standby validators and delegates
          inline void enable_standby_votes_tracking(bool enable)  { _track_standby_votes = enable; }
+         /// Set how many blocks the replay pipeline reads, decodes and precomputes ahead of the one being applied
+         inline void set_replay_pipeline_depth(uint32_t depth)  { _replay_pipeline_depth = std::max( depth, 1u ); }
+         /// Enable or disable verifying the authorities of the transactions of a block in precompute_parallel()
+         inline void enable_parallel_authority_check(bool enable)  { _parallel_authority_check = enable; }
+         /// Enable or disable tallying the votes in parallel during chain maintenance
+         inline void enable_parallel_vote_tally(bool enable)  { _parallel_vote_tally = enable; }
+         /// Set how many stakes each thread adds up at least when tallying the votes in parallel
+         inline void set_vote_tally_shard_size(uint32_t size)  { _vote_tally_shard_size = std::max( size, 1u ); }
+         /**
+          * Enable or disable keeping running totals of the votes, so that chain maintenance only walks the
+          * accounts that changed since the previous maintenance interval. With check, chain maintenance
+          * still recounts all votes and logs an error if the totals differ from the recount.
+          */
+         void enable_incremental_vote_tally(bool enable, bool check = false);
+         /// Set the most bytes of pending transactions and pending transactions per fee payer kept, 0 for no limit
+         inline void set_mempool_limits(size_t max_size, uint32_t max_per_account)
+         {
+            _pending_tx.set_limits( max_size, max_per_account );
+         }
+         /// Select how the block database is accessed, takes effect on the next open()
+         inline void set_block_storage_mode(block_database::storage_mode mode)  { _block_storage_mode = mode; }
+         /**
+          * Make the next open() start from a state snapshot instead of genesis or a full replay, if the data
+          * directory holds no object database yet. object_dir holds index files in the layout written by flush(),
+          * head_block is the block the state was taken at. It is stored in the block database, so that the node
+          * can sync on from there, and a replay of blocks already stored after it continues from the snapshot.
+          */
+         inline void set_snapshot_import(const fc::path& object_dir, const signed_block& head_block)
+         {
+            _snapshot_object_dir = object_dir;
+            _snapshot_head_block = head_block;
+         }
+         /// Publish read snapshots for API threads, see read_snapshot(), takes effect on the next open()
+         inline void enable_read_snapshots(bool enable)  { _read_snapshots_enabled = enable; }
    };
 
    namespace detail
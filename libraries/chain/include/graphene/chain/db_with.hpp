@@ -1,5 +1,6 @@
 #pragma once
 
+#include <graphene/chain/block_summary_object.hpp>
 #include <graphene/chain/database.hpp>
 
 /*
@@ -40,19 +41,59 @@ struct skip_flags_restorer
  * Class used to help the without_pending_transactions
  * implementation.
  *
+ * The pending transactions are pushed again on top of the new head block. Their signatures were checked already,
+ * against the state the pool was built on. So if the head did not move, or moved by one block that changed none of
+ * the accounts their authorities refer to, the signatures are not checked again. Everything else is, as the
+ * operations must be evaluated again to rebuild the pending state anyway.
+ *
+ * A transaction whose signatures are not checked again keeps its entry in the pool as it was, as the accounts it
+ * was described from did not change. The others are described again.
+ *
+ * The authorities were looked up in the pending state, which includes the changes of the earlier pending
+ * transactions. Once one of those fails or gives another result than before, e.g. an account update that
+ * expired, the later transactions may have been checked against accounts that differ now, so all of them are
+ * checked again.
+ *
  * TODO:  Change the name of this class to better reflect the fact
  * that it restores popped transactions as well as pending transactions.
  */
 struct pending_transactions_restorer
 {
-   pending_transactions_restorer( database& db, std::vector<processed_transaction>&& pending_transactions )
-      : _db(db), _pending_transactions( std::move(pending_transactions) )
+   pending_transactions_restorer( database& db, std::vector<mempool::entry>&& pending_transactions )
+      : _db(db), _pending_transactions( std::move(pending_transactions) ),
+        _previous_head_id( db.head_block_id() ), _previous_head_num( db.head_block_num() )
    {
       _db.clear_pending();
    }
 
    ~pending_transactions_restorer()
    {
+      // decide before pushing anything, pushing starts new undo sessions on top of the block's
+      std::vector<bool> signatures_checked( _pending_transactions.size(), false );
+      if( _db._popped_tx.empty() )
+      {
+         if( _db.head_block_id() == _previous_head_id )
+            signatures_checked.assign( _pending_transactions.size(), true );
+         else if( const graphene::db::undo_state* block_changes = changes_of_one_block() )
+         {
+            for( size_t i = 0; i < _pending_transactions.size(); ++i )
+            {
+               bool changed = false;
+               for( const auto& account : _pending_transactions[i].authorities )
+               {
+                  const object_id_type id = account;
+                  if( block_changes->old_values.count( id ) || block_changes->old_deltas.count( id )
+                      || block_changes->removed.count( id ) )
+                  {
+                     changed = true;
+                     break;
+                  }
+               }
+               signatures_checked[i] = !changed;
+            }
+         }
+      }
+
       for( const auto& tx : _db._popped_tx )
       {
          try {
@@ -63,22 +104,52 @@ struct pending_transactions_restorer
          }
       }
       _db._popped_tx.clear();
-      for( const processed_transaction& tx : _pending_transactions )
+      node_property_object& npo = _db.node_properties();
+      const uint32_t skip = npo.skip_flags;
+      bool same_pending_state = true;
+      for( size_t i = 0; i < _pending_transactions.size(); ++i )
       {
+         mempool::entry& pending = _pending_transactions[i];
+         const processed_transaction tx = std::move( pending.trx );
          try
          {
             if( !_db.is_known_transaction( tx.id() ) ) {
-               _db._push_transaction( tx );
+               skip_flags_restorer restorer( npo, skip );
+               processed_transaction result;
+               if( signatures_checked[i] && same_pending_state )
+               {
+                  npo.skip_flags = skip | database::skip_transaction_signatures;
+                  result = _db._push_transaction( tx, std::move( pending ) );
+               }
+               else
+                  result = _db._push_transaction( tx );
+               if( same_pending_state && fc::raw::pack( result.operation_results )
+                                         != fc::raw::pack( tx.operation_results ) )
+                  same_pending_state = false;
             }
          }
          catch( const fc::exception& )
          { // ignore invalid transactions
+            same_pending_state = false;
          }
       }
    }
 
+   /// @return the changes of the head block if it was applied right on top of the previous head, else null
+   const graphene::db::undo_state* changes_of_one_block()const
+   {
+      if( _db.head_block_num() != _previous_head_num + 1 || _db._undo_db.size() == 0 )
+         return nullptr;
+      const auto& summary = block_summary_id_type( static_cast<uint16_t>( _previous_head_num ) )( _db );
+      if( summary.block_id != _previous_head_id )
+         return nullptr;
+      return &_db._undo_db.head();
+   }
+
    database& _db;
-   std::vector< processed_transaction > _pending_transactions;
+   std::vector< mempool::entry > _pending_transactions;
+   block_id_type _previous_head_id;
+   uint32_t _previous_head_num;
 };
 
 /**
@@ -108,7 +179,7 @@ void with_skip_flags(
 template< typename Lambda >
 void without_pending_transactions(
    database& db,
-   std::vector<processed_transaction>&& pending_transactions,
+   std::vector<mempool::entry>&& pending_transactions,
    Lambda callback )
 {
     pending_transactions_restorer restorer( db, std::move(pending_transactions) );
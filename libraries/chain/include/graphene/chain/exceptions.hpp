@@ -99,6 +99,7 @@ namespace graphene { namespace chain {
    FC_DECLARE_DERIVED_EXCEPTION( insufficient_feeds,           chain_exception, 37006 )
 
    FC_DECLARE_DERIVED_EXCEPTION( duplicate_transaction,        transaction_process_exception, 3030001 )
+   FC_DECLARE_DERIVED_EXCEPTION( mempool_full,                 transaction_process_exception, 3030002 )
 
    FC_DECLARE_DERIVED_EXCEPTION( pop_empty_chain,              undo_database_exception, 3070001 )
 
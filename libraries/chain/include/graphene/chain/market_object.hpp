@@ -6,6 +6,12 @@
 
 #include <boost/multi_index/composite_key.hpp>
 
+#include <fc/uint128.hpp>
+
+#include <deque>
+#include <map>
+#include <stack>
+
 namespace graphene { namespace chain {
 
 using namespace graphene::db;
@@ -83,6 +89,106 @@ typedef multi_index_container<
 
 typedef generic_index<limit_order_object, limit_order_multi_index_type> limit_order_index;
 
+/**
+ *  @brief This secondary index keeps the limit orders of each side of each market by price level.
+ *
+ *  The orders selling an asset for another are in a book of their own, so walking it compares no asset ids. The
+ *  price of a level is kept as a reduced fraction, so an order finds its level by equality, and the orders of a
+ *  level are kept oldest first, as by_price does. The best price of a book is its last level, where orders are
+ *  matched and removed.
+ */
+class limit_order_book_index : public secondary_index
+{
+   public:
+      /// A price reduced to lowest terms, equal prices have equal keys
+      struct price_key
+      {
+         explicit price_key( const price& p );
+
+         bool operator==( const price_key& other )const { return base == other.base && quote == other.quote; }
+         bool operator!=( const price_key& other )const { return !( *this == other ); }
+         bool operator<( const price_key& other )const
+         {
+            return fc::uint128_t( base ) * other.quote < fc::uint128_t( other.base ) * quote;
+         }
+
+         uint64_t base;
+         uint64_t quote;
+      };
+
+      struct price_level
+      {
+         explicit price_level( const price_key& k ) : key( k ) {}
+
+         price_key key;
+         std::deque< const limit_order_object* > orders; ///< oldest first
+      };
+
+      /// The levels of the orders selling an asset for another, from the lowest price to the highest
+      typedef std::vector< price_level > book_side;
+
+      virtual void object_inserted( const object& obj ) override;
+      virtual void object_removed( const object& obj ) override;
+      virtual void about_to_modify( const object& before ) override;
+      virtual void object_modified( const object& after  ) override;
+
+      /// @return the levels of the orders selling sell for receive, or nullptr if there are none
+      const book_side* find( asset_id_type sell, asset_id_type receive )const;
+
+      /// @return the order selling sell for receive at the highest price, the oldest at that price, or nullptr
+      const limit_order_object* best( asset_id_type sell, asset_id_type receive )const;
+
+      /**
+       * Calls visitor with the orders selling sell for receive, in the order of by_price, until it returns false
+       * The book must not be changed by the visitor.
+       */
+      template< typename Visitor >
+      void for_each_order( asset_id_type sell, asset_id_type receive, Visitor&& visitor )const
+      {
+         const book_side* side = find( sell, receive );
+         if( side == nullptr )
+            return;
+         for( auto level = side->rbegin(); level != side->rend(); ++level )
+            for( const limit_order_object* order : level->orders )
+               if( !visitor( *order ) )
+                  return;
+      }
+
+      /// @return number of market sides with orders
+      size_t size()const { return _books.size(); }
+
+   private:
+      void insert( const limit_order_object& order );
+      void remove( const limit_order_object& order, const price& sell_price );
+
+      std::map< std::pair< asset_id_type, asset_id_type >, book_side > _books;
+      std::stack< price > _prices_being_modified;
+};
+
+/**
+ *  @brief The collateralization of a call order as kept by by_collateral
+ *
+ *  Keys compare by collateral and debt asset, then by the collateral to debt ratio in 64.64 fixed point, which
+ *  only rounds down, so the exact ratios need to be compared when the fixed point ratios are equal. This gives the
+ *  order of call_order_object::collateralization() without dividing or multiplying in most comparisons.
+ */
+struct collateralization_key
+{
+   asset_id_type  collateral_type;
+   asset_id_type  debt_type;
+   fc::uint128_t  ratio = 0;      ///< collateral * 2^64 / debt rounded down, the maximum when there is no debt
+   int64_t        collateral = -1; ///< negative until the key is computed
+   int64_t        debt = -1;
+};
+
+/// Orders collateralization keys, and keys with collateralization prices, like collateralization prices
+struct collateralization_less
+{
+   bool operator()( const collateralization_key& a, const collateralization_key& b )const;
+   bool operator()( const collateralization_key& a, const price& b )const;
+   bool operator()( const price& a, const collateralization_key& b )const;
+};
+
 /**
  * @class call_order_object
  * @brief tracks debt and call price information
@@ -127,6 +233,12 @@ class call_order_object : public abstract_object<call_order_object, protocol_ids
                                         price feed_price,
                                         const uint16_t maintenance_collateral_ratio,
                                         const optional<price>& maintenance_collateralization = optional<price>() )const;
+
+      /// The key of by_collateral, computed again only after the collateral or debt changed
+      const collateralization_key& get_collateralization_key()const;
+
+   private:
+      mutable collateralization_key _collateralization_key;
 };
 
 /**
@@ -189,9 +301,11 @@ typedef multi_index_container<
       >,
       ordered_unique< tag<by_collateral>,
          composite_key< call_order_object,
-            const_mem_fun< call_order_object, price, &call_order_object::collateralization >,
+            const_mem_fun< call_order_object, const collateralization_key&,
+                           &call_order_object::get_collateralization_key >,
             member< object, object_id_type, &object::id >
-         >
+         >,
+         composite_key_compare< collateralization_less, std::less<object_id_type> >
       >
    >
 > call_order_multi_index_type;
@@ -240,6 +354,43 @@ typedef multi_index_container<
 > collateral_bid_object_multi_index_type;
 
 typedef generic_index<call_order_object, call_order_multi_index_type>                      call_order_index;
+
+/**
+ *  @brief This secondary index tracks the least collateralized call order of each market, where margin calls and
+ *  black swan checks start.
+ *
+ *  A new order or a change that puts an order before the tracked one replaces it. A change that puts the tracked
+ *  order further back, or its removal, only marks the market, and the next lookup finds the order in by_collateral
+ *  again. So the many lookups of feed updates that call nothing cost no walk of the index.
+ */
+class call_order_trigger_index : public secondary_index
+{
+   public:
+      explicit call_order_trigger_index( const call_order_multi_index_type* calls ) : _calls( calls ) {}
+
+      virtual void object_inserted( const object& obj ) override;
+      virtual void object_removed( const object& obj ) override;
+      virtual void object_modified( const object& after  ) override;
+
+      /// @return the call order with the least collateralization and then the lowest id, as by_collateral, or nullptr
+      const call_order_object* least_collateralized( asset_id_type collateral, asset_id_type debt )const;
+
+   private:
+      struct trigger
+      {
+         const call_order_object* least = nullptr;
+         collateralization_key    key;           ///< of least when it was tracked
+         bool                     stale = false; ///< least needs to be looked up in by_collateral
+      };
+
+      /// whether order goes before the tracked order in by_collateral
+      static bool precedes( const call_order_object& order, const trigger& t );
+      static void track( trigger& t, const call_order_object* order );
+
+      const call_order_multi_index_type* _calls;
+      /// by collateral and debt asset, the index sees every order from the start so a missing market has no orders
+      mutable std::map< std::pair< asset_id_type, asset_id_type >, trigger > _triggers;
+};
 typedef generic_index<force_settlement_object, force_settlement_object_multi_index_type>   force_settlement_index;
 typedef generic_index<collateral_bid_object, collateral_bid_object_multi_index_type>       collateral_bid_index;
 
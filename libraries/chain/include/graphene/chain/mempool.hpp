@@ -0,0 +1,102 @@
+#pragma once
+
+#include <graphene/protocol/transaction.hpp>
+
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+#include <boost/multi_index/tag.hpp>
+
+namespace graphene { namespace chain {
+   class database;
+
+   /**
+    * @brief The transactions applied to the pending state, see database::_push_transaction()
+    *
+    * Besides the order they were applied in, the transactions are indexed by id, expiration, fee rate and fee
+    * payer, so that the pool can be kept to a size and the transactions of each account to a number. When the
+    * pool is full, a transaction paying a higher fee rate than the lowest in the pool takes the place of the
+    * lowest ones.
+    *
+    * An evicted transaction is only dropped from the pool, its changes stay in the pending state until the
+    * state is rebuilt from the pool after the next block.
+    */
+   class mempool
+   {
+      public:
+         struct entry
+         {
+            processed_transaction      trx;
+            transaction_id_type        id;
+            uint64_t                   sequence = 0;   ///< order the transactions were applied in
+            fc::time_point_sec         expiration;
+            account_id_type            fee_payer;      ///< of the first operation
+            uint64_t                   fee_rate = 0;   ///< fees in the core asset per kilobyte
+            size_t                     size = 0;       ///< packed size
+            /// The accounts whose authorities the signatures were checked against, and the accounts these
+            /// authorities refer to. The signatures need no checking again unless one of them changes.
+            flat_set<account_id_type>  authorities;
+         };
+
+         struct by_sequence;
+         struct by_id;
+         struct by_expiration;
+         struct by_fee_rate;
+         struct by_fee_payer;
+         using index_type = boost::multi_index_container< entry,
+            boost::multi_index::indexed_by<
+               boost::multi_index::ordered_unique< boost::multi_index::tag<by_sequence>,
+                  boost::multi_index::member< entry, uint64_t, &entry::sequence > >,
+               boost::multi_index::hashed_non_unique< boost::multi_index::tag<by_id>,
+                  boost::multi_index::member< entry, transaction_id_type, &entry::id >,
+                  std::hash<transaction_id_type> >,
+               boost::multi_index::ordered_non_unique< boost::multi_index::tag<by_expiration>,
+                  boost::multi_index::member< entry, fc::time_point_sec, &entry::expiration > >,
+               boost::multi_index::ordered_non_unique< boost::multi_index::tag<by_fee_rate>,
+                  boost::multi_index::member< entry, uint64_t, &entry::fee_rate > >,
+               boost::multi_index::ordered_non_unique< boost::multi_index::tag<by_fee_payer>,
+                  boost::multi_index::member< entry, account_id_type, &entry::fee_payer > > > >;
+
+         /// Describes a transaction that is about to be applied to the state of db, but for the processed
+         /// transaction, which is left to be set once it is applied
+         static entry describe( const database& db, const precomputable_transaction& trx );
+
+         /**
+          * @param max_size        most bytes of transactions kept, 0 for no limit
+          * @param max_per_account most transactions kept per fee payer, 0 for no limit
+          */
+         void set_limits( size_t max_size, uint32_t max_per_account );
+
+         /// @return whether the fee payer of the transaction has fewer transactions in the pool than allowed
+         bool account_has_room_for( const entry& e )const;
+         /// @return whether the transaction fits in the size of the pool, after evicting transactions with a lower
+         ///         fee rate if need be
+         bool has_room_for( const entry& e )const;
+         /// Evicts the transactions with the lowest fee rates until the transaction fits
+         void make_room( const entry& e );
+
+         /// Adds a transaction after the ones already in the pool
+         void insert( entry&& e );
+         /// Takes all transactions out of the pool, in the order they were applied
+         std::vector<entry> release();
+         void clear();
+
+         const index_type& indices()const { return _index; }
+         bool     empty()const         { return _index.empty(); }
+         size_t   size()const          { return _index.size(); }
+         size_t   size_in_bytes()const { return _size_in_bytes; }
+         uint32_t max_per_account()const { return _max_per_account; }
+         /// Number of transactions evicted to make room for others so far
+         uint64_t evicted()const       { return _evicted; }
+
+      private:
+         index_type  _index;
+         uint64_t    _next_sequence = 0;
+         size_t      _size_in_bytes = 0;
+         size_t      _max_size = 0;
+         uint32_t    _max_per_account = 0;
+         uint64_t    _evicted = 0;
+   };
+
+} } // graphene::chain
@@ -29,6 +29,13 @@ namespace graphene { namespace chain {
       std::string                   fail_reason;
 
       bool is_authorized_to_execute(database& db) const;
+
+      /// Proposals carry a whole transaction, the undo history only keeps the fields that changed
+      /// @{
+      bool undo_by_delta()const override { return true; }
+      void pack_fields( std::vector<char>& out, std::vector<uint32_t>& field_ends )const override;
+      void unpack_field( uint32_t field, fc::datastream<const char*>& ds ) override;
+      /// @}
 };
 
 /**
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <graphene/chain/market_object.hpp>
+
+#include <graphene/db/index.hpp>
+
+#include <map>
+#include <memory>
+#include <set>
+
+namespace graphene { namespace chain {
+   class database;
+
+   /**
+    * @brief An immutable view of the object database as of one head block
+    *
+    * When enabled with database::enable_read_snapshots(), the database publishes a snapshot after every block it
+    * pushes or pops, see database::read_snapshot(). A snapshot shares each object that did not change with the one
+    * published before, so publishing costs about as much as copying the objects the block changed.
+    *
+    * A published snapshot is never modified again. It can be read from any thread, without locks, while the
+    * database goes on applying blocks. It holds no pending transactions.
+    */
+   class read_snapshot
+   {
+      public:
+         /// Orders that sell one asset for another, best price first, as ordered by limit_order_index by_price
+         using order_book_side = std::vector< std::shared_ptr<const limit_order_object> >;
+
+         uint32_t             head_block_num = 0;
+         block_id_type        head_block_id;
+         fc::time_point_sec   head_block_time;
+
+         const object* find_object( const object_id_type& id )const;
+
+         template<typename T>
+         const T* find( const object_id_type& id )const
+         {
+            const object* obj = find_object( id );
+            assert( !obj || nullptr != dynamic_cast<const T*>(obj) );
+            return static_cast<const T*>(obj);
+         }
+
+         template<uint8_t SpaceID, uint8_t TypeID>
+         auto find( const object_id<SpaceID,TypeID>& id )const -> const object_downcast_t<decltype(id)>*
+         {
+            return find<object_downcast_t<decltype(id)>>( object_id_type(id) );
+         }
+
+         template<uint8_t SpaceID, uint8_t TypeID>
+         auto get( const object_id<SpaceID,TypeID>& id )const -> const object_downcast_t<decltype(id)>&
+         {
+            const auto* obj = find( id );
+            FC_ASSERT( obj != nullptr, "Unable to find Object ${id}", ("id", object_id_type(id)) );
+            return *obj;
+         }
+
+         /// @return the orders selling @p sell for @p receive, best price first
+         const order_book_side& get_orders( asset_id_type sell, asset_id_type receive )const;
+
+      private:
+         friend class read_snapshot_publisher;
+
+         /// Objects of an index by instance, in chunks that are shared between snapshots until they change
+         struct table
+         {
+            static constexpr uint64_t chunk_size = 256;
+            using chunk = std::vector< std::shared_ptr<const object> >;
+
+            std::vector< std::shared_ptr<const chunk> > chunks;
+         };
+
+         std::vector< std::vector< std::shared_ptr<const table> > >  _tables; ///< by space and type
+         std::map< std::pair<asset_id_type,asset_id_type>, std::shared_ptr<const order_book_side> >  _orders;
+   };
+
+   /**
+    * @brief Keeps track of the objects changed since the last published read_snapshot and publishes the next one
+    *
+    * Used by the database on the thread that applies blocks.
+    */
+   class read_snapshot_publisher
+   {
+      public:
+         explicit read_snapshot_publisher( database& db );
+
+         /// Builds a snapshot of the current state of the database, sharing what did not change with the last one
+         std::shared_ptr<const read_snapshot> publish();
+
+         /// @return an observer to add to every index, it records the objects that change
+         std::shared_ptr<db::index_observer> make_observer();
+
+         /// Forgets the last snapshot, so that the next one is built from scratch, e.g. after the state was reloaded
+         void reset();
+
+      private:
+         class observer;
+
+         static std::shared_ptr<const object> find_shared( const read_snapshot& snapshot, const object_id_type& id );
+
+         database&                                                 _db;
+         std::shared_ptr<const read_snapshot>                      _last;
+         std::set<object_id_type>                                  _changed;
+         std::set< std::pair<asset_id_type,asset_id_type> >        _changed_markets;
+   };
+
+} } // graphene::chain
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <graphene/chain/account_object.hpp>
+#include <graphene/chain/vesting_balance_object.hpp>
+#include <graphene/protocol/block.hpp>
+#include <graphene/protocol/chain_parameters.hpp>
+
+#include <map>
+#include <set>
+
+namespace graphene { namespace chain {
+   class database;
+
+   /**
+    * @brief This secondary index of account_index keeps running totals of the votes between maintenance intervals
+    *
+    * The totals are the sum of the contributions of the accounts, the voting stake of an account added to the
+    * opinions of its voting account. The contribution of an account is only computed again after the account was
+    * marked, because one of its account, statistics or vesting balance objects changed or its membership expired.
+    * So chain maintenance walks the marked accounts only, rather than every account with some core voting.
+    *
+    * update() walks the marked accounts the way perform_account_maintenance() walks all of them: in the same
+    * order, reading the voting stakes at the same point and processing the pending fees along the way. The totals
+    * are then exactly the ones of a full recount. The totals are not part of the state, so the first maintenance
+    * interval after the tracker is enabled, or after the block of the last update left the chain, recounts fully.
+    */
+   class vote_tally_tracker : public secondary_index
+   {
+      public:
+         virtual void object_inserted( const object& obj ) override;
+         virtual void object_removed( const object& obj ) override;
+         virtual void object_modified( const object& after  ) override;
+
+         /// Whether the stake of the account counts, and the stake, as tallied by chain maintenance
+         static bool     counts_votes( const database& db, const account_object& stake_account );
+         static uint64_t voting_stake( const database& db, const account_object& stake_account,
+                                       const account_statistics_object& stats );
+
+         /// Starts or stops tracking, either way the next maintenance recounts fully
+         void enable( bool enable );
+         bool enabled()const { return _enabled; }
+
+         /// Marks an account whose contribution may have changed
+         void mark( account_id_type account );
+
+         /// @return whether update() can bring the totals up to date, or a full recount is needed
+         bool is_current( const database& db )const;
+         /// Forgets the totals before a full recount
+         void reset();
+         /// Adds the contribution of an account walked by a full recount
+         void record( const database& db, const account_object& stake_account, uint64_t voting_stake );
+         /// Notes that the totals are those of the maintenance interval of block
+         void set_current( const database& db, const signed_block& block );
+
+         /// Walks the marked accounts, computes their contributions again and processes their pending fees
+         void update( database& db );
+
+         /// Adds the totals to the buffers chain maintenance sized for params
+         void get_totals( const chain_parameters& params, vector<uint64_t>& vote_tally,
+                          vector<uint64_t>& validator_count_histogram, vector<uint64_t>& council_count_histogram,
+                          uint64_t& total_voting_stake )const;
+
+         /// Number of update() results compared with a full recount, and how many differed
+         uint32_t checks()const        { return _checks; }
+         uint32_t failed_checks()const { return _failed_checks; }
+         void count_check( bool passed );
+
+      private:
+         struct contribution
+         {
+            uint64_t        stake = 0;
+            account_id_type opinion_account;
+            /// Key of the entry in _membership_expirations, if the account has one
+            optional<time_point_sec> membership_expiration;
+         };
+
+         struct opinion
+         {
+            flat_set<vote_id_type> votes;
+            uint16_t               num_producers = 0;
+            uint16_t               num_delegates = 0;
+            uint64_t               stake = 0;  ///< of the accounts voting with it
+            uint32_t               voters = 0;
+         };
+
+         void add( const database& db, const account_object& stake_account, uint64_t voting_stake );
+         void remove( account_id_type stake_account );
+         void refresh( const database& db, account_id_type opinion_account, opinion& o );
+         /// Adds stake to the totals of the opinions in o, or takes it off
+         void apply( const opinion& o, uint64_t stake, bool add );
+
+         bool                                          _enabled = false;
+         bool                                          _current = false;
+         uint32_t                                      _block_num = 0;
+         block_id_type                                 _block_id;
+         bool                                          _count_non_member_votes = false;
+
+         std::map< account_id_type, contribution >    _contributions;
+         std::map< account_id_type, opinion >         _opinions;
+         std::set< account_id_type >                   _marked;
+         /// Accounts that count as members until then
+         std::multimap< time_point_sec, account_id_type > _membership_expirations;
+
+         vector<uint64_t>                              _vote_totals;           ///< by vote instance
+         std::map< uint16_t, uint64_t >                _producer_count_totals; ///< by num_producers
+         std::map< uint16_t, uint64_t >                _council_count_totals;  ///< by num_delegates
+         uint64_t                                      _total_voting_stake = 0;
+
+         uint32_t                                      _checks = 0;
+         uint32_t                                      _failed_checks = 0;
+   };
+
+   /**
+    *  @brief This secondary index marks the owners of the changed objects of an index in vote_tally_tracker
+    */
+   template<typename ObjectType>
+   class vote_tally_marker_index : public secondary_index
+   {
+      public:
+         explicit vote_tally_marker_index( vote_tally_tracker* tracker ) : _tracker( tracker ) {}
+
+         virtual void object_inserted( const object& obj ) override { mark( obj ); }
+         virtual void object_removed( const object& obj ) override  { mark( obj ); }
+         virtual void object_modified( const object& after  ) override { mark( after ); }
+
+      private:
+         void mark( const object& obj )
+         {
+            if( _tracker->enabled() )
+               _tracker->mark( static_cast< const ObjectType& >( obj ).owner );
+         }
+
+         vote_tally_tracker* _tracker;
+   };
+
+} } // graphene::chain
@@ -2,7 +2,10 @@
 
 #include <boost/multiprecision/cpp_int.hpp>
 
+#include <algorithm>
 #include <functional>
+#include <limits>
+#include <numeric>
 
 #include <fc/io/raw.hpp>
 
@@ -277,6 +280,221 @@ share_type call_order_object::get_max_debt_to_cover( price match_price,
 
 } FC_CAPTURE_AND_RETHROW( (*this)(feed_price)(match_price)(maintenance_collateral_ratio) ) } // GCOVR_EXCL_LINE
 
+namespace graphene { namespace chain {
+
+const collateralization_key& call_order_object::get_collateralization_key()const
+{
+   auto& key = _collateralization_key;
+   if( key.collateral != collateral.value || key.debt != debt.value
+       || key.collateral_type != collateral_type() || key.debt_type != debt_type() )
+   {
+      key.collateral_type = collateral_type();
+      key.debt_type = debt_type();
+      key.collateral = collateral.value;
+      key.debt = debt.value;
+      key.ratio = debt.value > 0 ? ( fc::uint128_t( collateral.value ) << 64 ) / static_cast<uint64_t>( debt.value )
+                                 : std::numeric_limits<fc::uint128_t>::max();
+   }
+   return key;
+}
+
+bool collateralization_less::operator()( const collateralization_key& a, const collateralization_key& b )const
+{
+   if( a.collateral_type != b.collateral_type ) return a.collateral_type < b.collateral_type;
+   if( a.debt_type != b.debt_type ) return a.debt_type < b.debt_type;
+   if( a.ratio != b.ratio ) return a.ratio < b.ratio;
+   return fc::uint128_t( b.debt ) * a.collateral < fc::uint128_t( a.debt ) * b.collateral;
+}
+
+bool collateralization_less::operator()( const collateralization_key& a, const price& b )const
+{
+   if( a.collateral_type != b.base.asset_id ) return a.collateral_type < b.base.asset_id;
+   if( a.debt_type != b.quote.asset_id ) return a.debt_type < b.quote.asset_id;
+   return fc::uint128_t( b.quote.amount.value ) * a.collateral < fc::uint128_t( a.debt ) * b.base.amount.value;
+}
+
+bool collateralization_less::operator()( const price& a, const collateralization_key& b )const
+{
+   if( a.base.asset_id != b.collateral_type ) return a.base.asset_id < b.collateral_type;
+   if( a.quote.asset_id != b.debt_type ) return a.quote.asset_id < b.debt_type;
+   return fc::uint128_t( b.debt ) * a.base.amount.value < fc::uint128_t( a.quote.amount.value ) * b.collateral;
+}
+
+bool call_order_trigger_index::precedes( const call_order_object& order, const trigger& t )
+{
+   const collateralization_less less;
+   const auto& key = order.get_collateralization_key();
+   if( less( key, t.key ) ) return true;
+   if( less( t.key, key ) ) return false;
+   return order.id < t.least->id;
+}
+
+void call_order_trigger_index::track( trigger& t, const call_order_object* order )
+{
+   t.least = order;
+   if( order != nullptr )
+      t.key = order->get_collateralization_key();
+   t.stale = false;
+}
+
+void call_order_trigger_index::object_inserted( const object& obj )
+{
+   const auto& order = static_cast< const call_order_object& >( obj );
+   auto& t = _triggers[ std::make_pair( order.collateral_type(), order.debt_type() ) ];
+   if( !t.stale && ( t.least == nullptr || precedes( order, t ) ) )
+      track( t, &order );
+}
+
+void call_order_trigger_index::object_removed( const object& obj )
+{
+   const auto& order = static_cast< const call_order_object& >( obj );
+   auto itr = _triggers.find( std::make_pair( order.collateral_type(), order.debt_type() ) );
+   if( itr != _triggers.end() && itr->second.least == &order )
+   {
+      itr->second.least = nullptr;
+      itr->second.stale = true;
+   }
+}
+
+void call_order_trigger_index::object_modified( const object& after  )
+{
+   const auto& order = static_cast< const call_order_object& >( after );
+   auto& t = _triggers[ std::make_pair( order.collateral_type(), order.debt_type() ) ];
+   if( t.stale )
+      return;
+   if( t.least == &order )
+   {
+      // still first if it did not move back
+      if( collateralization_less()( t.key, order.get_collateralization_key() ) )
+         t.stale = true;
+      else
+         track( t, &order );
+   }
+   else if( t.least == nullptr || precedes( order, t ) )
+      track( t, &order );
+}
+
+const call_order_object* call_order_trigger_index::least_collateralized( asset_id_type collateral,
+                                                                          asset_id_type debt )const
+{
+   auto& t = _triggers[ std::make_pair( collateral, debt ) ];
+   if( t.stale )
+   {
+      const auto& by_collateral_idx = _calls->get<by_collateral>();
+      auto itr = by_collateral_idx.lower_bound( price::min( collateral, debt ) );
+      const bool found = itr != by_collateral_idx.end()
+                         && itr->collateral_type() == collateral && itr->debt_type() == debt;
+      track( t, found ? &*itr : nullptr );
+   }
+   return t.least;
+}
+
+limit_order_book_index::price_key::price_key( const price& p )
+{
+   const uint64_t b = p.base.amount.value;
+   const uint64_t q = p.quote.amount.value;
+   const uint64_t divisor = std::gcd( b, q );
+   base = divisor > 1 ? b / divisor : b;
+   quote = divisor > 1 ? q / divisor : q;
+}
+
+void limit_order_book_index::object_inserted( const object& obj )
+{
+   insert( static_cast< const limit_order_object& >( obj ) );
+}
+
+void limit_order_book_index::object_removed( const object& obj )
+{
+   const auto& order = static_cast< const limit_order_object& >( obj );
+   remove( order, order.sell_price );
+}
+
+void limit_order_book_index::about_to_modify( const object& before )
+{
+   _prices_being_modified.push( static_cast< const limit_order_object& >( before ).sell_price );
+}
+
+void limit_order_book_index::object_modified( const object& after  )
+{
+   const auto& order = static_cast< const limit_order_object& >( after );
+   const price before = _prices_being_modified.top();
+   _prices_being_modified.pop();
+   if( before.base.asset_id == order.sell_price.base.asset_id
+       && before.quote.asset_id == order.sell_price.quote.asset_id
+       && price_key( before ) == price_key( order.sell_price ) )
+      return;
+   remove( order, before );
+   insert( order );
+}
+
+void limit_order_book_index::insert( const limit_order_object& order )
+{
+   auto& side = _books[ std::make_pair( order.sell_asset_id(), order.receive_asset_id() ) ];
+   const price_key key( order.sell_price );
+   auto level = std::lower_bound( side.begin(), side.end(), key,
+                                  []( const price_level& l, const price_key& k ) { return l.key < k; } );
+   if( level == side.end() || level->key != key )
+      level = side.emplace( level, key );
+   // new orders have the highest ids, only orders restored by undo go in the middle
+   auto& orders = level->orders;
+   if( orders.empty() || orders.back()->id < order.id )
+      orders.push_back( &order );
+   else
+      orders.insert( std::lower_bound( orders.begin(), orders.end(), order.id,
+                                       []( const limit_order_object* o, const object_id_type& id ) {
+                                          return o->id < id;
+                                       } ),
+                     &order );
+}
+
+void limit_order_book_index::remove( const limit_order_object& order, const price& sell_price )
+{
+   auto book = _books.find( std::make_pair( sell_price.base.asset_id, sell_price.quote.asset_id ) );
+   if( book == _books.end() )
+      return;
+   auto& side = book->second;
+   const price_key key( sell_price );
+   auto level = std::lower_bound( side.begin(), side.end(), key,
+                                  []( const price_level& l, const price_key& k ) { return l.key < k; } );
+   if( level == side.end() || level->key != key )
+      return;
+   // matching removes the oldest order of a level
+   auto& orders = level->orders;
+   if( orders.front() == &order )
+      orders.pop_front();
+   else
+   {
+      auto itr = std::lower_bound( orders.begin(), orders.end(), order.id,
+                                   []( const limit_order_object* o, const object_id_type& id ) {
+                                      return o->id < id;
+                                   } );
+      if( itr == orders.end() || *itr != &order )
+         return;
+      orders.erase( itr );
+   }
+   if( orders.empty() )
+   {
+      side.erase( level );
+      if( side.empty() )
+         _books.erase( book );
+   }
+}
+
+const limit_order_book_index::book_side* limit_order_book_index::find( asset_id_type sell,
+                                                                       asset_id_type receive )const
+{
+   auto book = _books.find( std::make_pair( sell, receive ) );
+   return book == _books.end() ? nullptr : &book->second;
+}
+
+const limit_order_object* limit_order_book_index::best( asset_id_type sell, asset_id_type receive )const
+{
+   const book_side* side = find( sell, receive );
+   return side == nullptr ? nullptr : side->back().orders.front();
+}
+
+} } // graphene::chain
+
 FC_REFLECT_DERIVED_NO_TYPENAME( graphene::chain::limit_order_object,
                     (graphene::db::object),
                     (expiration)(seller)(for_sale)(sell_price)(deferred_fee)(deferred_paid_fee)
@@ -0,0 +1,161 @@
+#include <graphene/chain/mempool.hpp>
+#include <graphene/chain/database.hpp>
+
+namespace graphene { namespace chain {
+
+namespace {
+
+struct get_fee_visitor
+{
+   using result_type = asset;
+
+   template<typename OpType>
+   asset operator()( const OpType& op )const
+   {
+      return op.fee;
+   }
+};
+
+struct get_fee_payer_visitor
+{
+   using result_type = account_id_type;
+
+   template<typename OpType>
+   account_id_type operator()( const OpType& op )const
+   {
+      return op.fee_payer();
+   }
+};
+
+} // anonymous namespace
+
+mempool::entry mempool::describe( const database& db, const precomputable_transaction& trx )
+{
+   entry result;
+   result.id = trx.id();
+   result.expiration = trx.expiration;
+   result.size = trx.get_packed_size();
+   if( !trx.operations.empty() )
+      result.fee_payer = trx.operations.front().visit( get_fee_payer_visitor() );
+
+   // fees paid in other assets are counted at their core exchange rate, unknown assets count for nothing
+   share_type core_fees = 0;
+   for( const auto& op : trx.operations )
+   {
+      const asset fee = op.visit( get_fee_visitor() );
+      if( fee.asset_id == asset_id_type() )
+         core_fees += fee.amount;
+      else if( const asset_object* fee_asset = db.find( fee.asset_id ) )
+      {
+         try
+         {
+            core_fees += ( fee * fee_asset->options.core_exchange_rate ).amount;
+         }
+         catch( const fc::exception& )
+         { // overflow, the operation will be rejected anyway
+         }
+      }
+   }
+   if( core_fees > 0 )
+      result.fee_rate = static_cast<uint64_t>( fc::uint128_t( core_fees.value ) * 1024
+                                               / std::max<size_t>( result.size, 1 ) );
+
+   flat_set<account_id_type> owner;
+   vector<authority> other;
+   trx.get_required_authorities( result.authorities, owner, other );
+   result.authorities.insert( owner.begin(), owner.end() );
+   for( const auto& auth : other )
+      for( const auto& account_weight : auth.account_auths )
+         result.authorities.insert( account_weight.first );
+
+   // the accounts the required authorities refer to, as deep as they are followed when checking signatures
+   flat_set<account_id_type> level = result.authorities;
+   const uint8_t max_depth = db.get_global_properties().parameters.max_authority_depth;
+   for( uint8_t depth = 0; depth < max_depth && !level.empty(); ++depth )
+   {
+      flat_set<account_id_type> next;
+      for( const auto& account_id : level )
+      {
+         const account_object* account = db.find( account_id );
+         if( account == nullptr )
+            continue;
+         for( const auto& account_weight : account->active.account_auths )
+            if( result.authorities.insert( account_weight.first ).second )
+               next.insert( account_weight.first );
+         for( const auto& account_weight : account->owner.account_auths )
+            if( result.authorities.insert( account_weight.first ).second )
+               next.insert( account_weight.first );
+      }
+      level = std::move( next );
+   }
+   return result;
+}
+
+void mempool::set_limits( size_t max_size, uint32_t max_per_account )
+{
+   _max_size = max_size;
+   _max_per_account = max_per_account;
+}
+
+bool mempool::account_has_room_for( const entry& e )const
+{
+   return _max_per_account == 0 || _index.get<by_fee_payer>().count( e.fee_payer ) < _max_per_account;
+}
+
+bool mempool::has_room_for( const entry& e )const
+{
+   if( _max_size == 0 || _size_in_bytes + e.size <= _max_size )
+      return true;
+   if( e.size > _max_size )
+      return false;
+
+   // count what evicting the transactions paying less would free
+   size_t freed = 0;
+   const size_t needed = _size_in_bytes + e.size - _max_size;
+   const auto& by_rate = _index.get<by_fee_rate>();
+   for( auto itr = by_rate.begin(); itr != by_rate.end() && itr->fee_rate < e.fee_rate; ++itr )
+   {
+      freed += itr->size;
+      if( freed >= needed )
+         return true;
+   }
+   return false;
+}
+
+void mempool::make_room( const entry& e )
+{
+   if( _max_size == 0 )
+      return;
+   auto& by_rate = _index.get<by_fee_rate>();
+   while( !by_rate.empty() && _size_in_bytes + e.size > _max_size && by_rate.begin()->fee_rate < e.fee_rate )
+   {
+      _size_in_bytes -= by_rate.begin()->size;
+      by_rate.erase( by_rate.begin() );
+      ++_evicted;
+   }
+}
+
+void mempool::insert( entry&& e )
+{
+   e.sequence = _next_sequence++;
+   _size_in_bytes += e.size;
+   _index.insert( std::move( e ) );
+}
+
+std::vector<mempool::entry> mempool::release()
+{
+   std::vector<entry> result;
+   result.reserve( _index.size() );
+   for( const auto& e : _index.get<by_sequence>() )
+      result.push_back( e );
+   clear();
+   return result;
+}
+
+void mempool::clear()
+{
+   _index.clear();
+   _size_in_bytes = 0;
+}
+
+} } // graphene::chain
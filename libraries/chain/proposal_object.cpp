@@ -3,6 +3,8 @@
 #include <graphene/chain/transaction_evaluation_state.hpp>
 #include <graphene/chain/proposal_object.hpp>
 
+#include <graphene/db/undo_delta.hpp>
+
 namespace graphene { namespace chain {
 
 bool proposal_object::is_authorized_to_execute(database& db) const
@@ -118,3 +120,5 @@ FC_REFLECT_DERIVED_NO_TYPENAME( graphene::chain::proposal_object, (graphene::cha
                     (available_key_approvals)(proposer)(fail_reason) )
 
 GRAPHENE_IMPLEMENT_EXTERNAL_SERIALIZATION( graphene::chain::proposal_object )
+
+GRAPHENE_IMPLEMENT_DELTA_UNDO( graphene::chain::proposal_object )
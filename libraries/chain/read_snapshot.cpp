@@ -0,0 +1,173 @@
+#include <graphene/chain/read_snapshot.hpp>
+#include <graphene/chain/database.hpp>
+
+namespace graphene { namespace chain {
+
+const object* read_snapshot::find_object( const object_id_type& id )const
+{
+   if( id.space() >= _tables.size() || id.type() >= _tables[id.space()].size() )
+      return nullptr;
+   const auto& t = _tables[id.space()][id.type()];
+   if( !t )
+      return nullptr;
+   const uint64_t chunk = id.instance() / table::chunk_size;
+   if( chunk >= t->chunks.size() || !t->chunks[chunk] )
+      return nullptr;
+   return (*t->chunks[chunk])[ id.instance() % table::chunk_size ].get();
+}
+
+const read_snapshot::order_book_side& read_snapshot::get_orders( asset_id_type sell, asset_id_type receive )const
+{
+   static const order_book_side empty;
+   auto itr = _orders.find( std::make_pair( sell, receive ) );
+   return itr == _orders.end() ? empty : *itr->second;
+}
+
+/// Records every object that is added, modified or removed, including by undo
+class read_snapshot_publisher::observer : public db::index_observer
+{
+   public:
+      explicit observer( read_snapshot_publisher& publisher ) : _publisher( publisher ) {}
+
+      void on_add( const object& obj ) override    { changed( obj ); }
+      void on_remove( const object& obj ) override { changed( obj ); }
+      void on_modify( const object& obj ) override { changed( obj ); }
+
+   private:
+      void changed( const object& obj )
+      {
+         _publisher._changed.insert( obj.id );
+         if( obj.id.is<limit_order_id_type>() )
+         {
+            const auto& order = static_cast<const limit_order_object&>( obj );
+            _publisher._changed_markets.emplace( order.sell_price.base.asset_id, order.sell_price.quote.asset_id );
+         }
+      }
+
+      read_snapshot_publisher& _publisher;
+};
+
+read_snapshot_publisher::read_snapshot_publisher( database& db ) : _db( db ) {}
+
+std::shared_ptr<db::index_observer> read_snapshot_publisher::make_observer()
+{
+   return std::make_shared<observer>( *this );
+}
+
+void read_snapshot_publisher::reset()
+{
+   _last.reset();
+   _changed.clear();
+   _changed_markets.clear();
+}
+
+std::shared_ptr<const object> read_snapshot_publisher::find_shared( const read_snapshot& snapshot,
+                                                                   const object_id_type& id )
+{
+   const uint64_t chunk_size = read_snapshot::table::chunk_size;
+   const auto& chunks = snapshot._tables[id.space()][id.type()]->chunks;
+   return (*chunks[ id.instance() / chunk_size ])[ id.instance() % chunk_size ];
+}
+
+std::shared_ptr<const read_snapshot> read_snapshot_publisher::publish()
+{ try {
+   using table = read_snapshot::table;
+
+   auto result = std::make_shared<read_snapshot>();
+   result->head_block_num = _db.head_block_num();
+   result->head_block_id = _db.head_block_id();
+   result->head_block_time = _db.head_block_time();
+
+   const auto& limit_book = _db.get_limit_order_book();
+   auto rebuild_market = [&result,&limit_book]( asset_id_type sell, asset_id_type receive ) {
+      auto side = std::make_shared<read_snapshot::order_book_side>();
+      limit_book.for_each_order( sell, receive, [&result,&side]( const limit_order_object& order ) {
+         side->push_back( std::static_pointer_cast<const limit_order_object>(
+                             find_shared( *result, order.id ) ) );
+         return true;
+      });
+      if( side->empty() )
+         result->_orders.erase( std::make_pair( sell, receive ) );
+      else
+         result->_orders[ std::make_pair( sell, receive ) ] = std::move( side );
+   };
+
+   if( !_last )
+   {
+      // copy everything
+      _db.inspect_indexes( [&result]( const db::index& idx ) {
+         auto& space = result->_tables;
+         if( space.size() <= idx.object_space_id() )
+            space.resize( idx.object_space_id() + 1 );
+         if( space[idx.object_space_id()].size() <= idx.object_type_id() )
+            space[idx.object_space_id()].resize( idx.object_type_id() + 1 );
+
+         std::vector< std::shared_ptr<table::chunk> > chunks;
+         idx.inspect_all_objects( [&chunks]( const object& obj ) {
+            const uint64_t chunk = obj.id.instance() / table::chunk_size;
+            if( chunks.size() <= chunk )
+               chunks.resize( chunk + 1 );
+            if( !chunks[chunk] )
+               chunks[chunk] = std::make_shared<table::chunk>( table::chunk_size );
+            (*chunks[chunk])[ obj.id.instance() % table::chunk_size ] = obj.clone();
+         });
+         auto t = std::make_shared<table>();
+         t->chunks.assign( chunks.begin(), chunks.end() );
+         space[idx.object_space_id()][idx.object_type_id()] = std::move( t );
+      });
+
+      std::set< std::pair<asset_id_type,asset_id_type> > markets;
+      const auto& price_idx = _db.get_index_type<limit_order_index>().indices().get<by_price>();
+      for( const auto& order : price_idx )
+         markets.emplace( order.sell_price.base.asset_id, order.sell_price.quote.asset_id );
+      for( const auto& market : markets )
+         rebuild_market( market.first, market.second );
+   }
+   else
+   {
+      // share what did not change, ids are ordered by space, type and instance
+      result->_tables = _last->_tables;
+      result->_orders = _last->_orders;
+
+      auto itr = _changed.begin();
+      while( itr != _changed.end() )
+      {
+         const uint8_t space_id = itr->space();
+         const uint8_t type_id = itr->type();
+         auto& space = result->_tables;
+         if( space.size() <= space_id )
+            space.resize( space_id + 1 );
+         if( space[space_id].size() <= type_id )
+            space[space_id].resize( type_id + 1 );
+         auto t = space[space_id][type_id] ? std::make_shared<table>( *space[space_id][type_id] )
+                                           : std::make_shared<table>();
+
+         while( itr != _changed.end() && itr->space() == space_id && itr->type() == type_id )
+         {
+            const uint64_t chunk = itr->instance() / table::chunk_size;
+            if( t->chunks.size() <= chunk )
+               t->chunks.resize( chunk + 1 );
+            auto slots = t->chunks[chunk] ? std::make_shared<table::chunk>( *t->chunks[chunk] )
+                                          : std::make_shared<table::chunk>( table::chunk_size );
+            for( ; itr != _changed.end() && itr->space() == space_id && itr->type() == type_id
+                   && itr->instance() / table::chunk_size == chunk; ++itr )
+            {
+               const object* obj = _db.find_object( *itr );
+               (*slots)[ itr->instance() % table::chunk_size ] = obj ? obj->clone() : nullptr;
+            }
+            t->chunks[chunk] = std::move( slots );
+         }
+         space[space_id][type_id] = std::move( t );
+      }
+
+      for( const auto& market : _changed_markets )
+         rebuild_market( market.first, market.second );
+   }
+
+   _changed.clear();
+   _changed_markets.clear();
+   _last = result;
+   return result;
+} FC_CAPTURE_AND_RETHROW() } // GCOVR_EXCL_LINE
+
+} } // graphene::chain
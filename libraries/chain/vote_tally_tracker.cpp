@@ -0,0 +1,294 @@
+#include <graphene/chain/vote_tally_tracker.hpp>
+#include <graphene/chain/block_summary_object.hpp>
+#include <graphene/chain/database.hpp>
+#include <graphene/chain/global_property_object.hpp>
+
+#include <boost/tuple/tuple.hpp>
+
+namespace graphene { namespace chain {
+
+void vote_tally_tracker::object_inserted( const object& obj )
+{
+   if( _enabled )
+      mark( account_id_type( obj.id ) );
+}
+
+void vote_tally_tracker::object_removed( const object& obj )
+{
+   if( _enabled )
+      mark( account_id_type( obj.id ) );
+}
+
+void vote_tally_tracker::object_modified( const object& after  )
+{
+   if( _enabled )
+      mark( account_id_type( after.id ) );
+}
+
+bool vote_tally_tracker::counts_votes( const database& db, const account_object& stake_account )
+{
+   return db.get_global_properties().parameters.count_non_member_votes
+          || stake_account.is_member( db.head_block_time() );
+}
+
+uint64_t vote_tally_tracker::voting_stake( const database& db, const account_object& stake_account,
+                                           const account_statistics_object& stats )
+{
+   return stats.total_core_in_orders.value
+          + (stake_account.cashback_vb.valid() ? (*stake_account.cashback_vb)(db).balance.amount.value: 0)
+          + stats.core_in_balance.value;
+}
+
+void vote_tally_tracker::enable( bool enable )
+{
+   _enabled = enable;
+   reset();
+}
+
+void vote_tally_tracker::mark( account_id_type account )
+{
+   _marked.insert( account );
+}
+
+bool vote_tally_tracker::is_current( const database& db )const
+{
+   if( !_current || db.get_global_properties().parameters.count_non_member_votes != _count_non_member_votes )
+      return false;
+   // the block summaries tell which blocks of the last 0x10000 are in the chain
+   const uint32_t head_num = db.head_block_num();
+   if( _block_num > head_num || head_num - _block_num >= 0x10000 )
+      return false;
+   return block_summary_id_type( _block_num & 0xffff )( db ).block_id == _block_id;
+}
+
+void vote_tally_tracker::reset()
+{
+   _current = false;
+   _contributions.clear();
+   _opinions.clear();
+   _marked.clear();
+   _membership_expirations.clear();
+   _vote_totals.clear();
+   _producer_count_totals.clear();
+   _council_count_totals.clear();
+   _total_voting_stake = 0;
+}
+
+void vote_tally_tracker::record( const database& db, const account_object& stake_account, uint64_t voting_stake )
+{
+   add( db, stake_account, voting_stake );
+}
+
+void vote_tally_tracker::set_current( const database& db, const signed_block& block )
+{
+   _current = true;
+   _block_num = block.block_num();
+   _block_id = block.id();
+   _count_non_member_votes = db.get_global_properties().parameters.count_non_member_votes;
+}
+
+void vote_tally_tracker::update( database& db )
+{
+   // memberships that expired since count no more
+   const time_point_sec now = db.head_block_time();
+   const auto expired = _membership_expirations.lower_bound( now );
+   for( auto itr = _membership_expirations.begin(); itr != expired; ++itr )
+      _marked.insert( itr->second );
+   _membership_expirations.erase( _membership_expirations.begin(), expired );
+
+   // the opinions do not change while the accounts are walked
+   for( const account_id_type& account : _marked )
+   {
+      auto itr = _opinions.find( account );
+      if( itr != _opinions.end() )
+         refresh( db, itr->first, itr->second );
+   }
+
+   auto by_name = []( const account_statistics_object* a, const account_statistics_object* b ) {
+      return a->name < b->name;
+   };
+   std::set< const account_statistics_object*, decltype(by_name) > to_walk( by_name );
+   for( const account_id_type& account : _marked )
+   {
+      // accounts are only removed by undoing their creation
+      const account_statistics_object* stats = db.find( account_statistics_id_type( account.instance ) );
+      if( stats != nullptr )
+         to_walk.insert( stats );
+      else
+         remove( account );
+   }
+   _marked.clear();
+
+   const auto& stats_idx = db.get_index_type< account_stats_index >().indices().get< by_maintenance_seq >();
+   std::set< account_id_type > passed;
+   // perform_account_maintenance() moves on to the next account before the fees are processed, the accounts
+   // that need maintenance only after them and come before the next one are passed by
+   bool walk_started = false;
+   bool walk_ended = false;
+   string next_name;
+   while( !to_walk.empty() )
+   {
+      const account_statistics_object& stats = **to_walk.begin();
+      to_walk.erase( to_walk.begin() );
+      remove( stats.owner );
+
+      if( !stats.need_maintenance() )
+         continue;
+      if( walk_ended || ( walk_started && stats.name < next_name ) )
+      {
+         passed.insert( stats.owner );
+         continue;
+      }
+
+      const account_object& account = stats.owner( db );
+      if( stats.has_some_core_voting() && counts_votes( db, account ) )
+         add( db, account, voting_stake( db, account, stats ) );
+
+      walk_started = true;
+      auto next = stats_idx.upper_bound( boost::make_tuple( true, stats.name ) );
+      walk_ended = ( next == stats_idx.end() );
+      if( !walk_ended )
+         next_name = next->name;
+
+      if( stats.has_pending_fees() )
+         stats.process_fees( account, db );
+
+      // the accounts changed by the fees, the ones walked already count in the next maintenance interval
+      for( const account_id_type& changed : _marked )
+      {
+         const account_statistics_object& changed_stats = db.get_account_stats_by_owner( changed );
+         if( stats.name < changed_stats.name )
+            to_walk.insert( &changed_stats );
+         else
+            passed.insert( changed );
+      }
+      _marked.clear();
+   }
+   _marked = std::move( passed );
+}
+
+void vote_tally_tracker::get_totals( const chain_parameters& params, vector<uint64_t>& vote_tally,
+                                     vector<uint64_t>& validator_count_histogram,
+                                     vector<uint64_t>& council_count_histogram, uint64_t& total_voting_stake )const
+{
+   // votes for ids beyond the buffer are ignored, as by a full recount
+   const size_t votes = std::min( vote_tally.size(), _vote_totals.size() );
+   for( size_t i = 0; i < votes; ++i )
+      vote_tally[i] += _vote_totals[i];
+
+   for( const auto& count : _producer_count_totals )
+   {
+      if( count.first <= params.maximum_producer_count )
+         validator_count_histogram[ std::min( size_t(count.first / 2), validator_count_histogram.size() - 1 ) ]
+               += count.second;
+   }
+   for( const auto& count : _council_count_totals )
+   {
+      if( count.first <= params.maximum_council_count )
+         council_count_histogram[ std::min( size_t(count.first / 2), council_count_histogram.size() - 1 ) ]
+               += count.second;
+   }
+
+   total_voting_stake += _total_voting_stake;
+}
+
+void vote_tally_tracker::count_check( bool passed )
+{
+   ++_checks;
+   if( !passed )
+      ++_failed_checks;
+}
+
+void vote_tally_tracker::add( const database& db, const account_object& stake_account, uint64_t voting_stake )
+{
+   const account_id_type stake_account_id = stake_account.get_id();
+   const account_id_type opinion_account_id =
+         ( stake_account.options.voting_account == GRAPHENE_PROXY_TO_SELF_ACCOUNT )
+         ? stake_account_id : stake_account.options.voting_account;
+   contribution& contrib = _contributions[ stake_account_id ];
+   contrib = contribution{ voting_stake, opinion_account_id };
+
+   auto itr = _opinions.find( opinion_account_id );
+   if( itr == _opinions.end() )
+   {
+      itr = _opinions.emplace( opinion_account_id, opinion() ).first;
+      refresh( db, opinion_account_id, itr->second );
+   }
+   ++itr->second.voters;
+   itr->second.stake += voting_stake;
+   apply( itr->second, voting_stake, true );
+   _total_voting_stake += voting_stake;
+
+   if( !db.get_global_properties().parameters.count_non_member_votes && !stake_account.is_lifetime_member() )
+   {
+      _membership_expirations.emplace( stake_account.membership_expiration_date, stake_account_id );
+      contrib.membership_expiration = stake_account.membership_expiration_date;
+   }
+}
+
+void vote_tally_tracker::remove( account_id_type stake_account )
+{
+   auto itr = _contributions.find( stake_account );
+   if( itr == _contributions.end() )
+      return;
+
+   auto opinion_itr = _opinions.find( itr->second.opinion_account );
+   apply( opinion_itr->second, itr->second.stake, false );
+   opinion_itr->second.stake -= itr->second.stake;
+   if( --opinion_itr->second.voters == 0 )
+      _opinions.erase( opinion_itr );
+   _total_voting_stake -= itr->second.stake;
+
+   // gone already if the membership expired
+   if( itr->second.membership_expiration.valid() )
+   {
+      auto range = _membership_expirations.equal_range( *itr->second.membership_expiration );
+      for( auto expiration_itr = range.first; expiration_itr != range.second; ++expiration_itr )
+      {
+         if( expiration_itr->second == stake_account )
+         {
+            _membership_expirations.erase( expiration_itr );
+            break;
+         }
+      }
+   }
+   _contributions.erase( itr );
+}
+
+void vote_tally_tracker::refresh( const database& db, account_id_type opinion_account, opinion& o )
+{
+   const account_object* account = db.find( opinion_account );
+   if( account == nullptr ) // its creation was undone, and so were the votes with it
+      return;
+   apply( o, o.stake, false );
+   const account_options& options = account->options;
+   o.votes = options.votes;
+   o.num_producers = options.num_producers;
+   o.num_delegates = options.num_delegates;
+   apply( o, o.stake, true );
+}
+
+void vote_tally_tracker::apply( const opinion& o, uint64_t stake, bool add )
+{
+   if( stake == 0 )
+      return;
+
+   auto update = [stake,add]( uint64_t& total ) {
+      if( add )
+         total += stake;
+      else
+         total -= stake;
+   };
+
+   for( const vote_id_type& id : o.votes )
+   {
+      const uint32_t offset = id.instance();
+      if( offset >= _vote_totals.size() )
+         _vote_totals.resize( offset + 1 );
+      update( _vote_totals[offset] );
+   }
+   update( _producer_count_totals[ o.num_producers ] );
+   update( _council_count_totals[ o.num_delegates ] );
+}
+
+} } // graphene::chain
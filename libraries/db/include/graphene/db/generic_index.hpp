@@ -45,6 +45,16 @@ namespace graphene { namespace db {
          }
 
          void modify( const object& obj, const std::function<void(object&)>& m )override
+         {
+            modify( obj, m, []( object& ){} );
+         }
+
+         /**
+          * Like modify(), except that rollback is called on an object which violates an index constraint. If it
+          * gives the object back its keys from before, the object stays in place rather than being erased.
+          */
+         void modify( const object& obj, const std::function<void(object&)>& m,
+                      const std::function<void(object&)>& rollback )
          {
             assert(nullptr != dynamic_cast<const ObjectType*>(&obj));
             std::exception_ptr exc;
@@ -60,7 +70,8 @@ namespace graphene { namespace db {
                                              exc = std::current_exception();
                                              elog("Unknown exception while modifying object");
                                           }
-                                       }
+                                       },
+                                       [&rollback](ObjectType& o) { rollback( o ); }
                       );
             if (exc)
                 std::rethrow_exception(exc);
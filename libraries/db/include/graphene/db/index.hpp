@@ -7,11 +7,53 @@
 #include <fc/crypto/sha256.hpp>
 
 #include <fstream>
+#include <memory>
 #include <stack>
 
 namespace graphene { namespace db {
    class object_database;
 
+   /**
+    * @brief header of the files an index is saved to
+    *
+    * Files start with the header and hold length-prefixed packed objects that are unpacked straight from the
+    * mapped file. Indexes holding more than objects_per_shard objects are split over several files, which
+    * object_database decodes in parallel. Files without the header are in the format used before it was
+    * introduced and are still read.
+    */
+   struct index_file_header
+   {
+      static constexpr uint32_t current_format = 2;
+      static constexpr uint64_t objects_per_shard = 100000;
+
+      uint32_t       format = current_format;
+      fc::sha256     object_version;
+      object_id_type next_id;
+      uint32_t       shard = 0;
+      uint32_t       shard_count = 1;
+      uint64_t       object_count = 0;
+
+      /** @return false, leaving ds untouched, if ds does not start with a header */
+      static bool read( fc::datastream<const char*>& ds, index_file_header& header );
+      void        write( std::ostream& out )const;
+
+      /** @return the file holding a shard of the index saved to db */
+      static fc::path              shard_path( const fc::path& db, uint32_t shard );
+      /** @return the files of the index saved to db in shard order, empty if there is none */
+      static std::vector<fc::path> saved_shards( const fc::path& db );
+   };
+
+   /**
+    * @brief objects decoded from one file of a saved index, see index::read_shard()
+    */
+   class index_shard
+   {
+      public:
+         virtual ~index_shard() = default;
+
+         object_id_type next_id;
+   };
+
    /**
     * @class index_observer
     * @brief used to get callbacks when objects change
@@ -51,6 +93,8 @@ namespace graphene { namespace db {
 
          virtual uint8_t object_space_id()const = 0;
          virtual uint8_t object_type_id()const = 0;
+         /** @return the hash identifying the serialization of the objects, stored in the index files */
+         virtual fc::sha256 get_object_version()const = 0;
 
          virtual object_id_type get_next_id()const = 0;
          virtual void           use_next_id() = 0;
@@ -75,6 +119,18 @@ namespace graphene { namespace db {
          virtual void open( const fc::path& db ) = 0;
          virtual void save( const fc::path& db ) = 0;
 
+         /**
+          *  open() split in two, so that the files of large indexes can be decoded in parallel. read_shard() may
+          *  be called concurrently, load_shards() inserts the shards in the order of saved_shards().
+          */
+         virtual std::unique_ptr<index_shard> read_shard( const fc::path& file )const = 0;
+         virtual void                         load_shards( std::vector< std::unique_ptr<index_shard> >& shards ) = 0;
+
+         /** @return true if the index changed since it was last saved or loaded */
+         virtual bool is_dirty()const = 0;
+         /** called once a save() made it to disk */
+         virtual void clear_dirty() = 0;
+
 
 
          /** @return the object with id or nullptr if not found */
@@ -133,8 +189,12 @@ namespace graphene { namespace db {
 
          virtual ~base_primary_index() = default;
 
-         /** called just before obj is modified */
-         void save_undo( const object& obj );
+         /** called just before obj is modified
+          *  @return whether undo recorded the value obj has now, see undo_database::on_modify() */
+         bool save_undo( const object& obj );
+
+         /** gives obj back the value recorded by save_undo(), if that returned true for this modification */
+         void restore_undo( object& obj );
 
          /** called just after the object is added */
          void on_add( const object& obj );
@@ -305,8 +365,11 @@ namespace graphene { namespace db {
          { return object_type::type_id; }
 
          object_id_type get_next_id()const override              { return _next_id;    }
-         void           use_next_id()override                    { ++_next_id.number;  }
-         void           set_next_id( object_id_type id )override { _next_id = id;      }
+         void           use_next_id()override                    { ++_next_id.number; _dirty = true; }
+         void           set_next_id( object_id_type id )override { _next_id = id; _dirty = true; }
+
+         bool is_dirty()const override { return _dirty;  }
+         void clear_dirty()override    { _dirty = false; }
 
          /** @return the object with id or nullptr if not found */
          const object*  find( object_id_type id )const override
@@ -316,7 +379,7 @@ namespace graphene { namespace db {
             return DerivedIndex::find( id );
          }
 
-         fc::sha256 get_object_version()const
+         fc::sha256 get_object_version()const override
          {
             std::string desc = "1.0";
             return fc::sha256::hash(desc);
@@ -324,37 +387,115 @@ namespace graphene { namespace db {
 
          void open( const fc::path& db )override
          {
-            if( !fc::exists( db ) ) return;
-            fc::file_mapping fm( db.generic_string().c_str(), fc::read_only );
-            fc::mapped_region mr( fm, fc::read_only, 0, fc::file_size(db) );
+            std::vector< std::unique_ptr<index_shard> > shards;
+            for( const auto& file : index_file_header::saved_shards( db ) )
+               shards.emplace_back( read_shard( file ) );
+            load_shards( shards );
+         }
+
+         std::unique_ptr<index_shard> read_shard( const fc::path& file )const override
+         {
+            auto result = std::make_unique<shard>();
+            fc::file_mapping fm( file.generic_string().c_str(), fc::read_only );
+            fc::mapped_region mr( fm, fc::read_only, 0, fc::file_size(file) );
             fc::datastream<const char*> ds( (const char*)mr.get_address(), mr.get_size() );
-            fc::sha256 open_ver;
 
-            fc::raw::unpack(ds, _next_id);
-            fc::raw::unpack(ds, open_ver);
-            FC_ASSERT( open_ver == get_object_version(),
+            index_file_header header;
+            if( !index_file_header::read( ds, header ) )
+            {
+               // the format before the header, every object packed into a vector of its own
+               fc::sha256 open_ver;
+               fc::raw::unpack(ds, result->next_id);
+               fc::raw::unpack(ds, open_ver);
+               FC_ASSERT( open_ver == get_object_version(),
+                          "Incompatible Version, the serialization of objects in this index has changed" );
+               std::vector<char> tmp;
+               while( ds.remaining() > 0 )
+               {
+                  fc::raw::unpack( ds, tmp );
+                  result->objects.emplace_back( fc::raw::unpack<object_type>( tmp ) );
+               }
+               result->legacy = true;
+               return result;
+            }
+
+            FC_ASSERT( header.object_version == get_object_version(),
                        "Incompatible Version, the serialization of objects in this index has changed" );
-            std::vector<char> tmp;
-            while( ds.remaining() > 0 )
+            result->next_id = header.next_id;
+            result->objects.resize( header.object_count );
+            for( auto& obj : result->objects )
+            {
+               uint32_t size;
+               fc::raw::unpack( ds, size );
+               FC_ASSERT( ds.remaining() >= size, "Truncated object database file ${f}", ("f", file) );
+               fc::datastream<const char*> record( ds.pos(), size );
+               fc::raw::unpack( record, obj );
+               ds.skip( size );
+            }
+            return result;
+         }
+
+         void load_shards( std::vector< std::unique_ptr<index_shard> >& shards )override
+         {
+            bool legacy = false;
+            for( auto& item : shards )
             {
-               fc::raw::unpack( ds, tmp );
-               load( tmp );
+               auto& loaded = static_cast<shard&>( *item );
+               _next_id = loaded.next_id;
+               for( auto& obj : loaded.objects )
+               {
+                  const auto& result = DerivedIndex::insert( std::move( obj ) );
+                  for( const auto& sindex : _sindex )
+                     sindex->object_inserted( result );
+               }
+               loaded.objects.clear();
+               loaded.objects.shrink_to_fit();
+               legacy = legacy || loaded.legacy;
             }
+            // files in the old format are rewritten by the next flush, even an incremental one
+            _dirty = shards.empty() || legacy;
          }
 
          void save( const fc::path& db ) override
          {
-            std::ofstream out( db.generic_string(),
-                               std::ofstream::binary | std::ofstream::out | std::ofstream::trunc );
-            FC_ASSERT( out );
-            auto ver  = get_object_version();
-            fc::raw::pack( out, _next_id );
-            fc::raw::pack( out, ver );
-            this->inspect_all_objects( [&out]( const object& o ) {
-                auto vec = fc::raw::pack( static_cast<const object_type&>(o) );
-                auto packed_vec = fc::raw::pack( vec );
-                out.write( packed_vec.data(), packed_vec.size() );
+            const uint64_t per_shard = index_file_header::objects_per_shard;
+            uint64_t count = 0;
+            this->inspect_all_objects( [&count]( const object& ) { ++count; } );
+
+            index_file_header header;
+            header.object_version = get_object_version();
+            header.next_id = _next_id;
+            header.shard_count = std::max<uint64_t>( 1, ( count + per_shard - 1 ) / per_shard );
+
+            std::ofstream out;
+            uint64_t written = 0;
+            auto start_shard = [&]() {
+               if( out.is_open() )
+                  out.close();
+               header.shard = written / per_shard;
+               header.object_count = std::min( per_shard, count - written );
+               out.open( index_file_header::shard_path( db, header.shard ).generic_string(),
+                         std::ofstream::binary | std::ofstream::out | std::ofstream::trunc );
+               FC_ASSERT( out );
+               header.write( out );
+            };
+
+            start_shard();
+            std::vector<char> buffer;
+            this->inspect_all_objects( [&]( const object& o ) {
+               if( written > 0 && written % per_shard == 0 )
+                  start_shard();
+               const auto& obj = static_cast<const object_type&>(o);
+               const uint32_t size = fc::raw::pack_size( obj );
+               buffer.resize( size );
+               fc::datastream<char*> ds( buffer.data(), size );
+               fc::raw::pack( ds, obj );
+               fc::raw::pack( out, size );
+               out.write( buffer.data(), size );
+               ++written;
             });
+            out.close();
+            FC_ASSERT( out, "Unable to save ${db}", ("db", db) );
          }
 
          const object&  load( const std::vector<char>& data )override
@@ -368,6 +509,7 @@ namespace graphene { namespace db {
 
          const object&  create(const std::function<void(object&)>& constructor )override
          {
+            _dirty = true;
             const auto& result = DerivedIndex::create( constructor );
             for( const auto& item : _sindex )
                item->object_inserted( result );
@@ -377,6 +519,7 @@ namespace graphene { namespace db {
 
          const object& insert( object&& obj ) override
          {
+            _dirty = true;
             const auto& result = DerivedIndex::insert( std::move( obj ) );
             for( const auto& item : _sindex )
                item->object_inserted( result );
@@ -386,6 +529,7 @@ namespace graphene { namespace db {
 
          void  remove( const object& obj ) override
          {
+            _dirty = true;
             for( const auto& item : _sindex )
                item->object_removed( obj );
             on_remove(obj);
@@ -394,10 +538,33 @@ namespace graphene { namespace db {
 
          void modify( const object& obj, const std::function<void(object&)>& m )override
          {
-            save_undo( obj );
+            _dirty = true;
+            const object_id_type id = obj.id;
+            const bool recorded = save_undo( obj );
             for( const auto& item : _sindex )
                item->about_to_modify( obj );
-            DerivedIndex::modify( obj, m );
+            try {
+               // an object violating a constraint gets its value from before back from undo and stays in place
+               DerivedIndex::modify( obj, m, [this,recorded]( object& o ) {
+                  if( recorded )
+                     restore_undo( o );
+               });
+            } catch( ... ) {
+               // the direct index still points to an erased object, only the derived index knows
+               if( DerivedIndex::find( id ) != &obj )
+               {
+                  // Undo did not have the value from before, e.g. because the object was modified earlier in the
+                  // same undo state. The secondary indexes and undo can't be fixed without it, and guessing would
+                  // leave them pointing to the erased object.
+                  elog( "Modifying ${id} violated an index constraint and erased it, its previous value is unknown",
+                        ("id",id) );
+                  std::terminate();
+               }
+               // a failed modification may still have changed some fields, the secondary indexes see them
+               for( const auto& item : _sindex )
+                  item->object_modified( obj );
+               throw;
+            }
             for( const auto& item : _sindex )
                item->object_modified( obj );
             on_modify( obj );
@@ -427,8 +594,15 @@ namespace graphene { namespace db {
          }
 
       private:
+         struct shard : public index_shard
+         {
+            std::vector<object_type> objects;
+            bool                     legacy = false;
+         };
+
          object_id_type                                 _next_id;
          const direct_index< object_type, DirectBits >* _direct_by_id = nullptr;
+         bool                                           _dirty = true;
    };
 
 } } // graphene::db
@@ -4,6 +4,8 @@
 #include <fc/io/raw.hpp>
 #include <fc/crypto/city.hpp>
 
+#include <new>
+
 #define MAX_NESTING (200)
 
 namespace graphene { namespace db {
@@ -48,10 +50,26 @@ namespace graphene { namespace db {
          /// these methods are implemented for derived classes by inheriting base_abstract_object<DerivedClass>
          /// @{
          virtual std::unique_ptr<object> clone()const = 0;
+         /// copy-constructs this object into storage of at least storage_size() bytes, used by undo_arena
+         virtual object*                 clone_into( void* storage )const = 0;
+         virtual std::size_t             storage_size()const = 0;
          virtual void                    move_from( object& obj ) = 0;
          virtual fc::variant             to_variant()const  = 0;
          virtual std::vector<char>       pack()const = 0;
          /// @}
+
+         /// Object types that return true here are tracked in the undo history by the before-values of the
+         /// reflected fields that changed instead of by full copies. Such types override pack_fields() and
+         /// unpack_field(), usually via GRAPHENE_IMPLEMENT_DELTA_UNDO (see undo_delta.hpp).
+         /// @{
+         virtual bool undo_by_delta()const { return false; }
+         /// appends every reflected field, packed, to out and records where each one ends in field_ends
+         virtual void pack_fields( std::vector<char>& out, std::vector<uint32_t>& field_ends )const
+         { FC_THROW( "Field-level access is not implemented for object ${id}", ("id",id) ); }
+         /// replaces the reflected field with the given index with the value unpacked from ds
+         virtual void unpack_field( uint32_t field, fc::datastream<const char*>& ds )
+         { FC_THROW( "Field-level access is not implemented for object ${id}", ("id",id) ); }
+         /// @}
    };
 
    /**
@@ -70,6 +88,11 @@ namespace graphene { namespace db {
          {
             return std::make_unique<DerivedClass>( *static_cast<const DerivedClass*>(this) );
          }
+         object* clone_into( void* storage )const override
+         {
+            return new (storage) DerivedClass( *static_cast<const DerivedClass*>(this) );
+         }
+         std::size_t storage_size()const override { return sizeof(DerivedClass); }
 
          void    move_from( object& obj ) override
          {
@@ -31,8 +31,12 @@ namespace graphene { namespace db {
 
          /**
           * Saves the complete state of the object_database to disk, this could take a while
+          *
+          * In incremental mode the files of indexes that did not change since the last flush or open are kept
+          * instead of being written again.
           */
          void flush();
+         void set_incremental_flush( bool incremental ) { _incremental_flush = incremental; }
          void wipe(const fc::path& data_dir); // remove from disk
          void close();
 
@@ -60,6 +64,8 @@ namespace graphene { namespace db {
          const index&  get_index()const { return get_index(T::space_id,T::type_id); }
          const index&  get_index(uint8_t space_id, uint8_t type_id)const;
          const index&  get_index(const object_id_type& id)const { return get_index(id.space(),id.type()); }
+         /// Calls inspector for every index that was added, in the order of their space and type IDs
+         void          inspect_indexes( const std::function<void(const index&)>& inspector )const;
          /// @}
 
          const object& get_object( const object_id_type& id )const;
@@ -161,12 +167,14 @@ namespace graphene { namespace db {
 
          friend class base_primary_index;
          friend class undo_database;
-         void save_undo( const object& obj );
+         bool save_undo( const object& obj );
+         void restore_undo( object& obj );
          void save_undo_add( const object& obj );
          void save_undo_remove( const object& obj );
 
          fc::path                                                  _data_dir;
          std::vector< std::vector< std::unique_ptr<index> > >      _index;
+         bool                                                      _incremental_flush = false;
    };
 
 } } // graphene::db
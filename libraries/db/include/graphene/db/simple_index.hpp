@@ -36,6 +36,13 @@ namespace graphene { namespace db {
             modify_callback( *_objects[obj.id.instance()] );
          }
 
+         /** there are no constraints to violate, the same as modify() */
+         void modify( const object& obj, const std::function<void(object&)>& modify_callback,
+                      const std::function<void(object&)>& rollback )
+         {
+            modify( obj, modify_callback );
+         }
+
          virtual const object& insert( object&& obj )override
          {
             auto instance = obj.id.instance();
@@ -0,0 +1,306 @@
+#pragma once
+#include <graphene/db/object.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace graphene { namespace db {
+
+   /**
+    * @class undo_chunk_pool
+    * @brief recycles the memory chunks used by undo_arena
+    *
+    * Undo states are created and released for every pending transaction and every block. Keeping the
+    * released chunks around means that in steady state no undo session has to go back to the heap for
+    * the storage of its before-images.
+    */
+   class undo_chunk_pool
+   {
+      public:
+         static constexpr std::size_t chunk_size = 64 * 1024;
+         static constexpr std::size_t max_free_chunks = 256;
+
+         /** @return a chunk of at least size bytes, recycled if possible */
+         std::unique_ptr<char[]> acquire( std::size_t size );
+         /** hands a chunk back, oversized chunks and chunks beyond max_free_chunks are freed */
+         void                    release( std::unique_ptr<char[]> chunk, std::size_t size );
+
+         /** number of chunks that were taken from the heap since construction */
+         uint64_t heap_allocations()const { return _heap_allocations; }
+         std::size_t free_chunks()const { return _free.size(); }
+
+      private:
+         std::vector< std::unique_ptr<char[]> > _free;
+         uint64_t                               _heap_allocations = 0;
+   };
+
+   /**
+    * @class undo_arena
+    * @brief bump allocator holding the before-images of one undo state
+    *
+    * Objects are copy-constructed in place via object::clone_into() and linked through a small header so
+    * that they can be destroyed without any bookkeeping allocation. Releasing the arena destroys the
+    * objects and rewinds all chunks back into the pool in one go.
+    */
+   class undo_arena
+   {
+      public:
+         explicit undo_arena( undo_chunk_pool* pool = nullptr ):_pool(pool){}
+         undo_arena( undo_arena&& other ) noexcept;
+         undo_arena& operator = ( undo_arena&& other ) noexcept;
+         undo_arena( const undo_arena& ) = delete;
+         undo_arena& operator = ( const undo_arena& ) = delete;
+         ~undo_arena();
+
+         /** copy-constructs obj inside the arena, the copy lives until release() */
+         object* clone( const object& obj );
+
+         /** raw storage that lives until release(), nothing constructed in it is ever destroyed */
+         void*   allocate( std::size_t size );
+
+         /** takes ownership of all objects and chunks of other, leaving it empty */
+         void splice( undo_arena& other );
+
+         /** destroys all objects and returns the chunks to the pool */
+         void release();
+
+         std::size_t object_count()const { return _object_count; }
+         std::size_t chunk_count()const { return _chunks.size(); }
+
+      private:
+         struct header
+         {
+            header* next;
+            object* obj;
+         };
+
+         struct chunk
+         {
+            std::unique_ptr<char[]> data;
+            std::size_t             capacity = 0;
+            std::size_t             used = 0;
+         };
+
+         undo_chunk_pool*   _pool = nullptr;
+         std::vector<chunk> _chunks;
+         header*            _head = nullptr;
+         header*            _tail = nullptr;
+         std::size_t        _object_count = 0;
+   };
+
+   /**
+    * @class undo_id_map
+    * @brief compact open-addressing hash map keyed by object id
+    *
+    * Uses linear probing over a single power-of-two sized slot array and backward-shift deletion, so
+    * neither inserts nor erases allocate per entry. Iteration order is unspecified. The slot arrays come from
+    * Allocator, only growing the map allocates.
+    */
+   template<typename Value, typename Allocator = std::allocator< std::pair<object_id_type, Value> > >
+   class undo_id_map
+   {
+      public:
+         using value_type = std::pair<object_id_type, Value>;
+
+         explicit undo_id_map( const Allocator& alloc = Allocator() ):_slots(alloc),_used(alloc){}
+
+         template<typename Map, typename Entry>
+         class basic_iterator
+         {
+            public:
+               basic_iterator( Map* map, std::size_t pos ):_map(map),_pos(pos) { skip_empty(); }
+
+               Entry& operator*()const  { return _map->_slots[_pos]; }
+               Entry* operator->()const { return &_map->_slots[_pos]; }
+               basic_iterator& operator++() { ++_pos; skip_empty(); return *this; }
+               bool operator == ( const basic_iterator& other )const { return _pos == other._pos; }
+               bool operator != ( const basic_iterator& other )const { return _pos != other._pos; }
+
+            private:
+               void skip_empty()
+               {
+                  while( _pos < _map->_used.size() && !_map->_used[_pos] )
+                     ++_pos;
+               }
+
+               Map*        _map;
+               std::size_t _pos;
+         };
+
+         using iterator       = basic_iterator< undo_id_map, value_type >;
+         using const_iterator = basic_iterator< const undo_id_map, const value_type >;
+
+         iterator       begin()       { return iterator( this, 0 ); }
+         iterator       end()         { return iterator( this, _slots.size() ); }
+         const_iterator begin()const  { return const_iterator( this, 0 ); }
+         const_iterator end()const    { return const_iterator( this, _slots.size() ); }
+
+         std::size_t size()const  { return _size; }
+         bool        empty()const { return _size == 0; }
+
+         iterator find( object_id_type id )
+         {
+            return iterator( this, locate( id ) );
+         }
+         const_iterator find( object_id_type id )const
+         {
+            return const_iterator( this, locate( id ) );
+         }
+         std::size_t count( object_id_type id )const { return locate( id ) != _slots.size() ? 1 : 0; }
+
+         Value& operator[]( object_id_type id )
+         {
+            return emplace( id, Value() ).first->second;
+         }
+
+         /** inserts (id,value) unless id is already present, like std::unordered_map::emplace */
+         std::pair<iterator,bool> emplace( object_id_type id, Value value )
+         {
+            if( (_size + 1) * 4 > _slots.size() * 3 )
+               rehash( _slots.empty() ? 16 : _slots.size() * 2 );
+            std::size_t pos = home_of( id );
+            while( _used[pos] )
+            {
+               if( _slots[pos].first == id )
+                  return std::make_pair( iterator( this, pos ), false );
+               pos = ( pos + 1 ) & ( _slots.size() - 1 );
+            }
+            _used[pos] = true;
+            _slots[pos] = value_type( id, std::move(value) );
+            ++_size;
+            return std::make_pair( iterator( this, pos ), true );
+         }
+
+         std::size_t erase( object_id_type id )
+         {
+            std::size_t pos = locate( id );
+            if( pos == _slots.size() )
+               return 0;
+            erase_at( pos );
+            return 1;
+         }
+
+         void clear()
+         {
+            _slots.clear();
+            _used.clear();
+            _size = 0;
+            _shift = 64;
+         }
+
+      private:
+         std::size_t home_of( object_id_type id )const
+         {
+            // Fibonacci hashing, ids are sequential so the multiplication spreads neighbours apart
+            return std::size_t( ( id.number * 0x9E3779B97F4A7C15ULL ) >> _shift );
+         }
+
+         /** @return the slot holding id, or _slots.size() if not found */
+         std::size_t locate( object_id_type id )const
+         {
+            if( _size == 0 )
+               return _slots.size();
+            std::size_t pos = home_of( id );
+            while( _used[pos] )
+            {
+               if( _slots[pos].first == id )
+                  return pos;
+               pos = ( pos + 1 ) & ( _slots.size() - 1 );
+            }
+            return _slots.size();
+         }
+
+         void erase_at( std::size_t hole )
+         {
+            const std::size_t mask = _slots.size() - 1;
+            std::size_t next = ( hole + 1 ) & mask;
+            while( _used[next] )
+            {
+               // move the entry back into the hole unless that would place it before its home slot
+               const std::size_t home = home_of( _slots[next].first );
+               if( ( ( next - home ) & mask ) >= ( ( next - hole ) & mask ) )
+               {
+                  _slots[hole] = std::move( _slots[next] );
+                  hole = next;
+               }
+               next = ( next + 1 ) & mask;
+            }
+            _used[hole] = false;
+            _slots[hole] = value_type();
+            --_size;
+         }
+
+         void rehash( std::size_t capacity )
+         {
+            slot_vector old_slots( capacity, value_type(), _slots.get_allocator() );
+            used_vector old_used( capacity, false, _used.get_allocator() );
+            old_slots.swap( _slots );
+            old_used.swap( _used );
+            _shift = 64;
+            for( std::size_t c = capacity; c > 1; c >>= 1 )
+               --_shift;
+            _size = 0;
+            for( std::size_t i = 0; i < old_slots.size(); ++i )
+            {
+               if( !old_used[i] )
+                  continue;
+               std::size_t pos = home_of( old_slots[i].first );
+               while( _used[pos] )
+                  pos = ( pos + 1 ) & ( capacity - 1 );
+               _used[pos] = true;
+               _slots[pos] = std::move( old_slots[i] );
+               ++_size;
+            }
+         }
+
+         using slot_vector = std::vector< value_type,
+                                          typename std::allocator_traits<Allocator>::template rebind_alloc<value_type> >;
+         using used_vector = std::vector< bool, typename std::allocator_traits<Allocator>::template rebind_alloc<bool> >;
+
+         slot_vector _slots;
+         used_vector _used;
+         std::size_t _size = 0;
+         unsigned    _shift = 64;
+   };
+
+   /**
+    * @class undo_id_set
+    * @brief set of object ids on top of undo_id_map
+    */
+   class undo_id_set
+   {
+      public:
+         class const_iterator
+         {
+            public:
+               explicit const_iterator( undo_id_map<bool>::const_iterator itr ):_itr(itr){}
+
+               const object_id_type& operator*()const  { return _itr->first; }
+               const object_id_type* operator->()const { return &_itr->first; }
+               const_iterator& operator++() { ++_itr; return *this; }
+               bool operator == ( const const_iterator& other )const { return _itr == other._itr; }
+               bool operator != ( const const_iterator& other )const { return _itr != other._itr; }
+
+            private:
+               undo_id_map<bool>::const_iterator _itr;
+         };
+
+         const_iterator begin()const { return const_iterator( _map.begin() ); }
+         const_iterator end()const   { return const_iterator( _map.end() ); }
+         const_iterator find( object_id_type id )const { return const_iterator( _map.find( id ) ); }
+
+         std::size_t size()const  { return _map.size(); }
+         bool        empty()const { return _map.empty(); }
+         std::size_t count( object_id_type id )const { return _map.count( id ); }
+
+         bool        insert( object_id_type id ) { return _map.emplace( id, true ).second; }
+         std::size_t erase( object_id_type id )  { return _map.erase( id ); }
+         void        clear()                     { _map.clear(); }
+
+      private:
+         undo_id_map<bool> _map;
+   };
+
+} } // graphene::db
@@ -1,5 +1,6 @@
 #pragma once
 #include <graphene/db/object.hpp>
+#include <graphene/db/undo_arena.hpp>
 #include <deque>
 #include <fc/exception/exception.hpp>
 
@@ -7,12 +8,66 @@ namespace graphene { namespace db {
 
    class object_database;
 
+   /** the reflected fields of an object, packed one after another */
+   struct packed_fields
+   {
+      std::vector<char>     data;
+      std::vector<uint32_t> field_ends;
+
+      void pack( const object& obj );
+      void unpack_to( object& obj )const;
+   };
+
+   /**
+    * @class undo_delta
+    * @brief before-values of the reflected fields of one object that changed during an undo session
+    *
+    * Used instead of a full copy for object types that return true from object::undo_by_delta(). Only the
+    * first before-value of each field is kept. All storage lives in the arena of the owning undo_state.
+    *
+    * The fields are packed once, on the first modification in the undo state, into first_values. They are
+    * compared with the current ones only when the state is committed or merged, and the ones that changed are
+    * then recorded, so further modifications in the same state cost nothing.
+    */
+   struct undo_delta
+   {
+      struct field
+      {
+         field*      next;
+         uint32_t    index;
+         uint32_t    size;
+         const char* data()const { return reinterpret_cast<const char*>( this + 1 ); }
+      };
+
+      bool has_field( uint32_t index )const;
+      void add_field( undo_arena& arena, uint32_t index, const char* data, uint32_t size );
+      /** moves the fields of other which are not recorded here yet into this delta */
+      void merge( undo_delta& other );
+      /** writes the recorded before-values back into obj */
+      void apply_to( object& obj )const;
+
+      field*               first = nullptr;
+      std::size_t          field_count = 0;
+      /// all fields from before the first modification, until they are compared with the current ones
+      packed_fields* first_values = nullptr;
+   };
+
+   /**
+    * The before-images referenced by old_values and removed, and the deltas in old_deltas, are owned by
+    * arena, they stay valid until the state is popped from the undo stack. first_values holds the fields the
+    * deltas were not compared with yet.
+    */
    struct undo_state
    {
-      std::unordered_map<object_id_type, std::unique_ptr<object> > old_values;
-      std::unordered_map<object_id_type, object_id_type>           old_index_next_ids;
-      std::unordered_set<object_id_type>                           new_ids;
-      std::unordered_map<object_id_type, std::unique_ptr<object> > removed;
+      explicit undo_state( undo_chunk_pool* pool = nullptr ):arena(pool){}
+
+      undo_id_map<object*>         old_values;
+      undo_id_map<undo_delta*>     old_deltas;
+      undo_id_map<object_id_type>  old_index_next_ids;
+      undo_id_set                  new_ids;
+      undo_id_map<object*>         removed;
+      undo_arena                   arena;
+      std::deque<packed_fields>    first_values;
    };
 
 
@@ -74,8 +129,15 @@ namespace graphene { namespace db {
           * If it's a new object as of this undo state, its pre-modification value is not stored, because prior to this
           * undo state, it did not exist. Any modifications in this undo state are irrelevant, as the object will simply
           * be removed if we undo.
+          *
+          * @return whether the value of obj was recorded now, i.e. this is its first modification in the undo state
           */
-         void on_modify( const object& obj );
+         bool on_modify( const object& obj );
+         /**
+          * Gives obj back the value recorded by the last on_modify() that returned true for it, used when the
+          * modification violated an index constraint
+          */
+         void restore( object& obj )const;
          /**
           * This should be called just before an object is removed.
           *
@@ -101,16 +163,31 @@ namespace graphene { namespace db {
 
          const undo_state& head()const;
 
+         const undo_chunk_pool& chunk_pool()const { return _chunk_pool; }
+
       private:
          void undo();
          void merge();
          void commit();
 
+         /// packs the fields of obj into the first_values of state, reusing the buffers of released ones
+         packed_fields* pack_first_values( undo_state& state, const object& obj );
+         /// records the fields of the object that changed since delta's first_values were packed
+         void compare_first_values( undo_state& state, object_id_type id, undo_delta& delta );
+         /// compares the first_values of all deltas of the state, then releases them
+         void compare_first_values( undo_state& state );
+         void release_first_values( undo_state& state );
+
          uint32_t                _active_sessions = 0;
          bool                    _disabled = true;
+         undo_chunk_pool         _chunk_pool;
          std::deque<undo_state>  _stack;
          object_database&        _db;
          size_t                  _max_size = 256;
+
+         /// released first_values, their buffers are reused
+         std::vector<packed_fields>  _free_first_values;
+         packed_fields               _current_fields;
    };
 
 } } // graphene::db
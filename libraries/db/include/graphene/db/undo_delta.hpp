@@ -0,0 +1,71 @@
+#pragma once
+#include <graphene/db/object.hpp>
+
+#include <fc/io/raw.hpp>
+#include <fc/reflect/reflect.hpp>
+
+namespace graphene { namespace db { namespace detail {
+
+   template<typename T>
+   struct pack_fields_visitor
+   {
+      pack_fields_visitor( const T& v, std::vector<char>& o, std::vector<uint32_t>& e )
+      :value(v),out(o),field_ends(e){}
+
+      template<typename Member, class Class, Member (Class::*member)>
+      void operator()( const char* name )const
+      {
+         const auto start = out.size();
+         out.resize( start + fc::raw::pack_size( value.*member ) );
+         fc::datastream<char*> ds( out.data() + start, out.size() - start );
+         fc::raw::pack( ds, value.*member );
+         field_ends.push_back( static_cast<uint32_t>( out.size() ) );
+      }
+
+      const T&               value;
+      std::vector<char>&     out;
+      std::vector<uint32_t>& field_ends;
+   };
+
+   template<typename T>
+   struct unpack_field_visitor
+   {
+      unpack_field_visitor( T& v, uint32_t f, fc::datastream<const char*>& s ):value(v),field(f),ds(s){}
+
+      template<typename Member, class Class, Member (Class::*member)>
+      void operator()( const char* name )const
+      {
+         if( which++ != field )
+            return;
+         // unpack into a fresh value, some containers are not cleared by fc::raw::unpack
+         Member tmp;
+         fc::raw::unpack( ds, tmp );
+         value.*member = std::move( tmp );
+         found = true;
+      }
+
+      T&                           value;
+      const uint32_t               field;
+      fc::datastream<const char*>& ds;
+      mutable uint32_t             which = 0;
+      mutable bool                 found = false;
+   };
+
+} } } // graphene::db::detail
+
+/**
+ * Implements object::pack_fields() and object::unpack_field() for an object type that opted into delta undo by
+ * overriding undo_by_delta(). Must be used at global scope where FC_REFLECT for the type is visible.
+ */
+#define GRAPHENE_IMPLEMENT_DELTA_UNDO( type )                                                                  \
+void type::pack_fields( std::vector<char>& out, std::vector<uint32_t>& field_ends )const                       \
+{                                                                                                              \
+   graphene::db::detail::pack_fields_visitor<type> vtor( *this, out, field_ends );                             \
+   fc::reflector<type>::visit( vtor );                                                                         \
+}                                                                                                              \
+void type::unpack_field( uint32_t field, fc::datastream<const char*>& ds )                                     \
+{                                                                                                              \
+   graphene::db::detail::unpack_field_visitor<type> vtor( *this, field, ds );                                  \
+   fc::reflector<type>::visit( vtor );                                                                         \
+   FC_ASSERT( vtor.found, "Invalid field index ${f}", ("f",field) );                                           \
+}
@@ -2,9 +2,75 @@
 #include <graphene/db/index.hpp>
 #include <graphene/db/object_database.hpp>
 
+#include <cstring>
+
 namespace graphene { namespace db {
-   void base_primary_index::save_undo( const object& obj )
-   { _db.save_undo( obj ); }
+   namespace {
+      /// the last byte would be space 255 at the start of a file in the old format, which does not exist
+      const char index_file_magic[8] = { 'G', 'R', 'P', 'H', 'O', 'B', 'J', '\xff' };
+      /// upper bound of the packed size of index_file_header
+      const size_t max_header_size = 128;
+   }
+
+   bool index_file_header::read( fc::datastream<const char*>& ds, index_file_header& header )
+   {
+      if( ds.remaining() < sizeof(index_file_magic)
+            || std::memcmp( ds.pos(), index_file_magic, sizeof(index_file_magic) ) != 0 )
+         return false;
+      ds.skip( sizeof(index_file_magic) );
+      fc::raw::unpack( ds, header.format );
+      FC_ASSERT( header.format == current_format, "Unsupported object database format ${f}", ("f", header.format) );
+      fc::raw::unpack( ds, header.object_version );
+      fc::raw::unpack( ds, header.next_id );
+      fc::raw::unpack( ds, header.shard );
+      fc::raw::unpack( ds, header.shard_count );
+      fc::raw::unpack( ds, header.object_count );
+      return true;
+   }
+
+   void index_file_header::write( std::ostream& out )const
+   {
+      out.write( index_file_magic, sizeof(index_file_magic) );
+      fc::raw::pack( out, format );
+      fc::raw::pack( out, object_version );
+      fc::raw::pack( out, next_id );
+      fc::raw::pack( out, shard );
+      fc::raw::pack( out, shard_count );
+      fc::raw::pack( out, object_count );
+   }
+
+   fc::path index_file_header::shard_path( const fc::path& db, uint32_t shard )
+   {
+      if( shard == 0 )
+         return db;
+      return db.parent_path() / ( db.filename().generic_string() + "." + fc::to_string( shard ) );
+   }
+
+   std::vector<fc::path> index_file_header::saved_shards( const fc::path& db )
+   {
+      std::vector<fc::path> result;
+      if( !fc::exists( db ) )
+         return result;
+      result.push_back( db );
+
+      std::vector<char> buffer( max_header_size );
+      std::ifstream in( db.generic_string(), std::ifstream::binary );
+      in.read( buffer.data(), buffer.size() );
+      buffer.resize( in.gcount() );
+      fc::datastream<const char*> ds( buffer.data(), buffer.size() );
+      index_file_header header;
+      if( read( ds, header ) )
+      {
+         for( uint32_t shard = 1; shard < header.shard_count; ++shard )
+            result.push_back( shard_path( db, shard ) );
+      }
+      return result;
+   }
+   bool base_primary_index::save_undo( const object& obj )
+   { return _db.save_undo( obj ); }
+
+   void base_primary_index::restore_undo( object& obj )
+   { _db.restore_undo( obj ); }
 
    void base_primary_index::on_add( const object& obj )
    {
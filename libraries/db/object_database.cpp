@@ -55,6 +55,14 @@ index& object_database::get_mutable_index(uint8_t space_id, uint8_t type_id)
    return *idx;
 }
 
+void object_database::inspect_indexes( const std::function<void(const index&)>& inspector )const
+{
+   for( const auto& space : _index )
+      for( const auto& idx : space )
+         if( idx )
+            inspector( *idx );
+}
+
 void object_database::flush()
 {
    const auto tmp_dir = _data_dir / "object_database.tmp";
@@ -68,11 +76,36 @@ void object_database::flush()
    constexpr size_t max_tasks = 200;
    tasks.reserve(max_tasks);
 
-   auto push_task = [this,&tasks,&tmp_dir]( size_t space, size_t type ) {
-      if( _index[space][type] )
-         tasks.push_back( fc::do_parallel( [this,space,type,&tmp_dir] () {
-            _index[space][type]->save( tmp_dir / fc::to_string(space) / fc::to_string(type) );
-         } ) );
+   size_t reused = 0;
+   auto push_task = [this,&tasks,&tmp_dir,&target_dir,&reused]( size_t space, size_t type ) {
+      if( !_index[space][type] )
+         return;
+      const auto sub_path = fc::path( fc::to_string(space) ) / fc::to_string(type);
+      if( _incremental_flush && !_index[space][type]->is_dirty() )
+      {
+         // the files of the last flush or open still hold exactly this content, the new directory shares them
+         const auto files = index_file_header::saved_shards( target_dir / sub_path );
+         if( !files.empty() )
+         {
+            for( const auto& file : files )
+            {
+               const auto destination = tmp_dir / fc::to_string(space) / file.filename();
+               try
+               {
+                  fc::create_hard_link( file, destination );
+               }
+               catch( const fc::exception& )
+               {
+                  fc::copy( file, destination );
+               }
+            }
+            ++reused;
+            return;
+         }
+      }
+      tasks.push_back( fc::do_parallel( [this,space,type,&tmp_dir,sub_path] () {
+         _index[space][type]->save( tmp_dir / sub_path );
+      } ) );
    };
 
    const auto spaces = _index.size();
@@ -94,6 +127,13 @@ void object_database::flush()
    }
    fc::rename( tmp_dir, target_dir );
    fc::remove_all( old_dir );
+
+   for( const auto& space : _index )
+      for( const auto& idx : space )
+         if( idx )
+            idx->clear_dirty();
+   if( _incremental_flush )
+      ilog( "Saved ${n} changed indexes, kept ${r} unchanged ones", ("n", tasks.size())("r", reused) );
 }
 
 void object_database::wipe(const fc::path& data_dir)
@@ -112,24 +152,46 @@ void object_database::open(const fc::path& data_dir)
        wlog("Ignoring locked object_database");
        return;
    }
-   std::vector<fc::future<void>> tasks;
-   tasks.reserve(200);
-
-   auto push_task = [this,&tasks]( size_t space, size_t type ) {
-      if( _index[space][type] )
-         tasks.push_back( fc::do_parallel( [this,space,type] () {
-            _index[space][type]->open( _data_dir / "object_database" / fc::to_string(space) / fc::to_string(type) );
-         } ) );
+   // all files are decoded in parallel first, large indexes are split over several files
+   struct pending_index
+   {
+      index*                                      idx;
+      std::vector<fc::path>                       files;
+      std::vector< std::unique_ptr<index_shard> > shards;
    };
-
-   ilog("Opening object database from ${d} ...", ("d", data_dir));
+   std::vector<pending_index> pending;
    const auto spaces = _index.size();
    for( size_t space = 0; space < spaces; ++space )
    {
       const auto types = _index[space].size();
       for( size_t type = 0; type  < types; ++type )
-         push_task( space, type );
+      {
+         if( !_index[space][type] )
+            continue;
+         pending.push_back( { _index[space][type].get(),
+                              index_file_header::saved_shards( _data_dir / "object_database" / fc::to_string(space)
+                                                                                              / fc::to_string(type) ),
+                              {} } );
+         pending.back().shards.resize( pending.back().files.size() );
+      }
    }
+
+   ilog("Opening object database from ${d} ...", ("d", data_dir));
+   std::vector<fc::future<void>> tasks;
+   for( auto& item : pending )
+      for( size_t i = 0; i < item.files.size(); ++i )
+         tasks.push_back( fc::do_parallel( [&item,i] () {
+            item.shards[i] = item.idx->read_shard( item.files[i] );
+         } ) );
+   for( auto& task : tasks )
+      task.wait();
+
+   // then the indexes are filled, each one on its own
+   tasks.clear();
+   for( auto& item : pending )
+      tasks.push_back( fc::do_parallel( [&item] () {
+         item.idx->load_shards( item.shards );
+      } ) );
    for( auto& task : tasks )
       task.wait();
    ilog( "Done opening object database." );
@@ -142,9 +204,14 @@ void object_database::pop_undo()
    _undo_db.pop_commit();
 } FC_CAPTURE_AND_RETHROW() } // GCOVR_EXCL_LINE
 
-void object_database::save_undo( const object& obj )
+bool object_database::save_undo( const object& obj )
+{
+   return _undo_db.on_modify( obj );
+}
+
+void object_database::restore_undo( object& obj )
 {
-   _undo_db.on_modify( obj );
+   _undo_db.restore( obj );
 }
 
 void object_database::save_undo_add( const object& obj )
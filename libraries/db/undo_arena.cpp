@@ -0,0 +1,134 @@
+#include <graphene/db/undo_arena.hpp>
+
+#include <algorithm>
+#include <new>
+
+namespace graphene { namespace db {
+
+namespace {
+   constexpr std::size_t align_up( std::size_t size )
+   {
+      return ( size + alignof(std::max_align_t) - 1 ) & ~( alignof(std::max_align_t) - 1 );
+   }
+}
+
+std::unique_ptr<char[]> undo_chunk_pool::acquire( std::size_t size )
+{
+   if( size <= chunk_size && !_free.empty() )
+   {
+      auto result = std::move( _free.back() );
+      _free.pop_back();
+      return result;
+   }
+   ++_heap_allocations;
+   return std::unique_ptr<char[]>( new char[ std::max( size, chunk_size ) ] );
+}
+
+void undo_chunk_pool::release( std::unique_ptr<char[]> chunk, std::size_t size )
+{
+   if( size == chunk_size && _free.size() < max_free_chunks )
+      _free.emplace_back( std::move( chunk ) );
+}
+
+undo_arena::undo_arena( undo_arena&& other ) noexcept
+:_pool(other._pool),_chunks(std::move(other._chunks)),_head(other._head),_tail(other._tail),
+ _object_count(other._object_count)
+{
+   other._chunks.clear();
+   other._head = nullptr;
+   other._tail = nullptr;
+   other._object_count = 0;
+}
+
+undo_arena& undo_arena::operator = ( undo_arena&& other ) noexcept
+{
+   if( this == &other ) return *this;
+   release();
+   _pool = other._pool;
+   _chunks = std::move( other._chunks );
+   _head = other._head;
+   _tail = other._tail;
+   _object_count = other._object_count;
+   other._chunks.clear();
+   other._head = nullptr;
+   other._tail = nullptr;
+   other._object_count = 0;
+   return *this;
+}
+
+undo_arena::~undo_arena()
+{
+   release();
+}
+
+void* undo_arena::allocate( std::size_t size )
+{
+   size = align_up( size );
+   if( _chunks.empty() || _chunks.back().capacity - _chunks.back().used < size )
+   {
+      chunk c;
+      c.capacity = std::max( size, undo_chunk_pool::chunk_size );
+      c.data = _pool != nullptr ? _pool->acquire( c.capacity )
+                                : std::unique_ptr<char[]>( new char[ c.capacity ] );
+      _chunks.emplace_back( std::move( c ) );
+   }
+   auto& current = _chunks.back();
+   void* result = current.data.get() + current.used;
+   current.used += size;
+   return result;
+}
+
+object* undo_arena::clone( const object& obj )
+{
+   const std::size_t header_size = align_up( sizeof(header) );
+   char* storage = static_cast<char*>( allocate( header_size + obj.storage_size() ) );
+   // if the copy constructor throws the space is simply wasted until release()
+   object* result = obj.clone_into( storage + header_size );
+   header* h = new (storage) header{ nullptr, result };
+   if( _tail != nullptr )
+      _tail->next = h;
+   else
+      _head = h;
+   _tail = h;
+   ++_object_count;
+   return result;
+}
+
+void undo_arena::splice( undo_arena& other )
+{
+   if( this == &other || other._chunks.empty() ) return;
+   // keep our current chunk last so that further clones keep bumping into it
+   _chunks.insert( _chunks.empty() ? _chunks.end() : _chunks.end() - 1,
+                   std::make_move_iterator( other._chunks.begin() ),
+                   std::make_move_iterator( other._chunks.end() ) );
+   if( other._head != nullptr )
+   {
+      if( _tail != nullptr )
+         _tail->next = other._head;
+      else
+         _head = other._head;
+      _tail = other._tail;
+   }
+   _object_count += other._object_count;
+   other._chunks.clear();
+   other._head = nullptr;
+   other._tail = nullptr;
+   other._object_count = 0;
+}
+
+void undo_arena::release()
+{
+   for( header* h = _head; h != nullptr; h = h->next )
+      h->obj->~object();
+   _head = nullptr;
+   _tail = nullptr;
+   _object_count = 0;
+   for( auto& c : _chunks )
+   {
+      if( _pool != nullptr )
+         _pool->release( std::move( c.data ), c.capacity );
+   }
+   _chunks.clear();
+}
+
+} } // graphene::db
@@ -2,8 +2,74 @@
 #include <graphene/db/undo_database.hpp>
 #include <fc/reflect/variant.hpp>
 
+#include <cstring>
+
 namespace graphene { namespace db {
 
+void packed_fields::pack( const object& obj )
+{
+   data.clear();
+   field_ends.clear();
+   obj.pack_fields( data, field_ends );
+}
+
+void packed_fields::unpack_to( object& obj )const
+{
+   uint32_t start = 0;
+   for( uint32_t i = 0; i < field_ends.size(); ++i )
+   {
+      fc::datastream<const char*> ds( data.data() + start, field_ends[i] - start );
+      obj.unpack_field( i, ds );
+      start = field_ends[i];
+   }
+}
+
+bool undo_delta::has_field( uint32_t index )const
+{
+   for( const field* f = first; f != nullptr; f = f->next )
+      if( f->index == index )
+         return true;
+   return false;
+}
+
+void undo_delta::add_field( undo_arena& arena, uint32_t index, const char* data, uint32_t size )
+{
+   field* f = new (arena.allocate( sizeof(field) + size )) field{ first, index, size };
+   std::memcpy( reinterpret_cast<char*>( f + 1 ), data, size );
+   first = f;
+   ++field_count;
+}
+
+void undo_delta::merge( undo_delta& other )
+{
+   field* f = other.first;
+   while( f != nullptr )
+   {
+      field* next = f->next;
+      if( !has_field( f->index ) )
+      {
+         f->next = first;
+         first = f;
+         ++field_count;
+      }
+      f = next;
+   }
+   other.first = nullptr;
+   other.field_count = 0;
+}
+
+void undo_delta::apply_to( object& obj )const
+{
+   // the recorded fields are older than first_values
+   if( first_values != nullptr )
+      first_values->unpack_to( obj );
+   for( const field* f = first; f != nullptr; f = f->next )
+   {
+      fc::datastream<const char*> ds( f->data(), f->size );
+      obj.unpack_field( f->index, ds );
+   }
+}
+
 void undo_database::enable()  { _disabled = false; }
 void undo_database::disable() { _disabled = true; }
 
@@ -30,7 +96,7 @@ undo_database::session undo_database::start_undo_session( bool force_enable )
    while( size() > max_size() )
       _stack.pop_front();
 
-   _stack.emplace_back();
+   _stack.emplace_back( &_chunk_pool );
    ++_active_sessions;
    return session(*this, disable_on_exit );
 }
@@ -39,7 +105,7 @@ void undo_database::on_create( const object& obj )
    if( _disabled ) return;
 
    if( _stack.empty() )
-      _stack.emplace_back();
+      _stack.emplace_back( &_chunk_pool );
    auto& state = _stack.back();
    auto index_id = object_id_type( obj.id.space(), obj.id.type(), 0 );
    auto itr = state.old_index_next_ids.find( index_id );
@@ -47,25 +113,100 @@ void undo_database::on_create( const object& obj )
       state.old_index_next_ids[index_id] = obj.id;
    state.new_ids.insert(obj.id);
 }
-void undo_database::on_modify( const object& obj )
+bool undo_database::on_modify( const object& obj )
 {
-   if( _disabled ) return;
+   if( _disabled ) return false;
 
    if( _stack.empty() )
-      _stack.emplace_back();
+      _stack.emplace_back( &_chunk_pool );
    auto& state = _stack.back();
    if( state.new_ids.find(obj.id) != state.new_ids.end() )
-      return;
+      return false;
    auto itr =  state.old_values.find(obj.id);
-   if( itr != state.old_values.end() ) return;
-   state.old_values[obj.id] = obj.clone();
+   if( itr != state.old_values.end() ) return false;
+   if( obj.undo_by_delta() )
+   {
+      // the changed fields are only looked for when the state is committed or merged, see compare_first_values()
+      undo_delta*& delta = state.old_deltas[obj.id];
+      if( delta == nullptr )
+         delta = new (state.arena.allocate( sizeof(undo_delta) )) undo_delta();
+      else if( delta->first_values != nullptr )
+         return false;
+      delta->first_values = pack_first_values( state, obj );
+      return true;
+   }
+   state.old_values[obj.id] = state.arena.clone( obj );
+   return true;
+}
+void undo_database::restore( object& obj )const
+{
+   FC_ASSERT( !_stack.empty() );
+   const undo_state& state = _stack.back();
+   auto delta = state.old_deltas.find( obj.id );
+   if( delta != state.old_deltas.end() && delta->second->first_values != nullptr )
+   {
+      delta->second->first_values->unpack_to( obj );
+      return;
+   }
+   auto old = state.old_values.find( obj.id );
+   FC_ASSERT( old != state.old_values.end(), "The value of ${id} was not recorded", ("id",obj.id) );
+   obj.move_from( *old->second->clone() );
+}
+packed_fields* undo_database::pack_first_values( undo_state& state, const object& obj )
+{
+   if( _free_first_values.empty() )
+      state.first_values.emplace_back();
+   else
+   {
+      state.first_values.push_back( std::move( _free_first_values.back() ) );
+      _free_first_values.pop_back();
+   }
+   packed_fields& result = state.first_values.back();
+   result.pack( obj );
+   return &result;
+}
+void undo_database::compare_first_values( undo_state& state, object_id_type id, undo_delta& delta )
+{
+   const packed_fields& before = *delta.first_values;
+   auto& after = _current_fields;
+   after.pack( _db.get_object( id ) );
+   FC_ASSERT( after.field_ends.size() == before.field_ends.size() );
+
+   // the entry stays even if nothing changed so that the object is still reported as modified
+   uint32_t before_start = 0;
+   uint32_t after_start = 0;
+   for( uint32_t i = 0; i < before.field_ends.size(); ++i )
+   {
+      const uint32_t before_size = before.field_ends[i] - before_start;
+      const uint32_t after_size = after.field_ends[i] - after_start;
+      if( ( before_size != after_size
+            || 0 != std::memcmp( before.data.data() + before_start, after.data.data() + after_start, before_size ) )
+          && !delta.has_field( i ) )
+         delta.add_field( state.arena, i, before.data.data() + before_start, before_size );
+      before_start = before.field_ends[i];
+      after_start = after.field_ends[i];
+   }
+   delta.first_values = nullptr;
+}
+void undo_database::compare_first_values( undo_state& state )
+{
+   for( auto& item : state.old_deltas )
+      if( item.second->first_values != nullptr )
+         compare_first_values( state, item.first, *item.second );
+   release_first_values( state );
+}
+void undo_database::release_first_values( undo_state& state )
+{
+   for( auto& fields : state.first_values )
+      _free_first_values.push_back( std::move( fields ) );
+   state.first_values.clear();
 }
 void undo_database::on_remove( const object& obj )
 {
    if( _disabled ) return;
 
    if( _stack.empty() )
-      _stack.emplace_back();
+      _stack.emplace_back( &_chunk_pool );
    undo_state& state = _stack.back();
    if( state.new_ids.count(obj.id) > 0 )
    {
@@ -74,12 +215,22 @@ void undo_database::on_remove( const object& obj )
    }
    if( state.old_values.count(obj.id) > 0 )
    {
-      state.removed[obj.id] = std::move(state.old_values[obj.id]);
+      state.removed[obj.id] = state.old_values[obj.id];
       state.old_values.erase(obj.id);
       return;
    }
+   auto delta = state.old_deltas.find(obj.id);
+   if( delta != state.old_deltas.end() )
+   {
+      // rebuild the full before-image from the current value and the recorded fields
+      object* before = state.arena.clone( obj );
+      delta->second->apply_to( *before );
+      state.removed[obj.id] = before;
+      state.old_deltas.erase(obj.id);
+      return;
+   }
    if( state.removed.count(obj.id) > 0 ) return;
-   state.removed[obj.id] = obj.clone();
+   state.removed[obj.id] = state.arena.clone( obj );
 }
 
 void undo_database::undo()
@@ -94,6 +245,11 @@ void undo_database::undo()
       _db.modify( _db.get_object( item.second->id ), [&]( object& obj ){ obj.move_from( *item.second ); } );
    }
 
+   for( auto& item : state.old_deltas )
+   {
+      _db.modify( _db.get_object( item.first ), [&]( object& obj ){ item.second->apply_to( obj ); } );
+   }
+
    for( auto ritr = state.new_ids.begin(); ritr != state.new_ids.end(); ++ritr  )
    {
       _db.remove( _db.get_object(*ritr) );
@@ -107,6 +263,7 @@ void undo_database::undo()
    for( auto& item : state.removed )
       _db.insert( std::move(*item.second) );
 
+   release_first_values( state );
    _stack.pop_back();
    enable();
    --_active_sessions;
@@ -117,6 +274,7 @@ void undo_database::merge()
    FC_ASSERT( _active_sessions > 0 );
    if( _active_sessions == 1 && _stack.size() == 1 )
    {
+      release_first_values( _stack.back() );
       _stack.pop_back();
       --_active_sessions;
       return;
@@ -183,8 +341,48 @@ void undo_database::merge()
       // del+upd -> N/A
       assert( prev_state.removed.find(obj.second->id) == prev_state.removed.end() );
       // nop+upd(was=Y) -> upd(was=Y), type B
-      prev_state.old_values[obj.second->id] = std::move(obj.second);
+      prev_state.old_values[obj.second->id] = obj.second;
+   }
+
+   // *+upd for objects tracked by delta, same as above except that upd+upd has to combine the recorded fields:
+   // a field first changed in B still had its value from before A, so B's before-value is the right one
+   for( auto& item : state.old_deltas )
+   {
+      if( prev_state.new_ids.find(item.first) != prev_state.new_ids.end() )
+      {
+         // new+upd -> new, type A
+         continue;
+      }
+      if( prev_state.old_values.find(item.first) != prev_state.old_values.end() )
+      {
+         // upd(was=X) + upd(was=Y) -> upd(was=X), type A
+         continue;
+      }
+      // del+upd -> N/A
+      assert( prev_state.removed.find(item.first) == prev_state.removed.end() );
+      auto& prev_delta = prev_state.old_deltas[item.first];
+      if( prev_delta == nullptr )
+      {
+         // nop+upd(was=Y) -> upd(was=Y), type B, the fields not compared yet move along
+         if( item.second->first_values != nullptr )
+         {
+            prev_state.first_values.push_back( std::move( *item.second->first_values ) );
+            item.second->first_values = &prev_state.first_values.back();
+         }
+         prev_delta = item.second;
+         continue;
+      }
+      if( prev_delta->first_values != nullptr )
+      {
+         // upd(was=X) + upd(was=Y) -> upd(was=X), type A: comparing A later also finds the fields changed in B
+         continue;
+      }
+      // upd(was=X) + upd(was=Y) -> upd(was=X plus the fields only recorded in Y), type C
+      if( item.second->first_values != nullptr )
+         compare_first_values( state, item.first, *item.second );
+      prev_delta->merge( *item.second );
    }
+   release_first_values( state );
 
    // *+new, but we assume the N/A cases don't happen, leaving type B nop+new -> new
    for( auto id : state.new_ids )
@@ -220,15 +418,27 @@ void undo_database::merge()
       if( it != prev_state.old_values.end() )
       {
          // upd(was=X) + del(was=Y) -> del(was=X)
-         prev_state.removed[obj.second->id] = std::move(it->second);
+         prev_state.removed[obj.second->id] = it->second;
          prev_state.old_values.erase(obj.second->id);
          continue;
       }
+      auto dit = prev_state.old_deltas.find(obj.second->id);
+      if( dit != prev_state.old_deltas.end() )
+      {
+         // upd(was=X) + del(was=Y) -> del(was=X), X is Y with the fields recorded in A rolled back
+         dit->second->apply_to( *obj.second );
+         prev_state.removed[obj.second->id] = obj.second;
+         prev_state.old_deltas.erase(obj.second->id);
+         continue;
+      }
       // del + del -> N/A
       assert( prev_state.removed.find( obj.second->id ) == prev_state.removed.end() );
       // nop + del(was=Y) -> del(was=Y)
-      prev_state.removed[obj.second->id] = std::move(obj.second);
+      prev_state.removed[obj.second->id] = obj.second;
    }
+
+   // the before-images now referenced by prev_state live in state's arena
+   prev_state.arena.splice( state.arena );
    _stack.pop_back();
    --_active_sessions;
 }
@@ -236,6 +446,9 @@ void undo_database::commit()
 {
    FC_ASSERT( _active_sessions > 0 );
    --_active_sessions;
+   // the state is kept until it is popped, from now on it only holds the fields which changed
+   if( !_stack.empty() )
+      compare_first_values( _stack.back() );
 }
 
 void undo_database::pop_commit()
@@ -252,6 +465,11 @@ void undo_database::pop_commit()
          _db.modify( _db.get_object( item.second->id ), [&]( object& obj ){ obj.move_from( *item.second ); } );
       }
 
+      for( auto& item : state.old_deltas )
+      {
+         _db.modify( _db.get_object( item.first ), [&]( object& obj ){ item.second->apply_to( obj ); } );
+      }
+
       for( auto ritr = state.new_ids.begin(); ritr != state.new_ids.end(); ++ritr  )
       {
          _db.remove( _db.get_object(*ritr) );
@@ -265,6 +483,7 @@ void undo_database::pop_commit()
       for( auto& item : state.removed )
          _db.insert( std::move(*item.second) );
 
+      release_first_values( state );
       _stack.pop_back();
    }
    catch ( const fc::exception& e )
@@ -6,6 +6,9 @@ namespace graphene { namespace net {
 
   const core_message_type_enum trx_message::type                             = core_message_type_enum::trx_message_type;
   const core_message_type_enum block_message::type                           = core_message_type_enum::block_message_type;
+  const core_message_type_enum compact_block_message::type                   = core_message_type_enum::compact_block_message_type;
+  const core_message_type_enum fetch_block_transactions_message::type        = core_message_type_enum::fetch_block_transactions_message_type;
+  const core_message_type_enum block_transactions_message::type              = core_message_type_enum::block_transactions_message_type;
   const core_message_type_enum item_ids_inventory_message::type              = core_message_type_enum::item_ids_inventory_message_type;
   const core_message_type_enum blockchain_item_ids_inventory_message::type   = core_message_type_enum::blockchain_item_ids_inventory_message_type;
   const core_message_type_enum fetch_blockchain_item_ids_message::type       = core_message_type_enum::fetch_blockchain_item_ids_message_type;
@@ -24,10 +27,35 @@ namespace graphene { namespace net {
   const core_message_type_enum get_current_connections_request_message::type = core_message_type_enum::get_current_connections_request_message_type;
   const core_message_type_enum get_current_connections_reply_message::type   = core_message_type_enum::get_current_connections_reply_message_type;
 
+  compact_block_message::compact_block_message(const block_message& full_block, const item_hash_t& block_message_hash) :
+    block_message_hash(block_message_hash),
+    header(full_block.block)
+  {
+    transaction_ids.reserve(full_block.block.transactions.size());
+    operation_results.reserve(full_block.block.transactions.size());
+    for (const auto& trx : full_block.block.transactions)
+    {
+      transaction_ids.push_back(trx.id());
+      operation_results.push_back(trx.operation_results);
+    }
+  }
+
 } } // graphene::net
 
 FC_REFLECT_DERIVED_NO_TYPENAME( graphene::net::trx_message, BOOST_PP_SEQ_NIL, (trx) )
 FC_REFLECT_DERIVED_NO_TYPENAME( graphene::net::block_message, BOOST_PP_SEQ_NIL, (block)(block_id) )
+FC_REFLECT_DERIVED_NO_TYPENAME( graphene::net::compact_block_message, BOOST_PP_SEQ_NIL,
+                                (block_message_hash)
+                                (header)
+                                (transaction_ids)
+                                (operation_results) )
+FC_REFLECT_DERIVED_NO_TYPENAME( graphene::net::fetch_block_transactions_message, BOOST_PP_SEQ_NIL,
+                                (block_message_hash)
+                                (block_id)
+                                (transaction_indexes) )
+FC_REFLECT_DERIVED_NO_TYPENAME( graphene::net::block_transactions_message, BOOST_PP_SEQ_NIL,
+                                (block_message_hash)
+                                (transactions) )
 
 FC_REFLECT_DERIVED_NO_TYPENAME( graphene::net::item_id, BOOST_PP_SEQ_NIL,
                                (item_type)
@@ -108,6 +136,9 @@ FC_REFLECT_DERIVED_NO_TYPENAME(graphene::net::get_current_connections_reply_mess
 
 GRAPHENE_IMPLEMENT_EXTERNAL_SERIALIZATION( graphene::net::trx_message )
 GRAPHENE_IMPLEMENT_EXTERNAL_SERIALIZATION( graphene::net::block_message )
+GRAPHENE_IMPLEMENT_EXTERNAL_SERIALIZATION( graphene::net::compact_block_message )
+GRAPHENE_IMPLEMENT_EXTERNAL_SERIALIZATION( graphene::net::fetch_block_transactions_message )
+GRAPHENE_IMPLEMENT_EXTERNAL_SERIALIZATION( graphene::net::block_transactions_message )
 GRAPHENE_IMPLEMENT_EXTERNAL_SERIALIZATION( graphene::net::item_id )
 GRAPHENE_IMPLEMENT_EXTERNAL_SERIALIZATION( graphene::net::item_ids_inventory_message )
 GRAPHENE_IMPLEMENT_EXTERNAL_SERIALIZATION( graphene::net::blockchain_item_ids_inventory_message )
@@ -16,5 +16,7 @@ namespace graphene { namespace net {
    FC_IMPLEMENT_DERIVED_EXCEPTION( unlinkable_block_exception,          net_exception, 90006, "unlinkable block" )
    FC_IMPLEMENT_DERIVED_EXCEPTION( block_timestamp_in_future_exception, net_exception, 90007,
                                    "block timestamp in the future" )
+   FC_IMPLEMENT_DERIVED_EXCEPTION( transaction_queue_full_exception,    net_exception, 90008,
+                                   "too many transactions waiting to be validated" )
 
 } }
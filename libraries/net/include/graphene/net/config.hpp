@@ -39,6 +39,28 @@
 
 #define GRAPHENE_NET_MAXIMUM_QUEUED_MESSAGES_IN_BYTES        (1024 * 1024)
 
+/**
+ * Messages to send to a peer are queued by class, see peer_connection::send_class.  New blocks are always sent
+ * first, the other classes take turns sending up to this many bytes each while more than one has messages queued.
+ */
+#define GRAPHENE_NET_SEND_QUANTUM_CONTROL_BYTES              (16 * 1024)
+#define GRAPHENE_NET_SEND_QUANTUM_TRANSACTION_BYTES          (32 * 1024)
+#define GRAPHENE_NET_SEND_QUANTUM_SYNC_BYTES                 (64 * 1024)
+
+/**
+ * Transactions queued to send to a peer for longer than this, or beyond this many bytes, are dropped and the
+ * peer is told we don't have them, so that it asks another peer before it gives up on us
+ */
+#define GRAPHENE_NET_TRANSACTION_SEND_DEADLINE_SECONDS       3
+#define GRAPHENE_NET_MAXIMUM_QUEUED_TRANSACTIONS_IN_BYTES    (GRAPHENE_NET_MAXIMUM_QUEUED_MESSAGES_IN_BYTES / 4)
+
+/**
+ * Size of the buffers a connection decrypts received messages into and encrypts messages to send from. A
+ * message that does not fit grows them for as long as it is handled. The send queue of a peer is written in
+ * batches of messages of up to this many bytes.
+ */
+#define GRAPHENE_NET_MESSAGE_BUFFER_SIZE                     (64 * 1024)
+
 /**
  * When we receive a message from the network, we advertise it to
  * our peers and save a copy in a cache were we will find it if
@@ -61,8 +83,24 @@
 
 #define GRAPHENE_NET_MAX_INVENTORY_SIZE_IN_MINUTES           2
 
+/**
+ * The items we advertised to a peer are remembered in a bloom filter, see inventory_filter, sized for the most
+ * items we could advertise in half of GRAPHENE_NET_MAX_INVENTORY_SIZE_IN_MINUTES.  This is the chance that it
+ * wrongly tells we advertised an item, so that the peer doesn't hear about it from us.
+ */
+#define GRAPHENE_NET_INVENTORY_FILTER_FALSE_POSITIVE_RATE    0.001
+
 #define GRAPHENE_NET_MAX_BLOCKS_PER_PEER_DURING_SYNCING      200
 
+/**
+ * During syncing, we keep requesting blocks from each peer before it has sent all
+ * the blocks we asked it for, so that it never runs idle.  We keep about this many
+ * seconds worth of blocks requested from each peer, as measured by how fast it has
+ * been sending them, up to GRAPHENE_NET_MAX_BLOCKS_PER_PEER_DURING_SYNCING.
+ */
+#define GRAPHENE_NET_SYNC_REQUEST_WINDOW_SECONDS             2
+#define GRAPHENE_NET_MIN_SYNC_REQUEST_WINDOW                 10
+
 /**
  * During normal operation, how many items will be fetched from each
  * peer at a time.  This will only come into play when the network
@@ -86,6 +124,12 @@
 
 #define GRAPHENE_NET_MAX_TRX_PER_SECOND                      1000
 
+/**
+ * When the client is too busy to take a transaction we fetched from a peer, we fetch it again later, and
+ * fetch no other transaction from that peer for this long
+ */
+#define GRAPHENE_NET_TRANSACTION_BACKPRESSURE_DELAY_MS       500
+
 #define GRAPHENE_NET_MAX_NESTED_OBJECTS                      (250)
 
 #define MAXIMUM_PEERDB_SIZE 1000
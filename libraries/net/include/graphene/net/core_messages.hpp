@@ -62,6 +62,9 @@ namespace graphene { namespace net {
     check_firewall_reply_message_type            = 5015,
     get_current_connections_request_message_type = 5016,
     get_current_connections_reply_message_type   = 5017,
+    compact_block_message_type                   = 5018,
+    fetch_block_transactions_message_type        = 5019,
+    block_transactions_message_type              = 5020,
     core_message_type_last                       = 5099
   };
 
@@ -91,6 +94,56 @@ namespace graphene { namespace net {
 
    };
 
+  /**
+   * A block_message, sent in reply to a fetch_items_message for compact_block_message_type items, that names its
+   * transactions by id instead of carrying them.  The receiver rebuilds the block from the transactions it has
+   * already seen, and asks for the ones it has not with a fetch_block_transactions_message.
+   */
+  struct compact_block_message
+  {
+    static const core_message_type_enum type;
+
+    /// hash of the block_message this stands for, which is the id of the item that was requested
+    item_hash_t                                                     block_message_hash;
+    graphene::protocol::signed_block_header                         header;
+    std::vector<transaction_id_type>                                transaction_ids;
+    /// not covered by the transaction ids, but by the merkle root of the block
+    std::vector< std::vector<graphene::protocol::operation_result> > operation_results;
+
+    compact_block_message() {}
+    compact_block_message(const block_message& full_block, const item_hash_t& block_message_hash);
+  };
+
+  struct fetch_block_transactions_message
+  {
+    static const core_message_type_enum type;
+
+    item_hash_t             block_message_hash;
+    block_id_type           block_id;
+    std::vector<uint32_t>   transaction_indexes; ///< into the transactions of the block, in increasing order
+
+    fetch_block_transactions_message() {}
+    fetch_block_transactions_message(const item_hash_t& block_message_hash, const block_id_type& block_id,
+                                     const std::vector<uint32_t>& transaction_indexes) :
+      block_message_hash(block_message_hash),
+      block_id(block_id),
+      transaction_indexes(transaction_indexes)
+    {}
+  };
+
+  struct block_transactions_message
+  {
+    static const core_message_type_enum type;
+
+    item_hash_t                       block_message_hash;
+    std::vector<signed_transaction>   transactions; ///< in the order they were requested
+
+    block_transactions_message() {}
+    block_transactions_message(const item_hash_t& block_message_hash) :
+      block_message_hash(block_message_hash)
+    {}
+  };
+
   struct item_ids_inventory_message
   {
     static const core_message_type_enum type;
@@ -399,6 +452,9 @@ FC_REFLECT_ENUM( graphene::net::core_message_type_enum,
                  (check_firewall_reply_message_type)
                  (get_current_connections_request_message_type)
                  (get_current_connections_reply_message_type)
+                 (compact_block_message_type)
+                 (fetch_block_transactions_message_type)
+                 (block_transactions_message_type)
                  (core_message_type_last) )
 FC_REFLECT_ENUM(graphene::net::rejection_reason_code, (unspecified)
                                                  (different_chain)
@@ -420,6 +476,9 @@ FC_REFLECT_ENUM(graphene::net::firewall_check_result, (unable_to_check)
 
 FC_REFLECT_TYPENAME( graphene::net::trx_message )
 FC_REFLECT_TYPENAME( graphene::net::block_message )
+FC_REFLECT_TYPENAME( graphene::net::compact_block_message )
+FC_REFLECT_TYPENAME( graphene::net::fetch_block_transactions_message )
+FC_REFLECT_TYPENAME( graphene::net::block_transactions_message )
 FC_REFLECT_TYPENAME( graphene::net::item_id )
 FC_REFLECT_TYPENAME( graphene::net::item_ids_inventory_message )
 FC_REFLECT_TYPENAME( graphene::net::blockchain_item_ids_inventory_message )
@@ -443,6 +502,9 @@ FC_REFLECT_TYPENAME( graphene::net::get_current_connections_reply_message )
 
 GRAPHENE_DECLARE_EXTERNAL_SERIALIZATION( graphene::net::trx_message )
 GRAPHENE_DECLARE_EXTERNAL_SERIALIZATION( graphene::net::block_message )
+GRAPHENE_DECLARE_EXTERNAL_SERIALIZATION( graphene::net::compact_block_message )
+GRAPHENE_DECLARE_EXTERNAL_SERIALIZATION( graphene::net::fetch_block_transactions_message )
+GRAPHENE_DECLARE_EXTERNAL_SERIALIZATION( graphene::net::block_transactions_message )
 GRAPHENE_DECLARE_EXTERNAL_SERIALIZATION( graphene::net::item_id )
 GRAPHENE_DECLARE_EXTERNAL_SERIALIZATION( graphene::net::item_ids_inventory_message )
 GRAPHENE_DECLARE_EXTERNAL_SERIALIZATION( graphene::net::blockchain_item_ids_inventory_message )
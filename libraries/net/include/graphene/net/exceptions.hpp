@@ -12,5 +12,6 @@ namespace graphene { namespace net {
    FC_DECLARE_DERIVED_EXCEPTION( peer_is_on_an_unreachable_fork,      net_exception, 90005 )
    FC_DECLARE_DERIVED_EXCEPTION( unlinkable_block_exception,          net_exception, 90006 )
    FC_DECLARE_DERIVED_EXCEPTION( block_timestamp_in_future_exception, net_exception, 90007 )
+   FC_DECLARE_DERIVED_EXCEPTION( transaction_queue_full_exception,    net_exception, 90008 )
 
 } }
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <graphene/net/core_messages.hpp>
+
+#include <fc/time.hpp>
+
+#include <array>
+#include <vector>
+
+namespace graphene { namespace net {
+
+  /**
+   * @brief A bloom filter over item ids that forgets old items
+   *
+   * Items are added to the current generation of the filter.  When the current generation is older than the
+   * period, or holds as many items as it was sized for, it replaces the previous generation and a new empty one
+   * is started.  So an item is remembered for at least one period, unless a lot of items were added after it,
+   * and at most two.
+   *
+   * The memory used is bounded by the capacity, whatever the number of items added.  In exchange contains()
+   * may return true for an item that was never added, with about the probability given to the constructor.
+   */
+  class inventory_filter
+  {
+  public:
+    /**
+     * @param capacity            number of items a generation holds before it is rotated out
+     * @param period              time a generation is used for before it is rotated out
+     * @param false_positive_rate chance that contains() is true for an item not added, with a full generation
+     */
+    inventory_filter(uint32_t capacity, fc::microseconds period, double false_positive_rate);
+
+    void insert(const item_id& item);
+    bool contains(const item_id& item) const;
+
+    /// Drops the previous generation if it is older than two periods
+    void expire(fc::time_point now = fc::time_point::now());
+
+    /// Number of items added to the generations kept, counting an item added twice twice
+    uint32_t size() const;
+    /// Bytes used by the bits of the filter
+    size_t memory_used() const;
+    /// Estimated chance that contains() is true for an item not added, from how many items the generations hold
+    double false_positive_rate() const;
+
+  private:
+    struct generation
+    {
+      std::vector<uint64_t> bits; ///< empty until the first item is added
+      uint32_t              count = 0;
+      fc::time_point        started;
+    };
+
+    void rotate(fc::time_point now);
+    bool generation_contains(const generation& gen, const item_id& item) const;
+    double generation_false_positive_rate(const generation& gen) const;
+
+    uint32_t         _capacity;
+    fc::microseconds _period;
+    uint32_t         _number_of_bits;
+    uint32_t         _number_of_hashes;
+    std::array<generation, 2> _generations; ///< current and previous
+  };
+
+} } // graphene::net
@@ -57,10 +57,14 @@ namespace graphene { namespace net {
          /**
           *  @brief Called when a new transaction comes in from the network
           *
+          *  @param trx_msg the message which contains the transaction
+          *  @param trx_msg_id the id of that message, which handle_block() reports for the transaction later
+          *
           *  @throws exception if error validating the item, otherwise the item is
           *          safe to broadcast on.
           */
-         virtual void handle_transaction( const graphene::net::trx_message& trx_msg ) = 0;
+         virtual void handle_transaction( const graphene::net::trx_message& trx_msg,
+                                          const message_hash_type& trx_msg_id ) = 0;
 
          /**
           *  @brief Called when a new message comes in from the network other than a
@@ -4,6 +4,7 @@
 #include <graphene/net/peer_database.hpp>
 #include <graphene/net/message_oriented_connection.hpp>
 #include <graphene/net/config.hpp>
+#include <graphene/net/inventory_filter.hpp>
 
 #include <boost/tuple/tuple.hpp>
 
@@ -14,7 +15,9 @@
 #include <boost/multi_index/tag.hpp>
 #include <boost/multi_index/hashed_index.hpp>
 
-#include <queue>
+#include <array>
+#include <deque>
+#include <map>
 #include <boost/container/deque.hpp>
 #include <fc/thread/future.hpp>
 
@@ -28,7 +31,7 @@ namespace graphene { namespace net
       virtual void on_message(peer_connection* originating_peer,
                               const message& received_message) = 0;
       virtual void on_connection_closed(peer_connection* originating_peer) = 0;
-      virtual message get_message_for_item(const item_id& item) = 0;
+      virtual std::shared_ptr<const message> get_message_for_item(const item_id& item) = 0;
     };
 
     using peer_connection_ptr = std::shared_ptr<peer_connection>;
@@ -66,6 +69,25 @@ namespace graphene { namespace net
         closing,
         closed
       };
+      /// Classes of messages we send, each has its own queue, see send_queued_messages_task()
+      enum class send_class
+      {
+        block,       ///< New blocks, sent before anything else
+        control,     ///< Requests, inventory and connection management
+        transaction, ///< Transactions, dropped if they can't be sent in time
+        sync,        ///< Blocks and block ids sent to a peer syncing from us
+        count
+      };
+      /// What is queued to send to this peer in one class and how that went
+      struct send_queue_stats
+      {
+        size_t           queued_messages = 0;
+        size_t           queued_bytes = 0;
+        uint64_t         sent_messages = 0;
+        uint64_t         dropped_messages = 0;
+        /// Moving average of the time messages were queued until they were written
+        fc::microseconds average_latency;
+      };
     private:
       peer_connection_delegate*      _node;
       fc::optional<fc::ip::endpoint> _remote_endpoint;
@@ -76,6 +98,7 @@ namespace graphene { namespace net
        */
       struct queued_message
       {
+        send_class     message_class = send_class::control;
         fc::time_point enqueue_time;
         fc::time_point transmission_start_time;
         fc::time_point transmission_finish_time;
@@ -84,11 +107,13 @@ namespace graphene { namespace net
           enqueue_time(enqueue_time)
         {}
 
-        virtual message get_message(peer_connection_delegate* node) = 0;
+        virtual std::shared_ptr<const message> get_message(peer_connection_delegate* node) = 0;
         /** returns roughly the number of bytes of memory the message is consuming while
          * it is sitting on the queue
          */
         virtual size_t get_size_in_queue() = 0;
+        /// The item the message carries, only meaningful for items, e.g. transactions
+        virtual item_id get_item_id() = 0;
         virtual ~queued_message() = default;
       };
 
@@ -97,17 +122,34 @@ namespace graphene { namespace net
        */
       struct real_queued_message : queued_message
       {
-        message        message_to_send;
-        size_t         message_send_time_field_offset;
+        std::shared_ptr<message> message_to_send;
+        size_t                   message_send_time_field_offset;
 
         real_queued_message(message message_to_send,
                             size_t message_send_time_field_offset = (size_t)-1) :
-          message_to_send(std::move(message_to_send)),
+          message_to_send(std::make_shared<message>(std::move(message_to_send))),
           message_send_time_field_offset(message_send_time_field_offset)
         {}
 
-        message get_message(peer_connection_delegate* node) override;
+        std::shared_ptr<const message> get_message(peer_connection_delegate* node) override;
         size_t get_size_in_queue() override;
+        item_id get_item_id() override;
+      };
+
+      /* when you queue up a 'shared_queued_message', the message is shared with whoever
+       * else holds it, e.g. the message cache, instead of being copied
+       */
+      struct shared_queued_message : queued_message
+      {
+        std::shared_ptr<const message> message_to_send;
+
+        explicit shared_queued_message(std::shared_ptr<const message> message_to_send) :
+          message_to_send(std::move(message_to_send))
+        {}
+
+        std::shared_ptr<const message> get_message(peer_connection_delegate* node) override;
+        size_t get_size_in_queue() override;
+        item_id get_item_id() override;
       };
 
       /* when you queue up a 'virtual_queued_message', we just queue up the hash of the
@@ -122,13 +164,22 @@ namespace graphene { namespace net
           item_to_send(std::move(the_item_to_send))
         {}
 
-        message get_message(peer_connection_delegate* node) override;
+        std::shared_ptr<const message> get_message(peer_connection_delegate* node) override;
         size_t get_size_in_queue() override;
+        item_id get_item_id() override;
       };
 
 
+      struct send_queue
+      {
+        std::deque<std::unique_ptr<queued_message>> messages;
+        /// Bytes this class may still send before the classes after it get their turn
+        int64_t          deficit = 0;
+        send_queue_stats stats;
+      };
+
       size_t _total_queued_messages_size = 0;
-      std::queue<std::unique_ptr<queued_message>, std::list<std::unique_ptr<queued_message> > > _queued_messages;
+      std::array<send_queue, size_t(send_class::count)> _send_queues;
       fc::future<void> _send_queued_messages_done;
     public:
       fc::time_point connection_initiation_time;
@@ -167,6 +218,8 @@ namespace graphene { namespace net
       fc::optional<fc::time_point_sec> fc_git_revision_unix_timestamp;
       fc::optional<std::string> platform;
       fc::optional<uint32_t> bitness;
+      /// Whether the peer can send blocks as compact_block_message
+      bool supports_compact_blocks = false;
 
       // Initially, these fields record info about our local socket,
       // they are useless (except the remote_inbound_endpoint field for outbound connections).
@@ -206,6 +259,8 @@ namespace graphene { namespace net
       item_hash_t last_block_delegate_has_seen;
       fc::time_point_sec last_block_time_delegate_has_seen;
       bool inhibit_fetching_sync_blocks = false;
+      /// Sync blocks per second this peer has been sending us, a moving average, 0 until we received one
+      double sync_blocks_per_second = 0;
       /// @}
 
       /// non-synchronization state data
@@ -233,11 +288,21 @@ namespace graphene { namespace net
          >
       >;
       timestamped_items_set_type inventory_peer_advertised_to_us;
-      timestamped_items_set_type inventory_advertised_to_peer;
+      /// Items we advertised to this peer in the last GRAPHENE_NET_MAX_INVENTORY_SIZE_IN_MINUTES or so,
+      /// may wrongly contain a few we didn't
+      inventory_filter inventory_advertised_to_peer;
 
       /// Items we've requested from this peer during normal operation.
       /// Fetch from another peer if this peer disconnects
       item_to_time_map_type items_requested_from_peer;
+      /// A block this peer sent us as a compact_block_message, rebuilt but for the transactions we asked it for
+      struct compact_block_in_progress
+      {
+        signed_block          block;
+        std::vector<uint32_t> missing_transactions; ///< indexes into block.transactions
+      };
+      /// Compact blocks waiting for a block_transactions_message from this peer, by hash of the block_message
+      std::map<item_hash_t, compact_block_in_progress> compact_blocks_in_progress;
       /// @}
 
       // if they're flooding us with transactions, we set this to avoid fetching for a few seconds to let the
@@ -277,6 +342,8 @@ namespace graphene { namespace net
 
       void send_queueable_message(std::unique_ptr<queued_message>&& message_to_send);
       virtual void send_message( const message& message_to_send, size_t message_send_time_field_offset = (size_t)-1 );
+      /// Queues a message without copying it, it must not change until it is sent
+      void send_message( std::shared_ptr<const message> message_to_send );
       void send_item(const item_id& item_to_send);
       void close_connection();
       void destroy_connection();
@@ -295,6 +362,8 @@ namespace graphene { namespace net
       bool idle() const;
       bool is_currently_handling_message() const;
 
+      send_queue_stats get_send_queue_stats(send_class message_class) const;
+
       bool is_transaction_fetching_inhibited() const;
       fc::sha512 get_shared_secret() const;
       void clear_old_inventory();
@@ -302,6 +371,11 @@ namespace graphene { namespace net
       bool is_inventory_advertised_to_us_list_full() const;
       fc::optional<fc::ip::endpoint> get_endpoint_for_connecting() const;
     private:
+      send_class classify_message(uint32_t message_type) const;
+      void enqueue_message(std::unique_ptr<queued_message>&& message_to_send);
+      send_queue* next_send_queue();
+      void drop_stale_transactions();
+      void drop_queued_transaction();
       void send_queued_messages_task();
       void accept_connection_task();
       void connect_to_task(const fc::ip::endpoint& remote_endpoint);
@@ -331,4 +405,10 @@ FC_REFLECT_ENUM(graphene::net::peer_connection::connection_negotiation_status, (
                                                                           (closing)
                                                                           (closed) )
 
+FC_REFLECT_ENUM(graphene::net::peer_connection::send_class, (block)
+                                                       (control)
+                                                       (transaction)
+                                                       (sync)
+                                                       (count) )
+
 FC_REFLECT( graphene::net::peer_connection::timestamped_item_id, (item)(timestamp) )
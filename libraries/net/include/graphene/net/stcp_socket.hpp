@@ -30,6 +30,17 @@ class stcp_socket : public virtual fc::iostream
     virtual void     flush();
     virtual void     close();
 
+    /**
+     *  Reads up to len bytes into buf at offset and decrypts them where they are, without going through the
+     *  internal read buffer. len must be a multiple of 16, so is the number of bytes returned.
+     */
+    size_t           readsome_in_place( const std::shared_ptr<char>& buf, size_t len, size_t offset );
+    /**
+     *  Encrypts the first len bytes of buf where they are and writes them out, without going through the
+     *  internal write buffer. len must be a multiple of 16. The contents of buf are lost.
+     */
+    void             write_in_place( const std::shared_ptr<char>& buf, size_t len );
+
     using istream::get;
     void             get( char& c ) { read( &c, 1 ); }
     fc::sha512       get_shared_secret() const { return _shared_secret; }
@@ -0,0 +1,115 @@
+#include <graphene/net/inventory_filter.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace graphene { namespace net {
+
+  namespace
+  {
+    /// Two independent hashes of an item, the ids are ripemd160 hashes already so we just take their words
+    std::pair<uint64_t, uint64_t> hash_item(const item_id& item)
+    {
+      const auto& words = item.item_hash._hash;
+      const uint64_t h1 = ((uint64_t(words[0]) << 32) | words[1]) ^ item.item_type;
+      const uint64_t h2 = ((uint64_t(words[2]) << 32) | words[3]) | 1;
+      return std::make_pair(h1, h2);
+    }
+  }
+
+  inventory_filter::inventory_filter(uint32_t capacity, fc::microseconds period, double false_positive_rate) :
+    _capacity(std::max<uint32_t>(capacity, 1)),
+    _period(period)
+  {
+    // the usual optimal sizes, m = -n ln(p) / ln(2)^2 bits and k = m/n ln(2) hashes
+    const double ln2 = std::log(2.0);
+    const double bits = std::ceil(-double(_capacity) * std::log(false_positive_rate) / (ln2 * ln2));
+    _number_of_bits = std::max<uint32_t>(uint32_t(bits), 64);
+    _number_of_hashes = std::max<uint32_t>(uint32_t(std::round(bits / _capacity * ln2)), 1);
+    _generations[0].started = fc::time_point::now();
+    _generations[1].started = _generations[0].started - _period;
+  }
+
+  void inventory_filter::insert(const item_id& item)
+  {
+    const fc::time_point now = fc::time_point::now();
+    if (_generations[0].count >= _capacity || now - _generations[0].started >= _period)
+      rotate(now);
+
+    generation& current = _generations[0];
+    if (current.bits.empty())
+      current.bits.resize((_number_of_bits + 63) / 64);
+    const auto hashes = hash_item(item);
+    for (uint32_t i = 0; i < _number_of_hashes; ++i)
+    {
+      const uint64_t bit = (hashes.first + i * hashes.second) % _number_of_bits;
+      current.bits[bit / 64] |= uint64_t(1) << (bit % 64);
+    }
+    ++current.count;
+  }
+
+  bool inventory_filter::contains(const item_id& item) const
+  {
+    return generation_contains(_generations[0], item) || generation_contains(_generations[1], item);
+  }
+
+  bool inventory_filter::generation_contains(const generation& gen, const item_id& item) const
+  {
+    if (gen.count == 0)
+      return false;
+    const auto hashes = hash_item(item);
+    for (uint32_t i = 0; i < _number_of_hashes; ++i)
+    {
+      const uint64_t bit = (hashes.first + i * hashes.second) % _number_of_bits;
+      if (!(gen.bits[bit / 64] & (uint64_t(1) << (bit % 64))))
+        return false;
+    }
+    return true;
+  }
+
+  void inventory_filter::expire(fc::time_point now)
+  {
+    if (now - _generations[0].started >= _period)
+      rotate(now);
+    if (now - _generations[1].started >= _period + _period)
+    {
+      // nothing was added for a while, the previous generation is too old to keep
+      _generations[1].bits.clear();
+      _generations[1].bits.shrink_to_fit();
+      _generations[1].count = 0;
+    }
+  }
+
+  void inventory_filter::rotate(fc::time_point now)
+  {
+    std::swap(_generations[0], _generations[1]);
+    // reuse the memory of the dropped generation unless it was released
+    std::fill(_generations[0].bits.begin(), _generations[0].bits.end(), 0);
+    _generations[0].count = 0;
+    _generations[0].started = now;
+  }
+
+  uint32_t inventory_filter::size() const
+  {
+    return _generations[0].count + _generations[1].count;
+  }
+
+  size_t inventory_filter::memory_used() const
+  {
+    return (_generations[0].bits.size() + _generations[1].bits.size()) * sizeof(uint64_t);
+  }
+
+  double inventory_filter::generation_false_positive_rate(const generation& gen) const
+  {
+    // (1 - e^(-kn/m))^k
+    const double k = _number_of_hashes;
+    return std::pow(1.0 - std::exp(-k * gen.count / _number_of_bits), k);
+  }
+
+  double inventory_filter::false_positive_rate() const
+  {
+    return 1.0 - (1.0 - generation_false_positive_rate(_generations[0]))
+               * (1.0 - generation_false_positive_rate(_generations[1]));
+  }
+
+} } // graphene::net
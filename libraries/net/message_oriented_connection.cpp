@@ -25,6 +25,45 @@
 namespace graphene { namespace net {
   namespace detail
   {
+    /**
+     * A buffer the socket decrypts into or encrypts in, allocated once per connection. It is held by a shared_ptr,
+     * so that it outlives a socket operation that is interrupted.
+     */
+    class io_buffer
+    {
+    public:
+      char* data() const { return _data.get(); }
+      const std::shared_ptr<char>& get() const { return _data; }
+      size_t size() const { return _size; }
+
+      /** makes the buffer at least new_size bytes large, keeping its first kept bytes */
+      void grow(size_t new_size, size_t kept)
+      {
+        if (new_size <= _size)
+          return;
+        std::shared_ptr<char> grown(new char[new_size], [](char* p){ delete[] p; });
+        if (kept > 0)
+          memcpy(grown.get(), _data.get(), kept);
+        _data = std::move(grown);
+        _size = new_size;
+      }
+
+      /** gives back the memory of a buffer that grew for a large message */
+      void release_oversized()
+      {
+        if (_size > GRAPHENE_NET_MESSAGE_BUFFER_SIZE)
+        {
+          _data.reset();
+          _size = 0;
+          grow(GRAPHENE_NET_MESSAGE_BUFFER_SIZE, 0);
+        }
+      }
+
+    private:
+      std::shared_ptr<char> _data;
+      size_t                _size = 0;
+    };
+
     class message_oriented_connection_impl
     {
     private:
@@ -42,6 +81,11 @@ namespace graphene { namespace net {
 
       std::atomic_bool _send_message_in_progress;
       std::atomic_bool _read_loop_in_progress;
+
+      /// Bytes read from the socket and decrypted in place, possibly several messages and the beginning of the next one
+      io_buffer _receive_buffer;
+      /// The padded messages of the batch being sent, encrypted in place
+      io_buffer _send_buffer;
 #ifndef NDEBUG
       fc::thread* _thread;
 #endif
@@ -59,6 +103,7 @@ namespace graphene { namespace net {
       ~message_oriented_connection_impl();
 
       void send_message(const message& message_to_send);
+      void send_messages(const message* const* messages_to_send, size_t count);
       void close_connection();
       void destroy_connection();
 
@@ -136,12 +181,18 @@ namespace graphene { namespace net {
       }
     };
 
+    namespace {
+      /// Messages are padded to a multiple of the AES block size on the wire
+      size_t padded_size(uint32_t message_size)
+      {
+        return 16 * ((sizeof(message_header) + message_size + 15) / 16);
+      }
+    }
+
     void message_oriented_connection_impl::read_loop()
     {
       VERIFY_CORRECT_THREAD();
-      const int BUFFER_SIZE = 16;
-      const int LEFTOVER = BUFFER_SIZE - sizeof(message_header);
-      static_assert(BUFFER_SIZE >= sizeof(message_header), "insufficient buffer");
+      static_assert(GRAPHENE_NET_MESSAGE_BUFFER_SIZE % 16 == 0, "buffer must hold whole AES blocks");
 
       no_parallel_execution_guard guard( &_read_loop_in_progress );
 
@@ -154,50 +205,69 @@ namespace graphene { namespace net {
       try
       {
         message m;
-        char buffer[BUFFER_SIZE];
+        // Bytes [begin, end) of the buffer are received but not handled yet. Messages are padded to 16 bytes and
+        // the socket returns whole AES blocks, so both always lie on a block boundary.
+        _receive_buffer.grow(GRAPHENE_NET_MESSAGE_BUFFER_SIZE, 0);
+        size_t begin = 0;
+        size_t end = 0;
         while( true )
         {
-          try {
-            _sock.read(buffer, BUFFER_SIZE);
-          } catch ( const fc::canceled_exception& ) {
-            io_error = true;
-            throw;
-          }
-          _bytes_received += BUFFER_SIZE;
-          memcpy((char*)&m, buffer, sizeof(message_header));
-          FC_ASSERT( m.size.value() <= MAX_MESSAGE_SIZE, "", ("m.size",m.size.value())("MAX_MESSAGE_SIZE",MAX_MESSAGE_SIZE) );
-
-          size_t remaining_bytes_with_padding = 16 * ((m.size.value() - LEFTOVER + 15) / 16);
-          m.data.resize(LEFTOVER + remaining_bytes_with_padding); //give extra 16 bytes to allow for padding added in send call
-          std::copy(buffer + sizeof(message_header), buffer + sizeof(buffer), m.data.begin());
-          if (remaining_bytes_with_padding)
+          size_t needed = 16;
+          while( end - begin >= 16 )
           {
-            try {
-              _sock.read(&m.data[LEFTOVER], remaining_bytes_with_padding);
-            } catch ( const fc::canceled_exception& ) {
-              io_error = true;
+            memcpy((char*)&m, _receive_buffer.data() + begin, sizeof(message_header));
+            FC_ASSERT( m.size.value() <= MAX_MESSAGE_SIZE, "", ("m.size",m.size.value())("MAX_MESSAGE_SIZE",MAX_MESSAGE_SIZE) );
+
+            needed = padded_size(m.size.value());
+            if (end - begin < needed)
+              break;
+            // the data vector keeps its capacity, so that no message smaller than the largest one so far allocates
+            const char* body = _receive_buffer.data() + begin + sizeof(message_header);
+            m.data.assign(body, body + m.size.value());
+            begin += needed;
+            needed = 16;
+
+            _last_message_received_time = fc::time_point::now();
+
+            try
+            {
+              // message handling errors are warnings...
+              _delegate->on_message(_self, m);
+            }
+            /// Dedicated catches needed to distinguish from general fc::exception
+            catch ( const fc::canceled_exception& e ) { throw; }
+            catch ( const fc::eof_exception& e ) { throw; }
+            catch ( const fc::exception& e)
+            {
+              /// Here loop should be continued so exception should be just caught locally.
+              wlog( "message transmission failed ${er}", ("er", e.to_detail_string() ) );
               throw;
             }
-            _bytes_received += remaining_bytes_with_padding;
           }
-          m.data.resize(m.size.value()); // truncate off the padding bytes
 
-          _last_message_received_time = fc::time_point::now();
-
-          try
+          // keep the beginning of the next message, and make room for all of it
+          if (begin == end)
           {
-            // message handling errors are warnings...
-            _delegate->on_message(_self, m);
+            begin = end = 0;
+            _receive_buffer.release_oversized();
           }
-          /// Dedicated catches needed to distinguish from general fc::exception
-          catch ( const fc::canceled_exception& e ) { throw; }
-          catch ( const fc::eof_exception& e ) { throw; }
-          catch ( const fc::exception& e)
+          else if (begin > 0)
           {
-            /// Here loop should be continued so exception should be just caught locally.
-            wlog( "message transmission failed ${er}", ("er", e.to_detail_string() ) );
+            memmove(_receive_buffer.data(), _receive_buffer.data() + begin, end - begin);
+            end -= begin;
+            begin = 0;
+          }
+          _receive_buffer.grow(needed, end);
+
+          size_t bytes_read;
+          try {
+            bytes_read = _sock.readsome_in_place(_receive_buffer.get(), _receive_buffer.size() - end, end);
+          } catch ( const fc::canceled_exception& ) {
+            io_error = true;
             throw;
           }
+          end += bytes_read;
+          _bytes_received += bytes_read;
         }
       }
       catch ( const fc::canceled_exception& e )
@@ -263,27 +333,44 @@ namespace graphene { namespace net {
       } send_message_scope_logger(remote_endpoint);
 #endif
 #endif
+      const message* single_message = &message_to_send;
+      send_messages(&single_message, 1);
+    }
+
+    void message_oriented_connection_impl::send_messages(const message* const* messages_to_send, size_t count)
+    {
+      VERIFY_CORRECT_THREAD();
       no_parallel_execution_guard guard( &_send_message_in_progress );
       _ready_for_sending->wait();
 
       try
       {
-        size_t size_of_message_and_header = sizeof(message_header) + message_to_send.size.value();
-        if( message_to_send.size.value() > MAX_MESSAGE_SIZE )
-           elog("Trying to send a message larger than MAX_MESSAGE_SIZE. This probably won't work...");
-        //pad the message we send to a multiple of 16 bytes
-        size_t size_with_padding = 16 * ((size_of_message_and_header + 15) / 16);
-        std::vector<char> padded_message( size_with_padding );
-
-        memcpy( padded_message.data(), (const char*)&message_to_send, sizeof(message_header) );
-        memcpy( padded_message.data() + sizeof(message_header), message_to_send.data.data(),
-                message_to_send.size.value() );
-        char* padding_space = padded_message.data() + sizeof(message_header) + message_to_send.size.value();
-        memset(padding_space, 0, size_with_padding - size_of_message_and_header);
-        _sock.write( padded_message.data(), size_with_padding );
+        size_t total_size = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+          if( messages_to_send[i]->size.value() > MAX_MESSAGE_SIZE )
+             elog("Trying to send a message larger than MAX_MESSAGE_SIZE. This probably won't work...");
+          total_size += padded_size(messages_to_send[i]->size.value());
+        }
+
+        //pad each message we send to a multiple of 16 bytes, and send them all at once
+        _send_buffer.grow(total_size, 0);
+        char* position = _send_buffer.data();
+        for (size_t i = 0; i < count; ++i)
+        {
+          const message& message_to_send = *messages_to_send[i];
+          const size_t size_of_message_and_header = sizeof(message_header) + message_to_send.size.value();
+          const size_t size_with_padding = padded_size(message_to_send.size.value());
+          memcpy( position, (const char*)&message_to_send, sizeof(message_header) );
+          memcpy( position + sizeof(message_header), message_to_send.data.data(), message_to_send.size.value() );
+          memset( position + size_of_message_and_header, 0, size_with_padding - size_of_message_and_header );
+          position += size_with_padding;
+        }
+        _sock.write_in_place( _send_buffer.get(), total_size );
         _sock.flush();
-        _bytes_sent += size_with_padding;
+        _bytes_sent += total_size;
         _last_message_sent_time = fc::time_point::now();
+        _send_buffer.release_oversized();
       } FC_RETHROW_EXCEPTIONS( warn, "unable to send message" )
     }
 
@@ -389,6 +476,17 @@ namespace graphene { namespace net {
     my->send_message(message_to_send);
   }
 
+  void message_oriented_connection::send_messages(const std::vector<std::shared_ptr<const message>>& messages_to_send)
+  {
+    if (messages_to_send.empty())
+      return;
+    std::vector<const message*> messages;
+    messages.reserve(messages_to_send.size());
+    for (const auto& message_to_send : messages_to_send)
+      messages.push_back(message_to_send.get());
+    my->send_messages(messages.data(), messages.size());
+  }
+
   void message_oriented_connection::close_connection()
   {
     my->close_connection();
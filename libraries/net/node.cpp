@@ -63,10 +63,22 @@ namespace graphene { namespace net { namespace detail {
 
    void blockchain_tied_message_cache::block_accepted()
    {
-      ++block_clock;
-      if( block_clock > cache_duration_in_blocks )
-         _message_cache.get<block_clock_index>().erase(_message_cache.get<block_clock_index>().begin(),
-               _message_cache.get<block_clock_index>().lower_bound(block_clock - cache_duration_in_blocks ) );
+      for( shard& s : _shards )
+      {
+         std::lock_guard<std::mutex> lock( s.mutex );
+         s.buckets.emplace_back();
+         while( s.buckets.size() > cache_duration_in_blocks + 1 )
+         {
+            auto& by_hash = s.messages.get<message_hash_index>();
+            for( const message_hash_type& hash : s.buckets.front() )
+            {
+               auto iter = by_hash.find( hash );
+               s.memory_used -= sizeof(message) + iter->message_body->data.size();
+               by_hash.erase( iter );
+            }
+            s.buckets.pop_front();
+         }
+      }
    }
 
    void blockchain_tied_message_cache::cache_message( const message& message_to_cache,
@@ -74,35 +86,112 @@ namespace graphene { namespace net { namespace detail {
                                                       const message_propagation_data& propagation_data,
                                                       const message_hash_type& message_content_hash )
    {
-      _message_cache.insert( message_info(hash_of_message_to_cache,
-                                         message_to_cache,
-                                         block_clock,
-                                         propagation_data,
-                                         message_content_hash ) );
+      auto body = std::make_shared<const message>( message_to_cache );
+      shard& s = shard_for( hash_of_message_to_cache );
+      std::lock_guard<std::mutex> lock( s.mutex );
+      if( s.messages.insert( message_info{ hash_of_message_to_cache, body, propagation_data,
+                                           message_content_hash } ).second )
+      {
+         s.buckets.back().push_back( hash_of_message_to_cache );
+         s.memory_used += sizeof(message) + body->data.size();
+      }
+   }
+
+   std::shared_ptr<const message> blockchain_tied_message_cache::find_message(
+         const message_hash_type& hash_of_message_to_lookup ) const
+   {
+      const shard& s = shard_for( hash_of_message_to_lookup );
+      std::lock_guard<std::mutex> lock( s.mutex );
+      const auto& by_hash = s.messages.get<message_hash_index>();
+      auto iter = by_hash.find( hash_of_message_to_lookup );
+      if( iter == by_hash.end() )
+      {
+         ++_misses;
+         return nullptr;
+      }
+      ++_hits;
+      return iter->message_body;
    }
 
    message blockchain_tied_message_cache::get_message( const message_hash_type& hash_of_message_to_lookup ) const
    {
-      message_cache_container::index<message_hash_index>::type::const_iterator iter =
-         _message_cache.get<message_hash_index>().find(hash_of_message_to_lookup );
-      if( iter != _message_cache.get<message_hash_index>().end() )
-         return iter->message_body;
+      std::shared_ptr<const message> body = find_message( hash_of_message_to_lookup );
+      if( body )
+         return *body;
       FC_THROW_EXCEPTION(  fc::key_not_found_exception, "Requested message not in cache" );
    }
 
+   const blockchain_tied_message_cache::message_info* blockchain_tied_message_cache::find_by_contents(
+         const message_hash_type& hash_of_msg_contents_to_lookup, std::unique_lock<std::mutex>& lock ) const
+   {
+      // messages are sharded by their own hash, so any shard may hold it
+      for( const shard& s : _shards )
+      {
+         std::unique_lock<std::mutex> shard_lock( s.mutex );
+         const auto& by_contents = s.messages.get<message_contents_hash_index>();
+         auto iter = by_contents.find( hash_of_msg_contents_to_lookup );
+         if( iter != by_contents.end() )
+         {
+            lock = std::move( shard_lock );
+            return &*iter;
+         }
+      }
+      return nullptr;
+   }
+
+   std::shared_ptr<const message> blockchain_tied_message_cache::find_message_by_contents(
+         const message_hash_type& hash_of_msg_contents_to_lookup ) const
+   {
+      std::unique_lock<std::mutex> lock;
+      const message_info* info = find_by_contents( hash_of_msg_contents_to_lookup, lock );
+      if( info == nullptr )
+      {
+         ++_misses;
+         return nullptr;
+      }
+      ++_hits;
+      return info->message_body;
+   }
+
     message_propagation_data blockchain_tied_message_cache::get_message_propagation_data(
              const message_hash_type& hash_of_msg_contents_to_lookup ) const
     {
       if( hash_of_msg_contents_to_lookup != message_hash_type() )
       {
-        message_cache_container::index<message_contents_hash_index>::type::const_iterator iter =
-           _message_cache.get<message_contents_hash_index>().find(hash_of_msg_contents_to_lookup );
-        if( iter != _message_cache.get<message_contents_hash_index>().end() )
-          return iter->propagation_data;
+        std::unique_lock<std::mutex> lock;
+        const message_info* info = find_by_contents( hash_of_msg_contents_to_lookup, lock );
+        if( info != nullptr )
+        {
+          ++_hits;
+          return info->propagation_data;
+        }
       }
+      ++_misses;
       FC_THROW_EXCEPTION(  fc::key_not_found_exception, "Requested message not in cache" );
     }
 
+   size_t blockchain_tied_message_cache::size() const
+   {
+      size_t result = 0;
+      for( const shard& s : _shards )
+      {
+         std::lock_guard<std::mutex> lock( s.mutex );
+         result += s.messages.size();
+      }
+      return result;
+   }
+
+   size_t blockchain_tied_message_cache::memory_used() const
+   {
+      size_t result = 0;
+      for( const shard& s : _shards )
+      {
+         std::lock_guard<std::mutex> lock( s.mutex );
+         result += s.memory_used;
+      }
+      return result;
+   }
+
     void node_impl_deleter::operator()(node_impl* impl_to_delete)
     {
 #ifdef P2P_IN_DEDICATED_THREAD
@@ -484,10 +573,8 @@ namespace graphene { namespace net { namespace detail {
     bool node_impl::have_already_received_sync_item( const item_hash_t& item_hash )
     {
       VERIFY_CORRECT_THREAD();
-      return std::find_if(_received_sync_items.begin(), _received_sync_items.end(),
-                          [&item_hash]( const graphene::net::block_message& message ) { return message.block_id == item_hash; } ) != _received_sync_items.end() ||
-             std::find_if(_new_received_sync_items.begin(), _new_received_sync_items.end(),
-                          [&item_hash]( const graphene::net::block_message& message ) { return message.block_id == item_hash; } ) != _new_received_sync_items.end();                          ;
+      return _received_sync_items.get<sync_block_id_index>().find(item_hash)
+             != _received_sync_items.get<sync_block_id_index>().end();
     }
 
     void node_impl::request_sync_item_from_peer( const peer_connection_ptr& peer, const item_hash_t& item_to_request )
@@ -515,6 +602,14 @@ namespace graphene { namespace net { namespace detail {
       peer->send_message(fetch_items_message(graphene::net::block_message_type, items_to_request));
     }
 
+    size_t node_impl::get_sync_request_window( const peer_connection& peer ) const
+    {
+      if (peer.sync_blocks_per_second <= 0)
+        return _max_sync_blocks_per_peer;
+      const auto window = static_cast<size_t>(peer.sync_blocks_per_second * GRAPHENE_NET_SYNC_REQUEST_WINDOW_SECONDS);
+      return std::min(std::max(window, size_t(GRAPHENE_NET_MIN_SYNC_REQUEST_WINDOW)), _max_sync_blocks_per_peer);
+    }
+
     void node_impl::fetch_sync_items_loop()
     {
       VERIFY_CORRECT_THREAD();
@@ -530,15 +625,20 @@ namespace graphene { namespace net { namespace detail {
           {
             std::set<item_hash_t> sync_items_to_request;
 
-            // for each idle peer that we're syncing with
+            // for each peer that we're syncing with and that has room for more sync requests.
+            // Peers that send blocks faster get more of them requested, and are asked for more
+            // before they have sent all of what they were asked for, so that they never run idle
             fc::scoped_lock<fc::mutex> lock(_active_connections.get_mutex());
             for( const peer_connection_ptr& peer : _active_connections )
             {
+              const size_t window = get_sync_request_window(*peer);
               if( peer->we_need_sync_items_from_peer &&
                   // if we've already scheduled a request for this peer, don't consider scheduling another
                   sync_item_requests_to_send.find(peer) == sync_item_requests_to_send.end() &&
-                  peer->idle() )
+                  peer->items_requested_from_peer.empty() && !peer->item_ids_requested_from_peer &&
+                  peer->sync_items_requested_from_peer.size() < window )
               {
+                const size_t items_to_request = window - peer->sync_items_requested_from_peer.size();
                 if (!peer->inhibit_fetching_sync_blocks)
                 {
                   // loop through the items it has that we don't yet have on our blockchain
@@ -556,7 +656,7 @@ namespace graphene { namespace net { namespace detail {
                       // then schedule a request from this peer
                       sync_item_requests_to_send[peer].push_back(item_to_potentially_request);
                       sync_items_to_request.insert( item_to_potentially_request );
-                      if (sync_item_requests_to_send[peer].size() >= _max_sync_blocks_per_peer)
+                      if (sync_item_requests_to_send[peer].size() >= items_to_request)
                         break;
                     }
                   }
@@ -707,8 +807,12 @@ namespace graphene { namespace net { namespace detail {
                  ("count", items_by_type.second.size())("type", (uint32_t)items_by_type.first)
                  ("endpoint", peer_and_items.peer->get_remote_endpoint())
                  ("hashes", items_by_type.second));
-            peer_and_items.peer->send_message(fetch_items_message(items_by_type.first,
-                                                                  items_by_type.second));
+            // we have most likely seen the transactions of a new block already, so ask for it in compact form
+            // if the peer can send it that way.  It is still tracked as a block_message_type item.
+            uint32_t type_to_request = items_by_type.first;
+            if (type_to_request == graphene::net::block_message_type && peer_and_items.peer->supports_compact_blocks)
+              type_to_request = graphene::net::compact_block_message_type;
+            peer_and_items.peer->send_message(fetch_items_message(type_to_request, items_by_type.second));
           }
         }
         items_by_peer.clear();
@@ -751,14 +855,39 @@ namespace graphene { namespace net { namespace detail {
         std::unordered_set<item_id> inventory_to_advertise;
         _new_inventory.swap( inventory_to_advertise );
 
+        // take a copy of the peers we'll advertise to, the inventory messages are built without holding the lock
+        std::vector<peer_connection_ptr> peers_to_advertise_to;
+        {
+          fc::scoped_lock<fc::mutex> lock(_active_connections.get_mutex());
+          peers_to_advertise_to.reserve(_active_connections.size());
+          for (const peer_connection_ptr& peer : _active_connections)
+            peers_to_advertise_to.push_back(peer);
+        }
+
+        // remember what we advertise, anyone advertising it back to us needn't be fetched from
+        fc::time_point_sec now(fc::time_point::now());
+        fc::time_point_sec oldest_inventory_to_keep(fc::time_point::now()
+                                                    - fc::minutes(GRAPHENE_NET_MAX_INVENTORY_SIZE_IN_MINUTES));
+        auto& advertised_by_time = _recently_advertised_inventory.get<peer_connection::timestamp_index>();
+        advertised_by_time.erase(advertised_by_time.begin(), advertised_by_time.lower_bound(oldest_inventory_to_keep));
+        for (const item_id& item_to_advertise : inventory_to_advertise)
+        {
+          auto iter = _recently_advertised_inventory.find(item_to_advertise);
+          if (iter == _recently_advertised_inventory.end())
+            _recently_advertised_inventory.insert(peer_connection::timestamped_item_id(item_to_advertise, now));
+          else
+            _recently_advertised_inventory.modify(iter, [now](peer_connection::timestamped_item_id& item) {
+              item.timestamp = now;
+            });
+        }
+
         // process all inventory to advertise and construct the inventory messages we'll send
         // first, then send them all in a batch (to avoid any fiber interruption points while
         // we're computing the messages)
         std::list<std::pair<peer_connection_ptr, item_ids_inventory_message> > inventory_messages_to_send;
+        for (const peer_connection_ptr& peer : peers_to_advertise_to)
         {
-         fc::scoped_lock<fc::mutex> lock(_active_connections.get_mutex());
-         for (const peer_connection_ptr& peer : _active_connections)
-         {
+          peer->clear_old_inventory();
           // only advertise to peers who are in sync with us
           //idump((peer->peer_needs_sync_items_from_us)); // for debug
           if( !peer->peer_needs_sync_items_from_us )
@@ -768,35 +897,44 @@ namespace graphene { namespace net { namespace detail {
             // or anything it has advertised to us
             // group the items we need to send by type, because we'll need to send one inventory message per type
             size_t total_items_to_send = 0;
+            size_t total_items_filtered = 0;
+            size_t total_items_not_filtered = 0;
+            const double false_positive_rate = peer->inventory_advertised_to_peer.false_positive_rate();
             //idump((inventory_to_advertise)); // for debug
             for (const item_id& item_to_advertise : inventory_to_advertise)
             {
-               auto adv_to_peer = peer->inventory_advertised_to_peer.find(item_to_advertise);
-               auto adv_to_us   = peer->inventory_peer_advertised_to_us.find(item_to_advertise);
-
-              if (adv_to_peer == peer->inventory_advertised_to_peer.end() &&
-                  adv_to_us == peer->inventory_peer_advertised_to_us.end())
+              if (peer->inventory_advertised_to_peer.contains(item_to_advertise))
+              {
+                ++total_items_filtered;
+                dlog("not advertising item ${id} to peer ${endpoint}, we already did",
+                     ("id", item_to_advertise.item_hash)("endpoint", peer->get_remote_endpoint()));
+              }
+              else if (peer->inventory_peer_advertised_to_us.find(item_to_advertise)
+                       != peer->inventory_peer_advertised_to_us.end())
+              {
+                ++total_items_not_filtered;
+                dlog("not advertising item ${id} to peer ${endpoint}, it advertised it to us",
+                     ("id", item_to_advertise.item_hash)("endpoint", peer->get_remote_endpoint()));
+              }
+              else
               {
                 items_to_advertise_by_type[item_to_advertise.item_type].push_back(item_to_advertise.item_hash);
-                peer->inventory_advertised_to_peer.insert(
-                         peer_connection::timestamped_item_id(item_to_advertise, fc::time_point::now()));
+                peer->inventory_advertised_to_peer.insert(item_to_advertise);
                 ++total_items_to_send;
+                ++total_items_not_filtered;
                 if (item_to_advertise.item_type == trx_message_type)
                   testnetlog("advertising transaction ${id} to peer ${endpoint}",
                              ("id", item_to_advertise.item_hash)("endpoint", peer->get_remote_endpoint()));
                 dlog("advertising item ${id} to peer ${endpoint}",
                      ("id", item_to_advertise.item_hash)("endpoint", peer->get_remote_endpoint()));
               }
-              else
-              {
-                 if( adv_to_peer != peer->inventory_advertised_to_peer.end() )
-                    dlog( "adv_to_peer != peer->inventory_advertised_to_peer.end() : ${adv_to_peer}",
-                          ("adv_to_peer", *adv_to_peer) );
-                 if( adv_to_us != peer->inventory_peer_advertised_to_us.end() )
-                    dlog( "adv_to_us != peer->inventory_peer_advertised_to_us.end() : ${adv_to_us}",
-                          ("adv_to_us", *adv_to_us) );
-              }
             }
+            _inventory_items_filtered += total_items_filtered;
+            // Only items not advertised yet can be false positives, and the filter let through a share of
+            // 1 - rate of them, so n items let through stand for n * rate / (1 - rate) false positives
+            if (false_positive_rate < 1.0)
+              _inventory_filter_expected_false_positives += total_items_not_filtered * false_positive_rate
+                                                            / (1.0 - false_positive_rate);
               dlog("advertising ${count} new item(s) of ${types} type(s) to peer ${endpoint}",
                    ("count", total_items_to_send)
                    ("types", items_to_advertise_by_type.size())
@@ -807,9 +945,7 @@ namespace graphene { namespace net { namespace detail {
                      peer, item_ids_inventory_message(items_group.first, items_group.second)));
             }
           }
-          peer->clear_old_inventory();
-         }
-        } // lock_guard
+        }
 
         for (auto iter = inventory_messages_to_send.begin(); iter != inventory_messages_to_send.end(); ++iter)
           iter->first->send_message(iter->second);
@@ -1401,6 +1537,16 @@ namespace graphene { namespace net { namespace detail {
       case core_message_type_enum::block_message_type:
         process_block_message(originating_peer, received_message, message_hash);
         break;
+      case core_message_type_enum::compact_block_message_type:
+        on_compact_block_message(originating_peer, received_message.as<compact_block_message>());
+        break;
+      case core_message_type_enum::fetch_block_transactions_message_type:
+        on_fetch_block_transactions_message(originating_peer,
+                                            received_message.as<fetch_block_transactions_message>());
+        break;
+      case core_message_type_enum::block_transactions_message_type:
+        on_block_transactions_message(originating_peer, received_message.as<block_transactions_message>());
+        break;
       case core_message_type_enum::current_time_request_message_type:
         on_current_time_request_message(originating_peer, received_message.as<current_time_request_message>());
         break;
@@ -1449,6 +1595,7 @@ namespace graphene { namespace net { namespace detail {
       user_data["platform"] = "other";
 #endif
       user_data["bitness"] = sizeof(void*) * 8;
+      user_data["compact_blocks"] = true;
 
       user_data["node_id"] = fc::variant( _node_id, 1 );
 
@@ -1480,6 +1627,8 @@ namespace graphene { namespace net { namespace detail {
         originating_peer->platform = user_data["platform"].as_string();
       if (user_data.contains("bitness"))
         originating_peer->bitness = user_data["bitness"].as<uint32_t>(1);
+      if (user_data.contains("compact_blocks"))
+        originating_peer->supports_compact_blocks = user_data["compact_blocks"].as_bool();
       if (user_data.contains("node_id"))
         originating_peer->node_id = user_data["node_id"].as<node_id_t>(1);
       if (user_data.contains("last_known_fork_block_number"))
@@ -2603,21 +2752,18 @@ namespace graphene { namespace net { namespace detail {
       }
     }
 
-    graphene::net::message node_impl::get_message_for_item(const item_id& item)
+    std::shared_ptr<const message> node_impl::get_message_for_item(const item_id& item)
     {
+      std::shared_ptr<const message> cached_message = _message_cache.find_message(item.item_hash);
+      if (cached_message)
+        return cached_message;
       try
       {
-        return _message_cache.get_message(item.item_hash);
+        return std::make_shared<const message>(_delegate->get_item(item));
       }
       catch (fc::key_not_found_exception&)
       {}
-      try
-      {
-        return _delegate->get_item(item);
-      }
-      catch (fc::key_not_found_exception&)
-      {}
-      return item_not_available_message(item);
+      return std::make_shared<const message>(item_not_available_message(item));
     }
 
     void node_impl::on_fetch_items_message(peer_connection* originating_peer,
@@ -2638,43 +2784,46 @@ namespace graphene { namespace net { namespace detail {
            ("type", fetch_items_message_received.item_type)
            ("endpoint", originating_peer->get_remote_endpoint()));
 
-      fc::optional<message> last_block_message_sent;
+      // compact blocks are requested by the ids of the full blocks they stand for
+      const bool send_compact_blocks = fetch_items_message_received.item_type == compact_block_message_type;
+      const uint32_t item_type = send_compact_blocks ? uint32_t(block_message_type)
+                                                     : fetch_items_message_received.item_type;
+
+      std::shared_ptr<const message> last_block_message_sent;
 
-      std::list<message> reply_messages;
+      // cached messages are queued as they are, without copying them
+      std::list<std::shared_ptr<const message>> reply_messages;
       for (const item_hash_t& item_hash : fetch_items_message_received.items_to_fetch)
       {
-        try
+        std::shared_ptr<const message> cached_message = _message_cache.find_message(item_hash);
+        if (cached_message)
         {
-          message requested_message = _message_cache.get_message(item_hash);
           dlog("received item request for item ${id} from peer ${endpoint}, returning the item from my message cache",
                ("endpoint", originating_peer->get_remote_endpoint())
-               ("id", requested_message.id()));
-          reply_messages.push_back(requested_message);
-          if (fetch_items_message_received.item_type == block_message_type)
-            last_block_message_sent = requested_message;
+               ("id", item_hash));
+          if (item_type == block_message_type)
+            last_block_message_sent = cached_message;
+          reply_messages.push_back(std::move(cached_message));
           continue;
         }
-        catch (fc::key_not_found_exception&)
-        {
-           // it wasn't in our local cache, that's ok ask the client
-        }
+        // it wasn't in our local cache, that's ok ask the client
 
-        item_id item_to_fetch(fetch_items_message_received.item_type, item_hash);
+        item_id item_to_fetch(item_type, item_hash);
         try
         {
-          message requested_message = _delegate->get_item(item_to_fetch);
+          auto requested_message = std::make_shared<const message>(_delegate->get_item(item_to_fetch));
           dlog("received item request from peer ${endpoint}, returning the item from delegate with id ${id} size ${size}",
-               ("id", requested_message.id())
-               ("size", requested_message.size)
+               ("id", requested_message->id())
+               ("size", requested_message->size)
                ("endpoint", originating_peer->get_remote_endpoint()));
           reply_messages.push_back(requested_message);
-          if (fetch_items_message_received.item_type == block_message_type)
+          if (item_type == block_message_type)
             last_block_message_sent = requested_message;
           continue;
         }
         catch (fc::key_not_found_exception&)
         {
-          reply_messages.push_back(item_not_available_message(item_to_fetch));
+          reply_messages.push_back(std::make_shared<const message>(item_not_available_message(item_to_fetch)));
           dlog("received item request from peer ${endpoint} but we don't have it",
                ("endpoint", originating_peer->get_remote_endpoint()));
         }
@@ -2688,12 +2837,14 @@ namespace graphene { namespace net { namespace detail {
         originating_peer->last_block_time_delegate_has_seen = _delegate->get_block_time(block.block_id);
       }
 
-      for (const message& reply : reply_messages)
+      for (std::shared_ptr<const message>& reply : reply_messages)
       {
-        if (reply.msg_type.value() == block_message_type)
-          originating_peer->send_item(item_id(block_message_type, reply.as<graphene::net::block_message>().block_id));
+        if (reply->msg_type.value() == block_message_type && send_compact_blocks)
+          originating_peer->send_message(compact_block_message(reply->as<graphene::net::block_message>(), reply->id()));
+        else if (reply->msg_type.value() == block_message_type)
+          originating_peer->send_item(item_id(block_message_type, reply->as<graphene::net::block_message>().block_id));
         else
-          originating_peer->send_message(reply);
+          originating_peer->send_message(std::move(reply));
       }
     }
 
@@ -2705,6 +2856,7 @@ namespace graphene { namespace net { namespace detail {
       if (regular_item_iter != originating_peer->items_requested_from_peer.end())
       {
         originating_peer->items_requested_from_peer.erase( regular_item_iter );
+        originating_peer->compact_blocks_in_progress.erase( requested_item.item_hash );
         originating_peer->inventory_peer_advertised_to_us.erase( requested_item );
         if (is_item_in_any_peers_inventory(requested_item))
         {
@@ -2762,19 +2914,20 @@ namespace graphene { namespace net { namespace detail {
       for( const item_hash_t& item_hash : item_ids_inventory_message_received.item_hashes_available )
       {
         item_id advertised_item_id(item_ids_inventory_message_received.item_type, item_hash);
-        bool we_advertised_this_item_to_a_peer = false;
+        // the per-peer inventory filters may be wrong about this, so look it up in our own exact list
+        bool we_advertised_this_item_to_a_peer = _recently_advertised_inventory.find(advertised_item_id)
+                                                 != _recently_advertised_inventory.end();
         bool we_requested_this_item_from_a_peer = false;
+        if (!we_advertised_this_item_to_a_peer)
         {
            fc::scoped_lock<fc::mutex> lock(_active_connections.get_mutex());
             for (const peer_connection_ptr& peer : _active_connections)
             {
-               if (peer->inventory_advertised_to_peer.find(advertised_item_id) != peer->inventory_advertised_to_peer.end())
+               if (peer->items_requested_from_peer.find(advertised_item_id) != peer->items_requested_from_peer.end())
                {
-                  we_advertised_this_item_to_a_peer = true;
+                  we_requested_this_item_from_a_peer = true;
                   break;
                }
-               if (peer->items_requested_from_peer.find(advertised_item_id) != peer->items_requested_from_peer.end())
-                  we_requested_this_item_from_a_peer = true;
             }
         }
 
@@ -3152,38 +3305,49 @@ namespace graphene { namespace net { namespace detail {
       std::set<peer_connection_ptr> peers_we_need_to_sync_to;
       std::map<peer_connection_ptr, fc::oexception> peers_with_rejected_block;
 
+      auto& received_by_id = _received_sync_items.get<sync_block_id_index>();
       do
       {
-        std::copy(std::make_move_iterator(_new_received_sync_items.begin()),
-                  std::make_move_iterator(_new_received_sync_items.end()),
-                  std::front_inserter(_received_sync_items));
-        _new_received_sync_items.clear();
-        dlog("currently ${count} sync items to consider", ("count", _received_sync_items.size()));
+        if (!_received_sync_items.empty())
+        {
+          const auto& received_by_num = _received_sync_items.get<sync_block_num_index>();
+          dlog("currently ${count} sync items to consider, blocks ${first} to ${last}",
+               ("count", _received_sync_items.size())
+               ("first", received_by_num.begin()->block.block_num())
+               ("last", received_by_num.rbegin()->block.block_num()));
+        }
 
         block_processed_this_iteration = false;
-        for (auto received_block_iter = _received_sync_items.begin();
-             received_block_iter != _received_sync_items.end();
-             ++received_block_iter)
         {
-
-          // find out if this block is the next block on the active chain or one of the forks
-          bool potential_first_block = false;
+          // the next block on the active chain or one of the forks is the first item some peer has for us,
+          // find the lowest of those we have received
+          auto received_block_iter = received_by_id.end();
           {
             fc::scoped_lock<fc::mutex> lock(_active_connections.get_mutex());
             for (const peer_connection_ptr& peer : _active_connections)
             {
-               if (!peer->ids_of_items_to_get.empty() &&
-                     peer->ids_of_items_to_get.front() == received_block_iter->block_id)
-               {
-                  potential_first_block = true;
-                  peer->ids_of_items_to_get.pop_front();
-                  peer->ids_of_items_being_processed.insert(received_block_iter->block_id);
-               }
+              if (peer->ids_of_items_to_get.empty())
+                continue;
+              auto iter = received_by_id.find(peer->ids_of_items_to_get.front());
+              if (iter != received_by_id.end() &&
+                  (received_block_iter == received_by_id.end() ||
+                   iter->block.block_num() < received_block_iter->block.block_num()))
+                received_block_iter = iter;
             }
+            if (received_block_iter != received_by_id.end())
+              for (const peer_connection_ptr& peer : _active_connections)
+              {
+                 if (!peer->ids_of_items_to_get.empty() &&
+                       peer->ids_of_items_to_get.front() == received_block_iter->block_id)
+                 {
+                    peer->ids_of_items_to_get.pop_front();
+                    peer->ids_of_items_being_processed.insert(received_block_iter->block_id);
+                 }
+              }
           }
 
-          // if it is, process it, remove it from all sync peers lists
-          if (potential_first_block)
+          // if there is one, process it, remove it from all sync peers lists
+          if (received_block_iter != received_by_id.end())
           {
             // we can get into an interesting situation near the end of synchronization.  We can be in
             // sync with one peer who is sending us the last block on the chain via a regular inventory
@@ -3195,7 +3359,7 @@ namespace graphene { namespace net { namespace detail {
                           received_block_iter->block_id) == _most_recent_blocks_accepted.end())
             {
               graphene::net::block_message block_message_to_process = *received_block_iter;
-              _received_sync_items.erase(received_block_iter);
+              received_by_id.erase(received_block_iter);
               _handle_message_calls_in_progress.emplace_back(fc::async([this, block_message_to_process](){
                 send_sync_block_to_node_delegate(block_message_to_process);
               }, "send_sync_block_to_node_delegate"));
@@ -3228,13 +3392,13 @@ namespace graphene { namespace net { namespace detail {
                   }
                 }
               }
+              received_by_id.erase(received_block_iter);
+              block_processed_this_iteration = true;
               for( const peer_connection_ptr& peer : peers_needing_next_batch )
                 fetch_next_batch_of_item_ids_from_peer(peer.get());
             }
-
-            break; // start iterating _received_sync_items from the beginning
-          } // end if potential_first_block
-        } // end for each block in _received_sync_items
+          } // end if there is a next block
+        }
 
         if (_handle_message_calls_in_progress.size() >= _max_blocks_to_handle_at_once)
         {
@@ -3269,9 +3433,9 @@ namespace graphene { namespace net { namespace detail {
       VERIFY_CORRECT_THREAD();
       dlog( "received a sync block from peer ${endpoint}", ("endpoint", originating_peer->get_remote_endpoint() ) );
 
-      // add it to the front of _received_sync_items, then process _received_sync_items to try to
+      // add it to _received_sync_items, then process _received_sync_items to try to
       // pass as many messages as possible to the client.
-      _new_received_sync_items.push_front( block_message_to_process );
+      _received_sync_items.insert( block_message_to_process );
       trigger_process_backlog_of_sync_blocks();
     }
 
@@ -3469,7 +3633,19 @@ namespace graphene { namespace net { namespace detail {
           // of the function so we can log if this ever happens.
           try
           {
-            originating_peer->last_sync_item_received_time = fc::time_point::now();
+            // measure how fast the peer sends us blocks, to decide how many to ask it for
+            const fc::time_point now = fc::time_point::now();
+            const int64_t interval_us = std::max<int64_t>(
+                  (now - originating_peer->last_sync_item_received_time).count(), 1000 );
+            const double blocks_per_second = 1000000.0 / interval_us;
+            constexpr double weight_of_new_sample = 0.1;
+            if (originating_peer->sync_blocks_per_second <= 0)
+              originating_peer->sync_blocks_per_second = blocks_per_second;
+            else
+              originating_peer->sync_blocks_per_second += weight_of_new_sample
+                    * (blocks_per_second - originating_peer->sync_blocks_per_second);
+            originating_peer->last_sync_item_received_time = now;
+
             _active_sync_requests.erase(block_message_to_process.block_id);
             process_block_during_syncing(originating_peer, block_message_to_process, message_hash);
             if (originating_peer->idle())
@@ -3482,6 +3658,10 @@ namespace graphene { namespace net { namespace detail {
               else
                 trigger_fetch_sync_items_loop();
             }
+            else if (originating_peer->sync_items_requested_from_peer.size()
+                     <= get_sync_request_window(*originating_peer) / 2)
+              // half of the window is free, ask for more before the peer runs out
+              trigger_fetch_sync_items_loop();
             return;
           }
           catch (const fc::canceled_exception& e)
@@ -3518,6 +3698,179 @@ namespace graphene { namespace net { namespace detail {
       disconnect_from_peer(originating_peer, "You sent me a block that I didn't ask for", true, detailed_error);
     }
 
+    void node_impl::on_compact_block_message(peer_connection* originating_peer,
+                                             const compact_block_message& compact_block_message_received)
+    {
+      VERIFY_CORRECT_THREAD();
+      const item_hash_t& block_message_hash = compact_block_message_received.block_message_hash;
+      // Gatekeeping code
+      if (originating_peer->items_requested_from_peer.find(item_id(block_message_type, block_message_hash))
+          == originating_peer->items_requested_from_peer.end())
+      {
+        wlog("received a compact block ${hash} I didn't ask for from peer ${endpoint}, disconnecting from peer",
+             ("hash", block_message_hash)("endpoint", originating_peer->get_remote_endpoint()));
+        disconnect_from_peer(originating_peer, "You sent me a compact block that I didn't ask for");
+        return;
+      }
+      const std::vector<transaction_id_type>& transaction_ids = compact_block_message_received.transaction_ids;
+      if (compact_block_message_received.operation_results.size() != transaction_ids.size())
+      {
+        wlog("received an invalid compact block ${hash} from peer ${endpoint}, disconnecting from peer",
+             ("hash", block_message_hash)("endpoint", originating_peer->get_remote_endpoint()));
+        disconnect_from_peer(originating_peer, "You sent me an invalid compact block");
+        return;
+      }
+
+      // rebuild the block from the transactions we have relayed recently
+      signed_block rebuilt_block;
+      static_cast<graphene::protocol::signed_block_header&>(rebuilt_block) = compact_block_message_received.header;
+      rebuilt_block.transactions.resize(transaction_ids.size());
+      std::vector<uint32_t> missing_transactions;
+      for (uint32_t i = 0; i < transaction_ids.size(); ++i)
+      {
+        std::shared_ptr<const message> cached_message = _message_cache.find_message_by_contents(transaction_ids[i]);
+        if (cached_message && cached_message->msg_type.value() == trx_message_type)
+          rebuilt_block.transactions[i] = graphene::protocol::processed_transaction(
+                                                cached_message->as<trx_message>().trx);
+        else
+          missing_transactions.push_back(i);
+        rebuilt_block.transactions[i].operation_results = compact_block_message_received.operation_results[i];
+      }
+      dlog("received compact block ${hash} from peer ${endpoint}, ${missing} of ${count} transactions missing",
+           ("hash", block_message_hash)("endpoint", originating_peer->get_remote_endpoint())
+           ("missing", missing_transactions.size())("count", transaction_ids.size()));
+
+      if (missing_transactions.empty())
+      {
+        process_rebuilt_compact_block(originating_peer, block_message_hash, std::move(rebuilt_block), false);
+        return;
+      }
+      originating_peer->send_message(fetch_block_transactions_message(block_message_hash,
+                                                                      compact_block_message_received.header.id(),
+                                                                      missing_transactions));
+      auto& in_progress = originating_peer->compact_blocks_in_progress[block_message_hash];
+      in_progress.block = std::move(rebuilt_block);
+      in_progress.missing_transactions = std::move(missing_transactions);
+    }
+
+    void node_impl::on_fetch_block_transactions_message(peer_connection* originating_peer,
+                                                        const fetch_block_transactions_message& fetch_message_received)
+    {
+      VERIFY_CORRECT_THREAD();
+      // Gatekeeping code
+      if( originating_peer->their_state != peer_connection::their_connection_state::connection_accepted )
+      {
+         wlog( "Unexpected fetch_block_transactions_message from peer ${peer}, disconnecting",
+               ("peer", originating_peer->get_remote_endpoint()) );
+         disconnect_from_peer( originating_peer, "Received an unexpected fetch_block_transactions_message" );
+         return;
+      }
+
+      const item_id requested_item(block_message_type, fetch_message_received.block_message_hash);
+      std::shared_ptr<const message> full_block_message
+            = _message_cache.find_message(fetch_message_received.block_message_hash);
+      if (!full_block_message)
+      {
+        try
+        {
+          full_block_message = std::make_shared<const message>(
+                _delegate->get_item(item_id(block_message_type, fetch_message_received.block_id)));
+        }
+        catch (fc::key_not_found_exception&)
+        {
+        }
+      }
+      if (!full_block_message || full_block_message->msg_type.value() != block_message_type)
+      {
+        dlog("received a request for transactions of block ${id} from peer ${endpoint} but we don't have it",
+             ("id", fetch_message_received.block_id)("endpoint", originating_peer->get_remote_endpoint()));
+        originating_peer->send_message(item_not_available_message(requested_item));
+        return;
+      }
+
+      const signed_block full_block = full_block_message->as<graphene::net::block_message>().block;
+      block_transactions_message reply(fetch_message_received.block_message_hash);
+      reply.transactions.reserve(fetch_message_received.transaction_indexes.size());
+      for (uint32_t index : fetch_message_received.transaction_indexes)
+      {
+        if (index >= full_block.transactions.size())
+        {
+          wlog("peer ${endpoint} requested transaction ${index} of a block with ${count} transactions, disconnecting",
+               ("endpoint", originating_peer->get_remote_endpoint())
+               ("index", index)("count", full_block.transactions.size()));
+          disconnect_from_peer(originating_peer, "You requested a transaction that is not in the block");
+          return;
+        }
+        reply.transactions.push_back(full_block.transactions[index]);
+      }
+      originating_peer->send_message(reply);
+    }
+
+    void node_impl::on_block_transactions_message(peer_connection* originating_peer,
+                                                  const block_transactions_message& block_transactions_message_received)
+    {
+      VERIFY_CORRECT_THREAD();
+      const item_hash_t& block_message_hash = block_transactions_message_received.block_message_hash;
+      auto iter = originating_peer->compact_blocks_in_progress.find(block_message_hash);
+      // Gatekeeping code
+      if (iter == originating_peer->compact_blocks_in_progress.end())
+      {
+        wlog("received transactions of block ${hash} I didn't ask for from peer ${endpoint}, disconnecting from peer",
+             ("hash", block_message_hash)("endpoint", originating_peer->get_remote_endpoint()));
+        disconnect_from_peer(originating_peer, "You sent me transactions that I didn't ask for");
+        return;
+      }
+      peer_connection::compact_block_in_progress in_progress = std::move(iter->second);
+      originating_peer->compact_blocks_in_progress.erase(iter);
+
+      const std::vector<signed_transaction>& transactions = block_transactions_message_received.transactions;
+      if (transactions.size() != in_progress.missing_transactions.size())
+      {
+        wlog("peer ${endpoint} sent me ${count} of the ${missing} missing transactions of block ${hash}, "
+             "fetching the full block",
+             ("endpoint", originating_peer->get_remote_endpoint())("count", transactions.size())
+             ("missing", in_progress.missing_transactions.size())("hash", block_message_hash));
+        ++_compact_blocks_fetched_in_full;
+        originating_peer->send_message(fetch_items_message(block_message_type, { block_message_hash }));
+        return;
+      }
+      for (size_t i = 0; i < transactions.size(); ++i)
+      {
+        auto& rebuilt_trx = in_progress.block.transactions[in_progress.missing_transactions[i]];
+        graphene::protocol::processed_transaction received_trx(transactions[i]);
+        received_trx.operation_results = std::move(rebuilt_trx.operation_results);
+        rebuilt_trx = std::move(received_trx);
+      }
+      process_rebuilt_compact_block(originating_peer, block_message_hash, std::move(in_progress.block), true);
+    }
+
+    void node_impl::process_rebuilt_compact_block(peer_connection* originating_peer,
+                                                  const item_hash_t& block_message_hash,
+                                                  signed_block&& rebuilt_block,
+                                                  bool transactions_fetched)
+    {
+      VERIFY_CORRECT_THREAD();
+      graphene::net::block_message rebuilt_block_message;
+      rebuilt_block_message.block = std::move(rebuilt_block);
+      rebuilt_block_message.block_id = rebuilt_block_message.block.id();
+      message message_to_process(rebuilt_block_message);
+      // transaction ids don't cover signatures, so a transaction we relayed can differ from the one in the block.
+      // Only a block that is identical to what the peer announced can stand for it, otherwise fetch the block itself.
+      if (message_to_process.id() != block_message_hash)
+      {
+        dlog("compact block ${hash} from peer ${endpoint} did not rebuild to the announced block, fetching it in full",
+             ("hash", block_message_hash)("endpoint", originating_peer->get_remote_endpoint()));
+        ++_compact_blocks_fetched_in_full;
+        originating_peer->send_message(fetch_items_message(block_message_type, { block_message_hash }));
+        return;
+      }
+      if (transactions_fetched)
+        ++_compact_blocks_transactions_fetched;
+      else
+        ++_compact_blocks_rebuilt;
+      process_block_message(originating_peer, message_to_process, block_message_hash);
+    }
+
     void node_impl::on_current_time_request_message(peer_connection* originating_peer,
                                                     const current_time_request_message& current_time_request_message_received)
     {
@@ -3584,7 +3937,7 @@ namespace graphene { namespace net { namespace detail {
             trx_message transaction_message_to_process = message_to_process.as<trx_message>();
             dlog( "passing message containing transaction ${trx} to client",
                   ("trx", transaction_message_to_process.trx.id()) );
-            _delegate->handle_transaction(transaction_message_to_process);
+            _delegate->handle_transaction(transaction_message_to_process, message_hash);
           }
           else
             _delegate->handle_message( message_to_process );
@@ -3596,6 +3949,23 @@ namespace graphene { namespace net { namespace detail {
         }
         catch ( const fc::exception& e )
         {
+          if( e.code() == transaction_queue_full_exception::code_enum::code_value )
+          {
+            // the client is busy, nothing is wrong with the transaction: back off from this peer a little and
+            // fetch the transaction again later, from whichever peer has it
+            dlog( "client is too busy to take the transaction sent by peer ${peer}, will fetch it again",
+                  ("peer", originating_peer->get_remote_endpoint()) );
+            originating_peer->transaction_fetching_inhibited_until =
+                  fc::time_point::now() + fc::milliseconds(GRAPHENE_NET_TRANSACTION_BACKPRESSURE_DELAY_MS);
+            item_id busy_item( message_to_process.msg_type.value(), message_hash );
+            if( is_item_in_any_peers_inventory( busy_item ) )
+            {
+              _items_to_fetch.insert( prioritized_item_id( busy_item, _items_to_fetch_seq_counter ) );
+              ++_items_to_fetch_seq_counter;
+              trigger_fetch_items_loop();
+            }
+            return;
+          }
           switch( e.code() )
           {
           // log common exceptions in debug level
@@ -4632,17 +5002,25 @@ namespace graphene { namespace net { namespace detail {
       ilog( "--------- MEMORY USAGE ------------" );
       ilog( "node._active_sync_requests size: ${size}", ("size", _active_sync_requests.size() ) );
       ilog( "node._received_sync_items size: ${size}", ("size", _received_sync_items.size() ) );
-      ilog( "node._new_received_sync_items size: ${size}", ("size", _new_received_sync_items.size() ) );
       ilog( "node._items_to_fetch size: ${size}", ("size", _items_to_fetch.size() ) );
       ilog( "node._new_inventory size: ${size}", ("size", _new_inventory.size() ) );
-      ilog( "node._message_cache size: ${size}", ("size", _message_cache.size() ) );
+      ilog( "node._recently_advertised_inventory size: ${size}, ${filtered} items filtered from advertisements, "
+            "about ${false_positives} wrongly",
+            ("size", _recently_advertised_inventory.size())("filtered", _inventory_items_filtered)
+            ("false_positives", uint64_t(_inventory_filter_expected_false_positives)) );
+      ilog( "node._message_cache size: ${size}, ${bytes} bytes, ${hits} hits, ${misses} misses",
+            ("size", _message_cache.size())("bytes", _message_cache.memory_used())
+            ("hits", _message_cache.hits())("misses", _message_cache.misses()) );
       fc::scoped_lock<fc::mutex> lock(_active_connections.get_mutex());
       for( const peer_connection_ptr& peer : _active_connections )
       {
         ilog( "  peer ${endpoint}", ("endpoint", peer->get_remote_endpoint() ) );
         ilog( "    peer.ids_of_items_to_get size: ${size}", ("size", peer->ids_of_items_to_get.size() ) );
         ilog( "    peer.inventory_peer_advertised_to_us size: ${size}", ("size", peer->inventory_peer_advertised_to_us.size() ) );
-        ilog( "    peer.inventory_advertised_to_peer size: ${size}", ("size", peer->inventory_advertised_to_peer.size() ) );
+        ilog( "    peer.inventory_advertised_to_peer size: ${size}, ${bytes} bytes, ${rate} false positive rate",
+              ("size", peer->inventory_advertised_to_peer.size())
+              ("bytes", peer->inventory_advertised_to_peer.memory_used())
+              ("rate", peer->inventory_advertised_to_peer.false_positive_rate()) );
         ilog( "    peer.items_requested_from_peer size: ${size}", ("size", peer->items_requested_from_peer.size() ) );
         ilog( "    peer.sync_items_requested_from_peer size: ${size}", ("size", peer->sync_items_requested_from_peer.size() ) );
       }
@@ -4810,6 +5188,20 @@ namespace graphene { namespace net { namespace detail {
         peer_details["peer_needs_sync_items_from_us"] = peer->peer_needs_sync_items_from_us;
         peer_details["we_need_sync_items_from_peer"] = peer->we_need_sync_items_from_peer;
 
+        fc::mutable_variant_object send_queues;
+        for( size_t i = 0; i < size_t(peer_connection::send_class::count); ++i )
+        {
+          const auto message_class = peer_connection::send_class(i);
+          const peer_connection::send_queue_stats stats = peer->get_send_queue_stats(message_class);
+          send_queues[fc::variant( message_class, 1 ).as_string()] = fc::mutable_variant_object()
+                ( "queued_messages", stats.queued_messages )
+                ( "queued_bytes", stats.queued_bytes )
+                ( "sent_messages", stats.sent_messages )
+                ( "dropped_messages", stats.dropped_messages )
+                ( "average_latency_us", stats.average_latency.count() );
+        }
+        peer_details["send_queues"] = send_queues;
+
         this_peer_status.info = peer_details;
         statuses.push_back(this_peer_status);
       }
@@ -4981,6 +5373,15 @@ namespace graphene { namespace net { namespace detail {
       info["listening_on"] = std::string( _actual_listening_endpoint );
       info["node_public_key"] = fc::variant( _node_public_key, 1 );
       info["node_id"] = fc::variant( _node_id, 1 );
+      info["message_cache_size"] = _message_cache.size();
+      info["message_cache_bytes"] = _message_cache.memory_used();
+      info["message_cache_hits"] = _message_cache.hits();
+      info["message_cache_misses"] = _message_cache.misses();
+      info["inventory_items_filtered"] = _inventory_items_filtered;
+      info["inventory_filter_expected_false_positives"] = uint64_t(_inventory_filter_expected_false_positives);
+      info["compact_blocks_rebuilt"] = _compact_blocks_rebuilt;
+      info["compact_blocks_transactions_fetched"] = _compact_blocks_transactions_fetched;
+      info["compact_blocks_fetched_in_full"] = _compact_blocks_fetched_in_full;
       return info;
     }
     fc::variant_object node_impl::network_get_usage_stats() const
@@ -5318,9 +5719,10 @@ namespace graphene { namespace net { namespace detail {
       INVOKE_AND_COLLECT_STATISTICS(handle_block, block_message, sync_mode, contained_transaction_msg_ids);
     }
 
-    void statistics_gathering_node_delegate_wrapper::handle_transaction( const graphene::net::trx_message& transaction_message )
+    void statistics_gathering_node_delegate_wrapper::handle_transaction( const graphene::net::trx_message& transaction_message,
+                                                                         const message_hash_type& transaction_message_id )
     {
-      INVOKE_AND_COLLECT_STATISTICS(handle_transaction, transaction_message);
+      INVOKE_AND_COLLECT_STATISTICS(handle_transaction, transaction_message, transaction_message_id);
     }
 
     std::vector<item_hash_t> statistics_gathering_node_delegate_wrapper::get_block_ids(const std::vector<item_hash_t>& blockchain_synopsis,
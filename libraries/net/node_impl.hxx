@@ -16,7 +16,11 @@
 #define testnetlog(...) do {} while (0)
 #endif
 
+#include <array>
+#include <atomic>
+#include <deque>
 #include <memory>
+#include <mutex>
 #include <boost/accumulators/accumulators.hpp>
 #include <boost/accumulators/statistics.hpp>
 #include <boost/accumulators/statistics/rolling_mean.hpp>
@@ -153,51 +157,63 @@ public:
    }
 };
 
+/**
+ * Messages we have broadcast, so that peers can fetch them from us, kept for the last few blocks.
+ *
+ * Messages are stored behind shared immutable buffers and indexed by hash, in shards that each have their own
+ * lock.  The messages cached while a block was current are kept in one bucket, so that expiring them when
+ * blocks are accepted costs no lookups.
+ */
 class blockchain_tied_message_cache
 {
 private:
    static const uint32_t cache_duration_in_blocks = GRAPHENE_NET_MESSAGE_CACHE_DURATION_IN_BLOCKS;
+   static constexpr size_t shard_count = 8;
 
    struct message_hash_index{};
    struct message_contents_hash_index{};
-   struct block_clock_index{};
    struct message_info
    {
-      message_hash_type message_hash;
-      message           message_body;
-      uint32_t          block_clock_when_received;
+      message_hash_type               message_hash;
+      std::shared_ptr<const message>  message_body;
 
       /// for network performance stats
       message_propagation_data propagation_data;
       /// hash of whatever the message contains
       /// (if it's a transaction, this is the transaction id, if it's a block, it's the block_id)
       message_hash_type message_contents_hash;
-
-      message_info( const message_hash_type& message_hash,
-                    const message&           message_body,
-                    uint32_t                 block_clock_when_received,
-                    const message_propagation_data& propagation_data,
-                    message_hash_type        message_contents_hash ) :
-            message_hash( message_hash ),
-            message_body( message_body ),
-            block_clock_when_received( block_clock_when_received ),
-            propagation_data( propagation_data ),
-            message_contents_hash( message_contents_hash )
-      {}
    };
 
    using message_cache_container = boost::multi_index_container < message_info,
                bmi::indexed_by<
-                  bmi::ordered_unique< bmi::tag<message_hash_index>,
-                     bmi::member<message_info, message_hash_type, &message_info::message_hash> >,
-                  bmi::ordered_non_unique< bmi::tag<message_contents_hash_index>,
-                     bmi::member<message_info, message_hash_type, &message_info::message_contents_hash> >,
-                  bmi::ordered_non_unique< bmi::tag<block_clock_index>,
-                     bmi::member<message_info, uint32_t, &message_info::block_clock_when_received> > > >;
+                  bmi::hashed_unique< bmi::tag<message_hash_index>,
+                     bmi::member<message_info, message_hash_type, &message_info::message_hash>,
+                     std::hash<message_hash_type> >,
+                  bmi::hashed_non_unique< bmi::tag<message_contents_hash_index>,
+                     bmi::member<message_info, message_hash_type, &message_info::message_contents_hash>,
+                     std::hash<message_hash_type> > > >;
+
+   struct shard
+   {
+      mutable std::mutex      mutex;
+      message_cache_container messages;
+      /// hashes of the messages cached while each of the last blocks was current, oldest first
+      std::deque< std::vector<message_hash_type> > buckets;
+      size_t                  memory_used = 0;
+
+      shard() : buckets( 1 ) {}
+   };
+
+   std::array<shard, shard_count> _shards;
 
-   message_cache_container _message_cache;
+   mutable std::atomic<uint64_t> _hits { 0 };
+   mutable std::atomic<uint64_t> _misses { 0 };
 
-   uint32_t block_clock = 0;
+   shard& shard_for( const message_hash_type& hash ) { return _shards[ hash._hash[1] % shard_count ]; }
+   const shard& shard_for( const message_hash_type& hash ) const { return _shards[ hash._hash[1] % shard_count ]; }
+   /// @return the entry with the given contents hash, with the lock of its shard held by @p lock
+   const message_info* find_by_contents( const message_hash_type& hash_of_msg_contents_to_lookup,
+                                         std::unique_lock<std::mutex>& lock ) const;
 
 public:
    void block_accepted();
@@ -205,10 +221,20 @@ public:
                        const message_hash_type& hash_of_message_to_cache,
                        const message_propagation_data& propagation_data,
                        const message_hash_type& message_content_hash );
+   /// @return the cached message, or nullptr
+   std::shared_ptr<const message> find_message( const message_hash_type& hash_of_message_to_lookup ) const;
    message get_message( const message_hash_type& hash_of_message_to_lookup ) const;
+   /// @return a cached message by the hash of what it contains, e.g. a trx_message by transaction id
+   std::shared_ptr<const message> find_message_by_contents(
+         const message_hash_type& hash_of_msg_contents_to_lookup ) const;
    message_propagation_data get_message_propagation_data(
          const message_hash_type& hash_of_msg_contents_to_lookup ) const;
-   size_t size() const { return _message_cache.size(); }
+
+   size_t size() const;
+   /// @return the bytes taken by the cached messages
+   size_t memory_used() const;
+   uint64_t hits() const { return _hits; }
+   uint64_t misses() const { return _misses; }
 };
 
 /// When requesting items from peers, we want to prioritize any blocks before
@@ -348,7 +374,8 @@ class statistics_gathering_node_delegate_wrapper : public node_delegate
       void handle_message( const message& ) override;
       bool handle_block( const graphene::net::block_message& block_message, bool sync_mode,
                          std::vector<message_hash_type>& contained_transaction_msg_ids ) override;
-      void handle_transaction( const graphene::net::trx_message& transaction_message ) override;
+      void handle_transaction( const graphene::net::trx_message& transaction_message,
+                               const message_hash_type& transaction_message_id ) override;
       std::vector<item_hash_t> get_block_ids(const std::vector<item_hash_t>& blockchain_synopsis,
                                              uint32_t& remaining_item_count,
                                              uint32_t limit = 2000) override;
@@ -436,11 +463,23 @@ public:
 
       /// List of sync blocks we've asked for from peers but have not yet received
       active_sync_requests_map              _active_sync_requests;
-      /// List of sync blocks we've just received but haven't yet tried to process
-      std::list<graphene::net::block_message> _new_received_sync_items;
-      /// List of sync blocks we've received, but can't yet process because we are still missing blocks
-      /// that come earlier in the chain
-      std::list<graphene::net::block_message> _received_sync_items;
+
+      struct sync_block_id_index{};
+      struct sync_block_num_index{};
+      struct sync_block_num
+      {
+        using result_type = uint32_t;
+        uint32_t operator()(const graphene::net::block_message& m) const { return m.block.block_num(); }
+      };
+      using received_sync_items_type = boost::multi_index_container< graphene::net::block_message,
+         bmi::indexed_by<
+            bmi::hashed_unique< bmi::tag<sync_block_id_index>,
+               bmi::member<graphene::net::block_message, block_id_type, &graphene::net::block_message::block_id>,
+               std::hash<block_id_type> >,
+            bmi::ordered_non_unique< bmi::tag<sync_block_num_index>, sync_block_num > > >;
+      /// Sync blocks we've received, but can't yet process because we are still missing blocks
+      /// that come earlier in the chain, by id and by block number
+      received_sync_items_type              _received_sync_items;
       /// @}
 
       fc::future<void> _process_backlog_of_sync_blocks_done;
@@ -477,6 +516,12 @@ public:
       fc::future<void>              _advertise_inventory_loop_done;
       /// List of items we have received but not yet advertised to our peers
       concurrent_unordered_set<item_id>   _new_inventory;
+      /// Items we advertised to a peer in the last GRAPHENE_NET_MAX_INVENTORY_SIZE_IN_MINUTES, so we have them
+      peer_connection::timestamped_items_set_type _recently_advertised_inventory;
+      /// Number of times we didn't advertise an item to a peer because its inventory_filter said we already had
+      uint64_t _inventory_items_filtered = 0;
+      /// How many of these were expected to be false positives of the filter
+      double _inventory_filter_expected_false_positives = 0;
       /// @}
 
       fc::future<void>     _kill_inactive_conns_loop_done;
@@ -536,6 +581,16 @@ public:
       /// Cache message we have received and might be required to provide to other peers via inventory requests
       blockchain_tied_message_cache _message_cache;
 
+      /// Compact blocks received from peers, by how they were completed
+      /// @{
+      /// Rebuilt from the transactions in _message_cache alone
+      uint64_t _compact_blocks_rebuilt = 0;
+      /// Rebuilt after fetching the missing transactions with a fetch_block_transactions_message
+      uint64_t _compact_blocks_transactions_fetched = 0;
+      /// Not rebuilt to the announced block, fetched in full instead
+      uint64_t _compact_blocks_fetched_in_full = 0;
+      /// @}
+
       fc::rate_limiting_group _rate_limiter { 0, 0 };
 
       /// Number of connections last reported to the client (to avoid sending duplicate messages)
@@ -623,6 +678,8 @@ public:
       bool have_already_received_sync_item( const item_hash_t& item_hash );
       void request_sync_item_from_peer( const peer_connection_ptr& peer, const item_hash_t& item_to_request );
       void request_sync_items_from_peer( const peer_connection_ptr& peer, const std::vector<item_hash_t>& items_to_request );
+      /// @return how many sync blocks we may have requested from the peer at once
+      size_t get_sync_request_window( const peer_connection& peer ) const;
       void fetch_sync_items_loop();
       void trigger_fetch_sync_items_loop();
 
@@ -718,6 +775,18 @@ public:
                   const message& message_to_process,
                   const message_hash_type& message_hash);
 
+      void on_compact_block_message( peer_connection* originating_peer,
+                                     const compact_block_message& compact_block_message_received );
+      void on_fetch_block_transactions_message( peer_connection* originating_peer,
+                                                const fetch_block_transactions_message& fetch_message_received );
+      void on_block_transactions_message( peer_connection* originating_peer,
+                                          const block_transactions_message& block_transactions_message_received );
+      /// Checks a block rebuilt from a compact_block_message and processes it, or fetches the full block instead
+      void process_rebuilt_compact_block( peer_connection* originating_peer,
+                                          const item_hash_t& block_message_hash,
+                                          signed_block&& rebuilt_block,
+                                          bool transactions_fetched );
+
       void start_synchronizing();
       void start_synchronizing_with_peer(const peer_connection_ptr& peer);
 
@@ -798,7 +867,7 @@ public:
       void                       set_total_bandwidth_limit( uint32_t upload_bytes_per_second,
                                                             uint32_t download_bytes_per_second );
       fc::variant_object         get_call_statistics() const;
-      graphene::net::message     get_message_for_item(const item_id& item) override;
+      std::shared_ptr<const message> get_message_for_item(const item_id& item) override;
 
       fc::variant_object         network_get_info() const;
       fc::variant_object         network_get_usage_stats() const;
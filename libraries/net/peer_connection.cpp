@@ -21,24 +21,40 @@
 
 namespace graphene { namespace net
   {
-    message peer_connection::real_queued_message::get_message(peer_connection_delegate*)
+    std::shared_ptr<const message> peer_connection::real_queued_message::get_message(peer_connection_delegate*)
     {
       if (message_send_time_field_offset != (size_t)-1)
       {
         // patch the current time into the message.  Since this operates on the packed version of the structure,
         // it won't work for anything after a variable-length field
         std::vector<char> packed_current_time = fc::raw::pack(fc::time_point::now());
-        assert(message_send_time_field_offset + packed_current_time.size() <= message_to_send.data.size());
-        memcpy(message_to_send.data.data() + message_send_time_field_offset,
+        assert(message_send_time_field_offset + packed_current_time.size() <= message_to_send->data.size());
+        memcpy(message_to_send->data.data() + message_send_time_field_offset,
                packed_current_time.data(), packed_current_time.size());
       }
       return message_to_send;
     }
     size_t peer_connection::real_queued_message::get_size_in_queue()
     {
-      return message_to_send.data.size();
+      return message_to_send->data.size();
     }
-    message peer_connection::virtual_queued_message::get_message(peer_connection_delegate* node)
+    item_id peer_connection::real_queued_message::get_item_id()
+    {
+      return item_id(message_to_send->msg_type.value(), message_to_send->id());
+    }
+    std::shared_ptr<const message> peer_connection::shared_queued_message::get_message(peer_connection_delegate*)
+    {
+      return message_to_send;
+    }
+    size_t peer_connection::shared_queued_message::get_size_in_queue()
+    {
+      return message_to_send->data.size();
+    }
+    item_id peer_connection::shared_queued_message::get_item_id()
+    {
+      return item_id(message_to_send->msg_type.value(), message_to_send->id());
+    }
+    std::shared_ptr<const message> peer_connection::virtual_queued_message::get_message(peer_connection_delegate* node)
     {
       return node->get_message_for_item(item_to_send);
     }
@@ -47,6 +63,10 @@ namespace graphene { namespace net
     {
       return sizeof(item_id);
     }
+    item_id peer_connection::virtual_queued_message::get_item_id()
+    {
+      return item_to_send;
+    }
 
     peer_connection::peer_connection(peer_connection_delegate* delegate) :
       _node(delegate),
@@ -62,6 +82,10 @@ namespace graphene { namespace net
       peer_needs_sync_items_from_us(true),
       we_need_sync_items_from_peer(true),
       inhibit_fetching_sync_blocks(false),
+      inventory_advertised_to_peer(GRAPHENE_NET_MAX_INVENTORY_SIZE_IN_MINUTES * 30 *
+                                   (GRAPHENE_NET_MAX_TRX_PER_SECOND + 1),
+                                   fc::seconds(GRAPHENE_NET_MAX_INVENTORY_SIZE_IN_MINUTES * 30),
+                                   GRAPHENE_NET_INVENTORY_FILTER_FALSE_POSITIVE_RATE),
       transaction_fetching_inhibited_until(fc::time_point::min()),
       last_known_fork_block_number(0),
 #ifndef NDEBUG
@@ -308,27 +332,62 @@ namespace graphene { namespace net
         ~counter() { assert(_send_message_queue_tasks_counter == 1); --_send_message_queue_tasks_counter; /* dlog("leaving peer_connection::send_queued_messages_task()"); */ }
       } concurrent_invocation_counter(_send_message_queue_tasks_running);
 #endif
-      while (!_queued_messages.empty())
+      std::vector<std::unique_ptr<queued_message>> batch_items;
+      std::vector<std::shared_ptr<const message>> batch;
+      send_queue* queue = nullptr;
+      while ((queue = next_send_queue()) != nullptr)
       {
-        _queued_messages.front()->transmission_start_time = fc::time_point::now();
-        message message_to_send = _queued_messages.front()->get_message(_node);
+        // take as many queued messages as fit in one write, at least one, picking each from the queue
+        // whose turn it is
+        size_t batch_size = 0;
+        batch_items.clear();
+        batch.clear();
+        while (queue != nullptr &&
+               (batch.empty() || batch_size + queue->messages.front()->get_size_in_queue()
+                                    <= GRAPHENE_NET_MESSAGE_BUFFER_SIZE))
+        {
+          std::unique_ptr<queued_message> next = std::move(queue->messages.front());
+          queue->messages.pop_front();
+          const size_t size_in_queue = next->get_size_in_queue();
+          queue->stats.queued_bytes -= size_in_queue;
+          next->transmission_start_time = fc::time_point::now();
+          try
+          {
+            batch.emplace_back(next->get_message(_node));
+          }
+          catch (...)
+          {
+            // the messages taken off the queue are lost
+            _total_queued_messages_size -= batch_size + size_in_queue;
+            throw;
+          }
+          batch_size += size_in_queue;
+          // charge what is actually sent, a virtual message is only an id while it is queued
+          if (next->message_class != send_class::block)
+            queue->deficit -= batch.back()->size;
+          batch_items.emplace_back(std::move(next));
+          queue = next_send_queue();
+        }
+
         try
         {
-          //dlog("peer_connection::send_queued_messages_task() calling message_oriented_connection::send_message() "
-          //     "to send message of type ${type} for peer ${endpoint}",
-          //     ("type", message_to_send.msg_type)("endpoint", get_remote_endpoint()));
-          _message_connection.send_message(message_to_send);
-          //dlog("peer_connection::send_queued_messages_task()'s call to message_oriented_connection::send_message() completed normally for peer ${endpoint}",
+          //dlog("peer_connection::send_queued_messages_task() calling message_oriented_connection::send_messages() "
+          //     "to send ${count} messages for peer ${endpoint}",
+          //     ("count", batch.size())("endpoint", get_remote_endpoint()));
+          _message_connection.send_messages(batch);
+          //dlog("peer_connection::send_queued_messages_task()'s call to message_oriented_connection::send_messages() completed normally for peer ${endpoint}",
           //     ("endpoint", get_remote_endpoint()));
         }
         catch (const fc::canceled_exception&)
         {
-          dlog("message_oriented_connection::send_message() was canceled, rethrowing canceled_exception");
+          dlog("message_oriented_connection::send_messages() was canceled, rethrowing canceled_exception");
+          _total_queued_messages_size -= batch_size;
           throw;
         }
         catch (const fc::exception& send_error)
         {
           wlog("Error sending message: ${exception}.  Closing connection.", ("exception", send_error));
+          _total_queued_messages_size -= batch_size;
           try
           {
             close_connection();
@@ -341,24 +400,142 @@ namespace graphene { namespace net
         }
         catch (const std::exception& e)
         {
-          wlog("message_oriented_exception::send_message() threw a std::exception(): ${what}", ("what", e.what()));
+          wlog("message_oriented_exception::send_messages() threw a std::exception(): ${what}", ("what", e.what()));
         }
         catch (...)
         {
-          wlog("message_oriented_exception::send_message() threw an unhandled exception");
+          wlog("message_oriented_exception::send_messages() threw an unhandled exception");
         }
-        _queued_messages.front()->transmission_finish_time = fc::time_point::now();
-        _total_queued_messages_size -= _queued_messages.front()->get_size_in_queue();
-        _queued_messages.pop();
+        const fc::time_point finish_time = fc::time_point::now();
+        for (const auto& item : batch_items)
+        {
+          item->transmission_finish_time = finish_time;
+          send_queue_stats& stats = _send_queues[size_t(item->message_class)].stats;
+          const fc::microseconds latency = finish_time - item->enqueue_time;
+          if (stats.sent_messages == 0)
+            stats.average_latency = latency;
+          else
+            stats.average_latency = fc::microseconds((stats.average_latency.count() * 7 + latency.count()) / 8);
+          ++stats.sent_messages;
+        }
+        _total_queued_messages_size -= batch_size;
       }
       //dlog("leaving peer_connection::send_queued_messages_task() due to queue exhaustion");
     }
 
+    peer_connection::send_class peer_connection::classify_message(uint32_t message_type) const
+    {
+      switch (message_type)
+      {
+      case block_message_type:
+      case compact_block_message_type:
+      case block_transactions_message_type:
+        return peer_needs_sync_items_from_us ? send_class::sync : send_class::block;
+      case blockchain_item_ids_inventory_message_type:
+        return send_class::sync;
+      case trx_message_type:
+        return send_class::transaction;
+      default:
+        return send_class::control;
+      }
+    }
+
+    void peer_connection::enqueue_message(std::unique_ptr<queued_message>&& message_to_send)
+    {
+      send_queue& queue = _send_queues[size_t(message_to_send->message_class)];
+      const size_t size = message_to_send->get_size_in_queue();
+      _total_queued_messages_size += size;
+      queue.stats.queued_bytes += size;
+      queue.messages.emplace_back(std::move(message_to_send));
+    }
+
+    void peer_connection::drop_queued_transaction()
+    {
+      send_queue& queue = _send_queues[size_t(send_class::transaction)];
+      std::unique_ptr<queued_message> dropped = std::move(queue.messages.front());
+      queue.messages.pop_front();
+      const size_t size = dropped->get_size_in_queue();
+      _total_queued_messages_size -= size;
+      queue.stats.queued_bytes -= size;
+      ++queue.stats.dropped_messages;
+      // the peer asked for it, tell it to ask someone else
+      auto not_available = std::make_unique<real_queued_message>(item_not_available_message(dropped->get_item_id()));
+      not_available->message_class = send_class::control;
+      enqueue_message(std::move(not_available));
+    }
+
+    void peer_connection::drop_stale_transactions()
+    {
+      send_queue& queue = _send_queues[size_t(send_class::transaction)];
+      const fc::time_point deadline = fc::time_point::now() - fc::seconds(GRAPHENE_NET_TRANSACTION_SEND_DEADLINE_SECONDS);
+      while (!queue.messages.empty() && queue.messages.front()->enqueue_time < deadline)
+        drop_queued_transaction();
+    }
+
+    peer_connection::send_queue* peer_connection::next_send_queue()
+    {
+      drop_stale_transactions();
+
+      send_queue& blocks = _send_queues[size_t(send_class::block)];
+      if (!blocks.messages.empty())
+        return &blocks;
+
+      // deficit round robin over the other classes: each one sends while it has bytes left in its turn,
+      // when none has, they all get another quantum
+      static const std::array<std::pair<send_class, int64_t>, 3> quanta = {{
+        { send_class::control,     GRAPHENE_NET_SEND_QUANTUM_CONTROL_BYTES },
+        { send_class::transaction, GRAPHENE_NET_SEND_QUANTUM_TRANSACTION_BYTES },
+        { send_class::sync,        GRAPHENE_NET_SEND_QUANTUM_SYNC_BYTES } }};
+      bool any_queued = false;
+      for (const auto& class_and_quantum : quanta)
+      {
+        send_queue& queue = _send_queues[size_t(class_and_quantum.first)];
+        if (queue.messages.empty())
+          queue.deficit = 0; // an idle class doesn't save up its turns
+        else
+          any_queued = true;
+      }
+      if (!any_queued)
+        return nullptr;
+
+      while (true)
+      {
+        for (const auto& class_and_quantum : quanta)
+        {
+          send_queue& queue = _send_queues[size_t(class_and_quantum.first)];
+          if (!queue.messages.empty() && queue.deficit > 0)
+            return &queue;
+        }
+        for (const auto& class_and_quantum : quanta)
+        {
+          send_queue& queue = _send_queues[size_t(class_and_quantum.first)];
+          if (!queue.messages.empty())
+            queue.deficit += class_and_quantum.second;
+        }
+      }
+    }
+
+    peer_connection::send_queue_stats peer_connection::get_send_queue_stats(send_class message_class) const
+    {
+      VERIFY_CORRECT_THREAD();
+      send_queue_stats stats = _send_queues[size_t(message_class)].stats;
+      stats.queued_messages = _send_queues[size_t(message_class)].messages.size();
+      return stats;
+    }
+
     void peer_connection::send_queueable_message(std::unique_ptr<queued_message>&& message_to_send)
     {
       VERIFY_CORRECT_THREAD();
-      _total_queued_messages_size += message_to_send->get_size_in_queue();
-      _queued_messages.emplace(std::move(message_to_send));
+      const bool is_transaction = message_to_send->message_class == send_class::transaction;
+      enqueue_message(std::move(message_to_send));
+      if (is_transaction)
+      {
+        // rather drop the oldest transactions than let them take the room of everything else
+        send_queue& transactions = _send_queues[size_t(send_class::transaction)];
+        while (transactions.messages.size() > 1 &&
+               transactions.stats.queued_bytes > GRAPHENE_NET_MAXIMUM_QUEUED_TRANSACTIONS_IN_BYTES)
+          drop_queued_transaction();
+      }
       if (_total_queued_messages_size > GRAPHENE_NET_MAXIMUM_QUEUED_MESSAGES_IN_BYTES)
       {
         wlog("send queue exceeded maximum size of ${max} bytes (current size ${current} bytes)",
@@ -393,6 +570,16 @@ namespace graphene { namespace net
       //     ("type", message_to_send.msg_type)("endpoint", get_remote_endpoint())); // for debug
       auto message_to_enqueue = std::make_unique<real_queued_message>(
                                       message_to_send, message_send_time_field_offset );
+      message_to_enqueue->message_class = classify_message(message_to_send.msg_type.value());
+      send_queueable_message(std::move(message_to_enqueue));
+    }
+
+    void peer_connection::send_message(std::shared_ptr<const message> message_to_send)
+    {
+      VERIFY_CORRECT_THREAD();
+      const uint32_t message_type = message_to_send->msg_type.value();
+      auto message_to_enqueue = std::make_unique<shared_queued_message>(std::move(message_to_send));
+      message_to_enqueue->message_class = classify_message(message_type);
       send_queueable_message(std::move(message_to_enqueue));
     }
 
@@ -402,6 +589,7 @@ namespace graphene { namespace net
       //dlog("peer_connection::send_item() enqueueing message of type ${type} for peer ${endpoint}",
       //     ("type", item_to_send.item_type)("endpoint", get_remote_endpoint())); // for debug
       auto message_to_enqueue = std::make_unique<virtual_queued_message>(item_to_send);
+      message_to_enqueue->message_class = classify_message(item_to_send.item_type);
       send_queueable_message(std::move(message_to_enqueue));
     }
 
@@ -498,19 +686,16 @@ namespace graphene { namespace net
       fc::time_point_sec oldest_inventory_to_keep(fc::time_point::now() - fc::minutes(GRAPHENE_NET_MAX_INVENTORY_SIZE_IN_MINUTES));
 
       // expire old items from inventory_advertised_to_peer
-      auto oldest_inventory_to_keep_iter = inventory_advertised_to_peer.get<timestamp_index>().lower_bound(oldest_inventory_to_keep);
-      auto begin_iter = inventory_advertised_to_peer.get<timestamp_index>().begin();
-      unsigned number_of_elements_advertised_to_peer_to_discard = std::distance(begin_iter, oldest_inventory_to_keep_iter);
-      inventory_advertised_to_peer.get<timestamp_index>().erase(begin_iter, oldest_inventory_to_keep_iter);
+      inventory_advertised_to_peer.expire();
 
       // also expire items from inventory_peer_advertised_to_us
-      oldest_inventory_to_keep_iter = inventory_peer_advertised_to_us.get<timestamp_index>().lower_bound(oldest_inventory_to_keep);
-      begin_iter = inventory_peer_advertised_to_us.get<timestamp_index>().begin();
+      auto oldest_inventory_to_keep_iter = inventory_peer_advertised_to_us.get<timestamp_index>().lower_bound(oldest_inventory_to_keep);
+      auto begin_iter = inventory_peer_advertised_to_us.get<timestamp_index>().begin();
       unsigned number_of_elements_peer_advertised_to_discard = std::distance(begin_iter, oldest_inventory_to_keep_iter);
       inventory_peer_advertised_to_us.get<timestamp_index>().erase(begin_iter, oldest_inventory_to_keep_iter);
-      dlog("Expiring old inventory for peer ${peer}: removing ${to_peer} items advertised to peer (${remain_to_peer} left), and ${to_us} advertised to us (${remain_to_us} left)",
+      dlog("Expiring old inventory for peer ${peer}: ${remain_to_peer} items advertised to peer left, removing ${to_us} advertised to us (${remain_to_us} left)",
            ("peer", get_remote_endpoint())
-           ("to_peer", number_of_elements_advertised_to_peer_to_discard)("remain_to_peer", inventory_advertised_to_peer.size())
+           ("remain_to_peer", inventory_advertised_to_peer.size())
            ("to_us", number_of_elements_peer_advertised_to_discard)("remain_to_us", inventory_peer_advertised_to_us.size()));
     }
 
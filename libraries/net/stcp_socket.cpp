@@ -10,6 +10,7 @@
 #include <fc/exception/exception.hpp>
 
 #include <graphene/net/stcp_socket.hpp>
+#include <graphene/net/config.hpp>
 
 namespace graphene { namespace net {
 
@@ -77,7 +78,7 @@ size_t stcp_socket::readsome( char* buffer, size_t len )
     } buffer_in_use_checker(_read_buffer_in_use);
 #endif
 
-    const size_t read_buffer_length = 4096;
+    const size_t read_buffer_length = GRAPHENE_NET_MESSAGE_BUFFER_SIZE;
     if (!_read_buffer)
       _read_buffer.reset(new char[read_buffer_length], [](char* p){ delete[] p; });
 
@@ -98,6 +99,20 @@ size_t stcp_socket::readsome( const std::shared_ptr<char>& buf, size_t len, size
   return readsome(buf.get() + offset, len);
 }
 
+size_t stcp_socket::readsome_in_place( const std::shared_ptr<char>& buf, size_t len, size_t offset )
+{ try {
+    assert( len > 0 && (len % 16) == 0 );
+
+    size_t s = _sock.readsome( buf, len, offset );
+    if( s % 16 )
+    {
+      _sock.read( buf, 16 - (s%16), offset + s );
+      s += 16-(s%16);
+    }
+    _recv_aes.decode( buf.get() + offset, s, buf.get() + offset );
+    return s;
+} FC_RETHROW_EXCEPTIONS( warn, "", ("len",len)("offset",offset) ) }
+
 bool stcp_socket::eof()const
 {
   return _sock.eof();
@@ -118,11 +133,10 @@ size_t stcp_socket::writesome( const char* buffer, size_t len )
     } buffer_in_use_checker(_write_buffer_in_use);
 #endif
 
-    const std::size_t write_buffer_length = 4096;
+    const std::size_t write_buffer_length = GRAPHENE_NET_MESSAGE_BUFFER_SIZE;
     if (!_write_buffer)
       _write_buffer.reset(new char[write_buffer_length], [](char* p){ delete[] p; });
     len = std::min<size_t>(write_buffer_length, len);
-    memset(_write_buffer.get(), 0, len); // just in case aes.encode screws up
     /**
      * every sizeof(crypt_buf) bytes the aes channel
      * has an error and doesn't decrypt properly...  disable
@@ -140,6 +154,15 @@ size_t stcp_socket::writesome( const std::shared_ptr<const char>& buf, size_t le
   return writesome(buf.get() + offset, len);
 }
 
+void stcp_socket::write_in_place( const std::shared_ptr<char>& buf, size_t len )
+{ try {
+    assert( len > 0 && (len % 16) == 0 );
+
+    uint32_t ciphertext_len = _send_aes.encode( buf.get(), len, buf.get() );
+    assert(ciphertext_len == len);
+    _sock.write( buf, ciphertext_len );
+} FC_RETHROW_EXCEPTIONS( warn, "", ("len",len) ) }
+
 void stcp_socket::flush()
 {
   _sock.flush();
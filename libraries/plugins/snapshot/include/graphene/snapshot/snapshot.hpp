@@ -3,10 +3,46 @@
 #include <graphene/app/plugin.hpp>
 #include <graphene/chain/database.hpp>
 
+#include <fc/thread/future.hpp>
+#include <fc/thread/thread.hpp>
 #include <fc/time.hpp>
 
 namespace graphene { namespace snapshot_plugin {
 
+/**
+ * @brief checksum and size of one index in a binary snapshot
+ *
+ * The checksum covers the files of the index in shard order.
+ */
+struct snapshot_index_info
+{
+   uint8_t    space_id = 0;
+   uint8_t    type_id = 0;
+   uint32_t   shard_count = 0;
+   uint64_t   object_count = 0;
+   uint64_t   size = 0;
+   fc::sha256 checksum;
+};
+
+/**
+ * @brief describes a binary snapshot, stored as manifest.json in the snapshot directory
+ *
+ * The directory holds the files of all indexes under object_database/, in the format the object database is
+ * flushed in, and the packed head block in head_block. A node can be started from it with snapshot-import.
+ */
+struct snapshot_manifest
+{
+   static constexpr uint32_t current_format = 1;
+
+   uint32_t                          format = current_format;
+   std::string                       db_version;
+   chain::chain_id_type              chain_id;
+   uint32_t                          head_block_num = 0;
+   chain::block_id_type              head_block_id;
+   fc::time_point_sec                head_block_time;
+   std::vector<snapshot_index_info>  indexes;
+};
+
 class snapshot_plugin : public graphene::app::plugin {
    public:
       using graphene::app::plugin::plugin;
@@ -20,13 +56,30 @@ class snapshot_plugin : public graphene::app::plugin {
       ) override;
 
       void plugin_initialize( const boost::program_options::variables_map& options ) override;
+      void plugin_startup() override;
+      void plugin_shutdown() override;
 
    private:
        void check_snapshot( const graphene::chain::signed_block& b);
+       void create_binary_snapshot( const graphene::chain::signed_block& head );
+       void prepare_import( const fc::path& source );
 
        uint32_t           snapshot_block = -1, last_block = 0;
        fc::time_point_sec snapshot_time = fc::time_point_sec::maximum(), last_time = fc::time_point_sec(1);
        fc::path           dest;
+       bool               binary = false;
+
+       /// Binary snapshots are written by this thread while blocks keep being applied
+       std::unique_ptr<fc::thread> writer_thread;
+       fc::future<void>            pending_write;
+
+       /// Manifest of the imported snapshot, checked against the chain once the database is open
+       fc::optional<snapshot_manifest> imported;
 };
 
 } } //graphene::snapshot_plugin
+
+FC_REFLECT( graphene::snapshot_plugin::snapshot_index_info,
+            (space_id)(type_id)(shard_count)(object_count)(size)(checksum) )
+FC_REFLECT( graphene::snapshot_plugin::snapshot_manifest,
+            (format)(db_version)(chain_id)(head_block_num)(head_block_id)(head_block_time)(indexes) )
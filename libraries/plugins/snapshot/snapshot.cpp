@@ -3,6 +3,10 @@
 #include <graphene/chain/database.hpp>
 
 #include <fc/io/fstream.hpp>
+#include <fc/thread/parallel.hpp>
+
+#include <fstream>
+#include <sstream>
 
 using namespace graphene::snapshot_plugin;
 using std::string;
@@ -13,6 +17,8 @@ namespace bpo = boost::program_options;
 static const char* OPT_BLOCK_NUM  = "snapshot-at-block";
 static const char* OPT_BLOCK_TIME = "snapshot-at-time";
 static const char* OPT_DEST       = "snapshot-to";
+static const char* OPT_FORMAT     = "snapshot-format";
+static const char* OPT_IMPORT     = "snapshot-import";
 
 void snapshot_plugin::plugin_set_program_options(
    boost::program_options::options_description& command_line_options,
@@ -21,7 +27,13 @@ void snapshot_plugin::plugin_set_program_options(
    command_line_options.add_options()
          (OPT_BLOCK_NUM, bpo::value<uint32_t>(), "Block number after which to do a snapshot")
          (OPT_BLOCK_TIME, bpo::value<string>(), "Block time (ISO format) after which to do a snapshot")
-         (OPT_DEST, bpo::value<string>(), "Pathname of JSON file where to store the snapshot")
+         (OPT_DEST, bpo::value<string>(), "Pathname of JSON file or binary snapshot directory where to store the "
+                                          "snapshot")
+         (OPT_FORMAT, bpo::value<string>()->default_value("json"),
+                      "Format of the snapshot: json (one object per line) or binary (a directory that a node can be "
+                      "started from with snapshot-import, written in the background)")
+         (OPT_IMPORT, bpo::value<string>(), "Directory of a binary snapshot to start from if there is no chain state "
+                                            "yet, instead of replaying the blockchain")
          ;
    config_file_options.add(command_line_options);
 }
@@ -33,13 +45,16 @@ std::string snapshot_plugin::plugin_name()const
 
 std::string snapshot_plugin::plugin_description()const
 {
-   return "Create snapshots at a specified time or block number.";
+   return "Create snapshots at a specified time or block number, or start from one.";
 }
 
 void snapshot_plugin::plugin_initialize(const boost::program_options::variables_map& options)
 { try {
    ilog("snapshot plugin: plugin_initialize() begin");
 
+   if( options.count(OPT_IMPORT) > 0 )
+      prepare_import( options[OPT_IMPORT].as<std::string>() );
+
    if( options.count(OPT_BLOCK_NUM) > 0 || options.count(OPT_BLOCK_TIME) > 0 )
    {
       FC_ASSERT( options.count(OPT_DEST) > 0,
@@ -49,6 +64,14 @@ void snapshot_plugin::plugin_initialize(const boost::program_options::variables_
          snapshot_block = options[OPT_BLOCK_NUM].as<uint32_t>();
       if( options.count(OPT_BLOCK_TIME) > 0 )
          snapshot_time = fc::time_point_sec::from_iso_string( options[OPT_BLOCK_TIME].as<std::string>() );
+      if( options.count(OPT_FORMAT) > 0 )
+      {
+         const auto format = options[OPT_FORMAT].as<std::string>();
+         FC_ASSERT( format == "json" || format == "binary", "Unknown snapshot format ${f}", ("f", format) );
+         binary = ( format == "binary" );
+      }
+      if( binary )
+         writer_thread = std::make_unique<fc::thread>( "snapshot" );
       // connect with no group specified to process after the ones with a group specified
       database().applied_block.connect( [&]( const graphene::chain::signed_block& b ) {
          check_snapshot( b );
@@ -60,6 +83,26 @@ void snapshot_plugin::plugin_initialize(const boost::program_options::variables_
    ilog("snapshot plugin: plugin_initialize() end");
 } FC_LOG_AND_RETHROW() }
 
+void snapshot_plugin::plugin_startup()
+{
+   if( !imported.valid() )
+      return;
+   FC_ASSERT( database().get_chain_id() == imported->chain_id,
+              "The imported snapshot belongs to a different chain",
+              ("chain", database().get_chain_id())("snapshot", imported->chain_id) );
+   if( database().head_block_num() < imported->head_block_num )
+      wlog( "snapshot plugin: the snapshot was not imported, the node has an older chain state already" );
+}
+
+void snapshot_plugin::plugin_shutdown()
+{
+   if( pending_write.valid() && !pending_write.ready() )
+   {
+      ilog( "snapshot plugin: waiting for the snapshot to be written" );
+      pending_write.wait();
+   }
+}
+
 static void create_snapshot( const graphene::chain::database& db, const fc::path& dest )
 {
    ilog("snapshot plugin: creating snapshot");
@@ -73,32 +116,253 @@ static void create_snapshot( const graphene::chain::database& db, const fc::path
       wlog( "Failed to open snapshot destination: ${ex}", ("ex",e) );
       return;
    }
-   for( uint32_t space_id = 0; space_id < 256; space_id++ )
-      for( uint32_t type_id = 0; type_id < 256; type_id++ )
+   db.inspect_indexes( [&out]( const graphene::db::index& index ) {
+      index.inspect_all_objects( [&out]( const graphene::db::object& o ) {
+         out << fc::json::to_string( o.to_variant() ) << '\n';
+      });
+   });
+   out.close();
+   ilog("snapshot plugin: created snapshot");
+}
+
+namespace {
+
+   /**
+    * The objects of one index, packed into the records of the object database files while block application
+    * waits, so that they can be written out in the background while the chain moves on.
+    */
+   struct captured_index
+   {
+      const graphene::db::index*       source;
+      uint8_t                          space_id;
+      uint8_t                          type_id;
+      fc::sha256                       object_version;
+      graphene::db::object_id_type     next_id;
+      /// length-prefixed packed objects, index_file_header::objects_per_shard per shard at most
+      std::vector< std::vector<char> > shards;
+      std::vector<uint64_t>            shard_objects;
+
+      void capture()
       {
-         try
+         const uint64_t per_shard = graphene::db::index_file_header::objects_per_shard;
+         uint64_t count = 0;
+         source->inspect_all_objects( [this,&count,per_shard]( const graphene::db::object& o ) {
+            if( count % per_shard == 0 )
+            {
+               shards.emplace_back();
+               shard_objects.push_back( 0 );
+            }
+            const auto packed = o.pack();
+            const uint32_t size = packed.size();
+            auto& out = shards.back();
+            const auto pos = out.size();
+            out.resize( pos + sizeof(size) + size );
+            fc::datastream<char*> ds( out.data() + pos, out.size() - pos );
+            fc::raw::pack( ds, size );
+            ds.write( packed.data(), size );
+            ++shard_objects.back();
+            ++count;
+         });
+         if( shards.empty() )
          {
-            db.get_index( (uint8_t)space_id, (uint8_t)type_id );
+            shards.emplace_back();
+            shard_objects.push_back( 0 );
          }
-         catch (fc::assert_exception& e)
+         source = nullptr;
+      }
+   };
+
+   void write_index( captured_index& item, const fc::path& root, snapshot_index_info& info )
+   {
+      graphene::db::index_file_header header;
+      header.object_version = item.object_version;
+      header.next_id = item.next_id;
+      header.shard_count = item.shards.size();
+
+      const auto db = root / fc::to_string( item.space_id ) / fc::to_string( item.type_id );
+      fc::sha256::encoder checksum;
+      for( uint32_t shard = 0; shard < item.shards.size(); ++shard )
+      {
+         header.shard = shard;
+         header.object_count = item.shard_objects[shard];
+         std::ostringstream header_bytes;
+         header.write( header_bytes );
+         const auto head = header_bytes.str();
+         auto& data = item.shards[shard];
+
+         std::ofstream out( graphene::db::index_file_header::shard_path( db, shard ).generic_string(),
+                            std::ofstream::binary | std::ofstream::out | std::ofstream::trunc );
+         out.write( head.data(), head.size() );
+         out.write( data.data(), data.size() );
+         out.close();
+         FC_ASSERT( out, "Unable to write ${f}", ("f", db) );
+
+         checksum.write( head.data(), head.size() );
+         checksum.write( data.data(), data.size() );
+         info.size += head.size() + data.size();
+         info.object_count += header.object_count;
+         std::vector<char>().swap( data );
+      }
+      info.space_id = item.space_id;
+      info.type_id = item.type_id;
+      info.shard_count = header.shard_count;
+      info.checksum = checksum.result();
+   }
+
+   void write_binary_snapshot( std::vector<captured_index>& indexes, snapshot_manifest manifest,
+                               const std::vector<char>& head_block, const fc::path& dest )
+   {
+      const auto start = fc::time_point::now();
+      const fc::path tmp_dir = dest.generic_string() + ".tmp";
+      if( fc::exists( tmp_dir ) )
+         fc::remove_all( tmp_dir );
+      for( const auto& item : indexes )
+         fc::create_directories( tmp_dir / "object_database" / fc::to_string( item.space_id ) );
+
+      manifest.indexes.resize( indexes.size() );
+      std::vector<fc::future<void>> tasks;
+      tasks.reserve( indexes.size() );
+      for( size_t i = 0; i < indexes.size(); ++i )
+         tasks.push_back( fc::do_parallel( [&indexes,&manifest,&tmp_dir,i] () {
+            write_index( indexes[i], tmp_dir / "object_database", manifest.indexes[i] );
+         } ) );
+      for( auto& task : tasks )
+         task.wait();
+
+      std::ofstream block_out( ( tmp_dir / "head_block" ).generic_string(),
+                               std::ofstream::binary | std::ofstream::out | std::ofstream::trunc );
+      block_out.write( head_block.data(), head_block.size() );
+      block_out.close();
+      FC_ASSERT( block_out, "Unable to write the head block of the snapshot" );
+      fc::json::save_to_file( manifest, tmp_dir / "manifest.json" );
+
+      // the snapshot only appears under its name once it is complete
+      if( fc::exists( dest ) )
+         fc::remove_all( dest );
+      fc::rename( tmp_dir, dest );
+
+      uint64_t size = 0;
+      for( const auto& info : manifest.indexes )
+         size += info.size;
+      ilog( "snapshot plugin: wrote the snapshot of block ${n}, ${b} bytes in ${i} indexes, in ${t}ms",
+            ("n", manifest.head_block_num)("b", size)("i", manifest.indexes.size())
+            ("t", ( fc::time_point::now() - start ).count() / 1000) );
+   }
+
+   /// @return the checksum of the files of a saved index, in shard order
+   fc::sha256 checksum_of( const std::vector<fc::path>& files, uint64_t& size )
+   {
+      fc::sha256::encoder checksum;
+      std::vector<char> buffer( 1024 * 1024 );
+      for( const auto& file : files )
+      {
+         std::ifstream in( file.generic_string(), std::ifstream::binary );
+         FC_ASSERT( in, "Unable to read ${f}", ("f", file) );
+         while( in )
          {
-            continue;
+            in.read( buffer.data(), buffer.size() );
+            checksum.write( buffer.data(), in.gcount() );
+            size += in.gcount();
          }
-         auto& index = db.get_index( (uint8_t)space_id, (uint8_t)type_id );
-         index.inspect_all_objects( [&out]( const graphene::db::object& o ) {
-            out << fc::json::to_string( o.to_variant() ) << '\n';
-         });
       }
-   out.close();
-   ilog("snapshot plugin: created snapshot");
+      return checksum.result();
+   }
+
 }
 
+void snapshot_plugin::create_binary_snapshot( const graphene::chain::signed_block& head )
+{
+   ilog( "snapshot plugin: capturing the state at block ${n}", ("n", head.block_num()) );
+   const auto start = fc::time_point::now();
+   const auto& db = database();
+
+   // Objects are only read here, while this thread waits. Once packed, the database may move on.
+   auto indexes = std::make_shared< std::vector<captured_index> >();
+   db.inspect_indexes( [&indexes]( const graphene::db::index& idx ) {
+      indexes->push_back( { &idx, idx.object_space_id(), idx.object_type_id(), idx.get_object_version(),
+                            idx.get_next_id(), {}, {} } );
+   });
+   std::vector<fc::future<void>> tasks;
+   tasks.reserve( indexes->size() );
+   for( auto& item : *indexes )
+      tasks.push_back( fc::do_parallel( [&item] () { item.capture(); } ) );
+   for( auto& task : tasks )
+      task.wait();
+
+   snapshot_manifest manifest;
+   manifest.db_version = GRAPHENE_CURRENT_DB_VERSION;
+   manifest.chain_id = db.get_chain_id();
+   manifest.head_block_num = head.block_num();
+   manifest.head_block_id = head.id();
+   manifest.head_block_time = head.timestamp;
+   auto head_block = std::make_shared< std::vector<char> >( fc::raw::pack( head ) );
+   ilog( "snapshot plugin: captured ${i} indexes in ${t}ms, writing them in the background",
+         ("i", indexes->size())("t", ( fc::time_point::now() - start ).count() / 1000) );
+
+   if( pending_write.valid() && !pending_write.ready() )
+      pending_write.wait();
+   const fc::path target = dest;
+   pending_write = writer_thread->async( [indexes,manifest,head_block,target] () {
+      try
+      {
+         write_binary_snapshot( *indexes, manifest, *head_block, target );
+      }
+      catch( const fc::exception& e )
+      {
+         elog( "snapshot plugin: failed to write the snapshot: ${e}", ("e", e.to_detail_string()) );
+      }
+   }, "write_snapshot" );
+}
+
+void snapshot_plugin::prepare_import( const fc::path& source )
+{ try {
+   ilog( "snapshot plugin: verifying the snapshot in ${d}", ("d", source) );
+   auto manifest = fc::json::from_file( source / "manifest.json" ).as<snapshot_manifest>( GRAPHENE_MAX_NESTED_OBJECTS );
+   FC_ASSERT( manifest.format == snapshot_manifest::current_format, "Unsupported snapshot format ${f}",
+              ("f", manifest.format) );
+   FC_ASSERT( manifest.db_version == GRAPHENE_CURRENT_DB_VERSION,
+              "The snapshot was taken with database version ${s}, this node uses ${n}",
+              ("s", manifest.db_version)("n", GRAPHENE_CURRENT_DB_VERSION) );
+
+   std::vector<fc::future<void>> tasks;
+   tasks.reserve( manifest.indexes.size() );
+   for( const auto& info : manifest.indexes )
+      tasks.push_back( fc::do_parallel( [&info,&source] () {
+         const auto files = graphene::db::index_file_header::saved_shards( source / "object_database"
+                                                                           / fc::to_string( info.space_id )
+                                                                           / fc::to_string( info.type_id ) );
+         FC_ASSERT( files.size() == info.shard_count, "Index ${s}.${t} of the snapshot is incomplete",
+                    ("s", info.space_id)("t", info.type_id) );
+         uint64_t size = 0;
+         FC_ASSERT( checksum_of( files, size ) == info.checksum && size == info.size,
+                    "Index ${s}.${t} of the snapshot is corrupted", ("s", info.space_id)("t", info.type_id) );
+      } ) );
+   for( auto& task : tasks )
+      task.wait();
+
+   std::string packed_block;
+   fc::read_file_contents( source / "head_block", packed_block );
+   const auto head = fc::raw::unpack<graphene::chain::signed_block>(
+                        std::vector<char>( packed_block.begin(), packed_block.end() ) );
+   FC_ASSERT( head.id() == manifest.head_block_id, "The head block of the snapshot is corrupted" );
+
+   database().set_snapshot_import( source / "object_database", head );
+   ilog( "snapshot plugin: the node starts from the snapshot of block ${n} unless it has a chain state already",
+         ("n", manifest.head_block_num) );
+   imported = std::move( manifest );
+} FC_CAPTURE_AND_RETHROW( (source) ) } // GCOVR_EXCL_LINE
+
 void snapshot_plugin::check_snapshot( const graphene::chain::signed_block& b )
 { try {
     uint32_t current_block = b.block_num();
     if( (last_block < snapshot_block && snapshot_block <= current_block)
            || (last_time < snapshot_time && snapshot_time <= b.timestamp) )
-       create_snapshot( database(), dest );
+    {
+       if( binary )
+          create_binary_snapshot( b );
+       else
+          create_snapshot( database(), dest );
+    }
     last_block = current_block;
     last_time = b.timestamp;
 } FC_LOG_AND_RETHROW() }
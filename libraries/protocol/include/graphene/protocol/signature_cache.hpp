@@ -0,0 +1,81 @@
+#pragma once
+
+#include <graphene/protocol/types.hpp>
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+namespace graphene { namespace protocol {
+
+   /**
+    * @brief A process-wide, bounded cache of public keys recovered from signatures
+    *
+    * The same transaction is usually seen more than once, e.g. when it is pushed from the network or the API and
+    * later again in a block. Recovering the signing key is by far the most expensive part of checking it, so
+    * recovered keys are remembered by (digest, signature) and shared between all threads.
+    *
+    * The cache is split into shards with one lock each, so that the workers of precompute_parallel rarely wait for
+    * each other. When a shard is full the oldest entry is dropped. Failed recoveries are not cached.
+    */
+   class signature_cache
+   {
+      public:
+         static constexpr size_t default_capacity = 100000;
+
+         /// @return the cache shared by the whole process
+         static signature_cache& instance();
+
+         /**
+          * @brief Recovers the public key that produced @p sig over @p digest, or looks it up if it is known
+          * @throws fc::exception if the key cannot be recovered
+          */
+         public_key_type recover( const digest_type& digest, const signature_type& sig );
+
+         /// Sets the maximum number of keys to keep, 0 disables the cache. Drops entries that exceed it.
+         void set_capacity( size_t capacity );
+         size_t capacity()const { return _capacity; }
+
+         size_t size()const;
+         void   clear();
+
+         uint64_t hits()const   { return _hits; }
+         uint64_t misses()const { return _misses; }
+
+      private:
+         struct key_type
+         {
+            digest_type    digest;
+            signature_type signature;
+
+            bool operator == ( const key_type& o )const
+            {
+               return digest == o.digest && signature == o.signature;
+            }
+         };
+
+         struct key_hash
+         {
+            size_t operator()( const key_type& k )const;
+         };
+
+         struct shard
+         {
+            mutable std::mutex                                        mutex;
+            std::unordered_map<key_type, public_key_type, key_hash>   keys;
+            std::deque<key_type>                                      order; ///< insertion order, oldest first
+         };
+
+         static constexpr size_t shard_count = 16;
+
+         shard& shard_of( size_t hash ) { return _shards[ hash % shard_count ]; }
+         static void shrink( shard& s, size_t max_size );
+
+         shard                  _shards[shard_count];
+         std::atomic<size_t>    _capacity{ default_capacity };
+         std::atomic<uint64_t>  _hits{ 0 };
+         std::atomic<uint64_t>  _misses{ 0 };
+   };
+
+} } // graphene::protocol
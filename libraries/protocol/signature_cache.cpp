@@ -0,0 +1,99 @@
+#include <graphene/protocol/signature_cache.hpp>
+
+#include <cstring>
+
+namespace graphene { namespace protocol {
+
+   size_t signature_cache::key_hash::operator()( const key_type& k )const
+   {
+      // both the digest and the r value of the signature are uniformly distributed, skip the recovery id
+      uint64_t r;
+      std::memcpy( &r, &*k.signature.begin() + 1, sizeof(r) );
+      return static_cast<size_t>( k.digest._hash[0] ^ r );
+   }
+
+   signature_cache& signature_cache::instance()
+   {
+      static signature_cache cache;
+      return cache;
+   }
+
+   public_key_type signature_cache::recover( const digest_type& digest, const signature_type& sig )
+   {
+      const size_t max_size = _capacity / shard_count;
+      if( max_size == 0 )
+      {
+         ++_misses;
+         return fc::ecc::public_key( sig, digest );
+      }
+
+      key_type k{ digest, sig };
+      const size_t hash = key_hash()( k );
+      shard& s = shard_of( hash );
+      {
+         std::lock_guard<std::mutex> lock( s.mutex );
+         auto itr = s.keys.find( k );
+         if( itr != s.keys.end() )
+         {
+            ++_hits;
+            return itr->second;
+         }
+      }
+
+      // recover without holding the lock, two threads may occasionally both recover the same key
+      ++_misses;
+      public_key_type result( fc::ecc::public_key( sig, digest ) );
+
+      std::lock_guard<std::mutex> lock( s.mutex );
+      if( s.keys.emplace( k, result ).second )
+      {
+         s.order.push_back( std::move(k) );
+         shrink( s, max_size );
+      }
+      return result;
+   }
+
+   void signature_cache::shrink( shard& s, size_t max_size )
+   {
+      while( s.order.size() > max_size )
+      {
+         s.keys.erase( s.order.front() );
+         s.order.pop_front();
+      }
+   }
+
+   void signature_cache::set_capacity( size_t capacity )
+   {
+      _capacity = capacity;
+      const size_t max_size = capacity / shard_count;
+      for( shard& s : _shards )
+      {
+         std::lock_guard<std::mutex> lock( s.mutex );
+         shrink( s, max_size );
+      }
+   }
+
+   size_t signature_cache::size()const
+   {
+      size_t result = 0;
+      for( const shard& s : _shards )
+      {
+         std::lock_guard<std::mutex> lock( s.mutex );
+         result += s.keys.size();
+      }
+      return result;
+   }
+
+   void signature_cache::clear()
+   {
+      for( shard& s : _shards )
+      {
+         std::lock_guard<std::mutex> lock( s.mutex );
+         s.keys.clear();
+         s.order.clear();
+      }
+      _hits = 0;
+      _misses = 0;
+   }
+
+} } // graphene::protocol
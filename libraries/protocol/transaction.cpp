@@ -3,6 +3,7 @@
 #include <graphene/protocol/exceptions.hpp>
 #include <graphene/protocol/fee_schedule.hpp>
 #include <graphene/protocol/btc_address.hpp>
+#include <graphene/protocol/signature_cache.hpp>
 
 #include <fc/io/raw.hpp>
 
@@ -294,11 +295,13 @@ namespace graphene { namespace protocol {
    const flat_set<public_key_type>& signed_transaction::get_signature_keys( const chain_id_type& chain_id )const
    { try {
       auto d = sig_digest( chain_id );
+      auto& cache = signature_cache::instance();
       flat_set<public_key_type> result;
+      result.reserve( signatures.size() );
       for( const auto&  sig : signatures )
       {
          GRAPHENE_ASSERT(
-            result.insert( fc::ecc::public_key(sig,d) ).second,
+            result.insert( cache.recover( d, sig ) ).second,
                tx_duplicate_sig,
                "Duplicate Signature detected" );
       }
@@ -0,0 +1,144 @@
+#include <graphene/chain/block_database.hpp>
+#include <graphene/chain/compressed_block_file.hpp>
+
+#include <fc/io/raw.hpp>
+#include <fc/log/logger.hpp>
+
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+
+#include <algorithm>
+#include <iostream>
+
+using namespace graphene::chain;
+namespace bpo = boost::program_options;
+
+namespace {
+   block_database::storage_mode detect_mode( const fc::path& dir )
+   {
+      return compressed_block_file::exists( dir ) ? block_database::storage_mode::compressed
+                                                  : block_database::storage_mode::streams;
+   }
+}
+
+int main( int argc, char** argv )
+{
+   try
+   {
+      bpo::options_description cli_options("Convert a block database between the stream and compressed formats");
+      cli_options.add_options()
+            ("help,h", "Print this help message and exit.")
+            ("input,i", bpo::value<boost::filesystem::path>(),
+             "Block database to read, e.g. <data-dir>/blockchain/database/block_num_to_block. "
+             "Its format is detected automatically")
+            ("output,o", bpo::value<boost::filesystem::path>(), "Directory to write the converted block database to")
+            ("format,f", bpo::value<std::string>()->default_value("compressed"),
+             "Format to write, \"compressed\" or \"stream\"")
+            ("dictionary-samples", bpo::value<uint32_t>()->default_value(1000),
+             "Number of blocks, spread over the whole chain, to train the compression dictionary on")
+            ;
+
+      bpo::variables_map options;
+      try
+      {
+         bpo::store( bpo::parse_command_line(argc, argv, cli_options), options );
+         bpo::notify( options );
+      }
+      catch (const bpo::error& e)
+      {
+         std::cerr << "block_converter:  error parsing command line: " << e.what() << "\n";
+         return 1;
+      }
+
+      if( options.count("help") > 0 )
+      {
+         std::cout << cli_options << "\n";
+         return 1;
+      }
+
+      if( options.count("input") == 0 || options.count("output") == 0 )
+      {
+         std::cerr << "--input and --output options are required\n";
+         return 1;
+      }
+
+      const fc::path input_dir = options["input"].as<boost::filesystem::path>();
+      const fc::path output_dir = options["output"].as<boost::filesystem::path>();
+      const std::string format = options["format"].as<std::string>();
+      if( format != "compressed" && format != "stream" )
+      {
+         std::cerr << "--format must be \"compressed\" or \"stream\"\n";
+         return 1;
+      }
+      if( !fc::exists( input_dir / "index" ) )
+      {
+         std::cerr << "No block database found in " << input_dir.generic_string() << "\n";
+         return 1;
+      }
+      if( fc::exists( output_dir / "index" ) )
+      {
+         std::cerr << "Refusing to overwrite the block database in " << output_dir.generic_string() << "\n";
+         return 1;
+      }
+      const auto output_mode = format == "compressed" ? block_database::storage_mode::compressed
+                                                      : block_database::storage_mode::streams;
+
+      block_database input;
+      input.open( input_dir, detect_mode( input_dir ) );
+      const auto last_id = input.last_id();
+      if( !last_id.valid() )
+      {
+         std::cerr << "The input block database is empty\n";
+         return 1;
+      }
+      const uint32_t last_block_num = block_header::num_from_id( *last_id );
+
+      if( output_mode == block_database::storage_mode::compressed )
+      {
+         const uint32_t samples = std::max( 1u, std::min( options["dictionary-samples"].as<uint32_t>(),
+                                                          last_block_num ) );
+         std::vector< std::vector<char> > packed;
+         packed.reserve( samples );
+         for( uint32_t i = 0; i < samples; ++i )
+         {
+            const auto block = input.fetch_by_number( uint32_t( 1 + uint64_t(i) * last_block_num / samples ) );
+            if( block.valid() )
+               packed.push_back( fc::raw::pack( *block ) );
+         }
+         const auto dictionary = compressed_block_file::train_dictionary( packed );
+         compressed_block_file::write_dictionary( output_dir, dictionary );
+         ilog( "Trained a ${n} bytes dictionary on ${s} blocks", ("n", dictionary.size())("s", packed.size()) );
+      }
+
+      block_database output;
+      output.open( output_dir, output_mode );
+      const auto start = fc::time_point::now();
+      uint32_t converted = 0;
+      for( uint32_t block_num = 1; block_num <= last_block_num; ++block_num )
+      {
+         const auto block = input.fetch_by_number( block_num );
+         if( !block.valid() )
+         {
+            wlog( "Block ${n} is missing from the input, skipping it", ("n", block_num) );
+            continue;
+         }
+         output.store( block->id(), *block );
+         ++converted;
+         if( block_num % 100000 == 0 )
+            ilog( "Converted ${n} of ${l} blocks", ("n", block_num)("l", last_block_num) );
+      }
+      output.close();
+      input.close();
+
+      const auto elapsed = fc::time_point::now() - start;
+      ilog( "Converted ${n} blocks in ${t} sec, ${i} bytes on disk before, ${o} bytes after",
+            ("n", converted)("t", double( elapsed.count() ) / 1000000)
+            ("i", block_database::disk_size( input_dir ))("o", block_database::disk_size( output_dir )) );
+   }
+   catch ( const fc::exception& e )
+   {
+      std::cout << e.to_detail_string() << "\n";
+      return 1;
+   }
+   return 0;
+}
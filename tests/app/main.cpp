@@ -3,6 +3,8 @@
 
 #include <graphene/chain/balance_object.hpp>
 
+#include <graphene/net/inventory_filter.hpp>
+
 #include <graphene/utilities/tempdir.hpp>
 
 #include <fc/thread/thread.hpp>
@@ -344,6 +346,15 @@ BOOST_AUTO_TEST_CASE( three_node_network )
       BOOST_CHECK_EQUAL(app1.p2p_node()->get_connection_count(), 1u);
       BOOST_CHECK_EQUAL(app1.chain_database()->head_block_num(), 1u);
 
+      // app1 relayed the only transaction of the block, so the compact block needs nothing else
+      auto compact_blocks = [] ( graphene::app::application& app, const string& counter ) {
+         return app.p2p_node()->network_get_info()[counter].as<uint64_t>( 1 );
+      };
+      BOOST_TEST_MESSAGE( "Verifying app1 rebuilt the block from its message cache" );
+      BOOST_CHECK_EQUAL( compact_blocks( app1, "compact_blocks_rebuilt" ), 1u );
+      BOOST_CHECK_EQUAL( compact_blocks( app1, "compact_blocks_transactions_fetched" ), 0u );
+      BOOST_CHECK_EQUAL( compact_blocks( app1, "compact_blocks_fetched_in_full" ), 0u );
+
       BOOST_TEST_MESSAGE( "Checking GRAPHENE_NULL_ACCOUNT has balance" );
       BOOST_CHECK_EQUAL( db1->get_balance( GRAPHENE_NULL_ACCOUNT, asset_id_type() ).amount.value, 1000000 );
       BOOST_CHECK_EQUAL( db2->get_balance( GRAPHENE_NULL_ACCOUNT, asset_id_type() ).amount.value, 1000000 );
@@ -411,12 +422,191 @@ BOOST_AUTO_TEST_CASE( three_node_network )
       BOOST_REQUIRE_EQUAL(app3.p2p_node()->get_connection_count(), 2u);
       BOOST_TEST_MESSAGE( "app2 and app3 successfully connected" );
 
+      std::shared_ptr<chain::database> db3 = app3.chain_database();
+      const account_id_type nathan_id = db2->get_index_type<account_index>().indices().get<by_name>()
+                                           .find( "nathan" )->get_id();
+      auto make_transfer = [&nathan_id,&council_key,db2] ( int64_t amount ) {
+         graphene::chain::precomputable_transaction transfer_trx;
+         transfer_operation xfer_op;
+         xfer_op.from = nathan_id;
+         xfer_op.to = GRAPHENE_NULL_ACCOUNT;
+         xfer_op.amount = asset( amount );
+         transfer_trx.operations.push_back( xfer_op );
+         db2->current_fee_schedule().set_fee( transfer_trx.operations.back() );
+         transfer_trx.set_expiration( db2->get_slot_time( 10 ) );
+         transfer_trx.sign( council_key, db2->get_chain_id() );
+         transfer_trx.validate();
+         return transfer_trx;
+      };
+      // db2 produces a block with the transactions only it has, app2 announces it
+      auto broadcast_next_block = [&app2,&council_key,&broadcast_wait_time,db1,db2,db3] () {
+         wait_for( broadcast_wait_time, [db2] () {
+            return db2->get_slot_time(1) <= fc::time_point::now();
+         });
+         auto block = db2->generate_block(
+            db2->get_slot_time(1),
+            db2->get_scheduled_producer(1),
+            council_key,
+            database::skip_nothing);
+         app2.p2p_node()->broadcast(graphene::net::block_message( block ));
+         wait_for( broadcast_wait_time, [db1,db3,&block] () {
+            return db1->head_block_num() == block.block_num() && db3->head_block_num() == block.block_num();
+         });
+      };
+
+      BOOST_TEST_MESSAGE( "Generating a block with a transaction app1 has not seen" );
+      db2->push_transaction( make_transfer( 2000000 ) );
+      broadcast_next_block();
+      BOOST_CHECK_EQUAL( compact_blocks( app1, "compact_blocks_rebuilt" ), 1u );
+      BOOST_CHECK_EQUAL( compact_blocks( app1, "compact_blocks_transactions_fetched" ), 1u );
+      BOOST_CHECK_EQUAL( compact_blocks( app1, "compact_blocks_fetched_in_full" ), 0u );
+      BOOST_CHECK_EQUAL( db1->get_balance( GRAPHENE_NULL_ACCOUNT, asset_id_type() ).amount.value, 3000000 );
+      BOOST_CHECK_EQUAL( db3->get_balance( GRAPHENE_NULL_ACCOUNT, asset_id_type() ).amount.value, 3000000 );
+
+      // transaction ids don't cover signatures, app1 relays the transaction of the block with one more
+      BOOST_TEST_MESSAGE( "Generating a block with a transaction app1 has seen with other signatures" );
+      auto trx3 = make_transfer( 3000000 );
+      db2->push_transaction( trx3 );
+      signed_transaction forged_trx3 = trx3;
+      forged_trx3.sign( fc::ecc::private_key::generate(), db2->get_chain_id() );
+      BOOST_REQUIRE( forged_trx3.id() == trx3.id() );
+      app1.p2p_node()->broadcast(graphene::net::trx_message( forged_trx3 ));
+      broadcast_next_block();
+      BOOST_CHECK_EQUAL( compact_blocks( app1, "compact_blocks_rebuilt" ), 1u );
+      BOOST_CHECK_EQUAL( compact_blocks( app1, "compact_blocks_transactions_fetched" ), 1u );
+      BOOST_CHECK_EQUAL( compact_blocks( app1, "compact_blocks_fetched_in_full" ), 1u );
+      BOOST_CHECK( db1->fetch_block_by_number( 3 )->transactions.front().signatures == trx3.signatures );
+      BOOST_CHECK_EQUAL( db1->get_balance( GRAPHENE_NULL_ACCOUNT, asset_id_type() ).amount.value, 6000000 );
+      BOOST_CHECK_EQUAL( db3->get_balance( GRAPHENE_NULL_ACCOUNT, asset_id_type() ).amount.value, 6000000 );
+
+      BOOST_TEST_MESSAGE( "Verifying nodes are still connected" );
+      BOOST_CHECK_EQUAL( app1.p2p_node()->get_connection_count(), 2u );
+      BOOST_CHECK_EQUAL( app3.p2p_node()->get_connection_count(), 2u );
+
    } catch( fc::exception& e ) {
       edump((e.to_detail_string()));
       throw;
    }
 }
 
+/// the messages relaying a block in compact form survive being packed into a net message and back
+BOOST_AUTO_TEST_CASE( compact_block_messages_serialization )
+{ try {
+   using namespace graphene::chain;
+   fc::ecc::private_key key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("nathan")));
+
+   signed_block block;
+   block.timestamp = fc::time_point_sec( 1000000 );
+   block.validator = validator_id_type( 1 );
+   for( int64_t amount = 1; amount <= 3; ++amount )
+   {
+      signed_transaction trx;
+      transfer_operation xfer_op;
+      xfer_op.from = account_id_type( 17 );
+      xfer_op.to = GRAPHENE_NULL_ACCOUNT;
+      xfer_op.amount = asset( amount );
+      trx.operations.push_back( xfer_op );
+      trx.set_expiration( block.timestamp + 60 );
+      trx.sign( key, chain_id_type() );
+      processed_transaction ptrx( trx );
+      ptrx.operation_results.push_back( void_result() );
+      block.transactions.push_back( ptrx );
+   }
+   block.transaction_merkle_root = block.calculate_merkle_root();
+   block.sign( key );
+
+   const graphene::net::block_message full_block( block );
+   const graphene::net::message full_block_message( full_block );
+   const graphene::net::compact_block_message compact( full_block, full_block_message.id() );
+   const auto compact_copy = graphene::net::message( compact ).as<graphene::net::compact_block_message>();
+   BOOST_CHECK( compact_copy.block_message_hash == full_block_message.id() );
+   BOOST_CHECK( compact_copy.header.id() == block.id() );
+   BOOST_REQUIRE_EQUAL( compact_copy.transaction_ids.size(), 3u );
+   BOOST_REQUIRE_EQUAL( compact_copy.operation_results.size(), 3u );
+   for( size_t i = 0; i < 3; ++i )
+   {
+      BOOST_CHECK( compact_copy.transaction_ids[i] == block.transactions[i].id() );
+      BOOST_CHECK_EQUAL( compact_copy.operation_results[i].size(), 1u );
+   }
+
+   const graphene::net::fetch_block_transactions_message fetch( full_block_message.id(), block.id(), { 0, 2 } );
+   const auto fetch_copy = graphene::net::message( fetch ).as<graphene::net::fetch_block_transactions_message>();
+   BOOST_CHECK( fetch_copy.block_message_hash == fetch.block_message_hash );
+   BOOST_CHECK( fetch_copy.block_id == block.id() );
+   BOOST_CHECK( fetch_copy.transaction_indexes == fetch.transaction_indexes );
+
+   graphene::net::block_transactions_message reply( full_block_message.id() );
+   reply.transactions.push_back( block.transactions[0] );
+   reply.transactions.push_back( block.transactions[2] );
+   const auto reply_copy = graphene::net::message( reply ).as<graphene::net::block_transactions_message>();
+   BOOST_CHECK( reply_copy.block_message_hash == reply.block_message_hash );
+   BOOST_REQUIRE_EQUAL( reply_copy.transactions.size(), 2u );
+   BOOST_CHECK( reply_copy.transactions[1].id() == block.transactions[2].id() );
+   BOOST_CHECK( reply_copy.transactions[1].signatures == block.transactions[2].signatures );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( inventory_filter_test )
+{ try {
+   using graphene::net::inventory_filter;
+   using graphene::net::item_id;
+   auto make_item = [] ( uint32_t i ) {
+      return item_id( graphene::net::trx_message_type, fc::ripemd160::hash( std::to_string( i ) ) );
+   };
+   auto count_contained = [&make_item] ( const inventory_filter& filter, uint32_t begin, uint32_t end ) {
+      uint32_t result = 0;
+      for( uint32_t i = begin; i < end; ++i )
+         result += filter.contains( make_item( i ) ) ? 1 : 0;
+      return result;
+   };
+
+   // a generation is rotated out once it holds as many items as it was sized for
+   {
+      inventory_filter filter( 100, fc::hours(1), 0.001 );
+      BOOST_CHECK_EQUAL( filter.memory_used(), 0u );
+      BOOST_CHECK_EQUAL( count_contained( filter, 0, 100 ), 0u );
+      for( uint32_t i = 0; i < 200; ++i )
+         filter.insert( make_item( i ) );
+      BOOST_CHECK_EQUAL( filter.size(), 200u );
+      BOOST_CHECK_EQUAL( count_contained( filter, 0, 200 ), 200u );
+      BOOST_CHECK_GT( filter.memory_used(), 0u );
+
+      filter.insert( make_item( 200 ) );
+      BOOST_CHECK_EQUAL( filter.size(), 101u );
+      BOOST_CHECK_EQUAL( count_contained( filter, 100, 201 ), 101u );
+      BOOST_CHECK_LT( count_contained( filter, 0, 100 ), 5u );
+   }
+
+   // and once it is older than the period, expire() drops what is older than two periods
+   {
+      const fc::microseconds period = fc::minutes(1);
+      inventory_filter filter( 100, period, 0.001 );
+      filter.insert( make_item( 0 ) );
+      const fc::time_point now = fc::time_point::now();
+      filter.expire( now );
+      BOOST_CHECK( filter.contains( make_item( 0 ) ) );
+      filter.expire( now + period );
+      BOOST_CHECK( filter.contains( make_item( 0 ) ) );
+      BOOST_CHECK_EQUAL( filter.size(), 1u );
+      filter.expire( now + period + period + period );
+      BOOST_CHECK( !filter.contains( make_item( 0 ) ) );
+      BOOST_CHECK_EQUAL( filter.size(), 0u );
+   }
+
+   // the estimated false positive rate is close to the one seen, and to the one asked for once the filter is full
+   {
+      inventory_filter filter( 1000, fc::hours(1), 0.01 );
+      BOOST_CHECK_EQUAL( filter.false_positive_rate(), 0.0 );
+      for( uint32_t i = 0; i < 1000; ++i )
+         filter.insert( make_item( i ) );
+      const double estimate = filter.false_positive_rate();
+      BOOST_CHECK_GT( estimate, 0.005 );
+      BOOST_CHECK_LT( estimate, 0.02 );
+      const double seen = count_contained( filter, 1000, 21000 ) / 20000.0;
+      BOOST_CHECK_GT( seen, estimate / 2 );
+      BOOST_CHECK_LT( seen, estimate * 2 );
+   }
+} FC_LOG_AND_RETHROW() }
+
 /// a contrived example to test the breaking out of application_impl to a header file
 BOOST_AUTO_TEST_CASE(application_impl_breakout) {
 
@@ -11,6 +11,8 @@
 
 #include <graphene/db/simple_index.hpp>
 
+#include <graphene/protocol/signature_cache.hpp>
+
 #include <fc/crypto/digest.hpp>
 #include "../common/database_fixture.hpp"
 
@@ -1993,6 +1995,61 @@ BOOST_AUTO_TEST_CASE( irrelevant_signatures )
    PUSH_TX( db, trx );
 } FC_LOG_AND_RETHROW() }
 
+BOOST_AUTO_TEST_CASE( signature_cache_test )
+{ try {
+   ACTORS( (alice)(bob) );
+   fund( alice );
+
+   auto& cache = signature_cache::instance();
+   cache.clear();
+
+   transfer_operation to;
+   to.amount = asset( 1 );
+   to.from = alice_id;
+   to.to = bob_id;
+   trx.clear();
+   set_expiration( db, trx );
+   trx.operations.push_back( to );
+   sign( trx, alice_private_key );
+   sign( trx, bob_private_key );
+
+   const flat_set<public_key_type> expected{ alice_private_key.get_public_key(), bob_private_key.get_public_key() };
+   BOOST_CHECK( trx.get_signature_keys( db.get_chain_id() ) == expected );
+   BOOST_CHECK_EQUAL( cache.misses(), 2u );
+   BOOST_CHECK_EQUAL( cache.hits(), 0u );
+   BOOST_CHECK_EQUAL( cache.size(), 2u );
+
+   // a fresh copy of the transaction, as received again from a peer or in a block
+   const auto copy = fc::raw::unpack<precomputable_transaction>( fc::raw::pack( trx ) );
+   BOOST_CHECK( copy.get_signature_keys( db.get_chain_id() ) == expected );
+   BOOST_CHECK_EQUAL( cache.misses(), 2u );
+   BOOST_CHECK_EQUAL( cache.hits(), 2u );
+
+   // pushing it and applying it in a block does not recover the keys again
+   PUSH_TX( db, trx );
+   generate_block();
+   BOOST_CHECK_EQUAL( cache.misses(), 2u );
+
+   // other signatures of the same key are different entries
+   trx.clear_signatures();
+   set_expiration( db, trx );
+   sign( trx, alice_private_key );
+   BOOST_CHECK( trx.get_signature_keys( db.get_chain_id() ).count( alice_private_key.get_public_key() ) );
+   BOOST_CHECK_EQUAL( cache.misses(), 3u );
+
+   // when the cache is full the oldest entries are dropped, capacity 0 disables it
+   cache.set_capacity( 16 );
+   BOOST_CHECK_LE( cache.size(), 16u );
+   cache.set_capacity( 0 );
+   BOOST_CHECK_EQUAL( cache.size(), 0u );
+   const auto other_copy = fc::raw::unpack<signed_transaction>( fc::raw::pack( copy ) );
+   BOOST_CHECK( other_copy.get_signature_keys( db.get_chain_id() ) == expected );
+   BOOST_CHECK_EQUAL( cache.size(), 0u );
+
+   cache.set_capacity( signature_cache::default_capacity );
+   cache.clear();
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_CASE( self_approving_proposal )
 { try {
    ACTORS( (alice) );
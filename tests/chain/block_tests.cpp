@@ -109,6 +109,239 @@ BOOST_AUTO_TEST_CASE( block_database_test )
    }
 }
 
+BOOST_AUTO_TEST_CASE( mapped_block_database_test )
+{
+   try {
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+
+      // write a few blocks with streams, then continue in mapped mode on the same files
+      block_database bdb;
+      bdb.open( data_dir.path() );
+      clearable_block b;
+      for( uint32_t i = 0; i < 3; ++i )
+      {
+         if( i > 0 ) b.previous = b.id();
+         b.validator = validator_id_type(i+1);
+         b.clear();
+         bdb.store( b.id(), b );
+      }
+      bdb.close();
+
+      bdb.open( data_dir.path(), block_database::storage_mode::mapped );
+      FC_ASSERT( bdb.is_open() );
+      for( uint32_t i = 3; i < 6; ++i )
+      {
+         b.previous = b.id();
+         b.validator = validator_id_type(i+1);
+         b.clear();
+         bdb.store( b.id(), b );
+         FC_ASSERT( bdb.contains( b.id() ) );
+         FC_ASSERT( bdb.fetch_block_id( b.block_num() ) == b.id() );
+      }
+      for( uint32_t i = 1; i <= 6; ++i )
+      {
+         auto blk = bdb.fetch_by_number( i );
+         FC_ASSERT( blk.valid() );
+         FC_ASSERT( blk->validator == validator_id_type(i) );
+         FC_ASSERT( bdb.fetch_optional( blk->id() ).valid() );
+      }
+      FC_ASSERT( !bdb.fetch_by_number( 7 ).valid() );
+      FC_ASSERT( bdb.last_id().valid() && *bdb.last_id() == b.id() );
+
+      const auto range = bdb.read_range( 2, 10 );
+      FC_ASSERT( range.entries.size() == 5 );
+      FC_ASSERT( range.entries.back().block_id == b.id() );
+
+      bdb.remove( b.id() );
+      FC_ASSERT( !bdb.contains( b.id() ) );
+      FC_ASSERT( !bdb.fetch_optional( b.id() ).valid() );
+      bdb.close();
+      FC_ASSERT( !bdb.is_open() );
+
+      // preallocated space is cut off on close, so the files can be opened with streams again
+      bdb.open( data_dir.path() );
+      auto last = bdb.last();
+      FC_ASSERT( last.valid() && last->block_num() == 5 );
+      FC_ASSERT( last->validator == validator_id_type(5) );
+      bdb.close();
+
+      // after an unclean shutdown both files still hold zeroed preallocated space
+      const auto index_size = fc::file_size( data_dir.path() / "index" );
+      const auto blocks_size = fc::file_size( data_dir.path() / "blocks" );
+      fc::resize_file( data_dir.path() / "index", index_size + 1000 * sizeof(block_id_type) );
+      fc::resize_file( data_dir.path() / "blocks", blocks_size + 100000 );
+      bdb.open( data_dir.path(), block_database::storage_mode::mapped );
+      FC_ASSERT( bdb.last_id().valid() && block_header::num_from_id( *bdb.last_id() ) == 5 );
+      FC_ASSERT( bdb.total_block_size() <= blocks_size );
+      bdb.close();
+      FC_ASSERT( fc::file_size( data_dir.path() / "index" ) <= index_size );
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( compressed_block_database_test )
+{
+   try {
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+
+      // enough blocks to fill more than one compressed chunk
+      const uint32_t num_blocks = 3000;
+      block_database bdb;
+      bdb.open( data_dir.path(), block_database::storage_mode::compressed );
+      FC_ASSERT( bdb.is_open() );
+      clearable_block b;
+      std::vector<block_id_type> ids;
+      for( uint32_t i = 0; i < num_blocks; ++i )
+      {
+         if( i > 0 ) b.previous = b.id();
+         b.validator = validator_id_type(i % 10 + 1);
+         b.clear();
+         bdb.store( b.id(), b );
+         ids.push_back( b.id() );
+      }
+      FC_ASSERT( bdb.total_block_size() > compressed_block_file::default_chunk_size );
+      FC_ASSERT( fc::exists( data_dir.path() / "dictionary" ) );
+
+      auto check_blocks = [&]() {
+         for( uint32_t i = 1; i <= num_blocks; i += 7 )
+         {
+            auto blk = bdb.fetch_by_number( i );
+            FC_ASSERT( blk.valid() );
+            FC_ASSERT( blk->id() == ids[i-1] );
+            FC_ASSERT( bdb.contains( ids[i-1] ) );
+            FC_ASSERT( bdb.fetch_optional( ids[i-1] ).valid() );
+         }
+         const auto range = bdb.read_range( 1, num_blocks );
+         FC_ASSERT( range.entries.size() == num_blocks );
+         FC_ASSERT( range.entries.back().block_id == ids.back() );
+      };
+      check_blocks();
+
+      bdb.close();
+      bdb.open( data_dir.path(), block_database::storage_mode::compressed );
+      check_blocks();
+      auto last = bdb.last();
+      FC_ASSERT( last.valid() && last->id() == ids.back() );
+
+      // new blocks keep going to the tail after reopening
+      b.previous = b.id();
+      b.validator = validator_id_type(1);
+      b.clear();
+      bdb.store( b.id(), b );
+      FC_ASSERT( bdb.fetch_optional( b.id() ).valid() );
+      bdb.remove( b.id() );
+      FC_ASSERT( !bdb.contains( b.id() ) );
+      bdb.close();
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( block_database_read_range_test )
+{
+   try {
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+
+      // blocks 1 to 10 without block 6, and block 3 replaced by a fork block stored after all others
+      block_database bdb;
+      bdb.open( data_dir.path() );
+      clearable_block b;
+      std::vector<block_id_type> ids;
+      block_id_type before_3;
+      for( uint32_t i = 0; i < 10; ++i )
+      {
+         if( i > 0 ) b.previous = b.id();
+         if( i == 2 ) before_3 = b.previous;
+         b.validator = validator_id_type(i+1);
+         b.clear();
+         ids.push_back( b.id() );
+         if( i != 5 )
+            bdb.store( b.id(), b );
+      }
+      b.previous = before_3;
+      b.validator = validator_id_type(11);
+      b.clear();
+      bdb.store( b.id(), b );
+      ids[2] = b.id();
+      // read_range() reads through its own file handles
+      bdb.flush();
+
+      auto check_range = [&]( uint32_t first, uint32_t count, size_t expected ) {
+         const auto range = bdb.read_range( first, count );
+         FC_ASSERT( range.entries.size() == expected, "${n} blocks instead of ${e} from ${f}",
+                    ("n", range.entries.size())("e", expected)("f", first) );
+         for( const auto& entry : range.entries )
+         {
+            FC_ASSERT( entry.block_id == ids[entry.block_num - 1] );
+            FC_ASSERT( entry.offset + entry.size <= range.data.size() );
+            fc::datastream<const char*> ds( range.data.data() + entry.offset, entry.size );
+            signed_block block;
+            fc::raw::unpack( ds, block );
+            FC_ASSERT( block.id() == entry.block_id );
+         }
+      };
+      check_range( 1, 0, 0 );
+      check_range( 1, 3, 3 );
+      // stops at the gap
+      check_range( 1, 10, 5 );
+      check_range( 4, 10, 2 );
+      check_range( 6, 10, 0 );
+      check_range( 7, 10, 4 );
+      check_range( 9, 1, 1 );
+      // past the end of the index
+      check_range( 11, 5, 0 );
+      bdb.close();
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( block_database_format_mismatch_test )
+{
+   try {
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+
+      block_database bdb;
+      bdb.open( data_dir.path() );
+      clearable_block b;
+      for( uint32_t i = 0; i < 5; ++i )
+      {
+         if( i > 0 ) b.previous = b.id();
+         b.validator = validator_id_type(i+1);
+         b.clear();
+         bdb.store( b.id(), b );
+      }
+      bdb.close();
+      const auto index_size = fc::file_size( data_dir.path() / "index" );
+
+      // a raw database must not be opened as an empty compressed one, that would cut off the whole index
+      GRAPHENE_REQUIRE_THROW( bdb.open( data_dir.path(), block_database::storage_mode::compressed ), fc::exception );
+      FC_ASSERT( !compressed_block_file::exists( data_dir.path() ) );
+      FC_ASSERT( fc::file_size( data_dir.path() / "index" ) == index_size );
+      bdb.open( data_dir.path() );
+      FC_ASSERT( bdb.last_id().valid() && *bdb.last_id() == b.id() );
+      bdb.close();
+
+      // and the other way around
+      fc::temp_directory compressed_dir( graphene::utilities::temp_directory_path() );
+      bdb.open( compressed_dir.path(), block_database::storage_mode::compressed );
+      bdb.store( b.id(), b );
+      bdb.close();
+      GRAPHENE_REQUIRE_THROW( bdb.open( compressed_dir.path() ), fc::exception );
+      GRAPHENE_REQUIRE_THROW( bdb.open( compressed_dir.path(), block_database::storage_mode::mapped ), fc::exception );
+      bdb.open( compressed_dir.path(), block_database::storage_mode::compressed );
+      FC_ASSERT( bdb.last_id().valid() && *bdb.last_id() == b.id() );
+      bdb.close();
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
 BOOST_AUTO_TEST_CASE( generate_empty_blocks )
 {
    try {
@@ -168,6 +401,53 @@ BOOST_AUTO_TEST_CASE( generate_empty_blocks )
    }
 }
 
+BOOST_AUTO_TEST_CASE( snapshot_import_test )
+{
+   try {
+      fc::temp_directory dir1( graphene::utilities::temp_directory_path() );
+      fc::temp_directory dir2( graphene::utilities::temp_directory_path() );
+      auto init_account_priv_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("null_key")) );
+
+      database db1;
+      db1.open(dir1.path(), make_genesis, "TEST");
+      signed_block head;
+      for( uint32_t i = 0; i < 20; ++i )
+         head = db1.generate_block(db1.get_slot_time(1), db1.get_scheduled_producer(1), init_account_priv_key,
+                                   database::skip_nothing);
+      db1.flush();
+
+      // the second node starts from the state of the first one, without genesis and without its blocks
+      database db2;
+      db2.set_snapshot_import( dir1.path() / "object_database", head );
+      db2.open(dir2.path(), []() -> genesis_state_type {
+         BOOST_FAIL( "genesis must not be loaded when starting from a snapshot" );
+         return genesis_state_type();
+      }, "TEST");
+      BOOST_CHECK( db2.head_block_id() == head.id() );
+      BOOST_CHECK( db2.fetch_block_by_number( head.block_num() ).valid() );
+      BOOST_CHECK( !db2.fetch_block_by_number( head.block_num() - 1 ).valid() );
+
+      // and syncs on from there
+      for( uint32_t i = 0; i < 5; ++i )
+      {
+         head = db1.generate_block(db1.get_slot_time(1), db1.get_scheduled_producer(1), init_account_priv_key,
+                                   database::skip_nothing);
+         PUSH_BLOCK( db2, head );
+      }
+      BOOST_CHECK( db2.head_block_id() == db1.head_block_id() );
+      db2.close();
+
+      // once it has a state of its own the snapshot is not installed again
+      database db3;
+      db3.set_snapshot_import( dir1.path() / "object_database", head );
+      db3.open(dir2.path(), make_genesis, "TEST");
+      BOOST_CHECK( db3.head_block_id() == db1.head_block_id() );
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
 BOOST_AUTO_TEST_CASE( undo_block )
 {
    try {
@@ -707,6 +987,120 @@ BOOST_AUTO_TEST_CASE( duplicate_transactions )
    }
 }
 
+BOOST_AUTO_TEST_CASE( parallel_authority_check_test )
+{
+   try {
+      fc::temp_directory dir1( graphene::utilities::temp_directory_path() ),
+                         dir2( graphene::utilities::temp_directory_path() ),
+                         dir3( graphene::utilities::temp_directory_path() );
+      database db1, // produces the blocks
+               db2, // applies them one transaction after another
+               db3; // verifies their authorities in precompute_parallel()
+      db1.open(dir1.path(), make_genesis, "TEST");
+      db2.open(dir2.path(), make_genesis, "TEST");
+      db3.open(dir3.path(), make_genesis, "TEST");
+      db3.enable_parallel_authority_check( true );
+
+      auto init_account_priv_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("null_key")) );
+      const account_id_type init0 = db1.get_index_type<account_index>().indices().get<by_name>().find("init0")->get_id();
+
+      auto push_everywhere = [&]() {
+         auto b = db1.generate_block( db1.get_slot_time(1), db1.get_scheduled_producer(1), init_account_priv_key,
+                                      database::skip_nothing );
+         PUSH_BLOCK( db2, b );
+         db3.precompute_parallel( b ).wait();
+         PUSH_BLOCK( db3, b );
+         BOOST_CHECK( db2.head_block_id() == b.id() );
+         BOOST_CHECK( db3.head_block_id() == b.id() );
+      };
+      auto push = [&db1]( const operation& op, const fc::ecc::private_key& key, uint32_t skip = 0 ) {
+         signed_transaction trx;
+         set_expiration( db1, trx );
+         trx.operations.push_back( op );
+         trx.sign( key, db1.get_chain_id() );
+         PUSH_TX( db1, trx, skip );
+      };
+      auto update_memo = [&db1]( account_id_type account, const fc::ecc::private_key& key ) {
+         account_update_operation op;
+         op.account = account;
+         op.new_options = account(db1).options;
+         op.new_options->memo_key = key.get_public_key();
+         return op;
+      };
+
+      // independent accounts, all created by init0
+      const uint32_t num_accounts = 8;
+      std::vector<fc::ecc::private_key> keys;
+      std::vector<account_id_type> accounts;
+      for( uint32_t i = 0; i < num_accounts; ++i )
+      {
+         keys.push_back( fc::ecc::private_key::regenerate( fc::sha256::hash( "wave" + fc::to_string(i) ) ) );
+         accounts.push_back( account_id_type( db1.get_index_type<account_index>().get_next_id() ) );
+         account_create_operation op;
+         op.registrar = init0;
+         op.referrer = init0;
+         op.name = "wave" + fc::to_string(i);
+         op.owner = authority( 1, public_key_type( keys[i].get_public_key() ), 1 );
+         op.active = op.owner;
+         push( op, init_account_priv_key );
+      }
+      push_everywhere();
+
+      // the transaction after the key change of its account is only valid once the change is applied
+      const auto new_key = fc::ecc::private_key::regenerate( fc::sha256::hash( string("wave new") ) );
+      for( uint32_t i = 0; i < num_accounts; ++i )
+         push( update_memo( accounts[i], keys[i] ), keys[i] );
+      account_update_operation change_active;
+      change_active.account = accounts[0];
+      change_active.active = authority( 1, public_key_type( new_key.get_public_key() ), 1 );
+      push( change_active, keys[0] );
+      push( update_memo( accounts[0], new_key ), new_key );
+      // account 1 is now controlled by account 2
+      change_active.account = accounts[1];
+      change_active.active = authority( 1, accounts[2], 1 );
+      push( change_active, keys[1] );
+      push_everywhere();
+
+      // the authority of account 1 changes through account 2, which is not one of the accounts the second
+      // transaction requires
+      change_active.account = accounts[2];
+      change_active.active = authority( 1, public_key_type( new_key.get_public_key() ), 1 );
+      push( change_active, keys[2] );
+      push( update_memo( accounts[1], keys[3] ), new_key );
+      push_everywhere();
+
+      auto packed_state = []( const database& db ) {
+         std::vector< std::vector<char> > result;
+         db.inspect_indexes( [&result]( const graphene::db::index& idx ) {
+            idx.inspect_all_objects( [&result]( const graphene::db::object& o ) {
+               result.push_back( o.pack() );
+            });
+         });
+         return result;
+      };
+      BOOST_CHECK( packed_state( db2 ) == packed_state( db3 ) );
+      BOOST_CHECK( accounts[1](db3).options.memo_key == public_key_type( keys[3].get_public_key() ) );
+
+      // A block with a transaction signed by the keys account 3 had before an earlier transaction of the block
+      // replaced them. Its authorities are fine in the state precomputed against, but not when it is applied.
+      change_active.account = accounts[3];
+      change_active.owner = change_active.active;
+      push( change_active, keys[3] );
+      push( update_memo( accounts[3], keys[4] ), keys[3], database::skip_transaction_signatures );
+      auto b = db1.generate_block( db1.get_slot_time(1), db1.get_scheduled_producer(1), init_account_priv_key,
+                                   database::skip_transaction_signatures );
+      BOOST_CHECK_EQUAL( b.transactions.size(), 2u );
+      GRAPHENE_REQUIRE_THROW( PUSH_BLOCK( db2, b ), fc::exception );
+      db3.precompute_parallel( b ).wait();
+      GRAPHENE_REQUIRE_THROW( PUSH_BLOCK( db3, b ), fc::exception );
+      BOOST_CHECK( db2.head_block_id() == db3.head_block_id() );
+      BOOST_CHECK( packed_state( db2 ) == packed_state( db3 ) );
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
 BOOST_AUTO_TEST_CASE( tapos )
 {
    try {
@@ -1916,4 +2310,139 @@ BOOST_FIXTURE_TEST_CASE( block_size_test, database_fixture )
    }
 }
 
+BOOST_FIXTURE_TEST_CASE( mempool_limits, database_fixture )
+{
+   try
+   {
+      ACTORS((alice)(bob));
+      transfer(council_account, alice_id, asset(10000000));
+      transfer(council_account, bob_id, asset(10000000));
+      generate_block();
+
+      const auto block_interval = db.get_global_properties().parameters.block_interval;
+      auto make_xfer = [&]( account_id_type from, const fc::ecc::private_key& key, account_id_type to,
+                            share_type extra_fee ) -> signed_transaction
+      {
+         signed_transaction tx;
+         transfer_operation xfer_op;
+         xfer_op.from = from;
+         xfer_op.to = to;
+         xfer_op.amount = asset(1);
+         xfer_op.fee = db.current_fee_schedule().calculate_fee( xfer_op ) + asset( extra_fee );
+         tx.operations.push_back( xfer_op );
+         tx.set_expiration( db.head_block_time() + fc::seconds( 0x1000 * block_interval ) );
+         tx.set_reference_block( db.head_block_id() );
+         sign( tx, key );
+         return tx;
+      };
+
+      BOOST_TEST_MESSAGE( "Fill a pool that holds two transactions" );
+      const size_t tx_size = fc::raw::pack_size( make_xfer( alice_id, alice_private_key, bob_id, 0 ) );
+      db.set_mempool_limits( 2 * tx_size + tx_size / 2, 0 );
+      PUSH_TX( db, make_xfer( alice_id, alice_private_key, bob_id, 10 ) );
+      PUSH_TX( db, make_xfer( bob_id, bob_private_key, alice_id, 20 ) );
+      BOOST_CHECK_EQUAL( db.get_pending_transactions().size(), 2u );
+
+      BOOST_TEST_MESSAGE( "A transaction paying less than the pending ones is rejected" );
+      REQUIRE_EXCEPTION_WITH_TEXT( PUSH_TX( db, make_xfer( alice_id, alice_private_key, bob_id, 5 ) ),
+                                   "per kilobyte" );
+      BOOST_CHECK_EQUAL( db.get_pending_transactions().size(), 2u );
+
+      BOOST_TEST_MESSAGE( "A transaction paying more evicts the one paying the least" );
+      const auto top_xfer = make_xfer( bob_id, bob_private_key, alice_id, 30 );
+      PUSH_TX( db, top_xfer );
+      const auto& pool = db.get_pending_transactions();
+      BOOST_CHECK_EQUAL( pool.size(), 2u );
+      BOOST_CHECK_EQUAL( pool.evicted(), 1u );
+      for( const auto& pending : pool.indices() )
+         BOOST_CHECK( pending.fee_payer == bob_id );
+      BOOST_CHECK( pool.indices().get<mempool::by_id>().count( top_xfer.id() ) == 1 );
+
+      generate_block();
+      BOOST_CHECK( db.get_pending_transactions().empty() );
+
+      BOOST_TEST_MESSAGE( "Limit the transactions of each account" );
+      db.set_mempool_limits( 0, 2 );
+      PUSH_TX( db, make_xfer( alice_id, alice_private_key, bob_id, 1 ) );
+      PUSH_TX( db, make_xfer( alice_id, alice_private_key, bob_id, 2 ) );
+      REQUIRE_EXCEPTION_WITH_TEXT( PUSH_TX( db, make_xfer( alice_id, alice_private_key, bob_id, 3 ) ),
+                                   "pending transactions already" );
+      PUSH_TX( db, make_xfer( bob_id, bob_private_key, alice_id, 1 ) );
+      BOOST_CHECK_EQUAL( db.get_pending_transactions().size(), 3u );
+   }
+   catch( fc::exception& e )
+   {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( pending_transactions_signature_skip )
+{
+   try {
+      fc::temp_directory dir1( graphene::utilities::temp_directory_path() ),
+                         dir2( graphene::utilities::temp_directory_path() );
+      database db1, // holds the pending transactions
+               db2; // produces the blocks
+      db1.open(dir1.path(), make_genesis, "TEST");
+      db2.open(dir2.path(), make_genesis, "TEST");
+
+      auto init_account_priv_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("null_key")) );
+      const auto& accounts_by_name = db1.get_index_type<account_index>().indices().get<by_name>();
+      const account_id_type init1 = accounts_by_name.find("init1")->get_id();
+      const account_id_type init2 = accounts_by_name.find("init2")->get_id();
+      const auto block_interval = db1.get_global_properties().parameters.block_interval;
+
+      auto push_block_from_db2 = [&]( uint32_t slot ) {
+         auto b = db2.generate_block( db2.get_slot_time(slot), db2.get_scheduled_producer(slot),
+                                      init_account_priv_key, database::skip_nothing );
+         PUSH_BLOCK( db1, b );
+         BOOST_REQUIRE( db1.head_block_id() == b.id() );
+      };
+      auto update_memo = [&db1]( account_id_type account, const fc::ecc::private_key& key ) {
+         signed_transaction trx;
+         set_expiration( db1, trx );
+         account_update_operation op;
+         op.account = account;
+         op.new_options = account(db1).options;
+         op.new_options->memo_key = key.get_public_key();
+         trx.operations.push_back( op );
+         return trx;
+      };
+
+      BOOST_TEST_MESSAGE( "A block that leaves the authorities alone does not make them checked again" );
+      // unsigned, so it stays pending only if its signatures are not checked
+      PUSH_TX( db1, update_memo( init2, init_account_priv_key ), database::skip_transaction_signatures );
+      push_block_from_db2( 1 );
+      BOOST_CHECK_EQUAL( db1.get_pending_transactions().size(), 1u );
+      db1.clear_pending();
+
+      BOOST_TEST_MESSAGE( "Once an earlier pending transaction fails, the later ones are checked again" );
+      const auto new_key = fc::ecc::private_key::regenerate( fc::sha256::hash( string("pending new") ) );
+      signed_transaction change_active;
+      change_active.set_reference_block( db1.head_block_id() );
+      // expires before the next block but one
+      change_active.set_expiration( db1.head_block_time() + fc::seconds( block_interval ) );
+      account_update_operation op;
+      op.account = init1;
+      op.active = authority( 1, public_key_type( new_key.get_public_key() ), 1 );
+      change_active.operations.push_back( op );
+      change_active.sign( init_account_priv_key, db1.get_chain_id() );
+      PUSH_TX( db1, change_active );
+      // valid only as long as the key change is
+      signed_transaction memo = update_memo( init1, new_key );
+      memo.sign( new_key, db1.get_chain_id() );
+      PUSH_TX( db1, memo );
+      BOOST_CHECK_EQUAL( db1.get_pending_transactions().size(), 2u );
+
+      push_block_from_db2( 2 );
+      BOOST_CHECK( db1.get_pending_transactions().empty() );
+      BOOST_CHECK( init1(db1).active.key_auths.count( public_key_type( new_key.get_public_key() ) ) == 0 );
+      BOOST_CHECK( init1(db1).options.memo_key != public_key_type( new_key.get_public_key() ) );
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -2,6 +2,7 @@
 
 #include <graphene/app/database_api.hpp>
 #include <graphene/chain/hardfork.hpp>
+#include <graphene/chain/read_snapshot.hpp>
 
 #include <fc/crypto/digest.hpp>
 #include <fc/crypto/hex.hpp>
@@ -1595,6 +1596,74 @@ BOOST_AUTO_TEST_CASE( api_limit_get_order_book ){
    }
 }
 
+BOOST_AUTO_TEST_CASE( read_snapshot_test )
+{ try {
+   ACTORS( (alice)(bob) );
+   fund( alice );
+   const asset_id_type snap_id = create_user_asset( "SNAP" ).get_id();
+   issue_ua( bob_id, asset( 100000, snap_id ) );
+   generate_block();
+
+   graphene::app::database_api db_api( db, &( app.get_options() ) );
+
+   auto snapshot = db.read_snapshot();
+   BOOST_REQUIRE( snapshot );
+   BOOST_CHECK_EQUAL( snapshot->head_block_num, db.head_block_num() );
+   BOOST_CHECK( snapshot->head_block_id == db.head_block_id() );
+   BOOST_REQUIRE( snapshot->find( alice_id ) != nullptr );
+   BOOST_CHECK_EQUAL( snapshot->find( alice_id )->name, "alice" );
+   BOOST_CHECK( snapshot->get_orders( asset_id_type(), snap_id ).empty() );
+
+   const limit_order_id_type bid_id = create_sell_order( alice_id, asset( 1000 ), asset( 100, snap_id ) )->get_id();
+   create_sell_order( alice_id, asset( 1000 ), asset( 200, snap_id ) );
+   create_sell_order( bob_id, asset( 100, snap_id ), asset( 2000 ) );
+
+   // pending transactions are not in the snapshot
+   BOOST_CHECK( db.read_snapshot() == snapshot );
+   BOOST_CHECK( db_api.get_limit_orders( "SNAP", GRAPHENE_SYMBOL, 10 ).empty() );
+
+   generate_block();
+   auto next = db.read_snapshot();
+   BOOST_REQUIRE( next != snapshot );
+   BOOST_CHECK_EQUAL( next->head_block_num, db.head_block_num() );
+   BOOST_CHECK( snapshot->get_orders( asset_id_type(), snap_id ).empty() );
+   // unchanged objects are shared
+   BOOST_CHECK( next->find( bob_id ) == snapshot->find( bob_id ) );
+
+   // best price first, as in the live index
+   const auto& bids = next->get_orders( asset_id_type(), snap_id );
+   BOOST_REQUIRE_EQUAL( bids.size(), 2u );
+   BOOST_CHECK( bids[0]->get_id() == bid_id );
+   BOOST_CHECK_EQUAL( next->get_orders( snap_id, asset_id_type() ).size(), 1u );
+
+   const auto orders = db_api.get_limit_orders( "SNAP", GRAPHENE_SYMBOL, 10 );
+   BOOST_REQUIRE_EQUAL( orders.size(), 3u );
+   for( const auto& o : orders )
+      BOOST_CHECK( o.for_sale == o.get_id()(db).for_sale );
+
+   const auto book = db_api.get_order_book( GRAPHENE_SYMBOL, "SNAP", 10 );
+   BOOST_CHECK_EQUAL( book.bids.size(), 2u );
+   BOOST_CHECK_EQUAL( book.asks.size(), 1u );
+   BOOST_CHECK_EQUAL( book.bids[0].owner_name, "alice" );
+
+   const auto objects = db_api.get_objects( { bid_id, alice_id }, false );
+   BOOST_REQUIRE_EQUAL( objects.size(), 2u );
+   BOOST_CHECK_EQUAL( objects[1]["name"].as_string(), "alice" );
+
+   // cancelled orders leave the book with the block that cancels them
+   cancel_limit_order( bid_id(db) );
+   generate_block();
+   BOOST_CHECK_EQUAL( db.read_snapshot()->get_orders( asset_id_type(), snap_id ).size(), 1u );
+   BOOST_CHECK( db.read_snapshot()->find( bid_id ) == nullptr );
+   BOOST_CHECK( next->find( bid_id ) != nullptr );
+
+   // and come back when that block is popped
+   db.pop_block();
+   BOOST_CHECK_EQUAL( db.read_snapshot()->head_block_num, db.head_block_num() );
+   BOOST_CHECK_EQUAL( db.read_snapshot()->get_orders( asset_id_type(), snap_id ).size(), 2u );
+   BOOST_CHECK( db.read_snapshot()->find( bid_id ) != nullptr );
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_CASE( asset_in_collateral )
 { try {
    ACTORS( (dan)(nathan) );
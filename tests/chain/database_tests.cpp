@@ -3,6 +3,7 @@
 #include <graphene/chain/database.hpp>
 
 #include <graphene/chain/account_object.hpp>
+#include <graphene/chain/asset_object.hpp>
 #include <graphene/chain/proposal_object.hpp>
 
 #include <fc/crypto/digest.hpp>
@@ -114,6 +115,274 @@ BOOST_AUTO_TEST_CASE( merge_test )
    }
 }
 
+BOOST_AUTO_TEST_CASE( delta_undo_test )
+{ try {
+   ACTORS((alice));
+   const account_id_type alice_id = alice.get_id();
+   const public_key_type memo_key = alice.options.memo_key;
+   const uint16_t fee_percentage = alice.network_fee_percentage;
+   const public_key_type new_key = public_key_type( fc::ecc::private_key::generate().get_public_key() );
+   BOOST_REQUIRE( alice.undo_by_delta() );
+
+   {
+      auto ses = db._undo_db.start_undo_session();
+      db.modify( alice_id(db), [&]( account_object& a ){ a.options.memo_key = new_key; } );
+      db.modify( alice_id(db), [&]( account_object& a ){ a.network_fee_percentage = fee_percentage + 1; } );
+      BOOST_REQUIRE_EQUAL( 1u, db._undo_db.head().old_deltas.size() );
+      // the fields are compared only when the session is committed or merged
+      BOOST_CHECK( db._undo_db.head().old_deltas.find( alice_id )->second->first_values != nullptr );
+      BOOST_CHECK_EQUAL( 0u, db._undo_db.head().old_deltas.find( alice_id )->second->field_count );
+      BOOST_CHECK( db._undo_db.head().old_values.find( alice_id ) == db._undo_db.head().old_values.end() );
+      ses.undo();
+   }
+   BOOST_CHECK( alice_id(db).options.memo_key == memo_key );
+   BOOST_CHECK_EQUAL( alice_id(db).network_fee_percentage, fee_percentage );
+
+   // upd+upd merged into one session
+   {
+      auto outer = db._undo_db.start_undo_session();
+      db.modify( alice_id(db), [&]( account_object& a ){ a.options.memo_key = new_key; } );
+      {
+         auto inner = db._undo_db.start_undo_session();
+         db.modify( alice_id(db), [&]( account_object& a ){
+            a.options.memo_key = public_key_type();
+            a.network_fee_percentage = fee_percentage + 1;
+         } );
+         inner.merge();
+      }
+      outer.undo();
+   }
+   BOOST_CHECK( alice_id(db).options.memo_key == memo_key );
+   BOOST_CHECK_EQUAL( alice_id(db).network_fee_percentage, fee_percentage );
+
+   // upd+del merged into one session
+   {
+      auto outer = db._undo_db.start_undo_session();
+      db.modify( alice_id(db), [&]( account_object& a ){ a.options.memo_key = new_key; } );
+      {
+         auto inner = db._undo_db.start_undo_session();
+         db.modify( alice_id(db), [&]( account_object& a ){ a.network_fee_percentage = fee_percentage + 1; } );
+         db.remove( alice_id(db) );
+         inner.merge();
+      }
+      BOOST_CHECK( db.find( alice_id ) == nullptr );
+      outer.undo();
+   }
+   BOOST_REQUIRE( db.find( alice_id ) != nullptr );
+   BOOST_CHECK( alice_id(db).options.memo_key == memo_key );
+   BOOST_CHECK_EQUAL( alice_id(db).network_fee_percentage, fee_percentage );
+   BOOST_CHECK_EQUAL( alice_id(db).name, "alice" );
+
+   // a committed session keeps only the changed fields, and a modification after the commit is recorded too
+   generate_block();
+   BOOST_REQUIRE_EQUAL( 0u, db._undo_db.active_sessions() );
+   {
+      auto ses = db._undo_db.start_undo_session();
+      db.modify( alice_id(db), [&]( account_object& a ){ a.options.memo_key = new_key; } );
+      db.modify( alice_id(db), [&]( account_object& a ){ a.network_fee_percentage = fee_percentage + 1; } );
+      ses.commit();
+   }
+   const undo_delta* delta = db._undo_db.head().old_deltas.find( alice_id )->second;
+   BOOST_CHECK( delta->first_values == nullptr );
+   BOOST_CHECK_EQUAL( 2u, delta->field_count );
+   db.modify( alice_id(db), [&]( account_object& a ){ a.name = "alice2"; } );
+   BOOST_CHECK( delta->first_values != nullptr );
+   db._undo_db.pop_commit();
+   BOOST_CHECK( alice_id(db).options.memo_key == memo_key );
+   BOOST_CHECK_EQUAL( alice_id(db).network_fee_percentage, fee_percentage );
+   BOOST_CHECK_EQUAL( alice_id(db).name, "alice" );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( incremental_flush_test )
+{ try {
+   ACTORS((alice));
+   db.set_incremental_flush( true );
+   db.flush();
+
+   const auto& accounts = db.get_index_type<account_index>();
+   const auto& assets = db.get_index_type<asset_index>();
+   BOOST_CHECK( !accounts.is_dirty() );
+   BOOST_CHECK( !assets.is_dirty() );
+
+   const fc::path account_file = db.get_data_dir() / "object_database" / fc::to_string( account_object::space_id )
+                                                                       / fc::to_string( account_object::type_id );
+   const auto files = index_file_header::saved_shards( account_file );
+   BOOST_REQUIRE_EQUAL( 1u, files.size() );
+   auto shard = accounts.read_shard( files.front() );
+   BOOST_CHECK( shard->next_id == accounts.get_next_id() );
+
+   db.modify( alice, []( account_object& a ){ a.network_fee_percentage += 1; } );
+   BOOST_CHECK( accounts.is_dirty() );
+   BOOST_CHECK( !assets.is_dirty() );
+
+   // the unchanged index keeps its file, the changed one is written again
+   db.flush();
+   BOOST_CHECK( !accounts.is_dirty() );
+   BOOST_CHECK( fc::exists( account_file ) );
+   BOOST_CHECK( fc::exists( db.get_data_dir() / "object_database" / fc::to_string( asset_object::space_id )
+                                                                  / fc::to_string( asset_object::type_id ) ) );
+   BOOST_CHECK( !fc::exists( db.get_data_dir() / "object_database.tmp" ) );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( delta_undo_notify_test )
+{ try {
+   struct notifying_database : public database
+   {
+      using database::notify_changed_objects;
+   };
+   notifying_database db;
+
+   const account_id_type alice_id( 100 );
+   const account_id_type bob_id( 101 );
+   const account_id_type carol_id( 102 );
+   auto make_transfer = []( account_id_type from, account_id_type to ) {
+      transfer_operation op;
+      op.from = from;
+      op.to = to;
+      return op;
+   };
+   const auto& prop = db.create<proposal_object>( [&]( proposal_object& p ) {
+      p.proposed_transaction.operations.push_back( make_transfer( alice_id, bob_id ) );
+   });
+   BOOST_REQUIRE( prop.undo_by_delta() );
+
+   flat_set<account_id_type> impacted;
+   auto connection = db.changed_objects.connect( [&]( const vector<object_id_type>& ids,
+                                                      const flat_set<account_id_type>& accounts ) {
+      impacted = accounts;
+   });
+
+   // the accounts the proposal referred to before the change are impacted
+   db._undo_db.enable();
+   {
+      auto ses = db._undo_db.start_undo_session();
+      db.modify( prop, [&]( proposal_object& p ) {
+         p.proposed_transaction.operations.front() = make_transfer( carol_id, bob_id );
+      });
+      BOOST_REQUIRE_EQUAL( 1u, db._undo_db.head().old_deltas.size() );
+      db.notify_changed_objects();
+      BOOST_CHECK( impacted.count( alice_id ) == 1 );
+      BOOST_CHECK( impacted.count( bob_id ) == 1 );
+   }
+   BOOST_CHECK( prop.proposed_transaction.operations.front().get<transfer_operation>().from == alice_id );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( modify_constraint_violation_test )
+{ try {
+   ACTORS((alice)(bob));
+   const account_id_type bob_id = bob.get_id();
+   const public_key_type memo_key = bob.options.memo_key;
+   const public_key_type new_key = public_key_type( fc::ecc::private_key::generate().get_public_key() );
+   const auto& by_name = db.get_index_type<account_index>().indices().get<by_name>();
+
+   // the account gets its value from before back from undo and stays in place
+   {
+      auto ses = db._undo_db.start_undo_session();
+      GRAPHENE_REQUIRE_THROW( db.modify( bob_id(db), [&]( account_object& a ) {
+         a.options.memo_key = new_key;
+         a.name = "alice";
+      }), fc::exception );
+      BOOST_REQUIRE( db.find( bob_id ) != nullptr );
+      BOOST_CHECK_EQUAL( bob_id(db).name, "bob" );
+      BOOST_CHECK( bob_id(db).options.memo_key == memo_key );
+      BOOST_CHECK( by_name.find( "bob" ) != by_name.end() );
+      BOOST_CHECK( db._undo_db.head().removed.find( bob_id ) == db._undo_db.head().removed.end() );
+   }
+   BOOST_REQUIRE( db.find( bob_id ) != nullptr );
+   BOOST_CHECK_EQUAL( bob_id(db).name, "bob" );
+   BOOST_CHECK( bob_id(db).options.memo_key == memo_key );
+   BOOST_CHECK( by_name.find( "bob" ) != by_name.end() );
+   BOOST_CHECK( by_name.find( "alice" )->get_id() == alice.get_id() );
+
+   // the same for an object undo copies, the secondary index still finds it
+   const auto& balances = db.get_index_type< primary_index< account_balance_index > >()
+                            .get_secondary_index< balances_by_account_index >();
+   auto make_balance = [&]( asset_id_type asset ) -> const account_balance_object& {
+      return db.create<account_balance_object>( [&]( account_balance_object& b ) {
+         b.owner = bob_id;
+         b.asset_type = asset;
+         b.balance = 10;
+      });
+   };
+   make_balance( asset_id_type(1) );
+   const auto& balance = make_balance( asset_id_type(2) );
+   auto ses = db._undo_db.start_undo_session();
+   GRAPHENE_REQUIRE_THROW( db.modify( balance, []( account_balance_object& b ) {
+      b.asset_type = asset_id_type(1);
+   }), fc::exception );
+   BOOST_CHECK( db.find( balance.get_id() ) == &balance );
+   BOOST_CHECK( balance.asset_type == asset_id_type(2) );
+   BOOST_CHECK( balances.get_account_balance( bob_id, asset_id_type(2) ) == &balance );
+   // the index is not left waiting for the end of the failed modification
+   db.modify( balance, []( account_balance_object& b ) { b.balance = 20; } );
+   BOOST_CHECK_EQUAL( balance.balance.value, 20 );
+   ses.undo();
+   BOOST_CHECK_EQUAL( balance.balance.value, 10 );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( undo_id_map_test )
+{ try {
+   undo_id_map<uint64_t> map;
+   auto id_of = []( uint64_t i ) { return object_id_type( 1, 2, i ); };
+
+   // grows from 16 slots several times
+   const uint64_t count = 1000;
+   for( uint64_t i = 0; i < count; ++i )
+      BOOST_CHECK( map.emplace( id_of( i ), i ).second );
+   BOOST_CHECK( !map.emplace( id_of( 7 ), 0 ).second );
+   BOOST_REQUIRE_EQUAL( count, map.size() );
+   for( uint64_t i = 0; i < count; ++i )
+   {
+      auto itr = map.find( id_of( i ) );
+      BOOST_REQUIRE( itr != map.end() );
+      BOOST_CHECK_EQUAL( i, itr->second );
+   }
+   BOOST_CHECK( map.find( id_of( count ) ) == map.end() );
+
+   // erasing shifts the following entries back, they must all stay reachable
+   for( uint64_t i = 0; i < count; i += 3 )
+      BOOST_CHECK_EQUAL( 1u, map.erase( id_of( i ) ) );
+   BOOST_CHECK_EQUAL( 0u, map.erase( id_of( 0 ) ) );
+   BOOST_CHECK_EQUAL( count - ( count + 2 ) / 3, map.size() );
+   for( uint64_t i = 0; i < count; ++i )
+   {
+      auto itr = map.find( id_of( i ) );
+      if( i % 3 == 0 )
+         BOOST_CHECK( itr == map.end() );
+      else
+      {
+         BOOST_REQUIRE( itr != map.end() );
+         BOOST_CHECK_EQUAL( i, itr->second );
+      }
+   }
+
+   // iteration sees every entry once
+   uint64_t seen = 0;
+   uint64_t sum = 0;
+   for( const auto& item : map )
+   {
+      BOOST_CHECK_EQUAL( item.first.instance(), item.second );
+      ++seen;
+      sum += item.second;
+   }
+   BOOST_CHECK_EQUAL( map.size(), seen );
+   uint64_t expected_sum = 0;
+   for( uint64_t i = 0; i < count; ++i )
+      if( i % 3 != 0 )
+         expected_sum += i;
+   BOOST_CHECK_EQUAL( expected_sum, sum );
+
+   // the erased ids can come back, and the map is usable again after clear()
+   map[ id_of( 3 ) ] = 33;
+   BOOST_CHECK_EQUAL( 33u, map.find( id_of( 3 ) )->second );
+   map.clear();
+   BOOST_CHECK( map.empty() );
+   BOOST_CHECK( map.find( id_of( 1 ) ) == map.end() );
+   map[ id_of( 1 ) ] = 1;
+   BOOST_CHECK_EQUAL( 1u, map.size() );
+   BOOST_CHECK_EQUAL( 1u, map.count( id_of( 1 ) ) );
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_CASE( direct_index_test )
 { try {
    try {
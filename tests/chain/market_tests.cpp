@@ -833,4 +833,180 @@ BOOST_AUTO_TEST_CASE(mcr_decrease)
 
 } FC_LOG_AND_RETHROW() }
 
+/***
+ * The order books of limit_order_book_index list the orders of by_price
+ */
+BOOST_AUTO_TEST_CASE(limit_order_book_index_test)
+{ try {
+
+   ACTORS((seller)(buyer));
+
+   const auto& test = create_user_asset( "UATEST" );
+   const asset_id_type test_id = test.get_id();
+   const asset_id_type core_id;
+   transfer( council_account, seller_id, asset(1000000) );
+   issue_ua( buyer_id, asset(1000000, test_id) );
+
+   const auto& price_idx = db.get_index_type<limit_order_index>().indices().get<by_price>();
+   auto check_side = [&]( asset_id_type sell, asset_id_type receive ) {
+      vector<limit_order_id_type> expected;
+      auto itr = price_idx.lower_bound( price::max( sell, receive ) );
+      auto end = price_idx.upper_bound( price::min( sell, receive ) );
+      for( ; itr != end; ++itr )
+         expected.push_back( itr->get_id() );
+      vector<limit_order_id_type> actual;
+      db.get_limit_order_book().for_each_order( sell, receive, [&actual]( const limit_order_object& o ) {
+         actual.push_back( o.get_id() );
+         return true;
+      });
+      BOOST_CHECK( actual == expected );
+      const limit_order_object* best = db.get_limit_order_book().best( sell, receive );
+      BOOST_CHECK( expected.empty() ? best == nullptr : best != nullptr && best->id == expected.front() );
+   };
+   auto check_books = [&]() {
+      check_side( core_id, test_id );
+      check_side( test_id, core_id );
+   };
+
+   // 100/200 and 50/100 are the same price level
+   limit_order_id_type ask1 = create_sell_order( seller_id, asset(100), asset(200, test_id) )->get_id();
+   limit_order_id_type ask2 = create_sell_order( seller_id, asset(100), asset(300, test_id) )->get_id();
+   limit_order_id_type ask3 = create_sell_order( seller_id, asset(50), asset(100, test_id) )->get_id();
+   create_sell_order( seller_id, asset(10), asset(25, test_id) );
+   create_sell_order( buyer_id, asset(100, test_id), asset(100) );
+   create_sell_order( buyer_id, asset(100, test_id), asset(200) );
+   check_books();
+   BOOST_CHECK( db.get_limit_order_book().best( core_id, test_id )->id == ask1 );
+
+   cancel_limit_order( ask2(db) );
+   check_books();
+   generate_block();
+
+   // fills the oldest order of the best level, the other one of the level is next
+   BOOST_CHECK( create_sell_order( buyer_id, asset(200, test_id), asset(100) ) == nullptr );
+   BOOST_CHECK( !db.find( ask1 ) );
+   BOOST_CHECK( db.get_limit_order_book().best( core_id, test_id )->id == ask3 );
+   check_books();
+
+   generate_block();
+   db.pop_block();
+   check_books();
+
+} FC_LOG_AND_RETHROW() }
+
+/***
+ * Collateralization keys of call orders compare like their collateralization prices
+ */
+BOOST_AUTO_TEST_CASE(collateralization_key_test)
+{ try {
+
+   const asset_id_type core_id;
+   const asset_id_type usd_id( 1 );
+   const int64_t max = GRAPHENE_MAX_SHARE_SUPPLY;
+   // ratios that only differ beyond the fixed point precision, equal ratios and no debt
+   const vector< std::pair<int64_t,int64_t> > amounts = {
+      { 1, 1 }, { 2, 2 }, { max, max - 1 }, { max - 1, max - 2 }, { max, 1 }, { 1, max }, { 15000, 1000 },
+      { 15500, 1000 }, { 31, 2 }, { 3, 0 }, { 0, 3 }
+   };
+   vector<call_order_object> orders;
+   for( const auto& a : amounts )
+   {
+      call_order_object order;
+      order.collateral = a.first;
+      order.debt = a.second;
+      order.call_price = price( asset( 1, core_id ), asset( 1, usd_id ) );
+      orders.push_back( order );
+   }
+
+   const collateralization_less less;
+   for( const auto& a : orders )
+   {
+      for( const auto& b : orders )
+      {
+         BOOST_CHECK_EQUAL( less( a.get_collateralization_key(), b.get_collateralization_key() ),
+                            a.collateralization() < b.collateralization() );
+         BOOST_CHECK_EQUAL( less( a.get_collateralization_key(), b.collateralization() ),
+                            a.collateralization() < b.collateralization() );
+         BOOST_CHECK_EQUAL( less( a.collateralization(), b.get_collateralization_key() ),
+                            a.collateralization() < b.collateralization() );
+      }
+      // keys of other markets compare by asset first
+      BOOST_CHECK( less( a.get_collateralization_key(), price::min( usd_id, core_id ) ) );
+      BOOST_CHECK( less( price( asset( max, core_id ), asset( 1, core_id ) ), a.get_collateralization_key() ) );
+   }
+
+   // the key follows changes of the collateral
+   call_order_object& changed = orders.front();
+   const auto before = changed.get_collateralization_key().ratio;
+   changed.collateral = 3;
+   BOOST_CHECK( changed.get_collateralization_key().ratio > before );
+
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(call_order_trigger_index_test)
+{ try {
+
+   ACTORS((buyer)(seller)(borrower)(borrower2)(borrower3)(feedproducer));
+
+   const auto& bitusd = create_backed_asset("USDBIT", feedproducer_id);
+   const asset_id_type usd_id = bitusd.get_id();
+   const asset_id_type core_id;
+
+   transfer(council_account, borrower_id, asset(1000000));
+   transfer(council_account, borrower2_id, asset(1000000));
+   transfer(council_account, borrower3_id, asset(1000000));
+   update_feed_producers( bitusd, {feedproducer_id} );
+
+   price_feed current_feed;
+   current_feed.maintenance_collateral_ratio = 1750;
+   current_feed.maximum_short_squeeze_ratio = 1100;
+   current_feed.settlement_price = bitusd.amount( 1 ) / asset( 5 );
+   publish_feed( bitusd, feedproducer, current_feed );
+
+   // the tracked order is always the first one of by_collateral
+   auto check = [&]() -> const call_order_object* {
+      const auto& by_collateral_idx = db.get_index_type<call_order_index>().indices().get<by_collateral>();
+      auto itr = by_collateral_idx.lower_bound( price::min( core_id, usd_id ) );
+      const call_order_object* expected = ( itr != by_collateral_idx.end() && itr->debt_type() == usd_id )
+                                          ? &*itr : nullptr;
+      const call_order_object* least = db.get_call_order_triggers().least_collateralized( core_id, usd_id );
+      BOOST_CHECK( least == expected );
+      return least;
+   };
+
+   BOOST_CHECK( check() == nullptr );
+   const call_order_id_type call_id = borrow( borrower, bitusd.amount(1000), asset(16000) )->get_id();
+   BOOST_CHECK( check()->get_id() == call_id );
+   // a less collateralized order takes its place
+   const call_order_id_type call2_id = borrow( borrower2, bitusd.amount(1000), asset(15000) )->get_id();
+   BOOST_CHECK( check()->get_id() == call2_id );
+   // an order with more collateral does not
+   borrow( borrower3, bitusd.amount(1000), asset(17000) );
+   BOOST_CHECK( check()->get_id() == call2_id );
+   // the tracked order moving back is looked up again
+   borrow( borrower2, bitusd.amount(0), asset(1500) );
+   BOOST_CHECK( check()->get_id() == call_id );
+   // an order moving forward takes the place again
+   borrow( borrower3, bitusd.amount(1000), asset(0) );
+   BOOST_CHECK( check()->get_id() != call_id );
+
+   // undoing changes restores the tracked order
+   {
+      auto session = db._undo_db.start_undo_session();
+      cover( borrower3_id(db), bitusd.amount(2000), asset(17000) );
+      BOOST_CHECK( check()->get_id() == call_id );
+   }
+   BOOST_CHECK( check()->get_id() != call_id );
+
+   // margin calls remove orders from the front
+   transfer( borrower, seller, bitusd.amount(1000) );
+   transfer( borrower2, seller, bitusd.amount(1000) );
+   transfer( borrower3, seller, bitusd.amount(2000) );
+   create_sell_order( seller, bitusd.amount(4000), asset(28000) );
+   current_feed.settlement_price = bitusd.amount( 1 ) / asset( 7 );
+   publish_feed( bitusd, feedproducer, current_feed );
+   BOOST_CHECK( check()->get_id() == call_id );
+
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_SUITE_END()
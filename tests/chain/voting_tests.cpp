@@ -3,6 +3,7 @@
 #include <graphene/app/database_api.hpp>
 #include <graphene/chain/exceptions.hpp>
 #include <graphene/chain/hardfork.hpp>
+#include <graphene/chain/vote_tally_tracker.hpp>
 
 #include <iostream>
 
@@ -551,4 +552,146 @@ BOOST_AUTO_TEST_CASE(last_voting_date_proxy)
    } FC_LOG_AND_RETHROW()
 }
 
+BOOST_AUTO_TEST_CASE(incremental_vote_tally)
+{
+   try
+   {
+      // every maintenance interval compares the running totals with a full recount
+      db.enable_incremental_vote_tally( true, true );
+      const vote_tally_tracker& tracker = db.get_vote_tally_tracker();
+
+      ACTORS((alice)(bob)(proxy));
+      transfer(council_account, alice_id, asset(100));
+      transfer(council_account, bob_id, asset(200));
+      transfer(council_account, proxy_id, asset(300));
+
+      const vote_id_type validator1 = validator_id_type(1)(db).vote_id;
+      const vote_id_type validator2 = validator_id_type(2)(db).vote_id;
+      auto update_options = [this]( account_id_type account, const fc::ecc::private_key& key,
+                                    std::function<void(account_options&)> change ) {
+         graphene::chain::account_update_operation op;
+         op.account = account;
+         op.new_options = account(db).options;
+         change( *op.new_options );
+         trx.operations.push_back(op);
+         sign(trx, key);
+         set_expiration( db, trx );
+         PUSH_TX( db, trx, ~0 );
+         trx.clear();
+      };
+
+      // the first maintenance interval recounts fully
+      generate_blocks(db.get_dynamic_global_properties().next_maintenance_time);
+      BOOST_CHECK_EQUAL( tracker.checks(), 0u );
+
+      // votes, proxies and balances change
+      update_options( alice_id, alice_private_key, [&]( account_options& o ) { o.votes.insert( validator1 ); } );
+      update_options( bob_id, bob_private_key, [&]( account_options& o ) { o.voting_account = proxy_id; } );
+      update_options( proxy_id, proxy_private_key, [&]( account_options& o ) { o.votes.insert( validator2 ); } );
+      transfer(proxy_id, alice_id, asset(50));
+      generate_blocks(db.get_dynamic_global_properties().next_maintenance_time);
+      BOOST_CHECK_EQUAL( tracker.checks(), 1u );
+      BOOST_CHECK_EQUAL( validator_id_type(1)(db).total_votes, 150u );
+      BOOST_CHECK_EQUAL( validator_id_type(2)(db).total_votes, 450u );
+
+      // the proxy changes its opinion, alice moves her stake and bob votes for himself again
+      update_options( proxy_id, proxy_private_key, [&]( account_options& o ) {
+         o.votes.erase( validator2 );
+         o.votes.insert( validator1 );
+      });
+      update_options( bob_id, bob_private_key, [&]( account_options& o ) {
+         o.voting_account = GRAPHENE_PROXY_TO_SELF_ACCOUNT;
+      });
+      transfer(alice_id, proxy_id, asset(150));
+      generate_blocks(db.get_dynamic_global_properties().next_maintenance_time);
+      BOOST_CHECK_EQUAL( tracker.checks(), 2u );
+      BOOST_CHECK_EQUAL( validator_id_type(1)(db).total_votes, 400u );
+      BOOST_CHECK_EQUAL( validator_id_type(2)(db).total_votes, 0u );
+
+      // the maintenance block leaves the chain, the next maintenance interval recounts fully
+      db.pop_block();
+      update_options( alice_id, alice_private_key, [&]( account_options& o ) { o.votes.clear(); } );
+      generate_blocks(db.get_dynamic_global_properties().next_maintenance_time);
+      BOOST_CHECK_EQUAL( tracker.checks(), 2u );
+      update_options( alice_id, alice_private_key, [&]( account_options& o ) { o.votes.insert( validator2 ); } );
+      generate_blocks(db.get_dynamic_global_properties().next_maintenance_time);
+      BOOST_CHECK_EQUAL( tracker.checks(), 3u );
+
+      BOOST_CHECK_EQUAL( tracker.failed_checks(), 0u );
+
+   } FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE(parallel_vote_tally)
+{
+   try
+   {
+      // shards of a few stakes, so that the accounts below are split between the worker threads
+      db.set_vote_tally_shard_size( 4 );
+
+      vector<vote_id_type> validator_votes;
+      vector<vote_id_type> delegate_votes;
+      for( const auto& wit : db.get_index_type<validator_index>().indices() )
+         validator_votes.push_back( wit.vote_id );
+      for( const auto& del : db.get_index_type<delegate_index>().indices() )
+         delegate_votes.push_back( del.vote_id );
+
+      // accounts voting for different validators and delegates, and for different numbers of them
+      const uint32_t num_accounts = 40;
+      for( uint32_t i = 0; i < num_accounts; ++i )
+      {
+         const string name = "tally" + fc::to_string(i);
+         const auto key = generate_private_key( name );
+         const account_id_type account = create_account( name, key ).get_id();
+         transfer( council_account, account, asset( 1000 + 100 * i ) );
+
+         graphene::chain::account_update_operation op;
+         op.account = account;
+         op.new_options = account(db).options;
+         for( size_t j = 0; j < validator_votes.size(); ++j )
+            if( ( i + j ) % 3 == 0 )
+               op.new_options->votes.insert( validator_votes[j] );
+         for( size_t j = 0; j < delegate_votes.size(); ++j )
+            if( ( i + j ) % 4 == 0 )
+               op.new_options->votes.insert( delegate_votes[j] );
+         uint16_t num_validators = 0;
+         uint16_t num_delegates = 0;
+         for( const vote_id_type& id : op.new_options->votes )
+            ++( id.type() == vote_id_type::validator ? num_validators : num_delegates );
+         op.new_options->num_producers = num_validators * ( i % 3 ) / 2;
+         op.new_options->num_delegates = num_delegates * ( i % 2 );
+         trx.operations.push_back( op );
+         sign( trx, key );
+         set_expiration( db, trx );
+         PUSH_TX( db, trx, ~0 );
+         trx.clear();
+      }
+
+      auto results = [this]() {
+         vector<uint64_t> result;
+         for( const auto& wit : db.get_index_type<validator_index>().indices() )
+            result.push_back( wit.total_votes );
+         for( const auto& del : db.get_index_type<delegate_index>().indices() )
+            result.push_back( del.total_votes );
+         // the number of producers and delegates follows from the histograms
+         const auto& gpo = db.get_global_properties();
+         result.push_back( gpo.block_producers.size() );
+         result.push_back( gpo.council_delegates.size() );
+         return result;
+      };
+
+      // the first maintenance interval also pays out the fees of the transfers
+      generate_blocks( db.get_dynamic_global_properties().next_maintenance_time );
+
+      db.enable_parallel_vote_tally( false );
+      generate_blocks( db.get_dynamic_global_properties().next_maintenance_time );
+      const auto serial = results();
+
+      db.enable_parallel_vote_tally( true );
+      generate_blocks( db.get_dynamic_global_properties().next_maintenance_time );
+      BOOST_CHECK( results() == serial );
+
+   } FC_LOG_AND_RETHROW()
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -247,6 +247,10 @@ std::shared_ptr<boost::program_options::variables_map> database_fixture_base::in
    {
       set_option( options, "api-limit-get-order-book", (uint32_t)80 );
    }
+   if(fixture.current_test_name =="read_snapshot_test")
+   {
+      set_option( options, "read-snapshots", true );
+   }
    if(fixture.current_test_name =="api_limit_lookup_accounts")
    {
       set_option( options, "api-limit-lookup-accounts", (uint32_t)200 );
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <boost/test/unit_test.hpp>
+
+#include <fc/log/logger.hpp>
+#include <fc/time.hpp>
+
+#include <algorithm>
+#include <string>
+
+namespace graphene { namespace chain { namespace test {
+
+   /**
+    * How long some repetitions of a benchmark step took, in the units the benchmarks report
+    */
+   struct benchmark_result
+   {
+      fc::microseconds elapsed;
+      uint64_t         count = 1;
+
+      int64_t  ms()const         { return elapsed.count() / 1000; }
+      int64_t  us()const         { return elapsed.count(); }
+      int64_t  us_each()const    { return elapsed.count() / int64_t( std::max<uint64_t>( count, 1 ) ); }
+      int64_t  ns_each()const    { return elapsed.count() * 1000 / int64_t( std::max<uint64_t>( count, 1 ) ); }
+      uint64_t per_second()const { return count * 1000000 / uint64_t( std::max<int64_t>( elapsed.count(), 1 ) ); }
+   };
+
+   /** Runs step with the numbers of count repetitions */
+   template<typename Step>
+   benchmark_result benchmark_repeat( uint64_t count, Step&& step )
+   {
+      const auto start = fc::time_point::now();
+      for( uint64_t i = 0; i < count; ++i )
+         step( i );
+      return benchmark_result{ fc::time_point::now() - start, count };
+   }
+
+   /** Runs step once */
+   template<typename Step>
+   benchmark_result benchmark_once( Step&& step )
+   {
+      const auto start = fc::time_point::now();
+      step();
+      return benchmark_result{ fc::time_point::now() - start, 1 };
+   }
+
+   inline std::string current_benchmark()
+   {
+      return boost::unit_test::framework::current_test_case().p_name;
+   }
+
+} } } // graphene::chain::test
+
+/// Logs a result of the running benchmark, FORMAT and the arguments are as for ilog
+#define BENCHMARK_REPORT( FORMAT, ... ) \
+   ilog( "${benchmark}: " FORMAT, ("benchmark", graphene::chain::test::current_benchmark()) __VA_ARGS__ )
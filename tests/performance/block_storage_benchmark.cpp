@@ -0,0 +1,102 @@
+#include <boost/test/unit_test.hpp>
+
+#include <graphene/chain/database.hpp>
+#include <graphene/chain/block_database.hpp>
+
+#include <graphene/utilities/tempdir.hpp>
+
+#include <fc/io/raw.hpp>
+
+#include "../common/database_fixture.hpp"
+#include "benchmark.hpp"
+
+#include <random>
+
+using namespace graphene::chain;
+using namespace graphene::chain::test;
+
+BOOST_FIXTURE_TEST_SUITE( performance_tests, database_fixture )
+
+BOOST_AUTO_TEST_CASE( block_storage_benchmark )
+{ try {
+   const uint32_t num_accounts = 200;
+   const uint32_t num_blocks = 1000;
+   const uint32_t random_reads = 20000;
+
+   std::vector<account_id_type> accounts;
+   for( uint32_t i = 0; i < num_accounts; ++i )
+   {
+      const auto& acct = create_account( "storage" + fc::to_string(i) );
+      accounts.push_back( acct.get_id() );
+      fund( acct, asset(1000000) );
+   }
+   generate_block();
+
+   transfer_operation op;
+   op.fee = db.current_fee_schedule().calculate_fee( op );
+   for( uint32_t b = 0; b < num_blocks; ++b )
+   {
+      for( uint32_t i = 0; i < num_accounts; ++i )
+      {
+         op.from = accounts[i];
+         op.to = accounts[( i + b + 1 ) % num_accounts];
+         op.amount = asset( 1 + ( i * b ) % 100 );
+         trx.clear();
+         set_expiration( db, trx );
+         trx.operations.push_back( op );
+         db.push_transaction( trx, ~0 );
+      }
+      generate_block();
+   }
+   trx.clear();
+
+   std::vector<signed_block> blocks;
+   for( uint32_t n = 1; n <= db.head_block_num(); ++n )
+      blocks.push_back( *db.fetch_block_by_number( n ) );
+
+   const std::vector< std::pair<std::string, block_database::storage_mode> > modes = {
+      { "stream", block_database::storage_mode::streams },
+      { "compressed", block_database::storage_mode::compressed }
+   };
+   for( const auto& mode : modes )
+   {
+      fc::temp_directory dir( graphene::utilities::temp_directory_path() );
+      block_database bdb;
+      bdb.open( dir.path(), mode.second );
+      for( const auto& block : blocks )
+         bdb.store( block.id(), block );
+      bdb.flush();
+      const uint64_t disk_size = block_database::disk_size( dir.path() );
+
+      // what a replay reads and unpacks
+      uint32_t replayed = 0;
+      auto replay = benchmark_once( [&]() {
+         for( uint32_t first = 1; first <= blocks.size(); first += 100 )
+         {
+            const auto range = bdb.read_range( first, 100 );
+            for( const auto& entry : range.entries )
+            {
+               fc::datastream<const char*> ds( range.data.data() + entry.offset, entry.size );
+               signed_block block;
+               fc::raw::unpack( ds, block );
+               ++replayed;
+            }
+         }
+      });
+      replay.count = replayed;
+      BOOST_CHECK_EQUAL( replayed, blocks.size() );
+
+      // what get_block does
+      std::mt19937 rng( 42 );
+      std::uniform_int_distribution<uint32_t> pick( 1, blocks.size() );
+      const auto fetch = benchmark_repeat( random_reads, [&]( uint64_t ) {
+         BOOST_CHECK( bdb.fetch_by_number( pick( rng ) ).valid() );
+      });
+      bdb.close();
+
+      BENCHMARK_REPORT( "${m} ${s} bytes on disk, replay read ${r} blocks/s, random fetch_by_number ${f}ns",
+                        ("m", mode.first)("s", disk_size)("r", replay.per_second())("f", fetch.ns_each()) );
+   }
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_SUITE_END()
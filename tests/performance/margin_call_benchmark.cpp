@@ -0,0 +1,93 @@
+#include <boost/test/unit_test.hpp>
+
+#include <graphene/chain/database.hpp>
+#include <graphene/chain/asset_object.hpp>
+#include <graphene/chain/market_object.hpp>
+
+#include "../common/database_fixture.hpp"
+#include "benchmark.hpp"
+
+using namespace graphene::chain;
+using namespace graphene::chain::test;
+
+BOOST_FIXTURE_TEST_SUITE( performance_tests, database_fixture )
+
+BOOST_AUTO_TEST_CASE( margin_call_benchmark )
+{ try {
+   const uint32_t num_positions = 100000;
+   const uint32_t feed_updates = 1000;
+   const uint32_t checks = 100000;
+
+   ACTORS( (seller)(borrower)(feedproducer) );
+
+   const auto& bitusd = create_backed_asset( "USDBIT", feedproducer_id );
+   const asset_id_type usd_id = bitusd.get_id();
+   const asset_id_type core_id;
+
+   transfer( council_account, borrower_id, asset( 1000000 ) );
+   update_feed_producers( bitusd, { feedproducer_id } );
+
+   price_feed feed;
+   feed.maintenance_collateral_ratio = 1750;
+   feed.maximum_short_squeeze_ratio = 1100;
+   feed.settlement_price = bitusd.amount( 1 ) / asset( 5 );
+   publish_feed( bitusd, feedproducer, feed );
+
+   // the position to be margin called, 300% collateral at the feed, called below 1 USD / 8.57 CORE
+   const call_order_id_type called_id = borrow( borrower, bitusd.amount( 1000 ), asset( 15000 ) )->get_id();
+   transfer( borrower, seller, bitusd.amount( 1000 ) );
+   create_sell_order( seller, bitusd.amount( 1000 ), asset( 10000 ) );
+
+   // positions of made up borrowers with 400% collateral and more, none of them gets called below
+   {
+      const auto result = benchmark_once( [&]() {
+         for( uint32_t i = 0; i < num_positions; ++i )
+         {
+            db.create<call_order_object>( [&]( call_order_object& call ) {
+               call.borrower = account_id_type( 1000000 + i );
+               call.collateral = 20000 + i;
+               call.debt = 1000;
+               call.call_price = price( asset( 1, core_id ), asset( 1, usd_id ) );
+            });
+         }
+         db.modify( bitusd.dynamic_asset_data_id(db), [&]( asset_dynamic_data_object& data ) {
+            data.current_supply += int64_t( num_positions ) * 1000;
+         });
+      });
+      BENCHMARK_REPORT( "created ${n} call orders in ${ms}ms", ("n",num_positions)("ms",result.ms()) );
+   }
+
+   auto check_calls = [&]() {
+      uint32_t called = 0;
+      const auto result = benchmark_repeat( checks, [&]( uint64_t ) {
+         called += db.check_call_orders( usd_id(db) );
+      });
+      BOOST_CHECK_EQUAL( called, 0u );
+      return result;
+   };
+
+   // feed updates that cannot margin call, only the least collateralized position is looked at
+   {
+      const auto result = benchmark_repeat( feed_updates, [&]( uint64_t i ) {
+         feed.settlement_price = bitusd.amount( 1 ) / asset( 5 + i % 2 );
+         publish_feed( bitusd, feedproducer, feed );
+      });
+      BENCHMARK_REPORT( "feed updates with ${n} call orders and no margin call, ${us}us per feed update",
+                        ("n",num_positions)("us",result.us_each()) );
+   }
+   BENCHMARK_REPORT( "check_call_orders() with no margin call, ${ns}ns per call", ("ns",check_calls().ns_each()) );
+
+   // the feed update that margin calls the position, the next least collateralized one is looked up again
+   {
+      feed.settlement_price = bitusd.amount( 1 ) / asset( 10 );
+      const auto result = benchmark_once( [&]() { publish_feed( bitusd, feedproducer, feed ); } );
+      BOOST_CHECK( db.find( called_id ) == nullptr );
+      BENCHMARK_REPORT( "feed update margin calling 1 of ${n} call orders, ${us}us",
+                        ("n",num_positions + 1)("us",result.us()) );
+   }
+   BENCHMARK_REPORT( "check_call_orders() with no margin call after it, ${ns}ns per call",
+                     ("ns",check_calls().ns_each()) );
+
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_SUITE_END()
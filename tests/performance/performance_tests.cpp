@@ -8,6 +8,8 @@
 
 #include <graphene/db/simple_index.hpp>
 
+#include <graphene/protocol/signature_cache.hpp>
+
 #include <fc/crypto/digest.hpp>
 
 #include "../common/database_fixture.hpp"
@@ -181,4 +183,81 @@ BOOST_AUTO_TEST_CASE( one_hundred_k_benchmark )
    db._undo_db.enable();
 } FC_LOG_AND_RETHROW() }
 
+BOOST_AUTO_TEST_CASE( parallel_authority_check_benchmark )
+{ try {
+   const uint32_t num_accounts = 2000;
+
+   // the transfers of one_hundred_k_benchmark, in one block and signed by their senders
+   std::vector<fc::ecc::private_key> keys;
+   std::vector<account_id_type> accounts;
+   keys.reserve( num_accounts );
+   accounts.reserve( num_accounts );
+   for( uint32_t i = 0; i < num_accounts; ++i )
+   {
+      keys.push_back( generate_private_key( "signer" + fc::to_string(i) ) );
+      const auto& acct = create_account( "signer" + fc::to_string(i), keys.back().get_public_key() );
+      accounts.push_back( acct.get_id() );
+      fund( acct, asset(1000000) );
+   }
+   generate_block();
+
+   transfer_operation op;
+   op.amount = asset( 100 );
+   op.fee = db.current_fee_schedule().calculate_fee( op );
+   for( uint32_t i = 0; i < num_accounts; ++i )
+   {
+      op.from = accounts[i];
+      op.to = accounts[( i + 1 ) % num_accounts];
+      trx.clear();
+      test::set_expiration( db, trx );
+      trx.operations.push_back( op );
+      trx.sign( keys[i], db.get_chain_id() );
+      PUSH_TX( db, trx, ~0 );
+   }
+   trx.clear();
+   const auto packed = fc::raw::pack( generate_block() );
+   db.pop_block();
+
+   fc::optional< std::vector< std::vector<char> > > serial_state;
+   for( const bool parallel : { false, true } )
+   {
+      // a fresh copy of the block and an empty cache, so that no signature recovered by an earlier run is reused
+      const auto block = fc::raw::unpack<signed_block>( packed );
+      signature_cache::instance().clear();
+      db.enable_parallel_authority_check( parallel );
+      auto session = db._undo_db.start_undo_session();
+      const auto start = fc::time_point::now();
+      db.precompute_parallel( block, database::skip_validator_signature ).wait();
+      const auto precomputed = fc::time_point::now();
+      db.apply_block( block, database::skip_validator_signature );
+      const auto applied = fc::time_point::now();
+      wlog( "Parallel authority check ${p}: precomputed ${n} signed transfers in ${c}ms, applied them in ${t}ms",
+            ("p",parallel)("n",num_accounts)("c",( precomputed - start ).count() / 1000)
+            ("t",( applied - precomputed ).count() / 1000) );
+
+      std::vector< std::vector<char> > state;
+      db.inspect_indexes( [&state]( const graphene::db::index& idx ) {
+         idx.inspect_all_objects( [&state]( const graphene::db::object& o ) { state.push_back( o.pack() ); } );
+      });
+      if( !serial_state.valid() )
+         serial_state = std::move( state );
+      else
+         BOOST_CHECK( *serial_state == state );
+      session.undo();
+   }
+   db.enable_parallel_authority_check( false );
+
+   // the block again, after the last run above has seen its transactions
+   {
+      const auto block = fc::raw::unpack<signed_block>( packed );
+      const auto hits = signature_cache::instance().hits();
+      const auto start = fc::time_point::now();
+      db.precompute_parallel( block ).wait();
+      const auto elapsed = fc::time_point::now() - start;
+      wlog( "Recovered the keys of ${n} known signed transfers in ${t}ms, ${h} cache hits",
+            ("n",num_accounts)("t",elapsed.count() / 1000)("h",signature_cache::instance().hits() - hits) );
+      BOOST_CHECK_EQUAL( signature_cache::instance().hits() - hits, num_accounts );
+   }
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,199 @@
+#include <boost/test/unit_test.hpp>
+
+#include <graphene/chain/database.hpp>
+#include <graphene/chain/account_object.hpp>
+
+#include <graphene/db/undo_database.hpp>
+
+#include "../common/database_fixture.hpp"
+#include "benchmark.hpp"
+
+#include <memory>
+#include <unordered_map>
+
+using namespace graphene::chain;
+using namespace graphene::chain::test;
+
+namespace {
+   /** Counts the allocations of the containers using it, so that only the undo layouts are measured */
+   template<typename T>
+   struct counting_allocator
+   {
+      using value_type = T;
+
+      explicit counting_allocator( uint64_t* c ):count(c){}
+      template<typename U>
+      counting_allocator( const counting_allocator<U>& other ):count(other.count){}
+
+      T* allocate( std::size_t n )
+      {
+         ++*count;
+         return std::allocator<T>().allocate( n );
+      }
+      void deallocate( T* p, std::size_t n ) { std::allocator<T>().deallocate( p, n ); }
+
+      template<typename U>
+      bool operator == ( const counting_allocator<U>& other )const { return count == other.count; }
+      template<typename U>
+      bool operator != ( const counting_allocator<U>& other )const { return count != other.count; }
+
+      uint64_t* count;
+   };
+
+   /** The undo_state layout before undo_arena was introduced, kept as the baseline to compare against */
+   struct legacy_undo_state
+   {
+      using value_type = std::pair< const object_id_type, std::unique_ptr<object> >;
+
+      explicit legacy_undo_state( uint64_t* allocations )
+      : old_values( 0, std::hash<object_id_type>(), std::equal_to<object_id_type>(),
+                    counting_allocator<value_type>( allocations ) ),
+        _allocations( allocations ) {}
+
+      void save( const object& obj )
+      {
+         if( old_values.find( obj.id ) != old_values.end() )
+            return;
+         old_values[obj.id] = obj.clone();
+         // the copy made by clone()
+         ++*_allocations;
+      }
+
+      std::unordered_map< object_id_type, std::unique_ptr<object>, std::hash<object_id_type>,
+                          std::equal_to<object_id_type>, counting_allocator<value_type> > old_values;
+
+   private:
+      uint64_t* _allocations;
+   };
+
+   /** The before-images of undo_state, with the allocations of the id map counted */
+   struct arena_undo_state
+   {
+      using value_type = std::pair< object_id_type, object* >;
+
+      arena_undo_state( undo_chunk_pool* pool, uint64_t* allocations )
+      : old_values( counting_allocator<value_type>( allocations ) ), arena( pool ) {}
+
+      void save( const object& obj )
+      {
+         if( old_values.find( obj.id ) == old_values.end() )
+            old_values[obj.id] = arena.clone( obj );
+      }
+
+      undo_id_map< object*, counting_allocator<value_type> > old_values;
+      undo_arena                                             arena;
+   };
+}
+
+BOOST_FIXTURE_TEST_SUITE( performance_tests, database_fixture )
+
+BOOST_AUTO_TEST_CASE( undo_state_benchmark )
+{ try {
+   const uint32_t num_accounts = 2000;
+   const uint32_t sessions = 2000;
+
+   std::vector<const object*> objects;
+   objects.reserve( num_accounts );
+   for( uint32_t i = 0; i < num_accounts; ++i )
+      objects.push_back( &create_account( "undo" + fc::to_string(i) ).statistics(db) );
+
+   {
+      uint64_t allocations = 0;
+      auto result = benchmark_repeat( sessions, [&]( uint64_t ) {
+         legacy_undo_state state( &allocations );
+         for( const object* obj : objects )
+            state.save( *obj );
+      });
+      result.count *= num_accounts;
+      BENCHMARK_REPORT( "legacy undo_state ${a} allocations/session, ${ns}ns per touched object",
+                        ("a",allocations / sessions)("ns",result.ns_each()) );
+   }
+
+   {
+      undo_chunk_pool pool;
+      uint64_t allocations = 0;
+      auto result = benchmark_repeat( sessions, [&]( uint64_t ) {
+         arena_undo_state state( &pool, &allocations );
+         for( const object* obj : objects )
+            state.save( *obj );
+      });
+      result.count *= num_accounts;
+      BENCHMARK_REPORT( "arena undo_state ${a} allocations/session, ${ns}ns per touched object, "
+                        "${c} chunks from heap",
+                        ("a",( allocations + pool.heap_allocations() ) / sessions)("ns",result.ns_each())
+                        ("c",pool.heap_allocations()) );
+   }
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( undo_block_apply_benchmark )
+{ try {
+   const uint32_t num_accounts = 1000;
+   const uint32_t blocks = 100;
+
+   std::vector<account_id_type> accounts;
+   accounts.reserve( num_accounts );
+   for( uint32_t i = 0; i < num_accounts; ++i )
+   {
+      const auto& acct = create_account( "apply" + fc::to_string(i) );
+      accounts.push_back( acct.get_id() );
+      fund( acct, asset(1000000) );
+   }
+   generate_block();
+
+   transfer_operation op;
+   op.amount = asset( 1 );
+   op.fee = db.current_fee_schedule().calculate_fee( op );
+
+   benchmark_result push{ fc::microseconds(), blocks };
+   benchmark_result generate{ fc::microseconds(), blocks };
+   benchmark_result legacy{ fc::microseconds(), blocks };
+   benchmark_result arena{ fc::microseconds(), blocks };
+   uint64_t total_touched = 0;
+   uint64_t legacy_allocs = 0;
+   uint64_t arena_allocs = 0;
+   undo_chunk_pool pool;
+   for( uint32_t b = 0; b < blocks; ++b )
+   {
+      push.elapsed += benchmark_repeat( num_accounts, [&]( uint64_t i ) {
+         op.from = accounts[i];
+         op.to = accounts[( i + b + 1 ) % num_accounts];
+         trx.clear();
+         set_expiration( db, trx );
+         trx.operations.push_back( op );
+         db.push_transaction( trx, ~0 );
+      }).elapsed;
+
+      // the baselines take before-images of the objects the pending transactions changed, in either layout
+      std::vector<const object*> touched;
+      const undo_state& pending = db._undo_db.head();
+      for( const auto& item : pending.old_values )
+         touched.push_back( &db.get_object( item.first ) );
+      for( const auto& item : pending.old_deltas )
+         touched.push_back( &db.get_object( item.first ) );
+      total_touched += touched.size();
+      legacy.elapsed += benchmark_once( [&]() {
+         legacy_undo_state state( &legacy_allocs );
+         for( const object* obj : touched )
+            state.save( *obj );
+      }).elapsed;
+      arena.elapsed += benchmark_once( [&]() {
+         arena_undo_state state( &pool, &arena_allocs );
+         for( const object* obj : touched )
+            state.save( *obj );
+      }).elapsed;
+
+      generate.elapsed += benchmark_once( [this]() { generate_block(); } ).elapsed;
+   }
+   trx.clear();
+
+   BENCHMARK_REPORT( "${n} transfers/block, push ${p}us/block, generate ${g}us/block, ${c} undo chunks from heap",
+                     ("n",num_accounts)("p",push.us_each())("g",generate.us_each())
+                     ("c",db._undo_db.chunk_pool().heap_allocations()) );
+   BENCHMARK_REPORT( "before-images of ${t} objects/block, legacy layout ${la} allocations ${lt}us, "
+                     "arena layout ${aa} allocations ${at}us",
+                     ("t",total_touched / blocks)
+                     ("la",legacy_allocs / blocks)("lt",legacy.us_each())
+                     ("aa",( arena_allocs + pool.heap_allocations() ) / blocks)("at",arena.us_each()) );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_SUITE_END()
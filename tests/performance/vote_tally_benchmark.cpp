@@ -0,0 +1,90 @@
+#include <boost/test/unit_test.hpp>
+
+#include <graphene/chain/database.hpp>
+#include <graphene/chain/account_object.hpp>
+#include <graphene/chain/delegate_object.hpp>
+#include <graphene/chain/validator_object.hpp>
+
+#include "../common/database_fixture.hpp"
+#include "benchmark.hpp"
+
+using namespace graphene::chain;
+using namespace graphene::chain::test;
+
+BOOST_FIXTURE_TEST_SUITE( performance_tests, database_fixture )
+
+BOOST_AUTO_TEST_CASE( vote_tally_benchmark )
+{ try {
+   const uint32_t num_accounts = 200000;
+
+   const fc::ecc::private_key voter_key = fc::ecc::private_key::generate();
+   const public_key_type voter_pub = voter_key.get_public_key();
+
+   // every account votes for all validators and delegates
+   flat_set<vote_id_type> votes;
+   for( const auto& wit : db.get_index_type<validator_index>().indices() )
+      votes.insert( wit.vote_id );
+   for( const auto& del : db.get_index_type<delegate_index>().indices() )
+      votes.insert( del.vote_id );
+
+   {
+      account_create_operation aco;
+      aco.registrar = council_account;
+      aco.owner = authority( 1, voter_pub, 1 );
+      aco.active = authority( 1, voter_pub, 1 );
+      aco.options.memo_key = voter_pub;
+      aco.options.voting_account = GRAPHENE_PROXY_TO_SELF_ACCOUNT;
+      aco.options.votes = votes;
+      aco.options.num_producers = 0;
+      aco.options.num_delegates = 0;
+      aco.fee = db.current_fee_schedule().calculate_fee( aco );
+
+      transfer_operation top;
+      top.from = council_account;
+      top.fee = asset( 10 );
+
+      const auto result = benchmark_repeat( num_accounts, [&]( uint64_t i ) {
+         trx.clear();
+         set_expiration( db, trx );
+         aco.name = "voter" + fc::to_string( i );
+         trx.operations.push_back( aco );
+         const auto created = db.apply_transaction( trx, ~0 );
+         top.to = created.operation_results[0].get<object_id_type>();
+         top.amount = asset( 1000 + i );
+         trx.operations = { top };
+         db.apply_transaction( trx, ~0 );
+      });
+      trx.clear();
+      BENCHMARK_REPORT( "created ${n} voting accounts in ${ms}ms", ("n",num_accounts)("ms",result.ms()) );
+   }
+
+   auto votes_of_validators = [this]() {
+      vector<uint64_t> result;
+      for( const auto& wit : db.get_index_type<validator_index>().indices() )
+         result.push_back( wit.total_votes );
+      return result;
+   };
+
+   // the first maintenance also pays out the fees of the transfers
+   generate_blocks( db.get_dynamic_global_properties().next_maintenance_time );
+
+   auto maintenance = [this]() {
+      return benchmark_once( [this]() {
+         generate_blocks( db.get_dynamic_global_properties().next_maintenance_time );
+      });
+   };
+
+   db.enable_parallel_vote_tally( false );
+   const auto serial = maintenance();
+   const auto serial_votes = votes_of_validators();
+
+   db.enable_parallel_vote_tally( true );
+   const auto parallel = maintenance();
+   BOOST_CHECK( votes_of_validators() == serial_votes );
+
+   BENCHMARK_REPORT( "chain maintenance with ${n} voting accounts, ${s}ms serial tally, ${p}ms parallel tally",
+                     ("n",num_accounts)("s",serial.ms())("p",parallel.ms()) );
+
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_SUITE_END()